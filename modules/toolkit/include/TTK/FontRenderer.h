@@ -16,6 +16,7 @@
 #include "GLM/glm.hpp"
 #include "glad/glad.h"
 #include "stb_truetype.h"
+#include "StreamingBuffer.h"
 
 namespace  TTK
 {
@@ -109,9 +110,12 @@ namespace  TTK
 	private:
 		FontRenderer();
 				
+		static const size_t MaxQuads = 256;
+
 		GLuint   m_ShaderHandle;
-		GLuint   m_VAO, m_VBO, m_EBO;
-		Vert     m_MeshData[256 * 4];
-		GLuint   m_IndexData[256 * 6];
+		// The indices never change, so only the vertices are streamed
+		GLuint   m_VAO, m_EBO;
+		StreamingBuffer* m_Stream;
+		Vert     m_MeshData[MaxQuads * 4];
 	};
 }
\ No newline at end of file
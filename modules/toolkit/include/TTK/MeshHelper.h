@@ -4,8 +4,8 @@
 // You may not use this header in your GDW games.
 //
 // This header contains a helper class for drawing the primitive types that
-// were originally supported by GLUT. This file was purposefully built to
-// be non-optimal
+// were originally supported by GLUT. Draws are queued as instances, and
+// each type of primitive is drawn with a single instanced draw call
 //
 // Based off of TTK by Michael Gharbharan 2017
 // Shawn Matthews 2019
@@ -13,6 +13,8 @@
 //////////////////////////////////////////////////////////////////////////
 #pragma once
 
+#include <mutex>
+#include <vector>
 #include "TTKContext.h"
 
 namespace TTK {
@@ -21,21 +23,48 @@ namespace TTK {
 		public:
 			~MeshHelper();
 			MeshHelper();
+
+			/*
+			 * Queues a primitive to be drawn on the next Flush. These can be called from any thread
+			 * @param transform The primitive's world transform, the view projection is applied when flushing
+			 * @param color The color to draw the primitive in
+			 */
 			void RenderTeapot(const glm::mat4& transform, const glm::vec4& color) const;
 			void RenderSphere(const glm::mat4& transform, const glm::vec4& color) const;
 			void RenderCube(const glm::mat4& transform, const glm::vec4& color) const;
+
+			/*
+			 * Draws everything that has been queued, with one instanced draw per type of primitive
+			 * @param viewProjection The view projection matrix to draw with
+			 * @returns The number of draw calls that were made
+			 */
+			size_t Flush(const glm::mat4& viewProjection);
 			
 		private:
+			struct Instance {
+				glm::mat4 Transform;
+				glm::vec4 Color;
+			};
+
 			struct mesh {
 				GLuint VAO;
 				GLuint VBO;
+				GLuint EBO;
+				GLsizei IndexCount;
+				// The instances queued since the last flush, guarded by m_Lock
+				mutable std::vector<Instance> Instances;
 			};
 			mesh __MakeMesh(const float* data, size_t size) const;
+			void __Queue(const mesh& target, const glm::mat4& transform, const glm::vec4& color) const;
+			bool __Flush(const mesh& target);
 			
 			mesh m_Teapot;
 			mesh m_Sphere;
 			mesh m_Cube;
 			GLuint m_Shader;
+			// The instance data for every mesh is streamed in to the same buffer
+			StreamingBuffer* m_Stream;
+			mutable std::mutex m_Lock;
 		};
 	}
 }
\ No newline at end of file
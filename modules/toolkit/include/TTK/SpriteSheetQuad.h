@@ -14,6 +14,8 @@
 
 #include <GLM/glm.hpp>
 #include "Texture2D.h"
+#include "StreamingBuffer.h"
+#include <memory>
 #include <vector>
 
 namespace TTK {
@@ -123,7 +125,9 @@ namespace TTK {
 		Texture2D m_Texture;
 		glm::vec4 m_Color;
 		QuadVert  m_Vertices[4];
-		uint32_t m_VAO, m_VBO, m_EBO, m_Shader;
+		uint32_t m_VAO, m_EBO, m_Shader;
+		// The vertices are re-written every draw, so every sprite streams them in to one shared buffer
+		std::shared_ptr<StreamingBuffer> m_Stream;
 
 		std::vector<SpriteCoordinates> m_SpriteCoordinates;
 
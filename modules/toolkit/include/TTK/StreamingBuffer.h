@@ -0,0 +1,110 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// This header contains a ring buffer for streaming data to the GPU
+// every frame, without waiting for the GPU to finish with the last
+// frame's data
+//
+//////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "glad/glad.h"
+
+namespace TTK
+{
+	/*
+	 * Counters for a StreamingBuffer, or for all of them (see StreamingBuffer::GetTotalStats)
+	 */
+	struct StreamingStats
+	{
+		size_t Bytes       = 0; // The number of bytes written
+		size_t Allocations = 0; // The number of times that space was allocated
+		size_t Wraps       = 0; // The number of times a region filled up and we moved to the next one
+		size_t Stalls      = 0; // The number of times we had to wait for the GPU to finish reading a region
+		double StallMs     = 0.0; // The total time spent waiting for the GPU, in milliseconds
+	};
+
+	/*
+	 * A buffer for data that is re-written every frame (debug geometry, text, sprites, instance data, etc...)
+	 *
+	 * The storage is mapped once with GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT, so writes go straight in to memory
+	 * that the GPU reads from, with no glBufferData or glBufferSubData calls. The buffer is split into RegionCount
+	 * regions, and space is handed out from the current region until it is full. We then put a fence after the draws
+	 * that read it, and move to the next region, only waiting if the GPU still hasn't finished with it. With 3 regions
+	 * the CPU can be writing one while the GPU reads the other two.
+	 *
+	 * Data must be drawn before the next allocation that could fill the region, which is the usual write then draw
+	 * pattern. Since the data moves around, draws use the offset that Allocate returns (ex as a first vertex or base
+	 * vertex), and VAOs can point their attributes at the start of the buffer
+	 */
+	class StreamingBuffer
+	{
+	public:
+		static const int RegionCount = 3;
+
+		/*
+		 * Creates a new streaming buffer
+		 * @param regionSize The size of each region in bytes, a single allocation can't be bigger than this
+		 */
+		StreamingBuffer(size_t regionSize);
+		~StreamingBuffer();
+
+		StreamingBuffer(const StreamingBuffer& other) = delete;
+		StreamingBuffer(StreamingBuffer&& other) = delete;
+		StreamingBuffer& operator=(const StreamingBuffer& other) = delete;
+		StreamingBuffer& operator=(StreamingBuffer&& other) = delete;
+
+		/*
+		 * Reserves space in the buffer, moving to the next region if the current one is full
+		 * @param size The number of bytes to reserve, at most GetRegionSize
+		 * @param alignment The offset will be a multiple of this, use the vertex size so that the offset is a whole number of vertices
+		 * @param offset Receives the offset of the space from the start of the buffer, in bytes
+		 * @returns A pointer to write the data to, or nullptr if the size is bigger than a region
+		 */
+		void* Allocate(size_t size, size_t alignment, size_t& offset);
+		/*
+		 * Copies data in to the buffer
+		 * @param data The data to copy
+		 * @param size The size of the data in bytes, at most GetRegionSize
+		 * @param alignment The offset will be a multiple of this, use the vertex size so that the offset is a whole number of vertices
+		 * @returns The offset of the data from the start of the buffer in bytes, or SIZE_MAX if it didn't fit
+		 */
+		size_t Write(const void* data, size_t size, size_t alignment);
+
+		/*
+		 * Gets the underlying OpenGL buffer handle
+		 */
+		GLuint GetHandle() const { return m_Handle; }
+		/*
+		 * Gets the size of a single region in bytes
+		 */
+		size_t GetRegionSize() const { return m_RegionSize; }
+
+		/*
+		 * Gets the counters for this buffer since it was created
+		 */
+		const StreamingStats& GetStats() const { return m_Stats; }
+		/*
+		 * Gets the counters for every streaming buffer since the program started
+		 */
+		static const StreamingStats& GetTotalStats() { return s_TotalStats; }
+
+	private:
+		GLuint   m_Handle;
+		uint8_t* m_Mapped;
+		size_t   m_RegionSize;
+		int      m_Region;
+		size_t   m_Cursor; // The offset of the next free byte, from the start of the buffer
+		GLsync   m_Fences[RegionCount];
+		StreamingStats m_Stats;
+
+		static StreamingStats s_TotalStats;
+
+		// Fences the current region and moves to the next one, waiting for the GPU to finish reading it if needed
+		void __NextRegion();
+	};
+}
@@ -14,13 +14,25 @@
 #pragma once
 
 #include <GLM/glm.hpp>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include "FontRenderer.h"
+#include "StreamingBuffer.h"
 
 namespace TTK
 {
 	namespace Impl {
 		class MeshHelper;
 	}
+
+	/*
+	 * Selects how debug primitives are drawn
+	 */
+	enum class DebugLayer {
+		DepthTested = 0, // Hidden behind the things in front of them
+		Overlay     = 1  // Drawn over everything, after the depth tested layer
+	};
 	
 	class Context {
 	public:
@@ -69,12 +81,32 @@ namespace TTK
 		void DrawSphere(const glm::mat4& mat, const glm::vec4& color = glm::vec4(1.0f)) const;
 		void DrawCube(const glm::mat4& mat, const glm::vec4& color = glm::vec4(1.0f)) const;
 
-		void AddLine(const glm::vec3& a, const glm::vec3& b, const glm::vec4& color = {0, 0, 0, 1});
-		void AddTri(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec4& color = { 0, 0, 0, 1 });
-		void AddQuad(const glm::vec3& min, const glm::vec3& max, const glm::vec4& color = { 0, 0, 0, 1 });
-		void AddPoint(const glm::vec3& pos, float size, const glm::vec4& color = { 0, 0, 0, 1 });
-		
+		/*
+		 * Adds primitives to be drawn on the next Flush. These can be called from any thread, each thread records in to
+		 * a list of it's own, and the lists are merged when flushing
+		 * @param layer Whether the primitive is depth tested, or drawn over everything
+		 * @param duration If more than 0, the primitive is drawn on every flush for this many seconds
+		 */
+		void AddLine(const glm::vec3& a, const glm::vec3& b, const glm::vec4& color = {0, 0, 0, 1}, DebugLayer layer = DebugLayer::DepthTested, float duration = 0.0f);
+		void AddTri(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec4& color = { 0, 0, 0, 1 }, DebugLayer layer = DebugLayer::DepthTested, float duration = 0.0f);
+		void AddQuad(const glm::vec3& min, const glm::vec3& max, const glm::vec4& color = { 0, 0, 0, 1 }, DebugLayer layer = DebugLayer::DepthTested, float duration = 0.0f);
+		void AddPoint(const glm::vec3& pos, float size, const glm::vec4& color = { 0, 0, 0, 1 }, DebugLayer layer = DebugLayer::DepthTested, float duration = 0.0f);
+
+		/*
+		 * Draws everything that was added since the last flush, along with any timed primitives that haven't expired,
+		 * with one draw call per type of primitive in each layer. Meshes (DrawCube, DrawSphere and DrawTeapot) are
+		 * drawn first, with one instanced draw per mesh. Must be called on the main thread, usually once per
+		 * frame (see TTK::Graphics::EndFrame)
+		 */
 		void Flush();
+		/*
+		 * Removes all the timed primitives, including ones that were added but not yet flushed
+		 */
+		void ClearTimed();
+		/*
+		 * Gets the number of draw calls made by the last flush
+		 */
+		size_t GetFlushDrawCalls() const { return m_FlushDrawCalls; }
 
 	private:
 		Context();
@@ -86,28 +118,57 @@ namespace TTK
 
 		GLuint m_ShaderHandle;
 		GLuint m_PointShaderHandle;
+		// Every batch is streamed in to the same buffer, and drawn from wherever it lands
+		StreamingBuffer*          m_Stream;
+
 		struct GLBuff {
-			GLuint VBO, VAO;
-			size_t Count;
+			GLuint VAO;
 			size_t ElemSize;
 			GLenum Mode;
-			void*  Data;
 			GLuint Shader;
 		};
 		GLBuff m_Tris, m_Lines, m_Points;
 
-		int m_WindowWidth, m_WindowHeight;
+		static const int LayerCount = 2;
 
-		GLBuff __InitBuff(GLenum mode, GLuint shader, void* dataSource, size_t elemSize, size_t maxElems);
-		void __Flush(GLBuff& buff);
-		GLuint __CompileShader(const char* vsSource, const char* fsSource);
+		// The vertices of one type of primitive, for each layer
+		template <typename T>
+		struct Batch {
+			// Drawn once, on the next flush
+			std::vector<T>      Verts[LayerCount];
+			// Drawn on every flush until they expire
+			std::vector<T>      TimedVerts[LayerCount];
+			// The time that each timed primitive expires, one per primitive rather than per vertex
+			std::vector<double> Expiry[LayerCount];
+		};
+
+		// The primitives that one thread has added since the last flush
+		struct DrawList {
+			std::mutex         Lock;
+			Batch<SimpleVert>  Tris;
+			Batch<SimpleVert>  Lines;
+			Batch<PointVert>   Points;
+		};
+
+		// One list for every thread that has drawn something, only the lists themselves are guarded by the lock
+		std::vector<std::unique_ptr<DrawList>> m_DrawLists;
+		std::mutex m_DrawListsLock;
+		// Identifies this context, so that threads know to make new lists if the context is re-created
+		uint32_t   m_Id;
 
-		static const size_t MaxPointVerts = 512;
-		static const size_t MaxLineVerts = 512 * 2;
-		static const size_t MaxTriVerts = 512 * 3;
+		// Everything merged from the draw lists, the timed verts are kept here between flushes
+		Batch<SimpleVert> m_TriBatch;
+		Batch<SimpleVert> m_LineBatch;
+		Batch<PointVert>  m_PointBatch;
+		size_t m_FlushDrawCalls;
 
-		PointVert  m_PointVerts[MaxPointVerts];
-		SimpleVert m_LineVerts[MaxLineVerts];
-		SimpleVert m_TriVerts[MaxTriVerts];
+		int m_WindowWidth, m_WindowHeight;
+
+		GLBuff __InitBuff(GLenum mode, GLuint shader, size_t elemSize);
+		void __BindStream();
+		DrawList& __GetDrawList();
+		template <typename T>
+		void __Flush(GLBuff& buff, Batch<T>& batch, int layer);
+		GLuint __CompileShader(const char* vsSource, const char* fsSource);
 	};
 }
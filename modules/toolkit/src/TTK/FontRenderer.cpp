@@ -199,6 +199,8 @@ TTK::FontRenderer::~FontRenderer()
 {
 	glDeleteShader(m_ShaderHandle);
 	glDeleteVertexArrays(1, &m_VAO);
+	glDeleteBuffers(1, &m_EBO);
+	delete m_Stream;
 }
 
 void TTK::FontRenderer::Render(const TrueTypeTextureFont& font, const char* text, const glm::vec2& pos, const glm::vec4& color, float scale)
@@ -257,15 +259,6 @@ void TTK::FontRenderer::Render(const TrueTypeTextureFont& font, const char* text
 			m_MeshData[quads * 4 + 3].UV = glyph.UVs[3];
 			m_MeshData[quads * 4 + 3].Color = gpuCol;
 
-
-			m_IndexData[quads * 6 + 0] = quads * 4 + 0;
-			m_IndexData[quads * 6 + 1] = quads * 4 + 1;
-			m_IndexData[quads * 6 + 2] = quads * 4 + 2;
-
-			m_IndexData[quads * 6 + 3] = quads * 4 + 0;
-			m_IndexData[quads * 6 + 4] = quads * 4 + 2;
-			m_IndexData[quads * 6 + 5] = quads * 4 + 3;
-
 			quads++;
 		}
 	}
@@ -285,9 +278,9 @@ void TTK::FontRenderer::Render(const TrueTypeTextureFont& font, const char* text
 	glProgramUniformMatrix4fv(m_ShaderHandle, 0, 1, false, &proj[0][0]);
 	glProgramUniformHandleui64ARB(m_ShaderHandle, 1, font.m_TexHandle);	
 	glBindVertexArray(m_VAO);
-	glNamedBufferSubData(m_VBO, 0, length * 4 * sizeof(Vert), m_MeshData);
-	glNamedBufferSubData(m_EBO, 0, length * 6 * sizeof(GLuint), m_IndexData);
-	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(length * 6), GL_UNSIGNED_INT, nullptr);
+	// The vertices land somewhere in the stream, the base vertex moves the indices to them
+	const size_t offset = m_Stream->Write(m_MeshData, length * 4 * sizeof(Vert), sizeof(Vert));
+	glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(length * 6), GL_UNSIGNED_INT, nullptr, static_cast<GLint>(offset / sizeof(Vert)));
 	glBindVertexArray(0);
 	LOG_ASSERT(glGetError() == GL_NONE, "Failed to draw our text mesh!");
 	if (!blendState) glDisable(GL_BLEND);
@@ -298,16 +291,28 @@ TTK::FontRenderer::FontRenderer() {
 	LOG_INFO("Initializing font renderer");
 
 	memset(m_MeshData, 0, sizeof(m_MeshData));
-	memset(m_IndexData, 0, sizeof(m_IndexData));
+
+	// Every quad uses the same pattern of indices, so we can fill them in once
+	GLuint indices[MaxQuads * 6];
+	for (GLuint quad = 0; quad < MaxQuads; quad++) {
+		indices[quad * 6 + 0] = quad * 4 + 0;
+		indices[quad * 6 + 1] = quad * 4 + 1;
+		indices[quad * 6 + 2] = quad * 4 + 2;
+
+		indices[quad * 6 + 3] = quad * 4 + 0;
+		indices[quad * 6 + 4] = quad * 4 + 2;
+		indices[quad * 6 + 5] = quad * 4 + 3;
+	}
+
+	// Room for a few full strings per region
+	m_Stream = new StreamingBuffer(MaxQuads * 4 * sizeof(Vert) * 8);
 
 	glCreateVertexArrays(1, &m_VAO);
 	glBindVertexArray(m_VAO);
-	GLuint buffers[2];
-	glCreateBuffers(2, buffers);
-	glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
-	glNamedBufferData(buffers[0], 256 * 4 * sizeof(Vert), m_MeshData, GL_DYNAMIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
-	glNamedBufferData(buffers[1], 256 * 6 * sizeof(GLuint), m_IndexData, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, m_Stream->GetHandle());
+	glCreateBuffers(1, &m_EBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+	glNamedBufferStorage(m_EBO, sizeof(indices), indices, 0);
 	glEnableVertexAttribArray(0);
 	glEnableVertexAttribArray(1);
 	glEnableVertexAttribArray(2);
@@ -321,9 +326,6 @@ TTK::FontRenderer::FontRenderer() {
 	
 	glBindVertexArray(0);
 
-	m_VBO = buffers[0];
-	m_EBO = buffers[1];
-
 	const char* vsSource = R"LIT(#version 430
             layout (location = 0) in vec2 vertexPosition;
             layout (location = 1) in vec4 vertexColor;
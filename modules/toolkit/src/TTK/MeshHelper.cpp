@@ -11,59 +11,144 @@
 //////////////////////////////////////////////////////////////////////////
 #include "TTK/MeshHelper.h"
 
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
 #include "TTK/Teapot.h"
 #include "TTK/Sphere.h"
 #include "TTK/Cube.h"
 #include "Logging.h"
 
+namespace {
+	// The vertex data is 3 floats of position, followed by 3 of normal
+	const size_t FloatsPerVertex = 6;
+
+	// Hashes a position by it's bits, so that only identical positions are welded together
+	struct PositionHash {
+		size_t operator()(const glm::vec3& value) const {
+			uint32_t bits[3];
+			memcpy(bits, &value, sizeof(bits));
+			return (static_cast<size_t>(bits[0]) * 73856093u) ^ (static_cast<size_t>(bits[1]) * 19349663u) ^ (static_cast<size_t>(bits[2]) * 83492791u);
+		}
+	};
+}
 
 TTK::Impl::MeshHelper::~MeshHelper() {
-	glDeleteBuffers(1, &m_Teapot.VBO);
-	glDeleteBuffers(1, &m_Sphere.VBO);
-	glDeleteBuffers(1, &m_Cube.VBO);
-	glDeleteVertexArrays(1, &m_Teapot.VAO);
-	glDeleteVertexArrays(1, &m_Sphere.VAO);
-	glDeleteVertexArrays(1, &m_Cube.VAO);
+	const mesh* meshes[] = { &m_Teapot, &m_Sphere, &m_Cube };
+	for (const mesh* target : meshes) {
+		glDeleteBuffers(1, &target->VBO);
+		glDeleteBuffers(1, &target->EBO);
+		glDeleteVertexArrays(1, &target->VAO);
+	}
 	glDeleteProgram(m_Shader);
+	delete m_Stream;
 }
 
 void TTK::Impl::MeshHelper::RenderTeapot(const glm::mat4& transform, const glm::vec4& color) const {
-	glUseProgram(m_Shader);
-	glm::mat4 t = Context::Instance().GetViewProjection() * transform;
-	glProgramUniformMatrix4fv(m_Shader, 0, 1, FALSE, &t[0][0]);
-	glProgramUniform4fv(m_Shader, 1, 1, &color[0]);
-	glBindVertexArray(m_Teapot.VAO);
-	glDrawArrays(GL_TRIANGLES, 0, sizeof(TeapotData) / (sizeof(float) * 6));
+	__Queue(m_Teapot, transform, color);
 }
 
 void TTK::Impl::MeshHelper::RenderSphere(const glm::mat4& transform, const glm::vec4& color) const {
-	glUseProgram(m_Shader);
-	glm::mat4 t = Context::Instance().GetViewProjection() * transform;
-	glProgramUniformMatrix4fv(m_Shader, 0, 1, FALSE, &t[0][0]);
-	glProgramUniform4fv(m_Shader, 1, 1, &color[0]);
-	glBindVertexArray(m_Sphere.VAO);
-	glDrawArrays(GL_TRIANGLES, 0, sizeof(SphereData) / (sizeof(float) * 6));
+	__Queue(m_Sphere, transform, color);
 }
 
 void TTK::Impl::MeshHelper::RenderCube(const glm::mat4& transform, const glm::vec4& color) const
 {
+	__Queue(m_Cube, transform, color);
+}
+
+size_t TTK::Impl::MeshHelper::Flush(const glm::mat4& viewProjection) {
+	std::lock_guard<std::mutex> lock(m_Lock);
+	if (m_Teapot.Instances.empty() && m_Sphere.Instances.empty() && m_Cube.Instances.empty()) {
+		return 0;
+	}
 	glUseProgram(m_Shader);
-	glm::mat4 t = Context::Instance().GetViewProjection() * transform;
-	glProgramUniformMatrix4fv(m_Shader, 0, 1, FALSE, &t[0][0]);
-	glProgramUniform4fv(m_Shader, 1, 1, &color[0]);
-	glBindVertexArray(m_Cube.VAO);
-	glDrawArrays(GL_TRIANGLES, 0, sizeof(CubeData) / (sizeof(float) * 6));
+	glProgramUniformMatrix4fv(m_Shader, 0, 1, GL_FALSE, &viewProjection[0][0]);
+
+	size_t draws = 0;
+	draws += __Flush(m_Teapot) ? 1 : 0;
+	draws += __Flush(m_Sphere) ? 1 : 0;
+	draws += __Flush(m_Cube) ? 1 : 0;
+	return draws;
+}
+
+void TTK::Impl::MeshHelper::__Queue(const mesh& target, const glm::mat4& transform, const glm::vec4& color) const {
+	std::lock_guard<std::mutex> lock(m_Lock);
+	target.Instances.push_back({ transform, color });
+}
+
+bool TTK::Impl::MeshHelper::__Flush(const mesh& target) {
+	if (target.Instances.empty()) {
+		return false;
+	}
+
+	const size_t size = target.Instances.size() * sizeof(Instance);
+	if (size + sizeof(Instance) > m_Stream->GetRegionSize()) {
+		// Draws that are still reading the old buffer keep it alive until the GPU is done with it
+		const size_t regionSize = std::max(m_Stream->GetRegionSize() * 2, size + sizeof(Instance));
+		LOG_INFO("Growing debug mesh instance stream from {} to {} bytes per region", m_Stream->GetRegionSize(), regionSize);
+		delete m_Stream;
+		m_Stream = new StreamingBuffer(regionSize);
+	}
+	const size_t offset = m_Stream->Write(target.Instances.data(), size, sizeof(Instance));
+	LOG_ASSERT(offset != SIZE_MAX, "Failed to write debug mesh instances!");
+
+	// Point the instance attributes at this frame's data, rather than picking a base instance
+	glVertexArrayVertexBuffer(target.VAO, 1, m_Stream->GetHandle(), static_cast<GLintptr>(offset), sizeof(Instance));
+	glBindVertexArray(target.VAO);
+	glDrawElementsInstanced(GL_TRIANGLES, target.IndexCount, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(target.Instances.size()));
+
+	// Keep the storage for the next frame
+	target.Instances.clear();
+	return true;
 }
 
 TTK::Impl::MeshHelper::mesh TTK::Impl::MeshHelper::__MakeMesh(const float* data, size_t size) const {
+	// The meshes are stored as a flat list of triangles, we only draw the positions so we weld any vertices that share
+	// one and draw them with an index buffer
+	const size_t vertexCount = size / (sizeof(float) * FloatsPerVertex);
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+	std::unordered_map<glm::vec3, uint32_t, PositionHash> lookup;
+	indices.reserve(vertexCount);
+	lookup.reserve(vertexCount);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		const float* vertex = data + ix * FloatsPerVertex;
+		// Adding zero turns -0 in to 0, so that they hash the same
+		const glm::vec3 position(vertex[0] + 0.0f, vertex[1] + 0.0f, vertex[2] + 0.0f);
+		auto it = lookup.find(position);
+		if (it == lookup.end()) {
+			it = lookup.emplace(position, static_cast<uint32_t>(positions.size())).first;
+			positions.push_back(position);
+		}
+		indices.push_back(it->second);
+	}
+	LOG_INFO("Welded debug mesh from {} vertices to {}", vertexCount, positions.size());
+
 	mesh result;
-	glCreateVertexArrays(1, &result.VAO);
-	glBindVertexArray(result.VAO);
+	result.IndexCount = static_cast<GLsizei>(indices.size());
 	glCreateBuffers(1, &result.VBO);
-	glBindBuffer(GL_ARRAY_BUFFER, result.VBO);
-	glNamedBufferData(result.VBO, size, data, GL_DYNAMIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(float) * 6, 0);
+	glNamedBufferStorage(result.VBO, positions.size() * sizeof(glm::vec3), positions.data(), 0);
+	glCreateBuffers(1, &result.EBO);
+	glNamedBufferStorage(result.EBO, indices.size() * sizeof(uint32_t), indices.data(), 0);
+
+	glCreateVertexArrays(1, &result.VAO);
+	glVertexArrayElementBuffer(result.VAO, result.EBO);
+	glVertexArrayVertexBuffer(result.VAO, 0, result.VBO, 0, sizeof(glm::vec3));
+	glEnableVertexArrayAttrib(result.VAO, 0);
+	glVertexArrayAttribFormat(result.VAO, 0, 3, GL_FLOAT, false, 0);
+	glVertexArrayAttribBinding(result.VAO, 0, 0);
+
+	// The instance data is in binding 1, which is pointed at the stream when flushing. A mat4 takes up 4 attributes
+	glVertexArrayBindingDivisor(result.VAO, 1, 1);
+	for (GLuint column = 0; column < 4; column++) {
+		glEnableVertexArrayAttrib(result.VAO, 1 + column);
+		glVertexArrayAttribFormat(result.VAO, 1 + column, 4, GL_FLOAT, false, static_cast<GLuint>(offsetof(Instance, Transform) + sizeof(glm::vec4) * column));
+		glVertexArrayAttribBinding(result.VAO, 1 + column, 1);
+	}
+	glEnableVertexArrayAttrib(result.VAO, 5);
+	glVertexArrayAttribFormat(result.VAO, 5, 4, GL_FLOAT, false, static_cast<GLuint>(offsetof(Instance, Color)));
+	glVertexArrayAttribBinding(result.VAO, 5, 1);
 	return result;
 }
 
@@ -72,21 +157,26 @@ TTK::Impl::MeshHelper::MeshHelper()
 	m_Teapot = __MakeMesh(TeapotData, sizeof(TeapotData));
 	m_Sphere = __MakeMesh(SphereData, sizeof(SphereData));
 	m_Cube   = __MakeMesh(CubeData, sizeof(CubeData));
-	
-	glBindVertexArray(0);
+
+	// Room for a thousand instances of one mesh, it grows if we need more
+	m_Stream = new StreamingBuffer(sizeof(Instance) * 1024);
 	
 	const char* vsSource = R"LIT(#version 430
             layout (location = 0) in vec3 vertexPosition;
-            layout (location = 0) uniform mat4 xTransform;	
+            layout (location = 1) in mat4 instanceTransform;
+            layout (location = 5) in vec4 instanceColor;
+            layout (location = 0) uniform mat4 xViewProjection;
+            layout (location = 0) out vec4 fragmentColor;
             void main() {
-                gl_Position = xTransform * vec4(vertexPosition, 1);
+                gl_Position = xViewProjection * instanceTransform * vec4(vertexPosition, 1);
+                fragmentColor = instanceColor;
             })LIT";
 
 	const char* fsSource = R"LIT(#version 430   
-            layout (location = 1) uniform vec4 xColor;		
+            layout (location = 0) in vec4 fragColor;
             out vec4 frag_color;            	
             void main() {
-                frag_color = xColor;
+                frag_color = fragColor;
             })LIT";
 
 	m_Shader = glCreateProgram();
@@ -6,6 +6,9 @@
 #include <glad/glad.h>
 #include "Logging.h"
 
+// The stream shared by all the sprites, it is deleted along with the last sprite
+static std::weak_ptr<TTK::StreamingBuffer> SharedStream;
+
 TTK::SpriteSheetQuad::SpriteSheetQuad()
 {
 	m_Vertices[0].Position = { -1.0f,  1.0f, 0.0f };
@@ -26,13 +29,18 @@ TTK::SpriteSheetQuad::SpriteSheetQuad()
 		2, 1, 3
 	};
 
+	m_Stream = SharedStream.lock();
+	if (m_Stream == nullptr) {
+		// Room for a few thousand sprites per region
+		m_Stream = std::make_shared<StreamingBuffer>(sizeof(QuadVert) * 4 * 4096);
+		SharedStream = m_Stream;
+	}
+
 	int currentVAO = 0;
 	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &currentVAO);
 	glCreateVertexArrays(1, &m_VAO);
 	glBindVertexArray(m_VAO);
-	glCreateBuffers(1, &m_VBO);
-	glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(QuadVert) * 4, m_Vertices, GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, m_Stream->GetHandle());
 	glCreateBuffers(1, &m_EBO);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * 6, indices, GL_STATIC_DRAW);
@@ -175,8 +183,8 @@ void TTK::SpriteSheetQuad::Draw(const glm::mat4& matrix)
 	glProgramUniformMatrix4fv(m_Shader, 0, 1, false, &matrix[0][0]);
 	m_Texture.Bind();
 	glBindVertexArray(m_VAO);
-	glNamedBufferData(m_VBO, sizeof(QuadVert) * 4, m_Vertices, GL_STREAM_DRAW);
-	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+	const size_t offset = m_Stream->Write(m_Vertices, sizeof(QuadVert) * 4, sizeof(QuadVert));
+	glDrawElementsBaseVertex(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr, static_cast<GLint>(offset / sizeof(QuadVert)));
 	m_Texture.Unbind();
 	glBindVertexArray(currentVAO);
 	glUseProgram(currentProgram);
@@ -0,0 +1,117 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This file is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this file in your GDW games.
+//
+// This file implements the TTK streaming buffer
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "TTK/StreamingBuffer.h"
+#include <chrono>
+#include <cstring>
+#include "Logging.h"
+
+TTK::StreamingStats TTK::StreamingBuffer::s_TotalStats;
+
+TTK::StreamingBuffer::StreamingBuffer(size_t regionSize) :
+	m_Handle(0),
+	m_Mapped(nullptr),
+	m_RegionSize(regionSize),
+	m_Region(0),
+	m_Cursor(0),
+	m_Fences(),
+	m_Stats()
+{
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &m_Handle);
+	glNamedBufferStorage(m_Handle, m_RegionSize * RegionCount, nullptr, flags);
+	m_Mapped = static_cast<uint8_t*>(glMapNamedBufferRange(m_Handle, 0, m_RegionSize * RegionCount, flags));
+	LOG_ASSERT(m_Mapped != nullptr, "Failed to map streaming buffer!");
+}
+
+TTK::StreamingBuffer::~StreamingBuffer() {
+	for (GLsync& fence : m_Fences) {
+		if (fence != nullptr) {
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+	if (m_Handle != 0) {
+		glUnmapNamedBuffer(m_Handle);
+		glDeleteBuffers(1, &m_Handle);
+		m_Handle = 0;
+	}
+}
+
+void* TTK::StreamingBuffer::Allocate(size_t size, size_t alignment, size_t& offset) {
+	if (size > m_RegionSize) {
+		LOG_WARN("Streaming {} bytes, but regions are only {} bytes!", size, m_RegionSize);
+		return nullptr;
+	}
+	alignment = alignment == 0 ? 1 : alignment;
+
+	// Offsets are aligned from the start of the buffer, so that they are a whole number of vertices
+	size_t result = (m_Cursor + alignment - 1) / alignment * alignment;
+	if (result + size > (m_Region + 1) * m_RegionSize) {
+		__NextRegion();
+		result = (m_Cursor + alignment - 1) / alignment * alignment;
+		// The alignment padding can push a region sized allocation out of the region
+		if (result + size > (m_Region + 1) * m_RegionSize) {
+			LOG_WARN("Streaming {} bytes with alignment {} does not fit in a region!", size, alignment);
+			return nullptr;
+		}
+	}
+	m_Cursor = result + size;
+	offset = result;
+
+	m_Stats.Bytes += size;
+	m_Stats.Allocations++;
+	s_TotalStats.Bytes += size;
+	s_TotalStats.Allocations++;
+	return m_Mapped + result;
+}
+
+size_t TTK::StreamingBuffer::Write(const void* data, size_t size, size_t alignment) {
+	size_t offset = 0;
+	void* target = Allocate(size, alignment, offset);
+	if (target == nullptr) {
+		return SIZE_MAX;
+	}
+	memcpy(target, data, size);
+	return offset;
+}
+
+void TTK::StreamingBuffer::__NextRegion() {
+	// Everything that reads the current region has been submitted, so the fence goes in after it
+	m_Fences[m_Region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_Region = (m_Region + 1) % RegionCount;
+	m_Cursor = m_Region * m_RegionSize;
+	m_Stats.Wraps++;
+	s_TotalStats.Wraps++;
+
+	GLsync& fence = m_Fences[m_Region];
+	if (fence == nullptr) {
+		return;
+	}
+	// Check without waiting first, this is the common case if there are enough regions
+	GLenum status = glClientWaitSync(fence, 0, 0);
+	if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+		const auto start = std::chrono::high_resolution_clock::now();
+		// Flush on the first wait, otherwise the fence may never reach the GPU
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		do {
+			status = glClientWaitSync(fence, flags, 1000000);
+			flags = 0;
+		} while (status == GL_TIMEOUT_EXPIRED);
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		m_Stats.Stalls++;
+		m_Stats.StallMs += ms;
+		s_TotalStats.Stalls++;
+		s_TotalStats.StallMs += ms;
+		LOG_ASSERT(status != GL_WAIT_FAILED, "Failed to wait for a streaming buffer region!");
+	}
+	glDeleteSync(fence);
+	fence = nullptr;
+}
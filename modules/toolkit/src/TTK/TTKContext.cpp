@@ -12,6 +12,10 @@
 
 #include "TTK/TTKContext.h"
 #include <GLM/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <string>
 #include "Logging.h"
 #include "TTK/MeshHelper.h"
@@ -21,13 +25,11 @@ TTK::Context* TTK::Context::m_Instance = nullptr;
 TTK::Context::~Context() {
 	delete m_MeshHelper;
 	delete m_DefaultFont;
-	glDeleteBuffers(1, &m_Tris.VBO);
-	glDeleteBuffers(1, &m_Lines.VBO);
-	glDeleteBuffers(1, &m_Points.VBO);
 	glDeleteVertexArrays(1, &m_Tris.VAO);
 	glDeleteVertexArrays(1, &m_Lines.VAO);
 	glDeleteVertexArrays(1, &m_Points.VAO);
 	glDeleteProgram(m_ShaderHandle);
+	delete m_Stream;
 }
 
 glm::mat4 TTK::Context::GetOrthoProjection() const {
@@ -57,55 +59,155 @@ void TTK::Context::DrawCube(const glm::mat4& mat, const glm::vec4& color) const
 	m_MeshHelper->RenderCube(mat, color);
 }
 
-void TTK::Context::AddLine(const glm::vec3& a, const glm::vec3& b, const glm::vec4& color) {
-	m_LineVerts[m_Lines.Count + 0].Position = a;
-	m_LineVerts[m_Lines.Count + 0].Color = color;
-	m_LineVerts[m_Lines.Count + 1].Position = b;
-	m_LineVerts[m_Lines.Count + 1].Color = color;
-	m_Lines.Count += 2;
-	if (m_Lines.Count == MaxLineVerts) {
-		__Flush(m_Lines);
+namespace {
+	// The time in seconds, used to expire timed primitives
+	double Now() {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Adds a primitive's vertices to a batch, with an expiry time if it's timed
+	template <typename B, typename T, size_t N>
+	void Record(B& batch, TTK::DebugLayer layer, const T(&verts)[N], float duration) {
+		const int ix = static_cast<int>(layer);
+		if (duration > 0.0f) {
+			batch.TimedVerts[ix].insert(batch.TimedVerts[ix].end(), verts, verts + N);
+			batch.Expiry[ix].push_back(Now() + duration);
+		} else {
+			batch.Verts[ix].insert(batch.Verts[ix].end(), verts, verts + N);
+		}
+	}
+
+	// Moves everything from one batch to the end of another, keeping the source's storage for the next frame
+	template <typename B>
+	void Merge(B& target, B& source, int layerCount) {
+		for (int ix = 0; ix < layerCount; ix++) {
+			target.Verts[ix].insert(target.Verts[ix].end(), source.Verts[ix].begin(), source.Verts[ix].end());
+			target.TimedVerts[ix].insert(target.TimedVerts[ix].end(), source.TimedVerts[ix].begin(), source.TimedVerts[ix].end());
+			target.Expiry[ix].insert(target.Expiry[ix].end(), source.Expiry[ix].begin(), source.Expiry[ix].end());
+			source.Verts[ix].clear();
+			source.TimedVerts[ix].clear();
+			source.Expiry[ix].clear();
+		}
 	}
-}
 
-void TTK::Context::AddTri(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec4& color) {
-	m_TriVerts[m_Tris.Count + 0].Position = a;
-	m_TriVerts[m_Tris.Count + 0].Color = color;
-	m_TriVerts[m_Tris.Count + 1].Position = b;
-	m_TriVerts[m_Tris.Count + 1].Color = color;
-	m_TriVerts[m_Tris.Count + 2].Position = c;
-	m_TriVerts[m_Tris.Count + 2].Color = color;
-	m_Tris.Count += 3;
-	if (m_Tris.Count == MaxTriVerts) {
-		__Flush(m_Tris);
+	// Removes the timed primitives that have expired, keeping the rest in order
+	template <typename B>
+	void Expire(B& batch, int layerCount, size_t vertsPerPrim, double now) {
+		for (int ix = 0; ix < layerCount; ix++) {
+			size_t kept = 0;
+			for (size_t prim = 0; prim < batch.Expiry[ix].size(); prim++) {
+				if (batch.Expiry[ix][prim] > now) {
+					if (kept != prim) {
+						batch.Expiry[ix][kept] = batch.Expiry[ix][prim];
+						std::copy_n(batch.TimedVerts[ix].begin() + prim * vertsPerPrim, vertsPerPrim, batch.TimedVerts[ix].begin() + kept * vertsPerPrim);
+					}
+					kept++;
+				}
+			}
+			batch.Expiry[ix].resize(kept);
+			batch.TimedVerts[ix].resize(kept * vertsPerPrim);
+		}
 	}
+
+	// Empties the timed primitives in a batch
+	template <typename B>
+	void ClearTimedIn(B& batch, int layerCount) {
+		for (int ix = 0; ix < layerCount; ix++) {
+			batch.TimedVerts[ix].clear();
+			batch.Expiry[ix].clear();
+		}
+	}
+}
+
+void TTK::Context::AddLine(const glm::vec3& a, const glm::vec3& b, const glm::vec4& color, DebugLayer layer, float duration) {
+	const SimpleVert verts[2] = { { a, color }, { b, color } };
+	DrawList& list = __GetDrawList();
+	std::lock_guard<std::mutex> lock(list.Lock);
+	Record(list.Lines, layer, verts, duration);
+}
+
+void TTK::Context::AddTri(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec4& color, DebugLayer layer, float duration) {
+	const SimpleVert verts[3] = { { a, color }, { b, color }, { c, color } };
+	DrawList& list = __GetDrawList();
+	std::lock_guard<std::mutex> lock(list.Lock);
+	Record(list.Tris, layer, verts, duration);
 }
 
-void TTK::Context::AddQuad(const glm::vec3& min, const glm::vec3& max, const glm::vec4& color) {
+void TTK::Context::AddQuad(const glm::vec3& min, const glm::vec3& max, const glm::vec4& color, DebugLayer layer, float duration) {
 	glm::vec3 minXmaxY = { min.x, max.y, min.z };
 	glm::vec3 maxXminY = { max.x, min.y, min.z };
-	AddTri(min, maxXminY, minXmaxY, color);
-	AddTri(maxXminY, max, minXmaxY, color);
+	AddTri(min, maxXminY, minXmaxY, color, layer, duration);
+	AddTri(maxXminY, max, minXmaxY, color, layer, duration);
 }
 
-void TTK::Context::AddPoint(const glm::vec3& pos, float size, const glm::vec4& color)
+void TTK::Context::AddPoint(const glm::vec3& pos, float size, const glm::vec4& color, DebugLayer layer, float duration)
 {
-	m_PointVerts[m_Points.Count].Position = pos;
-	m_PointVerts[m_Points.Count].Color = color;
-	m_PointVerts[m_Points.Count].Size = size;
-	m_Points.Count += 1;
-	if (m_Points.Count == MaxPointVerts) {
-		__Flush(m_Points);
-	}
+	const PointVert verts[1] = { { pos, color, size } };
+	DrawList& list = __GetDrawList();
+	std::lock_guard<std::mutex> lock(list.Lock);
+	Record(list.Points, layer, verts, duration);
 }
 
 void TTK::Context::Flush() {
-	__Flush(m_Tris);
-	__Flush(m_Lines);
-	__Flush(m_Points);
+	// Pull in everything that every thread has added since the last flush
+	{
+		std::lock_guard<std::mutex> listsLock(m_DrawListsLock);
+		for (auto& list : m_DrawLists) {
+			std::lock_guard<std::mutex> lock(list->Lock);
+			Merge(m_TriBatch, list->Tris, LayerCount);
+			Merge(m_LineBatch, list->Lines, LayerCount);
+			Merge(m_PointBatch, list->Points, LayerCount);
+		}
+	}
+
+	const double now = Now();
+	Expire(m_TriBatch, LayerCount, 3, now);
+	Expire(m_LineBatch, LayerCount, 2, now);
+	Expire(m_PointBatch, LayerCount, 1, now);
+
+	// The queued meshes are depth tested, so they go first
+	m_FlushDrawCalls = m_MeshHelper->Flush(m_ViewProjection);
+	__Flush(m_Tris, m_TriBatch, static_cast<int>(DebugLayer::DepthTested));
+	__Flush(m_Lines, m_LineBatch, static_cast<int>(DebugLayer::DepthTested));
+	__Flush(m_Points, m_PointBatch, static_cast<int>(DebugLayer::DepthTested));
+
+	// The overlay goes on top of everything, so we turn off depth testing for it if there's anything to draw
+	const int overlay = static_cast<int>(DebugLayer::Overlay);
+	if (!m_TriBatch.Verts[overlay].empty() || !m_TriBatch.TimedVerts[overlay].empty() ||
+		!m_LineBatch.Verts[overlay].empty() || !m_LineBatch.TimedVerts[overlay].empty() ||
+		!m_PointBatch.Verts[overlay].empty() || !m_PointBatch.TimedVerts[overlay].empty()) {
+		const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+		glDisable(GL_DEPTH_TEST);
+		__Flush(m_Tris, m_TriBatch, overlay);
+		__Flush(m_Lines, m_LineBatch, overlay);
+		__Flush(m_Points, m_PointBatch, overlay);
+		if (depthTest) {
+			glEnable(GL_DEPTH_TEST);
+		}
+	}
+}
+
+void TTK::Context::ClearTimed() {
+	{
+		std::lock_guard<std::mutex> listsLock(m_DrawListsLock);
+		for (auto& list : m_DrawLists) {
+			std::lock_guard<std::mutex> lock(list->Lock);
+			ClearTimedIn(list->Tris, LayerCount);
+			ClearTimedIn(list->Lines, LayerCount);
+			ClearTimedIn(list->Points, LayerCount);
+		}
+	}
+	ClearTimedIn(m_TriBatch, LayerCount);
+	ClearTimedIn(m_LineBatch, LayerCount);
+	ClearTimedIn(m_PointBatch, LayerCount);
 }
 
-TTK::Context::Context() {
+TTK::Context::Context() :
+	m_FlushDrawCalls(0)
+{
+	static std::atomic<uint32_t> nextId(1);
+	m_Id = nextId++;
+
 	m_Projection = glm::ortho(0.0f, 800.0f, 0.0f, 600.0f);
 	m_ViewMatrix = glm::mat4(1.0f);
 	m_DefaultFont = new TrueTypeTextureFont("C:\\\\Windows\\Fonts\\consola.ttf", 32);
@@ -147,28 +249,30 @@ TTK::Context::Context() {
 	
 	m_PointShaderHandle = __CompileShader(vsSourcePoint, fsSource);
 
+	// Grows in Flush if a frame has more than this, so it only needs to cover a typical frame
+	m_Stream = new StreamingBuffer(64 * 1024);
 
-	m_Tris = __InitBuff(GL_TRIANGLES, m_ShaderHandle, m_TriVerts, sizeof(SimpleVert), MaxTriVerts);
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(SimpleVert), (void*)offsetof(SimpleVert, Position));
-	glVertexAttribPointer(1, 4, GL_FLOAT, false, sizeof(SimpleVert), (void*)offsetof(SimpleVert, Color));
+	m_Tris = __InitBuff(GL_TRIANGLES, m_ShaderHandle, sizeof(SimpleVert));
+	glEnableVertexArrayAttrib(m_Tris.VAO, 0);
+	glEnableVertexArrayAttrib(m_Tris.VAO, 1);
+	glVertexArrayAttribFormat(m_Tris.VAO, 0, 3, GL_FLOAT, false, offsetof(SimpleVert, Position));
+	glVertexArrayAttribFormat(m_Tris.VAO, 1, 4, GL_FLOAT, false, offsetof(SimpleVert, Color));
 
-	m_Lines = __InitBuff(GL_LINES, m_ShaderHandle, m_LineVerts, sizeof(SimpleVert), MaxLineVerts);
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(SimpleVert), (void*)offsetof(SimpleVert, Position));
-	glVertexAttribPointer(1, 4, GL_FLOAT, false, sizeof(SimpleVert), (void*)offsetof(SimpleVert, Color));
+	m_Lines = __InitBuff(GL_LINES, m_ShaderHandle, sizeof(SimpleVert));
+	glEnableVertexArrayAttrib(m_Lines.VAO, 0);
+	glEnableVertexArrayAttrib(m_Lines.VAO, 1);
+	glVertexArrayAttribFormat(m_Lines.VAO, 0, 3, GL_FLOAT, false, offsetof(SimpleVert, Position));
+	glVertexArrayAttribFormat(m_Lines.VAO, 1, 4, GL_FLOAT, false, offsetof(SimpleVert, Color));
 
-	m_Points = __InitBuff(GL_POINTS, m_PointShaderHandle, m_PointVerts, sizeof(PointVert), MaxLineVerts);
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(PointVert), (void*)offsetof(PointVert, Position));
-	glVertexAttribPointer(1, 4, GL_FLOAT, false, sizeof(PointVert), (void*)offsetof(PointVert, Color));
-	glVertexAttribPointer(2, 1, GL_FLOAT, false, sizeof(PointVert), (void*)offsetof(PointVert, Size));
+	m_Points = __InitBuff(GL_POINTS, m_PointShaderHandle, sizeof(PointVert));
+	glEnableVertexArrayAttrib(m_Points.VAO, 0);
+	glEnableVertexArrayAttrib(m_Points.VAO, 1);
+	glEnableVertexArrayAttrib(m_Points.VAO, 2);
+	glVertexArrayAttribFormat(m_Points.VAO, 0, 3, GL_FLOAT, false, offsetof(PointVert, Position));
+	glVertexArrayAttribFormat(m_Points.VAO, 1, 4, GL_FLOAT, false, offsetof(PointVert, Color));
+	glVertexArrayAttribFormat(m_Points.VAO, 2, 1, GL_FLOAT, false, offsetof(PointVert, Size));
 
-	glBindVertexArray(0);
+	__BindStream();
 
 	// Make sure that the mesh helper has a context
 	m_MeshHelper = new Impl::MeshHelper();
@@ -177,33 +281,79 @@ TTK::Context::Context() {
 	glEnable(GL_PROGRAM_POINT_SIZE);
 }
 
-TTK::Context::GLBuff TTK::Context::__InitBuff(GLenum mode, GLuint shader, void* dataSource, size_t elemSize, size_t maxElems)
+TTK::Context::GLBuff TTK::Context::__InitBuff(GLenum mode, GLuint shader, size_t elemSize)
 {
 	GLBuff result;
 	result.Mode = mode;
-	result.Count = 0;
-	result.Data = dataSource;
 	result.ElemSize = elemSize;
 	result.Shader = shader;
 
 	glCreateVertexArrays(1, &result.VAO);
-	glBindVertexArray(result.VAO);
-	glCreateBuffers(1, &result.VBO);
-	glBindBuffer(GL_ARRAY_BUFFER, result.VBO);
-	glNamedBufferData(result.VBO, elemSize * maxElems, nullptr, GL_STREAM_DRAW);
+	// Every attribute reads from the stream, which is bound to slot 0 in __BindStream
+	for (GLuint attrib = 0; attrib < 3; attrib++) {
+		glVertexArrayAttribBinding(result.VAO, attrib, 0);
+	}
 
 	return result;
 }
 
-void TTK::Context::__Flush(GLBuff& buff) {
-	if (buff.Count > 0) {
-		glUseProgram(buff.Shader);
-		glUniformMatrix4fv(0, 1, false, &m_ViewProjection[0][0]);
-		glNamedBufferSubData(buff.VBO, 0, buff.Count * buff.ElemSize, buff.Data);
-		glBindVertexArray(buff.VAO);
-		glDrawArrays(buff.Mode, 0, static_cast<GLsizei>(buff.Count));
-		buff.Count = 0;
+void TTK::Context::__BindStream() {
+	// The attributes point at the start of the stream, the draws pick the first vertex
+	glVertexArrayVertexBuffer(m_Tris.VAO, 0, m_Stream->GetHandle(), 0, static_cast<GLsizei>(m_Tris.ElemSize));
+	glVertexArrayVertexBuffer(m_Lines.VAO, 0, m_Stream->GetHandle(), 0, static_cast<GLsizei>(m_Lines.ElemSize));
+	glVertexArrayVertexBuffer(m_Points.VAO, 0, m_Stream->GetHandle(), 0, static_cast<GLsizei>(m_Points.ElemSize));
+}
+
+TTK::Context::DrawList& TTK::Context::__GetDrawList() {
+	// Each thread remembers it's list, so we only need the lock the first time a thread draws
+	struct Cached {
+		uint32_t  Id = 0;
+		DrawList* List = nullptr;
+	};
+	thread_local Cached cached;
+	if (cached.Id != m_Id) {
+		std::lock_guard<std::mutex> lock(m_DrawListsLock);
+		m_DrawLists.push_back(std::make_unique<DrawList>());
+		cached.List = m_DrawLists.back().get();
+		cached.Id = m_Id;
 	}
+	return *cached.List;
+}
+
+template <typename T>
+void TTK::Context::__Flush(GLBuff& buff, Batch<T>& batch, int layer) {
+	std::vector<T>& verts = batch.Verts[layer];
+	std::vector<T>& timed = batch.TimedVerts[layer];
+	const size_t count = verts.size() + timed.size();
+	if (count == 0) {
+		return;
+	}
+
+	// The whole batch goes in one draw, so it has to fit in a region (plus room to align it)
+	const size_t size = count * buff.ElemSize;
+	if (size + buff.ElemSize > m_Stream->GetRegionSize()) {
+		// Draws that are still reading the old buffer keep it alive until the GPU is done with it
+		const size_t regionSize = std::max(m_Stream->GetRegionSize() * 2, size + buff.ElemSize);
+		LOG_INFO("Growing debug draw stream from {} to {} bytes per region", m_Stream->GetRegionSize(), regionSize);
+		delete m_Stream;
+		m_Stream = new StreamingBuffer(regionSize);
+		__BindStream();
+	}
+
+	size_t offset = 0;
+	uint8_t* target = static_cast<uint8_t*>(m_Stream->Allocate(size, buff.ElemSize, offset));
+	LOG_ASSERT(target != nullptr, "Failed to allocate debug draw vertices!");
+	memcpy(target, verts.data(), verts.size() * buff.ElemSize);
+	memcpy(target + verts.size() * buff.ElemSize, timed.data(), timed.size() * buff.ElemSize);
+
+	glUseProgram(buff.Shader);
+	glUniformMatrix4fv(0, 1, false, &m_ViewProjection[0][0]);
+	glBindVertexArray(buff.VAO);
+	glDrawArrays(buff.Mode, static_cast<GLint>(offset / buff.ElemSize), static_cast<GLsizei>(count));
+	m_FlushDrawCalls++;
+
+	// The timed verts stay until they expire
+	verts.clear();
 }
 
 GLuint TTK::Context::__CompileShader(const char* vsSource, const char* fsSource)
@@ -1,19 +1,39 @@
-#version 410
+#version 420
 
 layout(location = 0) in vec3 inPos;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec3 inNormal;
 
-uniform vec3  u_AmbientCol;
-uniform float u_AmbientStrength;
+// Camera and timing, updated once per frame (see FrameUniforms)
+layout(std140, binding = 0) uniform b_Frame {
+	mat4  u_View;
+	mat4  u_Projection;
+	mat4  u_ViewProjection;
+	mat4  u_SkyboxMatrix;
+	vec3  u_CamPos;
+	float u_Time;
+	float u_DeltaTime;
+};
 
-uniform vec3  u_LightPos;
-uniform vec3  u_LightCol;
-uniform float u_AmbientLightStrength;
-uniform float u_SpecularLightStrength;
-uniform float u_Shininess;
+// The scene's light, updated once per frame (see LightUniforms). See https://learnopengl.com/Lighting/Light-casters
+// for a good reference on how the attenuation works, or https://developer.valvesoftware.com/wiki/Constant-Linear-Quadratic_Falloff
+layout(std140, binding = 1) uniform b_Light {
+	vec3  u_LightPos;
+	float u_LightAttenuationConstant;
+	vec3  u_LightCol;
+	float u_LightAttenuationLinear;
+	vec3  u_AmbientCol;
+	float u_LightAttenuationQuadratic;
+	float u_AmbientLightStrength;
+	float u_SpecularLightStrength;
+	float u_AmbientStrength;
+	int   u_DiffuseFactor;
+	int   u_AmbientFactor;
+	int   u_SpecularFactor;
+	int   u_ToonFactor;
+};
 
-uniform vec3  u_CamPos;
+uniform float u_Shininess;
 
 out vec4 frag_color;
 
@@ -1,4 +1,4 @@
-#version 410
+#version 420
 
 layout(location = 0) in vec3 inPos;
 layout(location = 1) in vec3 inColor;
@@ -14,28 +14,65 @@ uniform sampler2D s_Reflectivity;
 uniform samplerCube s_Environment;
 uniform mat3 u_EnvironmentRotation;
 
-uniform vec3  u_AmbientCol;
-uniform float u_AmbientStrength;
+// Camera and timing, updated once per frame (see FrameUniforms)
+layout(std140, binding = 0) uniform b_Frame {
+	mat4  u_View;
+	mat4  u_Projection;
+	mat4  u_ViewProjection;
+	mat4  u_SkyboxMatrix;
+	vec3  u_CamPos;
+	float u_Time;
+	float u_DeltaTime;
+};
+
+// The scene's light, updated once per frame (see LightUniforms). See https://learnopengl.com/Lighting/Light-casters
+// for a good reference on how the attenuation works, or https://developer.valvesoftware.com/wiki/Constant-Linear-Quadratic_Falloff
+layout(std140, binding = 1) uniform b_Light {
+	vec3  u_LightPos;
+	float u_LightAttenuationConstant;
+	vec3  u_LightCol;
+	float u_LightAttenuationLinear;
+	vec3  u_AmbientCol;
+	float u_LightAttenuationQuadratic;
+	float u_AmbientLightStrength;
+	float u_SpecularLightStrength;
+	float u_AmbientStrength;
+	int   u_DiffuseFactor;
+	int   u_AmbientFactor;
+	int   u_SpecularFactor;
+	int   u_ToonFactor;
+};
 
-uniform vec3  u_LightPos;
-uniform vec3  u_LightCol;
-uniform float u_AmbientLightStrength;
-uniform float u_SpecularLightStrength;
 uniform float u_Shininess;
-// NEW in week 7, see https://learnopengl.com/Lighting/Light-casters for a good reference on how this all works, or
-// https://developer.valvesoftware.com/wiki/Constant-Linear-Quadratic_Falloff
-uniform float u_LightAttenuationConstant;
-uniform float u_LightAttenuationLinear;
-uniform float u_LightAttenuationQuadratic;
 
 uniform float u_TextureMix;
 
-uniform vec3  u_CamPos;
-
 out vec4 frag_color;
 
+// LOD cross-fade, 0 to 1 for a mesh fading in (1 draws every pixel). A mesh fading out gets the fade minus 1, and
+// draws the opposite pixels from the one fading in, so between them every pixel is drawn exactly once
+uniform float u_LodFade = 1.0;
+
+const float ditherPattern[16] = float[](
+	 0.0,  8.0,  2.0, 10.0,
+	12.0,  4.0, 14.0,  6.0,
+	 3.0, 11.0,  1.0,  9.0,
+	15.0,  7.0, 13.0,  5.0
+);
+
+void LodDither() {
+	if (u_LodFade < 1.0) {
+		ivec2 cell = ivec2(gl_FragCoord.xy) % 4;
+		float threshold = (ditherPattern[cell.y * 4 + cell.x] + 0.5) / 16.0;
+		if ((u_LodFade >= 0.0) ? (threshold > u_LodFade) : (threshold <= 1.0 + u_LodFade))
+			discard;
+	}
+}
+
 // https://learnopengl.com/Advanced-Lighting/Advanced-Lighting
 void main() {
+	LodDither();
+
 	// Lecture 5
 	vec3 ambient = u_AmbientLightStrength * u_LightCol;
 
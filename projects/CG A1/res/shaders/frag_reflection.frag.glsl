@@ -1,4 +1,4 @@
-#version 410
+#version 420
 
 layout(location = 0) in vec3 inPos;
 layout(location = 1) in vec3 inColor;
@@ -8,12 +8,43 @@ layout(location = 3) in vec2 inUV;
 uniform samplerCube s_Environment;
 uniform mat3 u_EnvironmentRotation;
 
-uniform vec3  u_CamPos;
+// Camera and timing, updated once per frame (see FrameUniforms)
+layout(std140, binding = 0) uniform b_Frame {
+	mat4  u_View;
+	mat4  u_Projection;
+	mat4  u_ViewProjection;
+	mat4  u_SkyboxMatrix;
+	vec3  u_CamPos;
+	float u_Time;
+	float u_DeltaTime;
+};
 
 out vec4 frag_color;
 
+// LOD cross-fade, 0 to 1 for a mesh fading in (1 draws every pixel). A mesh fading out gets the fade minus 1, and
+// draws the opposite pixels from the one fading in, so between them every pixel is drawn exactly once
+uniform float u_LodFade = 1.0;
+
+const float ditherPattern[16] = float[](
+	 0.0,  8.0,  2.0, 10.0,
+	12.0,  4.0, 14.0,  6.0,
+	 3.0, 11.0,  1.0,  9.0,
+	15.0,  7.0, 13.0,  5.0
+);
+
+void LodDither() {
+	if (u_LodFade < 1.0) {
+		ivec2 cell = ivec2(gl_FragCoord.xy) % 4;
+		float threshold = (ditherPattern[cell.y * 4 + cell.x] + 0.5) / 16.0;
+		if ((u_LodFade >= 0.0) ? (threshold > u_LodFade) : (threshold <= 1.0 + u_LodFade))
+			discard;
+	}
+}
+
 // https://learnopengl.com/Advanced-Lighting/Advanced-Lighting
 void main() {
+	LodDither();
+
 	// Calculate the reflected normal
 	vec3 N = normalize(inNormal);
 	vec3 toEye = normalize(inPos - u_CamPos);
@@ -1,32 +1,40 @@
-#version 410
+#version 420
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec3 inNormal;
 layout(location = 3) in vec2 inUV;
+// Per-instance data, see RenderBatcher
+layout(location = 4) in mat4 inModel;
+layout(location = 8) in mat3 inNormalMatrix;
 
 layout(location = 0) out vec3 outPos;
 layout(location = 1) out vec3 outColor;
 layout(location = 2) out vec3 outNormal;
 layout(location = 3) out vec2 outUV;
 
-uniform mat4 u_ModelViewProjection;
-uniform mat4 u_View;
-uniform mat4 u_Model;
-uniform mat3 u_NormalMatrix;
-uniform vec3 u_LightPos;
-
+// Camera and timing, updated once per frame (see FrameUniforms)
+layout(std140, binding = 0) uniform b_Frame {
+	mat4  u_View;
+	mat4  u_Projection;
+	mat4  u_ViewProjection;
+	mat4  u_SkyboxMatrix;
+	vec3  u_CamPos;
+	float u_Time;
+	float u_DeltaTime;
+};
 
 void main() {
 
-	gl_Position = u_ModelViewProjection * vec4(inPosition, 1.0);
-
 	// Lecture 5
 	// Pass vertex pos in world space to frag shader
-	outPos = (u_Model * vec4(inPosition, 1.0)).xyz;
+	vec4 worldPos = inModel * vec4(inPosition, 1.0);
+	outPos = worldPos.xyz;
+
+	gl_Position = u_ViewProjection * worldPos;
 
 	// Normals
-	outNormal = u_NormalMatrix * inNormal;
+	outNormal = inNormalMatrix * inNormal;
 
 	// Pass our UV coords to the fragment shader
 	outUV = inUV;
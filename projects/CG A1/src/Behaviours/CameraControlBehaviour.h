@@ -6,8 +6,8 @@
 class CameraControlBehaviour : public IBehaviour
 {
 public:
-	void OnLoad(entt::handle entity) override;
-	void Update(entt::handle entity) override;
+	void OnLoad(entt::handle entity);
+	void Update(entt::handle entity);
 
 protected:
 	double _prevMouseX, _prevMouseY;
@@ -3,15 +3,16 @@
 #include "Gameplay/Timing.h"
 #include "Gameplay/Transform.h"
 
-void FollowPathBehaviour::Update(entt::handle entity) {
+void FollowPathBehaviour::FixedUpdate(entt::handle entity) {
 	if (Points.size() >= 2) {
 		Transform& transform = entity.get<Transform>();
 
+		const float step = Speed * Timing::Instance().FixedTimeStep;
 		const glm::vec3 next = Points[_nextPointIx];
 		const glm::vec3 direction = glm::normalize(next - transform.GetLocalPosition());
 		//transform.LookAt(next);
-		transform.MoveLocalFixed(direction * Speed * Timing::Instance().DeltaTime);
-		if (glm::distance(transform.GetLocalPosition(), next) < Speed * Timing::Instance().DeltaTime) {
+		transform.MoveLocalFixed(direction * step);
+		if (glm::distance(transform.GetLocalPosition(), next) < step) {
 			_nextPointIx++;
 			if (_nextPointIx >= Points.size()) {
 				_nextPointIx = 0;
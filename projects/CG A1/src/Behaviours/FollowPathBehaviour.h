@@ -2,6 +2,8 @@
 #include "Gameplay/IBehaviour.h"
 #include <vector>
 #include <GLM/glm.hpp>
+#include <cereal/types/vector.hpp>
+#include <CerealGLM.h>
 
 class FollowPathBehaviour final : public IBehaviour
 {
@@ -10,13 +12,21 @@ public:
 		Points(std::vector<glm::vec3>()),
 		Speed(1.0f),
 		_nextPointIx(0) { }
-	~FollowPathBehaviour() override = default;
+	~FollowPathBehaviour() = default;
 
 	std::vector<glm::vec3> Points;
 	float                  Speed;
 
-	void Update(entt::handle entity) override;
-	
+	// We move in fixed steps, so give the entity an InterpolatedTransform to render it smoothly between them
+	void FixedUpdate(entt::handle entity);
+	// We only touch our own transform, so our fixed steps can run in parallel
+	static constexpr bool ParallelUpdate = true;
+
+	template <class Archive>
+	void serialize(Archive& archive) {
+		archive(Enabled, Points, Speed, _nextPointIx);
+	}
+
 private:
 	int _nextPointIx;
 };
\ No newline at end of file
@@ -5,9 +5,9 @@
 
 #include "GLFW/glfw3.h"
 
-void SimpleMoveBehaviour::Update(entt::handle entity)
+void SimpleMoveBehaviour::FixedUpdate(entt::handle entity)
 {
-	float dt = Timing::Instance().DeltaTime;
+	float dt = Timing::Instance().FixedTimeStep;
 	GLFWwindow* window = Application::Instance().Window;
 	Transform& transform = entity.get<Transform>();
 
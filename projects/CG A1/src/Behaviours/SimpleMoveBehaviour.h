@@ -9,5 +9,6 @@ public:
 	SimpleMoveBehaviour() = default;
 	~SimpleMoveBehaviour() = default;
 
-	void Update(entt::handle entity) override;
+	// We move in fixed steps, so that we can share an InterpolatedTransform with other fixed step movement
+	void FixedUpdate(entt::handle entity);
 };
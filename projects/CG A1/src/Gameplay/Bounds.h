@@ -0,0 +1,21 @@
+#pragma once
+#include "Utilities/BoundingVolumes.h"
+
+/// <summary>
+/// The bounds of an entity in it's local space (ex the bounds of it's mesh, or of a trigger volume). Entities with
+/// this component are tracked by the scene's SpatialIndex, changes must be made with replace or patch so that the
+/// index sees them
+/// </summary>
+struct LocalBounds
+{
+	AABB Value;
+};
+
+/// <summary>
+/// The world space bounds of an entity, the local bounds transformed by the entity's world matrix. This is added and
+/// updated by the scene's SpatialIndex, and should be treated as read-only everywhere else
+/// </summary>
+struct WorldBounds
+{
+	AABB Value;
+};
@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <GLM/glm.hpp>
+#include <CerealGLM.h>
 
 /// <summary>
 /// Represents a simple perspective camera for use by first person or third person games
@@ -100,6 +101,15 @@ public:
 	const glm::mat4& GetViewProjNoTranslation() const;
 	void SetView(glm::mat4 mat) { _view = mat; _isDirty = true; }
 
+	/// <summary>
+	/// Saves or loads the camera with cereal, see SceneSnapshot. The cached view-projection is rebuilt after loading
+	/// </summary>
+	template <class Archive>
+	void serialize(Archive& archive) {
+		archive(_isOrtho, _orthoHeight, _nearPlane, _farPlane, _fovRadians, _aspectRatio, _position, _normal, _up, _view, _projection);
+		_isDirty = true;
+	}
+
 protected:
 	bool _isOrtho;
 	float _orthoHeight;
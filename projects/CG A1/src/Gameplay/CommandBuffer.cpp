@@ -0,0 +1,151 @@
+#include "CommandBuffer.h"
+
+#include "Scene.h"
+#include "Transform.h"
+#include "TransformHierarchy.h"
+#include "Logging.h"
+
+CommandBuffer::CommandBuffer(uint32_t index) :
+	_index(index),
+	_source(entt::null),
+	_pass(0),
+	_sequence(0),
+	_commandCount(0)
+{ }
+
+void CommandBuffer::SetSource(entt::entity source) {
+	// The sequence keeps counting, so a source that records more than once in a pass still has unique keys
+	_source = source;
+}
+
+void CommandBuffer::SetPass(uint32_t pass) {
+	_pass = pass;
+	_source = entt::null;
+}
+
+CommandEntity CommandBuffer::CreateEntity(const std::string& name) {
+	_creates.push_back({ _NextOrder(), name, entt::null, entt::null });
+	return CommandEntity(_index, static_cast<uint32_t>(_creates.size() - 1));
+}
+
+CommandEntity CommandBuffer::Instantiate(entt::entity prefab) {
+	_creates.push_back({ _NextOrder(), "", prefab, entt::null });
+	return CommandEntity(_index, static_cast<uint32_t>(_creates.size() - 1));
+}
+
+void CommandBuffer::Destroy(CommandEntity entity) {
+	_destroys.push_back({ _NextOrder(), entity, entt::null });
+}
+
+void CommandBuffer::SetParent(CommandEntity child, CommandEntity parent) {
+	_reparents.push_back({ _NextOrder(), child, parent });
+}
+
+CommandOrder CommandBuffer::_NextOrder() {
+	_commandCount++;
+	// Commands with no source sort after everything else in their pass, since null is the largest entity
+	return { _pass, static_cast<uint32_t>(entt::to_integral(_source)), _sequence++ };
+}
+
+void CommandBuffer::_Clear() {
+	_creates.clear();
+	_destroys.clear();
+	_reparents.clear();
+	// Component lists clear themselves as they are replayed, we keep them around so they don't need to be re-allocated
+	_source = entt::null;
+	_pass = 0;
+	_sequence = 0;
+	_commandCount = 0;
+}
+
+entt::entity CommandBuffer::_Resolve(const std::vector<std::unique_ptr<CommandBuffer>>& buffers, const CommandEntity& entity) {
+	return entity.IsDeferred() ? buffers[entity.Buffer]->_creates[entity.Index].Result : entity.Entity;
+}
+
+void CommandBuffer::Replay(GameScene& scene, const std::vector<std::unique_ptr<CommandBuffer>>& buffers) {
+	bool isEmpty = true;
+	for (const auto& buffer : buffers) {
+		isEmpty &= buffer->IsEmpty();
+	}
+	if (isEmpty) {
+		return;
+	}
+	entt::registry& registry = scene.Registry();
+
+	// Creation goes first, so that everything else can refer to the new entities
+	std::vector<CreateCommand*> creates;
+	for (const auto& buffer : buffers) {
+		for (CreateCommand& command : buffer->_creates) {
+			creates.push_back(&command);
+		}
+	}
+	std::stable_sort(creates.begin(), creates.end(), [](const CreateCommand* l, const CreateCommand* r) { return l->Order < r->Order; });
+	for (CreateCommand* command : creates) {
+		command->Result = command->Prefab != entt::null ? scene.CreateEntity(command->Prefab).entity() : scene.CreateEntity(command->Name).entity();
+	}
+
+	// Component changes, one type at a time. Type IDs are stable for a given build, so this order is too
+	std::vector<entt::id_type> types;
+	for (const auto& buffer : buffers) {
+		for (const auto& [type, list] : buffer->_componentLists) {
+			if (!list->IsEmpty()) {
+				types.push_back(type);
+			}
+		}
+	}
+	std::sort(types.begin(), types.end());
+	types.erase(std::unique(types.begin(), types.end()), types.end());
+	for (entt::id_type type : types) {
+		// Any buffer's list for this type can replay the lists from all the others
+		for (const auto& buffer : buffers) {
+			const auto it = buffer->_componentLists.find(type);
+			if (it != buffer->_componentLists.end()) {
+				it->second->Replay(registry, buffers);
+				break;
+			}
+		}
+	}
+
+	// Re-parenting, we hand the whole batch to the hierarchy at once
+	std::vector<const EntityCommand*> commands;
+	for (const auto& buffer : buffers) {
+		for (const EntityCommand& command : buffer->_reparents) {
+			commands.push_back(&command);
+		}
+	}
+	std::stable_sort(commands.begin(), commands.end(), [](const EntityCommand* l, const EntityCommand* r) { return l->Order < r->Order; });
+	std::vector<std::pair<entt::entity, entt::entity>> links;
+	links.reserve(commands.size());
+	for (const EntityCommand* command : commands) {
+		const entt::entity child = _Resolve(buffers, command->Target);
+		const entt::entity parent = _Resolve(buffers, command->Other);
+		if (registry.valid(child) && registry.has<Transform>(child) && (parent == entt::null || (registry.valid(parent) && registry.has<Transform>(parent)))) {
+			links.emplace_back(child, parent);
+		} else {
+			LOG_WARN("Skipping re-parent command, the child or parent no longer exists");
+		}
+	}
+	if (!links.empty()) {
+		scene.Hierarchy().SetParents(links);
+	}
+
+	// Destruction goes last, so that commands recorded before an entity was destroyed still apply
+	commands.clear();
+	for (const auto& buffer : buffers) {
+		for (const EntityCommand& command : buffer->_destroys) {
+			commands.push_back(&command);
+		}
+	}
+	std::stable_sort(commands.begin(), commands.end(), [](const EntityCommand* l, const EntityCommand* r) { return l->Order < r->Order; });
+	for (const EntityCommand* command : commands) {
+		const entt::entity entity = _Resolve(buffers, command->Target);
+		// The same entity may have been destroyed by more than one source
+		if (registry.valid(entity)) {
+			registry.destroy(entity);
+		}
+	}
+
+	for (const auto& buffer : buffers) {
+		buffer->_Clear();
+	}
+}
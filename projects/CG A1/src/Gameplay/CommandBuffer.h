@@ -0,0 +1,236 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <entt.hpp>
+
+class CommandBuffer;
+class GameScene;
+class Transform;
+
+/// <summary>
+/// Refers to an entity from within a CommandBuffer, this is either an existing entity, or one that will be created
+/// when the buffer is replayed
+/// </summary>
+struct CommandEntity
+{
+	CommandEntity(entt::entity entity) : Entity(entity), Buffer(0), Index(NotDeferred) {}
+	CommandEntity(entt::null_t) : Entity(entt::null), Buffer(0), Index(NotDeferred) {}
+
+	/// <summary>
+	/// Returns true if this refers to an entity that has not been created yet
+	/// </summary>
+	bool IsDeferred() const { return Index != NotDeferred; }
+
+private:
+	friend class CommandBuffer;
+	static constexpr uint32_t NotDeferred = UINT32_MAX;
+
+	CommandEntity(uint32_t buffer, uint32_t index) : Entity(entt::null), Buffer(buffer), Index(index) {}
+
+	entt::entity Entity;
+	uint32_t     Buffer;
+	uint32_t     Index;
+};
+
+/// <summary>
+/// The key that commands are replayed in, see CommandBuffer for how it is built
+/// </summary>
+struct CommandOrder
+{
+	uint32_t Pass;     // The recording pass, see CommandBuffer::SetPass
+	uint32_t Source;   // The entity that recorded the command, null sorts last in a pass
+	uint64_t Sequence; // Counts up for every command recorded into a buffer, and never resets until replay
+
+	bool operator<(const CommandOrder& other) const {
+		if (Pass != other.Pass) return Pass < other.Pass;
+		if (Source != other.Source) return Source < other.Source;
+		return Sequence < other.Sequence;
+	}
+};
+
+/// <summary>
+/// Records structural changes to a scene (creating and destroying entities, adding and removing components, and
+/// re-parenting) so that they can be made from a parallel phase and applied later at a sync point. Each thread in
+/// the job system has it's own buffer, see GameScene::Commands, and all of them are replayed in GameScene::Poll.
+///
+/// Replay happens in a fixed order: entities are created, then component changes are applied one component type at
+/// a time, then re-parenting, and finally destruction. Within each step, commands are ordered by the pass they were
+/// recorded in (see SetPass), then by the source entity that recorded them (see SetSource), and then by the order they
+/// were recorded in. A source is only ever updated by one thread in a pass, so all of it's commands from that pass are
+/// in one buffer, and the result does not depend on which thread ran what. Commands recorded with no source from job
+/// threads have no such guarantee, so jobs that record commands should always set a source
+/// </summary>
+class CommandBuffer final
+{
+public:
+	CommandBuffer(uint32_t index);
+	~CommandBuffer() = default;
+
+	CommandBuffer(const CommandBuffer& other) = delete;
+	CommandBuffer(CommandBuffer&& other) = delete;
+	CommandBuffer& operator=(const CommandBuffer& other) = delete;
+	CommandBuffer& operator=(CommandBuffer&& other) = delete;
+
+	/// <summary>
+	/// Sets the entity that subsequent commands are being recorded on behalf of, this is used to give replay a
+	/// deterministic order. The parallel behaviour update sets this to the entity being updated
+	/// </summary>
+	/// <param name="source">The entity recording commands, or entt::null for none</param>
+	void SetSource(entt::entity source);
+	/// <summary>
+	/// Sets the recording pass, commands from earlier passes replay first. GameScene::BeginCommandPass sets this on
+	/// every buffer before each group of behaviour updates, so it must only be called while nothing is recording
+	/// </summary>
+	void SetPass(uint32_t pass);
+
+	/// <summary>
+	/// Queues the creation of a new entity, with a transform and a tag
+	/// </summary>
+	/// <param name="name">The name for the new entity</param>
+	/// <returns>A reference to the new entity that may be used in other commands on this buffer</returns>
+	CommandEntity CreateEntity(const std::string& name = "");
+	/// <summary>
+	/// Queues the creation of a new instance of a prefab
+	/// </summary>
+	/// <param name="prefab">The prefab to instantiate, must be in the prefab registry</param>
+	/// <returns>A reference to the new entity that may be used in other commands on this buffer</returns>
+	CommandEntity Instantiate(entt::entity prefab);
+	/// <summary>
+	/// Queues an entity to be destroyed
+	/// </summary>
+	void Destroy(CommandEntity entity);
+	/// <summary>
+	/// Queues a change of parent for an entity's transform
+	/// </summary>
+	/// <param name="child">The entity to re-parent</param>
+	/// <param name="parent">The new parent, or entt::null to make child a root</param>
+	void SetParent(CommandEntity child, CommandEntity parent);
+
+	/// <summary>
+	/// Queues a component to be added to an entity, replacing it if the entity already has one. The component is
+	/// constructed immediately, and copied into the registry on replay
+	/// </summary>
+	template <typename Type, typename ... TArgs>
+	void Emplace(CommandEntity entity, TArgs&&... args) {
+		static_assert(!std::is_same<Type, Transform>::value, "Transforms are bound to their entity when it is created, use SetParent or modify the transform after replay");
+		_GetList<Type>().Commands.push_back({ _NextOrder(), entity, Type{ std::forward<TArgs>(args)... } });
+	}
+	/// <summary>
+	/// Queues a component to be removed from an entity, if the entity has one
+	/// </summary>
+	template <typename Type>
+	void Remove(CommandEntity entity) {
+		static_assert(!std::is_same<Type, Transform>::value, "Transforms cannot be removed, destroy the entity instead");
+		_GetList<Type>().Commands.push_back({ _NextOrder(), entity, std::nullopt });
+	}
+
+	/// <summary>
+	/// Returns true if nothing has been recorded since the last replay
+	/// </summary>
+	bool IsEmpty() const { return _commandCount == 0; }
+
+	/// <summary>
+	/// Replays the commands from all the given buffers against a scene, and clears them. Must be called from the
+	/// main thread, while nothing else is recording
+	/// </summary>
+	/// <param name="scene">The scene to apply the commands to</param>
+	/// <param name="buffers">The buffers to replay, every buffer's index must match it's position</param>
+	static void Replay(GameScene& scene, const std::vector<std::unique_ptr<CommandBuffer>>& buffers);
+
+private:
+	// Base for the per-component-type lists, so we can replay without knowing the component type
+	struct ICommandList {
+		virtual ~ICommandList() = default;
+		// Replays every list of this type from all the buffers, in order, and clears them
+		virtual void Replay(entt::registry& registry, const std::vector<std::unique_ptr<CommandBuffer>>& buffers) = 0;
+		virtual bool IsEmpty() const = 0;
+	};
+
+	template <typename Type>
+	struct ComponentCommandList final : ICommandList {
+		struct Command {
+			CommandOrder        Order;
+			CommandEntity       Target;
+			std::optional<Type> Value; // Empty for removal
+		};
+		std::vector<Command> Commands;
+
+		void Replay(entt::registry& registry, const std::vector<std::unique_ptr<CommandBuffer>>& buffers) override {
+			std::vector<Command*> commands;
+			for (const auto& buffer : buffers) {
+				const auto it = buffer->_componentLists.find(entt::type_info<Type>::id());
+				if (it != buffer->_componentLists.end()) {
+					for (Command& command : static_cast<ComponentCommandList<Type>*>(it->second.get())->Commands) {
+						commands.push_back(&command);
+					}
+				}
+			}
+			std::stable_sort(commands.begin(), commands.end(), [](const Command* l, const Command* r) { return l->Order < r->Order; });
+
+			registry.reserve<Type>(registry.size<Type>() + commands.size());
+			for (Command* command : commands) {
+				const entt::entity entity = CommandBuffer::_Resolve(buffers, command->Target);
+				if (!registry.valid(entity)) {
+					continue;
+				}
+				if (command->Value.has_value()) {
+					registry.emplace_or_replace<Type>(entity, std::move(*command->Value));
+				} else {
+					registry.remove_if_exists<Type>(entity);
+				}
+			}
+
+			for (const auto& buffer : buffers) {
+				const auto it = buffer->_componentLists.find(entt::type_info<Type>::id());
+				if (it != buffer->_componentLists.end()) {
+					static_cast<ComponentCommandList<Type>*>(it->second.get())->Commands.clear();
+				}
+			}
+		}
+		bool IsEmpty() const override { return Commands.empty(); }
+	};
+
+	struct CreateCommand {
+		CommandOrder Order;
+		std::string  Name;
+		entt::entity Prefab;
+		entt::entity Result;
+	};
+	struct EntityCommand {
+		CommandOrder  Order;
+		CommandEntity Target;
+		CommandEntity Other;
+	};
+
+	uint32_t _index;
+	entt::entity _source;
+	uint32_t _pass;
+	uint64_t _sequence;
+	size_t _commandCount;
+
+	std::vector<CreateCommand> _creates;
+	std::vector<EntityCommand> _destroys;
+	std::vector<EntityCommand> _reparents;
+	std::unordered_map<entt::id_type, std::unique_ptr<ICommandList>> _componentLists;
+
+	template <typename Type>
+	ComponentCommandList<Type>& _GetList() {
+		std::unique_ptr<ICommandList>& list = _componentLists[entt::type_info<Type>::id()];
+		if (list == nullptr) {
+			list = std::make_unique<ComponentCommandList<Type>>();
+		}
+		return *static_cast<ComponentCommandList<Type>*>(list.get());
+	}
+
+	// Gets the replay order for the next command, and counts it
+	CommandOrder _NextOrder();
+	void _Clear();
+
+	static entt::entity _Resolve(const std::vector<std::unique_ptr<CommandBuffer>>& buffers, const CommandEntity& entity);
+};
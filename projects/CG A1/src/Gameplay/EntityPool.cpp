@@ -0,0 +1,94 @@
+#include "EntityPool.h"
+
+#include "GameObjectTag.h"
+#include "Logging.h"
+
+EntityPool::EntityPool(GameScene& scene, entt::entity prefab) :
+	ResetOnAcquire(true),
+	_scene(scene),
+	_prefab(prefab),
+	_inactive(std::vector<entt::entity>()),
+	_activeCount(0)
+{
+	LOG_ASSERT(GameScene::Prefabs().valid(prefab), "Entity is not a valid prefab!");
+}
+
+void EntityPool::Prewarm(size_t count) {
+	const size_t start = _inactive.size();
+	_scene.InstantiateBatch(_prefab, count, _inactive);
+	_scene.Registry().insert<InactiveTag>(_inactive.begin() + start, _inactive.end());
+}
+
+entt::handle EntityPool::Acquire() {
+	entt::registry& registry = _scene.Registry();
+	_activeCount++;
+
+	const entt::entity entity = _PopInactive();
+	if (entity == entt::null) {
+		return _scene.CreateEntity(_prefab);
+	}
+	registry.remove<InactiveTag>(entity);
+	if (ResetOnAcquire) {
+		GameScene::StampEntity(GameScene::Prefabs(), _prefab, registry, entity);
+	}
+	return entt::handle(registry, entity);
+}
+
+void EntityPool::Acquire(size_t count, std::vector<entt::entity>& result) {
+	entt::registry& registry = _scene.Registry();
+	_activeCount += count;
+
+	// Recycle as many instances as we can
+	const size_t start = result.size();
+	while (result.size() - start < count) {
+		const entt::entity entity = _PopInactive();
+		if (entity == entt::null) {
+			break;
+		}
+		result.push_back(entity);
+	}
+	registry.remove<InactiveTag>(result.begin() + start, result.end());
+	if (ResetOnAcquire) {
+		for (size_t ix = start; ix < result.size(); ix++) {
+			GameScene::StampEntity(GameScene::Prefabs(), _prefab, registry, result[ix]);
+		}
+	}
+
+	// Create whatever is left over in one batch
+	const size_t recycled = result.size() - start;
+	if (recycled < count) {
+		_scene.InstantiateBatch(_prefab, count - recycled, result);
+	}
+}
+
+void EntityPool::Release(entt::entity entity) {
+	entt::registry& registry = _scene.Registry();
+	LOG_ASSERT(registry.valid(entity), "Cannot release an entity that has been destroyed!");
+	LOG_ASSERT(!registry.has<InactiveTag>(entity), "Entity has already been released!");
+	LOG_ASSERT(_activeCount > 0, "Releasing more entities than were acquired from this pool!");
+
+	registry.emplace<InactiveTag>(entity);
+	_inactive.push_back(entity);
+	_activeCount--;
+}
+
+void EntityPool::Release(const std::vector<entt::entity>& entities) {
+	LOG_ASSERT(_activeCount >= entities.size(), "Releasing more entities than were acquired from this pool!");
+
+	_scene.Registry().insert<InactiveTag>(entities.begin(), entities.end());
+	_inactive.insert(_inactive.end(), entities.begin(), entities.end());
+	_activeCount -= entities.size();
+}
+
+entt::entity EntityPool::_PopInactive() {
+	entt::registry& registry = _scene.Registry();
+	// Instances may have been destroyed out from under us, we just skip over those
+	while (!_inactive.empty()) {
+		const entt::entity entity = _inactive.back();
+		_inactive.pop_back();
+		if (registry.valid(entity)) {
+			return entity;
+		}
+	}
+	return entt::null;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+#include <entt.hpp>
+#include "Gameplay/Scene.h"
+#include "Utilities/Macros.h"
+
+/// <summary>
+/// An opt-in pool of prefab instances. Rather than destroying instances, they are released back to the pool,
+/// which deactivates them with an InactiveTag so they can be handed out again by Acquire. This avoids the cost
+/// of creating and destroying entities and components for objects that are spawned in bursts (ex projectiles)
+/// </summary>
+class EntityPool final
+{
+	SMART_MEMORY_MANAGED(EntityPool)
+
+public:
+	/// <summary>
+	/// If true, recycled instances have the prefab's components copied back onto them when they are acquired,
+	/// so they look exactly like a new instance. Disable this if you always set up instances after acquiring them
+	/// </summary>
+	bool ResetOnAcquire;
+
+	EntityPool(GameScene& scene, entt::entity prefab);
+	~EntityPool() = default;
+
+	/// <summary>
+	/// Creates inactive instances up front, so that later calls to Acquire don't have to create anything
+	/// </summary>
+	/// <param name="count">The number of instances to add to the pool</param>
+	void Prewarm(size_t count);
+
+	/// <summary>
+	/// Gets an active instance of the prefab, recycling an inactive instance if there is one
+	/// </summary>
+	entt::handle Acquire();
+	/// <summary>
+	/// Gets many active instances of the prefab at once, recycling inactive instances first
+	/// </summary>
+	/// <param name="count">The number of instances to get</param>
+	/// <param name="result">The vector to append the instances to</param>
+	void Acquire(size_t count, std::vector<entt::entity>& result);
+
+	/// <summary>
+	/// Deactivates an instance and returns it to the pool
+	/// </summary>
+	/// <param name="entity">The instance to release, must have been acquired from this pool</param>
+	void Release(entt::entity entity);
+	/// <summary>
+	/// Deactivates many instances and returns them to the pool
+	/// </summary>
+	/// <param name="entities">The instances to release, must have been acquired from this pool</param>
+	void Release(const std::vector<entt::entity>& entities);
+
+	entt::entity GetPrefab() const { return _prefab; }
+	size_t GetActiveCount() const { return _activeCount; }
+	size_t GetInactiveCount() const { return _inactive.size(); }
+
+private:
+	GameScene& _scene;
+	entt::entity _prefab;
+	std::vector<entt::entity> _inactive;
+	size_t _activeCount;
+
+	// Pops the most recently released instance that is still alive, or entt::null if there are none
+	entt::entity _PopInactive();
+};
@@ -0,0 +1,140 @@
+#include "FrustumCuller.h"
+
+#include <chrono>
+#include <limits>
+#include "Bounds.h"
+#include "RendererComponent.h"
+#include "WorldMatrix.h"
+#include "Utilities/JobSystem.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_CULLER_SSE
+#include <xmmintrin.h>
+#endif
+
+bool FrustumCuller::IsSimd() {
+	#ifdef FRUSTUM_CULLER_SSE
+	return true;
+	#else
+	return false;
+	#endif
+}
+
+void FrustumCuller::TestSpheres(const Frustum& frustum, const float* x, const float* y, const float* z, const float* radius, size_t count, uint8_t* visible) {
+	size_t ix = 0;
+
+	#ifdef FRUSTUM_CULLER_SSE
+	// Each lane holds a different sphere, and we test all 4 against one plane at a time
+	__m128 planes[6][4];
+	for (int p = 0; p < 6; p++) {
+		for (int c = 0; c < 4; c++) {
+			planes[p][c] = _mm_set1_ps(frustum.Planes[p][c]);
+		}
+	}
+	for (; ix + 4 <= count; ix += 4) {
+		const __m128 cx = _mm_loadu_ps(x + ix);
+		const __m128 cy = _mm_loadu_ps(y + ix);
+		const __m128 cz = _mm_loadu_ps(z + ix);
+		const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + ix));
+		// All bits set, so every lane starts out visible
+		__m128 inside = _mm_cmpeq_ps(cx, cx);
+		for (int p = 0; p < 6; p++) {
+			const __m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(planes[p][0], cx), _mm_mul_ps(planes[p][1], cy)),
+				_mm_add_ps(_mm_mul_ps(planes[p][2], cz), planes[p][3]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+		}
+		const int mask = _mm_movemask_ps(inside);
+		visible[ix + 0] = (mask >> 0) & 1;
+		visible[ix + 1] = (mask >> 1) & 1;
+		visible[ix + 2] = (mask >> 2) & 1;
+		visible[ix + 3] = (mask >> 3) & 1;
+	}
+	#endif
+
+	for (; ix < count; ix++) {
+		visible[ix] = frustum.Intersects(BoundingSphere(glm::vec3(x[ix], y[ix], z[ix]), radius[ix])) ? 1 : 0;
+	}
+}
+
+void FrustumCuller::AssignRendererBounds(entt::registry& registry) {
+	const auto view = registry.view<const RendererComponent>(entt::exclude<LocalBounds>);
+	std::vector<std::pair<entt::entity, AABB>> missing;
+	for (entt::entity entity : view) {
+		const RendererComponent& renderer = view.get<const RendererComponent>(entity);
+		if (renderer.Mesh != nullptr && renderer.Mesh->GetBounds().IsValid()) {
+			missing.emplace_back(entity, renderer.Mesh->GetBounds());
+		}
+	}
+	// Adding components while iterating a view that excludes them is not allowed, so we do it afterwards
+	for (const auto& [entity, bounds] : missing) {
+		registry.emplace<LocalBounds>(entity, bounds);
+	}
+}
+
+void FrustumCuller::_Cull(const entt::registry& registry, const glm::mat4& viewProjection) {
+	const auto start = std::chrono::high_resolution_clock::now();
+	const size_t count = _candidates.size();
+
+	if (!Enabled) {
+		_visible = _candidates;
+	} else {
+		_x.resize(count);
+		_y.resize(count);
+		_z.resize(count);
+		_radius.resize(count);
+		_results.resize(count);
+
+		const Frustum frustum = Frustum::FromMatrix(viewProjection);
+		JobSystem& jobs = JobSystem::Instance();
+		if (Parallel && count >= MinParallelCount && jobs.GetThreadCount() > 1) {
+			jobs.Wait(jobs.ParallelFor(count, [&](size_t begin, size_t end) {
+				_CullRange(registry, frustum, begin, end);
+			}, BatchSize));
+		} else {
+			_CullRange(registry, frustum, 0, count);
+		}
+
+		// Compact the survivors, keeping their order
+		_visible.clear();
+		for (size_t ix = 0; ix < count; ix++) {
+			if (_results[ix]) {
+				_visible.push_back(_candidates[ix]);
+			}
+		}
+	}
+
+	const auto end = std::chrono::high_resolution_clock::now();
+	_stats.Tested = count;
+	_stats.Visible = _visible.size();
+	_stats.Culled = count - _visible.size();
+	_stats.Ms = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void FrustumCuller::_CullRange(const entt::registry& registry, const Frustum& frustum, size_t begin, size_t end) {
+	for (size_t ix = begin; ix < end; ix++) {
+		const entt::entity entity = _candidates[ix];
+		const RendererComponent& renderer = registry.get<RendererComponent>(entity);
+		const glm::mat4& world = registry.get<WorldMatrix>(entity).Value;
+
+		if (renderer.Mesh == nullptr || !renderer.Mesh->GetBounds().IsValid() || (renderer.Material != nullptr && !renderer.Material->IsCullable)) {
+			// An infinite sphere passes every plane
+			_x[ix] = _y[ix] = _z[ix] = 0.0f;
+			_radius[ix] = std::numeric_limits<float>::infinity();
+			continue;
+		}
+
+		// Scaling the radius by the largest axis scale keeps the whole mesh inside the sphere, even with non-uniform scale
+		const BoundingSphere& sphere = renderer.Mesh->GetBoundingSphere();
+		const glm::vec3 center = glm::vec3(world * glm::vec4(sphere.Center, 1.0f));
+		const float scale = glm::sqrt(glm::max(glm::max(
+			glm::dot(glm::vec3(world[0]), glm::vec3(world[0])),
+			glm::dot(glm::vec3(world[1]), glm::vec3(world[1]))),
+			glm::dot(glm::vec3(world[2]), glm::vec3(world[2]))));
+		_x[ix] = center.x;
+		_y[ix] = center.y;
+		_z[ix] = center.z;
+		_radius[ix] = sphere.Radius * scale;
+	}
+	TestSpheres(frustum, _x.data() + begin, _y.data() + begin, _z.data() + begin, _radius.data() + begin, end - begin, _results.data() + begin);
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <entt.hpp>
+#include <GLM/glm.hpp>
+#include "Utilities/BoundingVolumes.h"
+
+/// <summary>
+/// Counters from the last call to FrustumCuller::Cull
+/// </summary>
+struct CullingStats
+{
+	size_t Tested  = 0;
+	size_t Visible = 0;
+	size_t Culled  = 0;
+	// The time taken by the last cull, in milliseconds
+	double Ms      = 0.0;
+};
+
+/// <summary>
+/// Works out which renderers are inside the camera's view frustum, so that we only submit the ones that can be seen.
+///
+/// Each renderer's mesh bounding sphere is moved into world space with it's WorldMatrix, and tested against the 6
+/// frustum planes. The spheres are stored as separate x, y, z and radius arrays so that the plane tests can be done
+/// on 4 spheres at once with SSE. Large lists are split into batches and culled on the job system.
+///
+/// The visible list keeps the order of the candidates, so a list that was sorted for drawing stays sorted
+/// </summary>
+class FrustumCuller final
+{
+public:
+	/// <summary>
+	/// If false, everything is treated as visible
+	/// </summary>
+	bool   Enabled = true;
+	/// <summary>
+	/// If true, lists of at least MinParallelCount renderers are culled on the job system
+	/// </summary>
+	bool   Parallel = true;
+	size_t MinParallelCount = 4096;
+	size_t BatchSize = 1024;
+
+	FrustumCuller() = default;
+	~FrustumCuller() = default;
+
+	FrustumCuller(const FrustumCuller& other) = delete;
+	FrustumCuller(FrustumCuller&& other) = delete;
+	FrustumCuller& operator=(const FrustumCuller& other) = delete;
+	FrustumCuller& operator=(FrustumCuller&& other) = delete;
+
+	/// <summary>
+	/// Culls a list of entities with RendererComponent and WorldMatrix components, see GetVisible for the results.
+	/// Renderers without a mesh, with a mesh that has no bounds, or with a material that is not cullable are always
+	/// visible
+	/// </summary>
+	/// <param name="registry">The registry that the entities belong to</param>
+	/// <param name="first">The first entity to cull (ex renderGroup.begin())</param>
+	/// <param name="last">The end of the entities to cull (ex renderGroup.end())</param>
+	/// <param name="viewProjection">The view projection matrix of the camera to cull against</param>
+	template <typename Iterator>
+	void Cull(const entt::registry& registry, Iterator first, Iterator last, const glm::mat4& viewProjection) {
+		_candidates.assign(first, last);
+		_Cull(registry, viewProjection);
+	}
+
+	/// <summary>
+	/// Gets the entities that passed the last cull, in the order they were given
+	/// </summary>
+	const std::vector<entt::entity>& GetVisible() const { return _visible; }
+	const CullingStats& GetStats() const { return _stats; }
+
+	/// <summary>
+	/// Tests spheres against a frustum, 4 at a time where SSE is available
+	/// </summary>
+	/// <param name="frustum">The frustum to test against</param>
+	/// <param name="x">The x coordinates of the sphere centers</param>
+	/// <param name="y">The y coordinates of the sphere centers</param>
+	/// <param name="z">The z coordinates of the sphere centers</param>
+	/// <param name="radius">The radii of the spheres</param>
+	/// <param name="count">The number of spheres to test</param>
+	/// <param name="visible">Receives 1 for each sphere that is at least partially inside the frustum, and 0 otherwise</param>
+	static void TestSpheres(const Frustum& frustum, const float* x, const float* y, const float* z, const float* radius, size_t count, uint8_t* visible);
+
+	/// <summary>
+	/// Gives every renderer with a mesh that has bounds, but no LocalBounds of it's own, a copy of it's mesh's bounds.
+	/// This puts renderers in the scene's SpatialIndex. Renderers that change their mesh later should replace their
+	/// LocalBounds. Makes structural changes, so must be called from the main thread
+	/// </summary>
+	static void AssignRendererBounds(entt::registry& registry);
+
+	/// <summary>
+	/// Returns true if the sphere tests were compiled with SSE support
+	/// </summary>
+	static bool IsSimd();
+
+private:
+	std::vector<entt::entity> _candidates;
+	std::vector<entt::entity> _visible;
+	CullingStats _stats;
+
+	// World space spheres for the candidates, in separate arrays for the SIMD tests
+	std::vector<float>   _x;
+	std::vector<float>   _y;
+	std::vector<float>   _z;
+	std::vector<float>   _radius;
+	std::vector<uint8_t> _results;
+
+	void _Cull(const entt::registry& registry, const glm::mat4& viewProjection);
+	// Gathers the world space spheres for, and tests, the candidates in [begin, end)
+	void _CullRange(const entt::registry& registry, const Frustum& frustum, size_t begin, size_t end);
+};
@@ -35,5 +35,20 @@ struct GameObjectTag
 		HashedName = entt::hashed_string::value(name.c_str());
 	}
 
+	// Only the name is saved, the hash is rebuilt from it when loading
+	template <class Archive>
+	void save(Archive& archive) const { archive(Name); }
+	template <class Archive>
+	void load(Archive& archive) {
+		archive(Name);
+		HashedName = entt::hashed_string::value(Name.c_str());
+	}
+
 	// TODO: we could expand this in the future for properties that all game objects should have
-};
\ No newline at end of file
+};
+
+/// <summary>
+/// Marks a game object as inactive, inactive objects are skipped by rendering and behaviour updates but are
+/// otherwise left untouched. This is used by EntityPool to park instances until they are needed again
+/// </summary>
+struct InactiveTag { };
\ No newline at end of file
@@ -0,0 +1,46 @@
+#include "IBehaviour.h"
+
+std::vector<BehaviourBinding::BehaviourType> BehaviourBinding::_types;
+
+void BehaviourBinding::Update(GameScene& scene) {
+	for (const BehaviourType& type : _types) {
+		if (!type.Parallel && type.Update != nullptr) {
+			type.Update(scene);
+		}
+	}
+	// We wait for each type before starting the next, since two behaviours on the same entity may both write to it's transform
+	for (const BehaviourType& type : _types) {
+		if (type.Parallel && type.Update != nullptr) {
+			type.Update(scene);
+		}
+	}
+}
+
+void BehaviourBinding::FixedUpdate(GameScene& scene) {
+	for (const BehaviourType& type : _types) {
+		if (!type.Parallel && type.FixedUpdate != nullptr) {
+			type.FixedUpdate(scene);
+		}
+	}
+	for (const BehaviourType& type : _types) {
+		if (type.Parallel && type.FixedUpdate != nullptr) {
+			type.FixedUpdate(scene);
+		}
+	}
+}
+
+void BehaviourBinding::LateUpdate(GameScene& scene) {
+	for (const BehaviourType& type : _types) {
+		if (type.LateUpdate != nullptr) {
+			type.LateUpdate(scene);
+		}
+	}
+}
+
+void BehaviourBinding::RenderGUI(GameScene& scene) {
+	for (const BehaviourType& type : _types) {
+		if (type.RenderGUI != nullptr) {
+			type.RenderGUI(scene);
+		}
+	}
+}
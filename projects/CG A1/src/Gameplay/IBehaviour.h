@@ -1,11 +1,19 @@
 #pragma once
-#include <memory>
+#include <type_traits>
+#include <vector>
 #include <entt.hpp>
-#include <typeindex>
+#include "Gameplay/Scene.h"
+#include "Gameplay/SceneSnapshot.h"
+#include "Gameplay/GameObjectTag.h"
+#include "Utilities/JobSystem.h"
+#include "Logging.h"
 struct BehaviourBinding;
 
 /*
- * Represents a behaviour that can be tied to a single GameObject
+ * Represents a behaviour that can be tied to a single GameObject. Behaviours are stored by value as entt components,
+ * so every behaviour type gets it's own contiguous pool, and the hooks below are not virtual. A behaviour overrides a
+ * hook by declaring a method with the same signature, and BehaviourBinding will only dispatch the hooks that a type
+ * actually declares, calling them directly on the concrete type
  */
 class IBehaviour {
 public:
@@ -13,141 +21,236 @@ public:
 	 * Whether or not this component will fire it's events
 	 */
 	bool    Enabled = true;
-	virtual ~IBehaviour() = default;
+	~IBehaviour() = default;
 
 	/*
 	 * Invoked when the behaviour is added to the scene, or the scene has been loaded
 	 * @param entity The entity that the behaviour is bound to
 	 */
-	virtual void OnLoad(entt::handle entity) {}
+	void OnLoad(entt::handle entity) {}
 	/*
 	 * Invoked when the behaviour is removed from the entity, or the scene is unloaded
 	 * @param entity The entity that the behaviour is bound to
 	 */
-	virtual void OnUnload(entt::handle entity) {}
+	void OnUnload(entt::handle entity) {}
 	/*
 	 * Invoked during the variable rate update. This is generally where we want to add our updates.
-	 * To get the time since the last update, use florp::app::Timing::DeltaTime
+	 * To get the time since the last update, use Timing::DeltaTime
 	 * @param entity The entity that the behaviour is bound to
 	 */
-	virtual void Update(entt::handle entity) {}
+	void Update(entt::handle entity) {}
 	/*
 	 * Invoked during the fixed rate update phase.
-	 * To get the approximate time since the last fixed update, use florp::app::Timing::FixedTimeStep
+	 * To get the time since the last fixed update, use Timing::FixedTimeStep. Entities moved here should have an
+	 * InterpolatedTransform so they render smoothly between steps
 	 * @param entity The entity that the behaviour is bound to
 	 */
-	virtual void FixedUpdate(entt::handle entity) {}
+	void FixedUpdate(entt::handle entity) {}
 	/*
 	 * Invoked during the variable rate update. This is called after all behaviours/layers have called Update
-	 * To get the time since the last update, use florp::app::Timing::DeltaTime
+	 * To get the time since the last update, use Timing::DeltaTime
 	 * @param entity The entity that the behaviour is bound to
 	 */
-	virtual void LateUpdate(entt::handle entity) {}
+	void LateUpdate(entt::handle entity) {}
 	/*
-	 * Invoked during the GUI render phase.
+	 * Invoked during the GUI render phase, controls added here go in the debug window
 	 * @param entity The entity that the behaviour is bound to
 	 */
-	virtual void RenderGUI(entt::handle entity) {}
+	void RenderGUI(entt::handle entity) {}
+
+	/*
+	 * Whether this behaviour's Update and FixedUpdate may be invoked from a worker thread during the parallel phase,
+	 * which runs after all main thread updates (or fixed updates) have completed. Hide this with a constant set to
+	 * true to opt in. Behaviours that opt in must follow these rules inside Update and FixedUpdate:
+	 *   - Only write to the behaviour itself, and to the Transform of the entity it is bound to
+	 *   - Other components and globals (such as Timing) may be read, but not written
+	 *   - Do not create or destroy entities, add or remove components, or re-parent directly, record these on
+	 *     the scene's command buffer instead (GameScene::Commands), they will be applied in GameScene::Poll
+	 *   - Do not make any OpenGL, GLFW or ImGui calls
+	 */
+	static constexpr bool ParallelUpdate = false;
 
 protected:
 	IBehaviour() = default;
 };
 
 /*
- * The component added to an entt entity to connect a behaviour to a specific entity
+ * Binds behaviours to entities, and dispatches their events. Behaviour types are registered the first time they are
+ * bound, and each event is dispatched one type at a time, in a tight loop over that type's pool
  */
 struct BehaviourBinding {
-	std::vector<std::shared_ptr<IBehaviour>> Behaviours;
-
 	/*
-	 * Binds an IBehaviour interface to the given entt entity
+	 * Binds a behaviour to the given entt entity. Behaviours are stored as components, so an entity can only have one
+	 * behaviour of each type, use Get to reach the one it already has
 	 * @param T The type of behaviour to add
 	 * @param TArgs The argument types to forward to the behaviour's constructor
-	 * @param registry The registry that the entity is part of
 	 * @param entity The entity to add the behaviour to
 	 * @param args The arguments to forward to the behaviour's constructor
+	 * @returns The new behaviour, this reference is invalidated when behaviours of the same type are bound or unbound
 	 */
 	template <typename T, typename ... TArgs, typename = typename std::enable_if<std::is_base_of<IBehaviour, T>::value>::type>
-	static std::shared_ptr<T> Bind(entt::handle entity, TArgs&&... args) {
-		// Get the binding component
-		BehaviourBinding& binding = entity.get_or_emplace<BehaviourBinding>();
-		// Make a new behaviour, forwarding the arguments
-		const std::shared_ptr<IBehaviour> behaviour = std::make_shared<T>(std::forward<TArgs>(args)...);
-		// Append it to the binding component's storage, and invoke the OnLoad
-		binding.Behaviours.push_back(behaviour);
-		behaviour->OnLoad(entity);
-		return std::dynamic_pointer_cast<T>(behaviour);
+	static T& Bind(entt::handle entity, TArgs&&... args) {
+		_Register<T>();
+		LOG_ASSERT(!entity.has<T>(), "Entity already has a behaviour of this type, entities can only have one of each!");
+		T& behaviour = entity.emplace<T>(std::forward<TArgs>(args)...);
+		behaviour.OnLoad(entity);
+		return behaviour;
 	}
 
 	/*
-	 * Binds an IBehaviour interface to the given entt entity, setting it to disabled by default
+	 * Binds a behaviour to the given entt entity, setting it to disabled by default. Like Bind, an entity can only
+	 * have one behaviour of each type
 	 * @param T The type of behaviour to add
 	 * @param TArgs The argument types to forward to the behaviour's constructor
-	 * @param registry The registry that the entity is part of
 	 * @param entity The entity to add the behaviour to
 	 * @param args The arguments to forward to the behaviour's constructor
+	 * @returns The new behaviour, this reference is invalidated when behaviours of the same type are bound or unbound
 	 */
 	template <typename T, typename ... TArgs, typename = typename std::enable_if<std::is_base_of<IBehaviour, T>::value>::type>
-	static std::shared_ptr<T> BindDisabled(entt::handle entity, TArgs&&... args) {
-		// Get the binding component
-		BehaviourBinding& binding = entity.get_or_emplace<BehaviourBinding>();
-		// Make a new behaviour, forwarding the arguments
-		const std::shared_ptr<IBehaviour> behaviour = std::make_shared<T>(std::forward<TArgs>(args)...);
-		behaviour->Enabled = false;
-		// Append it to the binding component's storage, and invoke the OnLoad
-		binding.Behaviours.push_back(behaviour);
-		behaviour->OnLoad(entity);
-		return std::dynamic_pointer_cast<T>(behaviour);
+	static T& BindDisabled(entt::handle entity, TArgs&&... args) {
+		_Register<T>();
+		LOG_ASSERT(!entity.has<T>(), "Entity already has a behaviour of this type, entities can only have one of each!");
+		T& behaviour = entity.emplace<T>(std::forward<TArgs>(args)...);
+		behaviour.Enabled = false;
+		behaviour.OnLoad(entity);
+		return behaviour;
+	}
+
+	/*
+	 * Removes a behaviour from an entity, invoking it's OnUnload
+	 * @param T The type of behaviour to remove
+	 * @param entity The entity to remove the behaviour from
+	 */
+	template <typename T, typename = typename std::enable_if<std::is_base_of<IBehaviour, T>::value>::type>
+	static void Unbind(entt::handle entity) {
+		if (T* behaviour = entity.try_get<T>()) {
+			behaviour->OnUnload(entity);
+			entity.remove<T>();
+		}
 	}
 
-	
 	/*
 	 * Checks whether the given entity has a behaviour of the given type
 	 * @param T The type of behaviour to check for
-	 * @param registry The registry that the entity is part of
 	 * @param entity The entity to check
 	 * @returns True if a behaviour of type T is attached to entity, or false if otherwise
 	 */
 	template <typename T, typename = typename std::enable_if<std::is_base_of<IBehaviour, T>::value>::type>
 	static bool Has(entt::handle entity) {
-		// Check to see if the entity has a behaviour binding attached
-		if (entity.has<BehaviourBinding>()) {
-			// Get the binding component
-			const auto& binding = entity.get<BehaviourBinding>();
-			// Iterate over all the pointers in the binding list
-			for (const auto& ptr : binding.Behaviours) {
-				// If the pointer type matches T, we return true
-				if (std::type_index(typeid(*ptr.get())) == std::type_index(typeid(T))) {
-					return true;
-				}
-			}
-			return false;
-		}
-		else return false;
+		return entity.has<T>();
 	}
 
 	/*
 	 * Gets the behaviour with the given type from the entity, or nullptr if none exists
 	 * @param T The type of behaviour to check for
-	 * @param registry The registry that the entity is part of
 	 * @param entity The entity to search
-	 * @returns The behaviour of type T that is attached to entity, or nullptr if no behaviour of that type is attached
+	 * @returns The behaviour of type T that is attached to entity, or nullptr if no behaviour of that type is attached.
+	 *          The pointer is invalidated when behaviours of the same type are bound or unbound
 	 */
 	template <typename T, typename = typename std::enable_if<std::is_base_of<IBehaviour, T>::value>::type>
-	static std::shared_ptr<T> Get(entt::handle entity) {
-		// Check to see if the entity has a behaviour binding attached
-		if (entity.has<BehaviourBinding>()) {
-			// Get the binding component
-			const auto& binding = entity.get<BehaviourBinding>();
-			// Iterate over all the pointers in the binding list
-			for (const auto& ptr : binding.Behaviours) {
-				// If the pointer type matches T, we return that behaviour, making sure to cast it back to the requested type
-				if (std::type_index(typeid(*ptr.get())) == std::type_index(typeid(T))) {
-					return std::dynamic_pointer_cast<T>(ptr);
-				}
+	static T* Get(entt::handle entity) {
+		return entity.try_get<T>();
+	}
+
+	/*
+	 * Invokes Update on all the enabled behaviours in the scene, skipping inactive entities. Main thread behaviours
+	 * are updated first, then the behaviours that opted into the parallel update phase
+	 * @param scene The scene to update
+	 */
+	static void Update(GameScene& scene);
+	/*
+	 * Invokes FixedUpdate on all the enabled behaviours in the scene, skipping inactive entities. This should be
+	 * called once for every fixed step, see Timing::NextFixedStep. Like Update, main thread behaviours go first
+	 * @param scene The scene to update
+	 */
+	static void FixedUpdate(GameScene& scene);
+	/*
+	 * Invokes LateUpdate on all the enabled behaviours in the scene, skipping inactive entities
+	 * @param scene The scene to update
+	 */
+	static void LateUpdate(GameScene& scene);
+	/*
+	 * Invokes RenderGUI on all the enabled behaviours in the scene, skipping inactive entities. This should be
+	 * called while the debug window is open
+	 * @param scene The scene to draw the GUI for
+	 */
+	static void RenderGUI(GameScene& scene);
+
+private:
+	// The dispatch table entry for a single behaviour type, hooks that the type does not declare are left as nullptr
+	struct BehaviourType {
+		bool Parallel;
+		void(*Update)(GameScene& scene);
+		void(*FixedUpdate)(GameScene& scene);
+		void(*LateUpdate)(GameScene& scene);
+		void(*RenderGUI)(GameScene& scene);
+	};
+	static std::vector<BehaviourType> _types;
+
+	template <typename T>
+	static void _Register() {
+		static bool isRegistered = false;
+		if (!isRegistered) {
+			isRegistered = true;
+			GameScene::RegisterComponentType<T>();
+			// Behaviours that can't be saved are simply left out of scene snapshots
+			if constexpr (std::is_trivially_copyable<T>::value || cereal::traits::is_output_serializable<T, cereal::BinaryOutputArchive>::value) {
+				SceneSnapshot::RegisterComponentType(entt::type_info<T>::id(), &SceneSnapshot::SaveComponents<T>, &_LoadFromSnapshot<T>);
+			}
+			BehaviourType type = { T::ParallelUpdate, nullptr, nullptr, nullptr, nullptr };
+			// If T does not declare it's own version of a hook, it inherits the empty one from IBehaviour and we can skip it entirely
+			if constexpr (!std::is_same<decltype(&T::Update), decltype(&IBehaviour::Update)>::value) {
+				type.Update = &_Invoke<T, &T::Update, T::ParallelUpdate>;
+			}
+			if constexpr (!std::is_same<decltype(&T::FixedUpdate), decltype(&IBehaviour::FixedUpdate)>::value) {
+				type.FixedUpdate = &_Invoke<T, &T::FixedUpdate, T::ParallelUpdate>;
+			}
+			if constexpr (!std::is_same<decltype(&T::LateUpdate), decltype(&IBehaviour::LateUpdate)>::value) {
+				type.LateUpdate = &_Invoke<T, &T::LateUpdate, false>;
+			}
+			if constexpr (!std::is_same<decltype(&T::RenderGUI), decltype(&IBehaviour::RenderGUI)>::value) {
+				type.RenderGUI = &_Invoke<T, &T::RenderGUI, false>;
 			}
-			return nullptr;
+			_types.push_back(type);
 		}
-		else return nullptr;
 	}
-};
\ No newline at end of file
+
+	// Loads the behaviours of type T from a snapshot, and lets them know that the scene has been loaded
+	template <typename T>
+	static bool _LoadFromSnapshot(entt::registry& registry, cereal::BinaryInputArchive& archive) {
+		if (!SceneSnapshot::LoadComponents<T>(registry, archive)) {
+			return false;
+		}
+		registry.view<T>().each([&](entt::entity entity, T& behaviour) {
+			behaviour.OnLoad(entt::handle(registry, entity));
+		});
+		return true;
+	}
+
+	// Invokes a hook on every enabled behaviour of type T, spreading them across the job system if IsParallel is set
+	template <typename T, void(T::*Hook)(entt::handle), bool IsParallel>
+	static void _Invoke(GameScene& scene) {
+		entt::registry& registry = scene.Registry();
+		auto view = registry.view<T>(entt::exclude<InactiveTag>);
+		// Each entity is only visited once per pass, so it's commands all land in one buffer
+		scene.BeginCommandPass();
+		if constexpr (IsParallel) {
+			JobSystem& jobs = JobSystem::Instance();
+			jobs.Wait(jobs.ParallelForEach(view, [&](entt::entity entity, T& behaviour) {
+				if (behaviour.Enabled) {
+					// Tag any structural changes with the entity, so they replay in the same order no matter which thread ran it
+					scene.Commands().SetSource(entity);
+					(behaviour.*Hook)(entt::handle(registry, entity));
+				}
+			}));
+		} else {
+			CommandBuffer& commands = scene.Commands();
+			view.each([&](entt::entity entity, T& behaviour) {
+				if (behaviour.Enabled) {
+					commands.SetSource(entity);
+					(behaviour.*Hook)(entt::handle(registry, entity));
+				}
+			});
+		}
+	}
+};
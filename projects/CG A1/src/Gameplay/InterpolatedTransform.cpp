@@ -0,0 +1,44 @@
+#include "InterpolatedTransform.h"
+
+#include "Transform.h"
+
+void InterpolatedTransform::Restore(entt::registry& registry) {
+	registry.view<Transform, InterpolatedTransform>().each([](Transform& transform, InterpolatedTransform& state) {
+		if (state.IsCaptured) {
+			transform.SetLocalPosition(state.CurrentPosition);
+			transform.SetLocalRotation(state.CurrentRotation);
+			transform.SetLocalScale(state.CurrentScale);
+		}
+	});
+}
+
+void InterpolatedTransform::BeginFixedStep(entt::registry& registry) {
+	registry.view<Transform, InterpolatedTransform>().each([](const Transform& transform, InterpolatedTransform& state) {
+		state.PreviousPosition = transform.GetLocalPosition();
+		state.PreviousRotation = transform.GetLocalRotationQuat();
+		state.PreviousScale = transform.GetLocalScale();
+		state.IsCaptured = true;
+	});
+}
+
+void InterpolatedTransform::Interpolate(entt::registry& registry, float alpha) {
+	registry.view<Transform, InterpolatedTransform>().each([alpha](Transform& transform, InterpolatedTransform& state) {
+		state.CurrentPosition = transform.GetLocalPosition();
+		state.CurrentRotation = transform.GetLocalRotationQuat();
+		state.CurrentScale = transform.GetLocalScale();
+		if (!state.IsCaptured) {
+			state.PreviousPosition = state.CurrentPosition;
+			state.PreviousRotation = state.CurrentRotation;
+			state.PreviousScale = state.CurrentScale;
+			state.IsCaptured = true;
+			return;
+		}
+		transform.SetLocalPosition(glm::mix(state.PreviousPosition, state.CurrentPosition, alpha));
+		transform.SetLocalRotation(glm::slerp(state.PreviousRotation, state.CurrentRotation, alpha));
+		transform.SetLocalScale(glm::mix(state.PreviousScale, state.CurrentScale, alpha));
+	});
+}
+
+void InterpolatedTransform::Reset(entt::handle entity) {
+	entity.get<InterpolatedTransform>().IsCaptured = false;
+}
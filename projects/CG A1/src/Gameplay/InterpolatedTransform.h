@@ -0,0 +1,44 @@
+#pragma once
+#include <entt.hpp>
+#include <GLM/glm.hpp>
+#include <GLM/gtc/quaternion.hpp>
+
+/// <summary>
+/// Opt-in component for entities that are moved by the fixed rate simulation (FixedUpdate). Their transforms are
+/// rendered part way between the last two simulated states, based on Timing::FixedAlpha, so that they move smoothly
+/// when we render faster than we simulate.
+///
+/// The transform holds the interpolated state between frames, and the simulated state is put back right before the
+/// fixed steps run, so entities with this component should only be moved from FixedUpdate. Use Reset after
+/// teleporting one from anywhere else
+/// </summary>
+struct InterpolatedTransform
+{
+	glm::vec3 PreviousPosition = glm::vec3(0.0f);
+	glm::quat PreviousRotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::vec3 PreviousScale    = glm::vec3(1.0f);
+	glm::vec3 CurrentPosition  = glm::vec3(0.0f);
+	glm::quat CurrentRotation  = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::vec3 CurrentScale     = glm::vec3(1.0f);
+	// False until the first interpolation, so that new entities don't interpolate from the origin
+	bool      IsCaptured       = false;
+
+	/// <summary>
+	/// Puts the simulated state back into the transforms, call this once per frame before running any fixed steps
+	/// </summary>
+	static void Restore(entt::registry& registry);
+	/// <summary>
+	/// Remembers the state before a fixed step as the previous state, call this before every fixed step
+	/// </summary>
+	static void BeginFixedStep(entt::registry& registry);
+	/// <summary>
+	/// Remembers the simulated state, and replaces the transforms with the state to render, call this once per frame
+	/// after the fixed steps have run
+	/// </summary>
+	/// <param name="alpha">The interpolation factor between the previous and current states, see Timing::FixedAlpha</param>
+	static void Interpolate(entt::registry& registry, float alpha);
+	/// <summary>
+	/// Stops an entity from interpolating from it's old state, call this after teleporting it outside of FixedUpdate
+	/// </summary>
+	static void Reset(entt::handle entity);
+};
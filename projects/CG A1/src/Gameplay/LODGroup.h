@@ -0,0 +1,59 @@
+#pragma once
+#include <vector>
+#include "Graphics/VertexArrayObject.h"
+
+/// <summary>
+/// One level of detail in a LODGroup
+/// </summary>
+struct LODLevel
+{
+	VertexArrayObject::sptr Mesh;
+	/// <summary>
+	/// The smallest fraction of the screen's height that the object's bounding sphere can cover while this level is
+	/// used, ex 0.25 means the object must be at least a quarter of the screen tall
+	/// </summary>
+	float ScreenCoverage;
+};
+
+/// <summary>
+/// Swaps an entity's RendererComponent mesh for simpler versions as it gets smaller on screen. Levels are ordered from
+/// the most detailed to the least detailed, and each frame the LODSelector picks the first level whose ScreenCoverage
+/// the object still covers (or the last level if it's smaller than all of them) and assigns it's mesh to the renderer.
+///
+/// To stop objects from flickering between levels when they sit right on a threshold, an object has to shrink a bit
+/// past the threshold (by the Hysteresis fraction) before it switches to a coarser level. With a FadeDuration, the old
+/// and new meshes are both drawn for a short time with complementary dither patterns, so the switch is not a pop
+/// </summary>
+struct LODGroup
+{
+	std::vector<LODLevel> Levels;
+	/// <summary>
+	/// How far below a level's ScreenCoverage the object must shrink before it switches to the next level, as a
+	/// fraction of the threshold
+	/// </summary>
+	float Hysteresis = 0.1f;
+	/// <summary>
+	/// The time in seconds to cross-fade between levels, or 0 to switch instantly
+	/// </summary>
+	float FadeDuration = 0.0f;
+
+	/// <summary>
+	/// The level that is currently being drawn, or -1 if none has been selected yet. Managed by the LODSelector
+	/// </summary>
+	int   CurrentLevel = -1;
+	/// <summary>
+	/// The level we are fading out of, or -1 if we are not fading. Managed by the LODSelector
+	/// </summary>
+	int   PreviousLevel = -1;
+	/// <summary>
+	/// How far we are through the fade into CurrentLevel, from 0 to 1. Managed by the LODSelector
+	/// </summary>
+	float Fade = 1.0f;
+
+	LODGroup& AddLevel(const VertexArrayObject::sptr& mesh, float screenCoverage) {
+		Levels.push_back({ mesh, screenCoverage });
+		return *this;
+	}
+
+	bool IsFading() const { return PreviousLevel >= 0; }
+};
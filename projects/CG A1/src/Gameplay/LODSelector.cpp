@@ -0,0 +1,112 @@
+#include "LODSelector.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include "LODGroup.h"
+#include "RendererComponent.h"
+#include "WorldMatrix.h"
+#include "Utilities/JobSystem.h"
+
+float LODSelector::ScreenCoverage(const glm::vec3& center, float radius, const glm::mat4& projection) {
+	// projection[1][1] is the scale from view space to NDC on the y axis, NDC covers 2 units of the screen's height
+	if (projection[3][3] == 1.0f) {
+		// Orthographic, the size on screen does not depend on distance
+		return radius * projection[1][1];
+	}
+	const float distance = glm::length(center);
+	if (distance <= radius) {
+		return std::numeric_limits<float>::max();
+	}
+	return radius * projection[1][1] / distance;
+}
+
+int LODSelector::SelectLevel(const LODGroup& group, float coverage) {
+	const int count = static_cast<int>(group.Levels.size());
+	for (int ix = 0; ix < count - 1; ix++) {
+		float threshold = group.Levels[ix].ScreenCoverage;
+		// While we are drawing this level or a finer one, we hang on until we've shrunk past the hysteresis band
+		if (group.CurrentLevel >= 0 && group.CurrentLevel <= ix) {
+			threshold *= 1.0f - group.Hysteresis;
+		}
+		if (coverage >= threshold) {
+			return ix;
+		}
+	}
+	return std::max(count - 1, 0);
+}
+
+void LODSelector::Update(entt::registry& registry, const glm::mat4& view, const glm::mat4& projection, float deltaTime) {
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	const auto groups = registry.view<LODGroup, RendererComponent, const WorldMatrix>();
+	_groups.assign(groups.begin(), groups.end());
+	_changed.resize(_groups.size());
+
+	JobSystem& jobs = JobSystem::Instance();
+	jobs.Wait(jobs.ParallelFor(_groups.size(), [&](size_t begin, size_t end) {
+		for (size_t ix = begin; ix < end; ix++) {
+			auto [group, renderer, world] = groups.get<LODGroup, RendererComponent, const WorldMatrix>(_groups[ix]);
+			_changed[ix] = 0;
+			if (group.Levels.empty()) {
+				continue;
+			}
+
+			int level = 0;
+			const VertexArrayObject::sptr& finest = group.Levels[0].Mesh;
+			if (Enabled && finest != nullptr && finest->GetBounds().IsValid()) {
+				// Same as the frustum culler, the largest axis scale keeps the whole mesh inside the sphere
+				const BoundingSphere& sphere = finest->GetBoundingSphere();
+				const glm::vec3 center = glm::vec3(view * world.Value * glm::vec4(sphere.Center, 1.0f));
+				const float scale = glm::sqrt(glm::max(glm::max(
+					glm::dot(glm::vec3(world.Value[0]), glm::vec3(world.Value[0])),
+					glm::dot(glm::vec3(world.Value[1]), glm::vec3(world.Value[1]))),
+					glm::dot(glm::vec3(world.Value[2]), glm::vec3(world.Value[2]))));
+				level = SelectLevel(group, ScreenCoverage(center, sphere.Radius * scale, projection) * Bias);
+			}
+
+			if (level != group.CurrentLevel) {
+				// The very first selection has nothing to fade from
+				if (group.CurrentLevel >= 0 && group.FadeDuration > 0.0f) {
+					group.PreviousLevel = group.CurrentLevel;
+					group.Fade = 0.0f;
+				} else {
+					group.PreviousLevel = -1;
+					group.Fade = 1.0f;
+				}
+				group.CurrentLevel = level;
+				_changed[ix] = 1;
+			} else if (group.IsFading()) {
+				group.Fade = group.FadeDuration > 0.0f ? group.Fade + deltaTime / group.FadeDuration : 1.0f;
+				if (group.Fade >= 1.0f) {
+					group.PreviousLevel = -1;
+					group.Fade = 1.0f;
+				}
+			}
+
+			if (group.Levels[group.CurrentLevel].Mesh != nullptr) {
+				renderer.Mesh = group.Levels[group.CurrentLevel].Mesh;
+			}
+		}
+	}, BatchSize));
+
+	_stats.Groups = _groups.size();
+	_stats.Changed = 0;
+	_stats.Fading = 0;
+	std::fill(_stats.LevelCounts.begin(), _stats.LevelCounts.end(), 0);
+	for (size_t ix = 0; ix < _groups.size(); ix++) {
+		const LODGroup& group = groups.get<LODGroup>(_groups[ix]);
+		if (group.CurrentLevel < 0) {
+			continue;
+		}
+		if (static_cast<size_t>(group.CurrentLevel) >= _stats.LevelCounts.size()) {
+			_stats.LevelCounts.resize(group.CurrentLevel + 1, 0);
+		}
+		_stats.LevelCounts[group.CurrentLevel]++;
+		_stats.Changed += _changed[ix];
+		_stats.Fading += group.IsFading() ? 1 : 0;
+	}
+
+	const auto end = std::chrono::high_resolution_clock::now();
+	_stats.Ms = std::chrono::duration<double, std::milli>(end - start).count();
+}
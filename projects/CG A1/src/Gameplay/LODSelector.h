@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <entt.hpp>
+#include <GLM/glm.hpp>
+
+struct LODGroup;
+
+/// <summary>
+/// Counters from the last call to LODSelector::Update
+/// </summary>
+struct LODStats
+{
+	size_t Groups  = 0;
+	// The number of groups that changed level this frame
+	size_t Changed = 0;
+	size_t Fading  = 0;
+	// The number of groups drawing each level, LevelCounts[0] is the most detailed
+	std::vector<size_t> LevelCounts;
+	double Ms      = 0.0;
+};
+
+/// <summary>
+/// Picks the level of detail for every LODGroup from the camera each frame, and assigns the chosen mesh to the
+/// entity's RendererComponent.
+///
+/// An object's screen coverage is the fraction of the screen's height covered by it's most detailed mesh's bounding
+/// sphere, using the entity's WorldMatrix and the camera's projection. Groups are independent of each other, so large
+/// scenes are split into batches on the job system.
+///
+/// Since the renderer's mesh is replaced, culling and sorting see the selected level. Call this before culling
+/// </summary>
+class LODSelector final
+{
+public:
+	/// <summary>
+	/// If false, every group is drawn at it's most detailed level
+	/// </summary>
+	bool   Enabled = true;
+	/// <summary>
+	/// Multiplies every object's screen coverage, values below 1 favor coarser levels and above 1 favor finer ones
+	/// </summary>
+	float  Bias = 1.0f;
+	size_t BatchSize = 512;
+
+	LODSelector() = default;
+	~LODSelector() = default;
+
+	LODSelector(const LODSelector& other) = delete;
+	LODSelector(LODSelector&& other) = delete;
+	LODSelector& operator=(const LODSelector& other) = delete;
+	LODSelector& operator=(LODSelector&& other) = delete;
+
+	/// <summary>
+	/// Selects levels for all entities with LODGroup, RendererComponent and WorldMatrix components
+	/// </summary>
+	/// <param name="registry">The registry holding the groups</param>
+	/// <param name="view">The view matrix of the camera</param>
+	/// <param name="projection">The projection matrix of the camera, perspective or orthographic</param>
+	/// <param name="deltaTime">The time since the last update in seconds, used to advance cross-fades</param>
+	void Update(entt::registry& registry, const glm::mat4& view, const glm::mat4& projection, float deltaTime);
+
+	const LODStats& GetStats() const { return _stats; }
+
+	/// <summary>
+	/// Works out how much of the screen's height a sphere covers
+	/// </summary>
+	/// <param name="center">The center of the sphere, in view space</param>
+	/// <param name="radius">The radius of the sphere</param>
+	/// <param name="projection">The projection matrix of the camera</param>
+	/// <returns>The fraction of the screen's height covered, 1 or more if the camera is inside the sphere</returns>
+	static float ScreenCoverage(const glm::vec3& center, float radius, const glm::mat4& projection);
+
+	/// <summary>
+	/// Picks the level for a screen coverage, starting from the level that is currently drawn
+	/// </summary>
+	/// <param name="group">The group to select a level for</param>
+	/// <param name="coverage">The fraction of the screen's height that the group covers</param>
+	/// <returns>The index of the level to draw</returns>
+	static int SelectLevel(const LODGroup& group, float coverage);
+
+private:
+	std::vector<entt::entity> _groups;
+	// 1 for each group that changed level in the last update
+	std::vector<uint8_t>      _changed;
+	LODStats _stats;
+};
@@ -0,0 +1,16 @@
+#pragma once
+#include <GLM/glm.hpp>
+#include <GLM/gtc/quaternion.hpp>
+
+/// <summary>
+/// The local position, rotation and scale of an entity. This is the only part of a transform that the
+/// TransformKernel reads, so it is kept in it's own tightly packed component, apart from the hierarchy links in
+/// the Transform. Every entity with a Transform has one, and it should be modified through the Transform so that
+/// the world matrices are marked dirty
+/// </summary>
+struct LocalTRS
+{
+	glm::vec3 Position = glm::vec3(0.0f);
+	glm::quat Rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::vec3 Scale    = glm::vec3(1.0f);
+};
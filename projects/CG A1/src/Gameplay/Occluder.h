@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <GLM/glm.hpp>
+#include <CerealGLM.h>
+#include <cereal/types/memory.hpp>
+#include <cereal/types/vector.hpp>
+#include "Utilities/MeshBuilder.h"
+
+/// <summary>
+/// A CPU side copy of a mesh's triangles, used by the OcclusionCuller to draw the mesh into it's depth buffer. Only
+/// positions are kept, and a simplified version of the render mesh works just as well, as long as it does not
+/// stick out past the real mesh
+/// </summary>
+struct OccluderMesh
+{
+	typedef std::shared_ptr<OccluderMesh> sptr;
+
+	std::vector<glm::vec3> Positions;
+	// Three per triangle
+	std::vector<uint32_t>  Indices;
+
+	/// <summary>
+	/// Copies the triangles out of a mesh builder
+	/// </summary>
+	template <typename VertType>
+	static sptr Create(const MeshBuilder<VertType>& mesh) {
+		sptr result = std::make_shared<OccluderMesh>();
+		const VertType* vertices = mesh.GetVertexDataPtr();
+		result->Positions.reserve(mesh.GetVertexCount());
+		for (size_t ix = 0; ix < mesh.GetVertexCount(); ix++) {
+			result->Positions.push_back(vertices[ix].Position);
+		}
+		if (mesh.GetIndexCount() > 0) {
+			result->Indices.assign(mesh.GetIndexDataPtr(), mesh.GetIndexDataPtr() + mesh.GetIndexCount());
+		} else {
+			result->Indices.reserve(mesh.GetVertexCount());
+			for (uint32_t ix = 0; ix < static_cast<uint32_t>(mesh.GetVertexCount()); ix++) {
+				result->Indices.push_back(ix);
+			}
+		}
+		return result;
+	}
+
+	template <typename Archive>
+	void serialize(Archive& archive) {
+		archive(Positions, Indices);
+	}
+};
+
+/// <summary>
+/// Marks an entity as an occluder, it's mesh will be drawn into the OcclusionCuller's depth buffer (using the
+/// entity's WorldMatrix) and can hide other renderers. Occluders should be large, solid objects like terrain and
+/// buildings
+/// </summary>
+struct Occluder
+{
+	OccluderMesh::sptr Mesh;
+
+	// Occluders that share a mesh still share it after a snapshot is loaded, cereal only writes each mesh once
+	template <typename Archive>
+	void serialize(Archive& archive) {
+		archive(Mesh);
+	}
+};
@@ -0,0 +1,368 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include "Bounds.h"
+#include "Occluder.h"
+#include "RendererComponent.h"
+#include "WorldMatrix.h"
+#include "Utilities/JobSystem.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define OCCLUSION_CULLER_SSE
+#include <xmmintrin.h>
+#endif
+
+// The number of depth buffer rows in each band that is rasterized as a single job
+static constexpr int BAND_HEIGHT = 8;
+
+OcclusionCuller::OcclusionCuller(int width, int height) :
+	_width((std::max(width, 4) + 3) & ~3),
+	_height(std::max(height, 1)),
+	_viewProjection(1.0f)
+{
+	// Each level is half the size of the one before it (rounding up), down to a single texel
+	int levelWidth = _width, levelHeight = _height;
+	while (true) {
+		Level level;
+		level.Width = levelWidth;
+		level.Height = levelHeight;
+		level.Depth.resize(static_cast<size_t>(levelWidth) * levelHeight, 1.0f);
+		_levels.push_back(std::move(level));
+		if (levelWidth == 1 && levelHeight == 1) {
+			break;
+		}
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+	}
+}
+
+void OcclusionCuller::Cull(const entt::registry& registry, const std::vector<entt::entity>& candidates, const glm::mat4& viewProjection) {
+	if (!Enabled) {
+		_visible = candidates;
+		_stats = OcclusionStats();
+		_stats.Tested = candidates.size();
+		return;
+	}
+
+	RenderOccluders(registry, viewProjection);
+
+	const auto start = std::chrono::high_resolution_clock::now();
+	const size_t count = candidates.size();
+	_results.resize(count);
+
+	JobSystem& jobs = JobSystem::Instance();
+	jobs.Wait(jobs.ParallelFor(count, [&](size_t begin, size_t end) {
+		for (size_t ix = begin; ix < end; ix++) {
+			const entt::entity entity = candidates[ix];
+			const RendererComponent* renderer = registry.try_get<RendererComponent>(entity);
+			const WorldBounds* bounds = registry.try_get<WorldBounds>(entity);
+			if (bounds == nullptr || !bounds->Value.IsValid() || registry.has<Occluder>(entity) ||
+				(renderer != nullptr && renderer->Material != nullptr && !renderer->Material->IsCullable)) {
+				_results[ix] = 1;
+			} else {
+				_results[ix] = IsVisible(bounds->Value) ? 1 : 0;
+			}
+		}
+	}, BatchSize));
+
+	// Compact the survivors, keeping their order
+	_visible.clear();
+	for (size_t ix = 0; ix < count; ix++) {
+		if (_results[ix]) {
+			_visible.push_back(candidates[ix]);
+		}
+	}
+
+	const auto end = std::chrono::high_resolution_clock::now();
+	_stats.Tested = count;
+	_stats.Occluded = count - _visible.size();
+	_stats.TestMs = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void OcclusionCuller::RenderOccluders(const entt::registry& registry, const glm::mat4& viewProjection) {
+	const auto start = std::chrono::high_resolution_clock::now();
+	_viewProjection = viewProjection;
+
+	_occluders.clear();
+	const auto view = registry.view<const Occluder, const WorldMatrix>();
+	for (entt::entity entity : view) {
+		if (view.get<const Occluder>(entity).Mesh != nullptr) {
+			_occluders.push_back(entity);
+		}
+	}
+
+	// Set up the triangles for each occluder in parallel, each one has it's own output list
+	if (_triangles.size() < _occluders.size()) {
+		_triangles.resize(_occluders.size());
+	}
+	JobSystem& jobs = JobSystem::Instance();
+	jobs.Wait(jobs.ParallelFor(_occluders.size(), [&](size_t begin, size_t end) {
+		for (size_t ix = begin; ix < end; ix++) {
+			_triangles[ix].clear();
+			_SetupTriangles(registry, _occluders[ix], _triangles[ix]);
+		}
+	}, 1));
+
+	size_t triangleCount = 0;
+	for (size_t ix = 0; ix < _occluders.size(); ix++) {
+		triangleCount += _triangles[ix].size();
+	}
+
+	// Bands never share rows, so they can all be filled at the same time without any locking
+	std::fill(_levels[0].Depth.begin(), _levels[0].Depth.end(), 1.0f);
+	const size_t bandCount = static_cast<size_t>((_height + BAND_HEIGHT - 1) / BAND_HEIGHT);
+	jobs.Wait(jobs.ParallelFor(bandCount, [&](size_t begin, size_t end) {
+		for (size_t band = begin; band < end; band++) {
+			const int bandMin = static_cast<int>(band) * BAND_HEIGHT;
+			const int bandMax = std::min(bandMin + BAND_HEIGHT, _height) - 1;
+			for (size_t ix = 0; ix < _occluders.size(); ix++) {
+				for (const ScreenTriangle& triangle : _triangles[ix]) {
+					if (triangle.MaxY >= bandMin && triangle.MinY <= bandMax) {
+						_Rasterize(triangle, std::max(triangle.MinY, bandMin), std::min(triangle.MaxY, bandMax));
+					}
+				}
+			}
+		}
+	}, 1));
+
+	_BuildPyramid();
+
+	const auto end = std::chrono::high_resolution_clock::now();
+	_stats.Occluders = _occluders.size();
+	_stats.Triangles = triangleCount;
+	_stats.RasterMs = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+bool OcclusionCuller::IsVisible(const AABB& bounds) const {
+	glm::vec2 screenMin(std::numeric_limits<float>::max());
+	glm::vec2 screenMax(std::numeric_limits<float>::lowest());
+	float minDepth = 1.0f;
+	// Projection is linear in clip space, so we transform one corner and step along the box's edges from there
+	const glm::vec3 size = bounds.Max - bounds.Min;
+	const glm::vec4 origin = _viewProjection * glm::vec4(bounds.Min, 1.0f);
+	const glm::vec4 axisX = _viewProjection[0] * size.x;
+	const glm::vec4 axisY = _viewProjection[1] * size.y;
+	const glm::vec4 axisZ = _viewProjection[2] * size.z;
+	for (int ix = 0; ix < 8; ix++) {
+		glm::vec4 clip = origin;
+		if (ix & 1) { clip += axisX; }
+		if (ix & 2) { clip += axisY; }
+		if (ix & 4) { clip += axisZ; }
+		// Boxes that cross the near plane are right in front of the camera, we can't project them so just draw them
+		if (clip.w <= 1e-5f || clip.z < -clip.w) {
+			return true;
+		}
+		const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		const glm::vec2 screen((ndc.x * 0.5f + 0.5f) * _width, (ndc.y * 0.5f + 0.5f) * _height);
+		screenMin = glm::min(screenMin, screen);
+		screenMax = glm::max(screenMax, screen);
+		minDepth = std::min(minDepth, ndc.z * 0.5f + 0.5f);
+	}
+
+	// Off screen boxes are left to the frustum culler
+	if (screenMax.x < 0.0f || screenMax.y < 0.0f || screenMin.x >= _width || screenMin.y >= _height) {
+		return true;
+	}
+	// Every pixel that the rectangle touches, even partially
+	const int x0 = std::max(static_cast<int>(std::floor(screenMin.x)), 0);
+	const int y0 = std::max(static_cast<int>(std::floor(screenMin.y)), 0);
+	const int x1 = std::min(static_cast<int>(std::floor(screenMax.x)), _width - 1);
+	const int y1 = std::min(static_cast<int>(std::floor(screenMax.y)), _height - 1);
+
+	// Pick the level where the rectangle covers at most 2x2 texels
+	int level = 0;
+	while (level + 1 < static_cast<int>(_levels.size()) && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) {
+		level++;
+	}
+
+	// The box is only hidden if it's closest point is behind the furthest depth of every texel it covers
+	const Level& mip = _levels[level];
+	for (int y = y0 >> level; y <= (y1 >> level); y++) {
+		for (int x = x0 >> level; x <= (x1 >> level); x++) {
+			if (minDepth <= mip.Depth[static_cast<size_t>(y) * mip.Width + x]) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void OcclusionCuller::_SetupTriangles(const entt::registry& registry, entt::entity occluder, std::vector<ScreenTriangle>& output) const {
+	const OccluderMesh& mesh = *registry.get<Occluder>(occluder).Mesh;
+	const glm::mat4 transform = _viewProjection * registry.get<WorldMatrix>(occluder).Value;
+
+	// Each worker keeps it's own scratch space, so we don't allocate every frame
+	thread_local std::vector<glm::vec4> clip;
+	clip.resize(mesh.Positions.size());
+	for (size_t ix = 0; ix < mesh.Positions.size(); ix++) {
+		clip[ix] = transform * glm::vec4(mesh.Positions[ix], 1.0f);
+	}
+
+	for (size_t ix = 0; ix + 2 < mesh.Indices.size(); ix += 3) {
+		const glm::vec4& a = clip[mesh.Indices[ix]];
+		const glm::vec4& b = clip[mesh.Indices[ix + 1]];
+		const glm::vec4& c = clip[mesh.Indices[ix + 2]];
+
+		// Skip triangles that are entirely outside of one of the other frustum planes
+		if ((a.x >  a.w && b.x >  b.w && c.x >  c.w) || (a.x < -a.w && b.x < -b.w && c.x < -c.w) ||
+			(a.y >  a.w && b.y >  b.w && c.y >  c.w) || (a.y < -a.w && b.y < -b.w && c.y < -c.w) ||
+			(a.z >  a.w && b.z >  b.w && c.z >  c.w)) {
+			continue;
+		}
+		_AddTriangle(a, b, c, output);
+	}
+}
+
+void OcclusionCuller::_AddTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c, std::vector<ScreenTriangle>& output) const {
+	// Clip against the near plane (z >= -w), which can leave us with up to 4 vertices
+	const glm::vec4 input[3] = { a, b, c };
+	glm::vec4 polygon[4];
+	int count = 0;
+	for (int ix = 0; ix < 3; ix++) {
+		const glm::vec4& current = input[ix];
+		const glm::vec4& next = input[(ix + 1) % 3];
+		const float currentDistance = current.z + current.w;
+		const float nextDistance = next.z + next.w;
+		if (currentDistance >= 0.0f) {
+			polygon[count++] = current;
+		}
+		if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f)) {
+			const float t = currentDistance / (currentDistance - nextDistance);
+			polygon[count++] = glm::mix(current, next, t);
+		}
+	}
+	if (count < 3) {
+		return;
+	}
+
+	glm::vec3 screen[4];
+	for (int ix = 0; ix < count; ix++) {
+		// w can only be 0 here if the near plane is at 0, which the projection matrices don't allow
+		const float invW = 1.0f / polygon[ix].w;
+		screen[ix] = glm::vec3(
+			(polygon[ix].x * invW * 0.5f + 0.5f) * _width,
+			(polygon[ix].y * invW * 0.5f + 0.5f) * _height,
+			polygon[ix].z * invW * 0.5f + 0.5f);
+	}
+
+	// Fan out the polygon into triangles
+	for (int ix = 1; ix + 1 < count; ix++) {
+		glm::vec3 v0 = screen[0], v1 = screen[ix], v2 = screen[ix + 1];
+		float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+		if (std::abs(area) < 1e-8f) {
+			continue;
+		}
+		// Occluders are drawn from both sides, so we flip the back faces to keep the edge functions positive inside
+		if (area < 0.0f) {
+			std::swap(v1, v2);
+			area = -area;
+		}
+
+		const float minY = std::min(std::min(v0.y, v1.y), v2.y);
+		const float maxY = std::max(std::max(v0.y, v1.y), v2.y);
+		const float minX = std::min(std::min(v0.x, v1.x), v2.x);
+		const float maxX = std::max(std::max(v0.x, v1.x), v2.x);
+		if (maxY < 0.0f || minY >= _height || maxX < 0.0f || minX >= _width) {
+			continue;
+		}
+
+		ScreenTriangle triangle;
+		triangle.Vertices[0] = glm::vec2(v0);
+		triangle.Vertices[1] = glm::vec2(v1);
+		triangle.Vertices[2] = glm::vec2(v2);
+		// Solve for the plane that goes through the depths of the 3 vertices
+		const float dz1 = v1.z - v0.z, dz2 = v2.z - v0.z;
+		triangle.DepthPlane.x = (dz1 * (v2.y - v0.y) - dz2 * (v1.y - v0.y)) / area;
+		triangle.DepthPlane.y = ((v1.x - v0.x) * dz2 - (v2.x - v0.x) * dz1) / area;
+		triangle.DepthPlane.z = v0.z - triangle.DepthPlane.x * v0.x - triangle.DepthPlane.y * v0.y;
+		triangle.MinY = std::max(static_cast<int>(std::floor(minY)), 0);
+		triangle.MaxY = std::min(static_cast<int>(std::ceil(maxY)), _height - 1);
+		output.push_back(triangle);
+	}
+}
+
+void OcclusionCuller::_Rasterize(const ScreenTriangle& triangle, int minY, int maxY) {
+	// Edge function for each edge, positive on the inside: E(x, y) = A * x + B * y + C
+	float edgeA[3], edgeB[3], edgeC[3];
+	for (int ix = 0; ix < 3; ix++) {
+		const glm::vec2& p = triangle.Vertices[ix];
+		const glm::vec2& q = triangle.Vertices[(ix + 1) % 3];
+		edgeA[ix] = -(q.y - p.y);
+		edgeB[ix] = q.x - p.x;
+		edgeC[ix] = -edgeA[ix] * p.x - edgeB[ix] * p.y;
+	}
+
+	const float minX = std::min(std::min(triangle.Vertices[0].x, triangle.Vertices[1].x), triangle.Vertices[2].x);
+	const float maxX = std::max(std::max(triangle.Vertices[0].x, triangle.Vertices[1].x), triangle.Vertices[2].x);
+	// Start on a multiple of 4 so that the SSE loop never runs past the end of the row (the width is a multiple of 4)
+	const int startX = std::max(static_cast<int>(std::floor(minX)), 0) & ~3;
+	const int endX = std::min(static_cast<int>(std::ceil(maxX)), _width - 1);
+
+	float* depth = _levels[0].Depth.data();
+	const glm::vec3& plane = triangle.DepthPlane;
+
+	#ifdef OCCLUSION_CULLER_SSE
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 a0 = _mm_set1_ps(edgeA[0]), a1 = _mm_set1_ps(edgeA[1]), a2 = _mm_set1_ps(edgeA[2]);
+	const __m128 depthA = _mm_set1_ps(plane.x);
+	const __m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+	#endif
+
+	for (int y = minY; y <= maxY; y++) {
+		// Pixels are sampled at their centers
+		const float py = y + 0.5f;
+		const float rowE0 = edgeB[0] * py + edgeC[0];
+		const float rowE1 = edgeB[1] * py + edgeC[1];
+		const float rowE2 = edgeB[2] * py + edgeC[2];
+		const float rowDepth = plane.y * py + plane.z;
+		float* row = depth + static_cast<size_t>(y) * _width;
+
+		#ifdef OCCLUSION_CULLER_SSE
+		const __m128 e0Row = _mm_set1_ps(rowE0), e1Row = _mm_set1_ps(rowE1), e2Row = _mm_set1_ps(rowE2);
+		const __m128 depthRow = _mm_set1_ps(rowDepth);
+		for (int x = startX; x <= endX; x += 4) {
+			const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets);
+			const __m128 inside = _mm_and_ps(
+				_mm_and_ps(
+					_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, px), e0Row), zero),
+					_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, px), e1Row), zero)),
+				_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, px), e2Row), zero));
+			if (_mm_movemask_ps(inside) == 0) {
+				continue;
+			}
+			const __m128 previous = _mm_loadu_ps(row + x);
+			const __m128 closest = _mm_min_ps(previous, _mm_add_ps(_mm_mul_ps(depthA, px), depthRow));
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closest), _mm_andnot_ps(inside, previous)));
+		}
+		#else
+		for (int x = startX; x <= endX; x++) {
+			const float px = x + 0.5f;
+			if (edgeA[0] * px + rowE0 >= 0.0f && edgeA[1] * px + rowE1 >= 0.0f && edgeA[2] * px + rowE2 >= 0.0f) {
+				row[x] = std::min(row[x], plane.x * px + rowDepth);
+			}
+		}
+		#endif
+	}
+}
+
+void OcclusionCuller::_BuildPyramid() {
+	for (size_t ix = 1; ix < _levels.size(); ix++) {
+		const Level& source = _levels[ix - 1];
+		Level& target = _levels[ix];
+		for (int y = 0; y < target.Height; y++) {
+			// Odd sized levels have their last row or column folded into the last texel
+			const int sy0 = y * 2;
+			const int sy1 = std::min(sy0 + 1, source.Height - 1);
+			for (int x = 0; x < target.Width; x++) {
+				const int sx0 = x * 2;
+				const int sx1 = std::min(sx0 + 1, source.Width - 1);
+				target.Depth[static_cast<size_t>(y) * target.Width + x] = std::max(
+					std::max(source.Depth[static_cast<size_t>(sy0) * source.Width + sx0], source.Depth[static_cast<size_t>(sy0) * source.Width + sx1]),
+					std::max(source.Depth[static_cast<size_t>(sy1) * source.Width + sx0], source.Depth[static_cast<size_t>(sy1) * source.Width + sx1]));
+			}
+		}
+	}
+}
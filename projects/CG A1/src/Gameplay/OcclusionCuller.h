@@ -0,0 +1,133 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <entt.hpp>
+#include <GLM/glm.hpp>
+#include "Utilities/BoundingVolumes.h"
+
+/// <summary>
+/// Counters from the last call to OcclusionCuller::Cull
+/// </summary>
+struct OcclusionStats
+{
+	size_t Occluders = 0;
+	// The number of occluder triangles that made it to the rasterizer, after clipping
+	size_t Triangles = 0;
+	size_t Tested    = 0;
+	size_t Occluded  = 0;
+	// Time spent drawing the occluders and building the depth pyramid, and testing the occludees, in milliseconds
+	double RasterMs  = 0.0;
+	double TestMs    = 0.0;
+};
+
+/// <summary>
+/// Culls renderers that are hidden behind large occluders, without any help from the GPU.
+///
+/// Every entity with an Occluder component has it's mesh drawn into a small depth buffer by a software rasterizer.
+/// The screen is split into bands that are rasterized in parallel on the job system, and within a band each
+/// triangle is filled 4 pixels at a time with SSE. The depth buffer is then reduced into a hierarchical-Z pyramid,
+/// where each texel holds the furthest depth of the 4 texels below it.
+///
+/// Occludees are tested with their WorldBounds. The box is projected to the screen, and it is hidden only if it's
+/// closest point is further away than everything in the pyramid texels that it covers, so objects are never culled
+/// when they might be visible (aside from the usual small errors at the edges of occluders, since the buffer is much
+/// smaller than the screen). Entities without WorldBounds, occluders themselves, and renderers with a material that is
+/// not cullable are always visible.
+///
+/// Since nothing is read back from the GPU, this never stalls the pipeline and can be run without a window
+/// </summary>
+class OcclusionCuller final
+{
+public:
+	/// <summary>
+	/// If false, everything is treated as visible
+	/// </summary>
+	bool   Enabled = true;
+	/// <summary>
+	/// The number of candidates tested per job
+	/// </summary>
+	size_t BatchSize = 256;
+
+	/// <summary>
+	/// Creates an occlusion culler
+	/// </summary>
+	/// <param name="width">The width of the depth buffer, rounded up to a multiple of 4</param>
+	/// <param name="height">The height of the depth buffer</param>
+	OcclusionCuller(int width = 256, int height = 128);
+	~OcclusionCuller() = default;
+
+	OcclusionCuller(const OcclusionCuller& other) = delete;
+	OcclusionCuller(OcclusionCuller&& other) = delete;
+	OcclusionCuller& operator=(const OcclusionCuller& other) = delete;
+	OcclusionCuller& operator=(OcclusionCuller&& other) = delete;
+
+	/// <summary>
+	/// Draws all of the occluders in a registry, and then tests a list of candidates against them, see GetVisible for
+	/// the results
+	/// </summary>
+	/// <param name="registry">The registry holding the occluders and candidates</param>
+	/// <param name="candidates">The entities to test, usually the output of the FrustumCuller</param>
+	/// <param name="viewProjection">The view projection matrix of the camera</param>
+	void Cull(const entt::registry& registry, const std::vector<entt::entity>& candidates, const glm::mat4& viewProjection);
+
+	/// <summary>
+	/// Draws all of the occluders in a registry into the depth buffer, and builds the depth pyramid
+	/// </summary>
+	void RenderOccluders(const entt::registry& registry, const glm::mat4& viewProjection);
+	/// <summary>
+	/// Tests a world space box against the depth pyramid from the last call to RenderOccluders
+	/// </summary>
+	/// <returns>True if the box may be visible, false if it is definitely hidden</returns>
+	bool IsVisible(const AABB& bounds) const;
+
+	/// <summary>
+	/// Gets the entities that passed the last cull, in the order they were given
+	/// </summary>
+	const std::vector<entt::entity>& GetVisible() const { return _visible; }
+	const OcclusionStats& GetStats() const { return _stats; }
+
+	int GetWidth() const { return _width; }
+	int GetHeight() const { return _height; }
+	/// <summary>
+	/// Gets the depth buffer from the last call to RenderOccluders, row by row from the bottom of the screen. Depths
+	/// go from 0 at the near plane to 1 at the far plane, and 1 where nothing was drawn
+	/// </summary>
+	const std::vector<float>& GetDepthBuffer() const { return _levels[0].Depth; }
+
+private:
+	struct Level {
+		int Width;
+		int Height;
+		std::vector<float> Depth;
+	};
+	// A triangle that has been clipped and projected to the depth buffer, with it's depth as a plane equation
+	struct ScreenTriangle {
+		glm::vec2 Vertices[3];
+		// depth = DepthPlane.x * x + DepthPlane.y * y + DepthPlane.z
+		glm::vec3 DepthPlane;
+		// The range of rows that the triangle touches
+		int MinY;
+		int MaxY;
+	};
+
+	int _width;
+	int _height;
+	glm::mat4 _viewProjection;
+	// The depth buffer is level 0, each level after that is half the size of the last
+	std::vector<Level> _levels;
+
+	std::vector<entt::entity> _occluders;
+	// The triangles for each occluder, these are set up in parallel so each occluder gets it's own list
+	std::vector<std::vector<ScreenTriangle>> _triangles;
+	std::vector<uint8_t> _results;
+	std::vector<entt::entity> _visible;
+	OcclusionStats _stats;
+
+	// Transforms, clips and projects the triangles of an occluder
+	void _SetupTriangles(const entt::registry& registry, entt::entity occluder, std::vector<ScreenTriangle>& output) const;
+	// Clips a clip space triangle against the near plane, and adds what's left to the list
+	void _AddTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c, std::vector<ScreenTriangle>& output) const;
+	// Fills the rows [minY, maxY] of a triangle into the depth buffer
+	void _Rasterize(const ScreenTriangle& triangle, int minY, int maxY);
+	void _BuildPyramid();
+};
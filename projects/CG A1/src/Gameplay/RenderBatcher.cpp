@@ -0,0 +1,168 @@
+#include "RenderBatcher.h"
+
+#include <chrono>
+#include <cstddef>
+#include "LODGroup.h"
+#include "RendererComponent.h"
+#include "WorldMatrix.h"
+#include "Graphics/GLStateCache.h"
+#include "Utilities/JobSystem.h"
+
+const std::vector<BufferAttribute>& RenderBatcher::GetInstanceAttributes() {
+	static const std::vector<BufferAttribute> attributes = [] {
+		std::vector<BufferAttribute> result;
+		// Matrices take one slot per column
+		for (GLuint column = 0; column < 4; column++) {
+			result.push_back(BufferAttribute(INSTANCE_SLOT + column, 4, GL_FLOAT, false, sizeof(InstanceData),
+				offsetof(InstanceData, Model) + sizeof(glm::vec4) * column, AttribUsage::User0));
+		}
+		for (GLuint column = 0; column < 3; column++) {
+			result.push_back(BufferAttribute(INSTANCE_SLOT + 4 + column, 3, GL_FLOAT, false, sizeof(InstanceData),
+				offsetof(InstanceData, NormalMatrix) + sizeof(glm::vec3) * column, AttribUsage::User1));
+		}
+		return result;
+	}();
+	return attributes;
+}
+
+void RenderBatcher::Build(const entt::registry& registry, const std::vector<entt::entity>& entities) {
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	// Copy out the matrices first, this is the bulk of the work and every entity is independent
+	_instances.resize(entities.size());
+	const auto gather = [&](size_t begin, size_t end) {
+		for (size_t ix = begin; ix < end; ix++) {
+			_instances[ix].Model = registry.get<WorldMatrix>(entities[ix]).Value;
+			_instances[ix].NormalMatrix = registry.get<WorldNormalMatrix>(entities[ix]).Value;
+		}
+	};
+	if (entities.size() >= MinParallelCount) {
+		JobSystem& jobs = JobSystem::Instance();
+		jobs.Wait(jobs.ParallelFor(entities.size(), gather, BatchSize));
+	} else {
+		gather(0, entities.size());
+	}
+
+	// Then split the list in to runs of the same mesh and material
+	_batches.clear();
+	_stats.Renderers = 0;
+	_stats.Instanced = 0;
+	const auto addBatch = [&](VertexArrayObject* mesh, ShaderMaterial* material, size_t ix, float lodFade) {
+		DrawBatch& batch = _batches.emplace_back();
+		batch.Mesh = mesh;
+		batch.Material = material;
+		batch.FirstInstance = static_cast<uint32_t>(ix);
+		batch.InstanceCount = 1;
+		batch.LodFade = lodFade;
+	};
+	for (size_t ix = 0; ix < entities.size(); ix++) {
+		const RendererComponent& renderer = registry.get<RendererComponent>(entities[ix]);
+		if (renderer.Mesh == nullptr || renderer.Material == nullptr) {
+			continue;
+		}
+		_stats.Renderers++;
+
+		// Objects that are switching levels of detail draw both levels dithered together, with a uniform that
+		// has to be set for each of them
+		const LODGroup* lod = registry.try_get<LODGroup>(entities[ix]);
+		if (lod != nullptr && lod->IsFading() && lod->PreviousLevel < static_cast<int>(lod->Levels.size()) && lod->Levels[lod->PreviousLevel].Mesh != nullptr) {
+			addBatch(renderer.Mesh.get(), renderer.Material.get(), ix, lod->Fade);
+			addBatch(lod->Levels[lod->PreviousLevel].Mesh.get(), renderer.Material.get(), ix, lod->Fade - 1.0f);
+			continue;
+		}
+
+		if (Enabled && !_batches.empty()) {
+			DrawBatch& last = _batches.back();
+			// The instances in a batch have to be next to each other in the buffer, skipped renderers break the run
+			if (last.Mesh == renderer.Mesh.get() && last.Material == renderer.Material.get() && last.LodFade == 1.0f &&
+				last.FirstInstance + last.InstanceCount == ix) {
+				_stats.Instanced += last.InstanceCount == 1 ? 2 : 1;
+				last.InstanceCount++;
+				continue;
+			}
+		}
+		addBatch(renderer.Mesh.get(), renderer.Material.get(), ix, 1.0f);
+	}
+	_commands.clear();
+	_stats.MultiDraws = 0;
+	_stats.Commands = 0;
+	if (MultiDraw) {
+		_MergeMultiDraws();
+	}
+	_stats.Batches = _batches.size();
+
+	const auto end = std::chrono::high_resolution_clock::now();
+	_stats.Ms = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void RenderBatcher::_MergeMultiDraws() {
+	// Batches from the same arena can be drawn together if nothing needs to change between them
+	const auto canMerge = [](const DrawBatch& a, const DrawBatch& b) {
+		return a.Mesh->IsRange() && b.Mesh->IsRange() && a.Mesh->GetSource() == b.Mesh->GetSource() &&
+			a.Material == b.Material && a.LodFade == 1.0f && b.LodFade == 1.0f;
+	};
+	const auto toCommand = [](const DrawBatch& batch) {
+		return DrawElementsIndirectCommand{ static_cast<uint32_t>(batch.Mesh->GetIndexCount()), batch.InstanceCount,
+			batch.Mesh->GetFirstIndex(), batch.Mesh->GetBaseVertex(), batch.FirstInstance };
+	};
+
+	size_t count = 0;
+	for (size_t ix = 0; ix < _batches.size(); ix++) {
+		const DrawBatch batch = _batches[ix];
+		// Batches that can't be merged with the next one are left alone, a multi-draw of one is no better
+		if (ix + 1 >= _batches.size() || !canMerge(batch, _batches[ix + 1])) {
+			_batches[count++] = batch;
+			continue;
+		}
+
+		DrawBatch merged = batch;
+		merged.Mesh = batch.Mesh->GetSource();
+		merged.FirstCommand = static_cast<uint32_t>(_commands.size());
+		_commands.push_back(toCommand(batch));
+		while (ix + 1 < _batches.size() && canMerge(batch, _batches[ix + 1])) {
+			ix++;
+			merged.InstanceCount += _batches[ix].InstanceCount;
+			_commands.push_back(toCommand(_batches[ix]));
+		}
+		merged.CommandCount = static_cast<uint32_t>(_commands.size()) - merged.FirstCommand;
+		_stats.MultiDraws++;
+		_stats.Commands += merged.CommandCount;
+		_batches[count++] = merged;
+	}
+	_batches.resize(count);
+}
+
+void RenderBatcher::Upload() {
+	if (_instanceBuffer == nullptr) {
+		// Starts with room for a few thousand instances per frame, and grows if it needs more
+		_instanceBuffer = StreamingBuffer::Create(sizeof(InstanceData) * 4096);
+	}
+	if (!_instances.empty()) {
+		const GLuint base = _instanceBuffer->Write(_instances.data(), _instances.size());
+		for (DrawBatch& batch : _batches) {
+			batch.FirstInstance += base;
+		}
+		for (DrawElementsIndirectCommand& command : _commands) {
+			command.BaseInstance += base;
+		}
+	}
+	if (!_commands.empty()) {
+		if (_commandBuffer == nullptr) {
+			// There is one command per mesh in a multi-draw, so this is plenty for most scenes, and grows if it isn't
+			_commandBuffer = StreamingBuffer::Create(sizeof(DrawElementsIndirectCommand) * 1024);
+		}
+		const GLuint first = _commandBuffer->Write(_commands.data(), _commands.size());
+		for (DrawBatch& batch : _batches) {
+			if (batch.CommandCount > 0) {
+				batch.FirstCommand += first;
+			}
+		}
+		// Streaming buffers are vertex buffers, so we bind it to the indirect target ourselves
+		GLStateCache::Instance().BindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer->GetHandle());
+	}
+	for (const DrawBatch& batch : _batches) {
+		if (!batch.Mesh->HasBuffer(_instanceBuffer)) {
+			batch.Mesh->AddInstanceBuffer(_instanceBuffer, GetInstanceAttributes());
+		}
+	}
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <entt.hpp>
+#include <GLM/glm.hpp>
+#include "Graphics/IndirectBuffer.h"
+#include "Graphics/StreamingBuffer.h"
+#include "Graphics/VertexArrayObject.h"
+#include "Graphics/VertexBuffer.h"
+
+class ShaderMaterial;
+
+/// <summary>
+/// The per-instance data that is streamed to the vertex shader, see RenderBatcher::GetInstanceAttributes for the
+/// slots that it is bound to
+/// </summary>
+struct InstanceData
+{
+	glm::mat4 Model;
+	glm::mat3 NormalMatrix;
+};
+
+/// <summary>
+/// A run of instances that share a mesh and material, and are drawn with one draw call
+/// </summary>
+struct DrawBatch
+{
+	VertexArrayObject* Mesh     = nullptr;
+	ShaderMaterial*    Material = nullptr;
+	// The index of the first instance in the instance buffer
+	uint32_t FirstInstance = 0;
+	uint32_t InstanceCount = 0;
+	// The value for the u_LodFade uniform, objects that are switching levels of detail are drawn on their own
+	float    LodFade       = 1.0f;
+	// If not 0, this batch is several meshes from the same GeometryArena, drawn with glMultiDrawElementsIndirect. Mesh
+	// is the arena's VAO, and these are the commands in the indirect buffer to draw
+	uint32_t FirstCommand  = 0;
+	uint32_t CommandCount  = 0;
+};
+
+/// <summary>
+/// Counters from the last call to RenderBatcher::Build
+/// </summary>
+struct BatchingStats
+{
+	size_t Renderers = 0;
+	// The number of draw calls that the renderers will be drawn with
+	size_t Batches   = 0;
+	// The number of renderers that share a draw call with at least one other renderer
+	size_t Instanced = 0;
+	// The number of draw calls that are multi-draws, and the number of instanced draws they replaced
+	size_t MultiDraws = 0;
+	size_t Commands   = 0;
+	double Ms        = 0.0;
+};
+
+/// <summary>
+/// Groups renderers into instanced draw calls. After sorting and culling, renderers that use the same mesh and
+/// material sit next to each other, so each run of them becomes a single glDrawElementsInstanced call.
+///
+/// Every visible renderer's model and normal matrices are written in to a streaming instance buffer each frame, in draw
+/// order, and each batch draws a range of it. The instance buffer is added to each mesh's VAO the first time the mesh is
+/// drawn, at the slots given by GetInstanceAttributes, so shaders read the matrices as vertex attributes instead of
+/// uniforms.
+///
+/// Meshes that live in the same GeometryArena share a VAO, so runs of them with the same material are drawn with a
+/// single glMultiDrawElementsIndirect. Each command reads it's matrices from the instance buffer through it's base
+/// instance, so shaders don't need to know the difference. The commands are streamed through a buffer of their own the
+/// same way as the instances, so neither is re-allocated or waited on between frames.
+///
+/// Build only reads the registry, so it can run on any thread. Upload and drawing must happen on the main thread
+/// </summary>
+class RenderBatcher final
+{
+public:
+	/// <summary>
+	/// If false, every renderer gets a draw call of it's own
+	/// </summary>
+	bool   Enabled = true;
+	/// <summary>
+	/// If false, meshes from a GeometryArena are drawn one batch at a time like any other mesh
+	/// </summary>
+	bool   MultiDraw = true;
+	size_t MinParallelCount = 4096;
+	size_t BatchSize = 1024;
+
+	/// <summary>
+	/// The first attribute slot that instance data is bound to. The model matrix uses 4 slots, and the normal matrix 3
+	/// </summary>
+	static constexpr GLuint INSTANCE_SLOT = 4;
+
+	RenderBatcher() = default;
+	~RenderBatcher() = default;
+
+	RenderBatcher(const RenderBatcher& other) = delete;
+	RenderBatcher(RenderBatcher&& other) = delete;
+	RenderBatcher& operator=(const RenderBatcher& other) = delete;
+	RenderBatcher& operator=(RenderBatcher&& other) = delete;
+
+	/// <summary>
+	/// Builds the batches and instance data for a list of entities with RendererComponent, WorldMatrix and
+	/// WorldNormalMatrix components. Renderers without a mesh or material are skipped
+	/// </summary>
+	/// <param name="registry">The registry that the entities belong to</param>
+	/// <param name="entities">The entities to draw, in the order they should be drawn</param>
+	void Build(const entt::registry& registry, const std::vector<entt::entity>& entities);
+
+	/// <summary>
+	/// Uploads the instance data and indirect commands from the last build, and adds the instance buffer to any meshes
+	/// that don't have it yet. Both land somewhere new in their streaming buffers each frame, so this also moves the
+	/// batches' FirstInstance and FirstCommand (and the commands' BaseInstance) to where they are. Leaves the command
+	/// buffer bound as the indirect buffer for the multi-draws. Must be called on the main thread once per build, before
+	/// drawing the batches
+	/// </summary>
+	void Upload();
+
+	/// <summary>
+	/// Gets the buffer that instance data is streamed through, this is nullptr until the first upload
+	/// </summary>
+	const StreamingBuffer::sptr& GetInstanceBuffer() const { return _instanceBuffer; }
+
+	const std::vector<DrawBatch>& GetBatches() const { return _batches; }
+	const BatchingStats& GetStats() const { return _stats; }
+
+	/// <summary>
+	/// Gets the vertex attributes for InstanceData, starting at INSTANCE_SLOT
+	/// </summary>
+	static const std::vector<BufferAttribute>& GetInstanceAttributes();
+
+private:
+	std::vector<InstanceData> _instances;
+	std::vector<DrawBatch>    _batches;
+	std::vector<DrawElementsIndirectCommand> _commands;
+	StreamingBuffer::sptr     _instanceBuffer;
+	StreamingBuffer::sptr     _commandBuffer;
+	BatchingStats _stats;
+
+	// Folds runs of batches from the same arena with the same material into multi-draws
+	void _MergeMultiDraws();
+};
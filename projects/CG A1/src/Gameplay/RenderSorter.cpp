@@ -0,0 +1,217 @@
+#include "RenderSorter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+#include "RendererComponent.h"
+#include "WorldMatrix.h"
+#include "Utilities/JobSystem.h"
+
+// The bits of the key, from the top. Opaque keys are layer | 0 | shader | material | mesh | depth, and transparent
+// keys are layer | 1 | inverted depth | shader | material | mesh
+static constexpr int LAYER_SHIFT       = 56;
+static constexpr int TRANSPARENT_SHIFT = 55;
+static constexpr int SHADER_BITS       = 12;
+static constexpr int MATERIAL_BITS     = 12;
+static constexpr int MESH_BITS         = 11;
+static constexpr int DEPTH_BITS        = 20;
+
+static inline uint32_t QuantizeDepth(float depth) {
+	// The bits of a positive float sort the same way as it's value, so the top bits after the sign are a
+	// quantized depth with more precision up close than far away
+	depth = std::max(depth, 0.0f);
+	uint32_t bits;
+	memcpy(&bits, &depth, sizeof(float));
+	return bits >> (31 - DEPTH_BITS);
+}
+
+uint64_t RenderSorter::MakeKey(int layer, bool transparent, uint32_t shader, uint32_t material, uint32_t mesh, float depth) {
+	const uint64_t state =
+		(static_cast<uint64_t>(shader & ((1u << SHADER_BITS) - 1)) << (MATERIAL_BITS + MESH_BITS)) |
+		(static_cast<uint64_t>(material & ((1u << MATERIAL_BITS) - 1)) << MESH_BITS) |
+		static_cast<uint64_t>(mesh & ((1u << MESH_BITS) - 1));
+	const uint64_t quantized = QuantizeDepth(depth);
+
+	uint64_t key = static_cast<uint64_t>(std::clamp(layer, -128, 127) + 128) << LAYER_SHIFT;
+	if (transparent) {
+		const uint64_t backToFront = ((1ull << DEPTH_BITS) - 1) - quantized;
+		key |= (1ull << TRANSPARENT_SHIFT) | (backToFront << (SHADER_BITS + MATERIAL_BITS + MESH_BITS)) | state;
+	} else {
+		key |= (state << DEPTH_BITS) | quantized;
+	}
+	return key;
+}
+
+void RenderSorter::RadixSort(std::vector<Entry>& entries, std::vector<Entry>& scratch) {
+	// 11 bit digits cover the whole key in 6 passes, and the histograms still fit in the L1 cache
+	constexpr int DIGIT_BITS = 11;
+	constexpr int PASSES = (64 + DIGIT_BITS - 1) / DIGIT_BITS;
+	constexpr uint64_t DIGIT_MASK = (1ull << DIGIT_BITS) - 1;
+
+	const size_t count = entries.size();
+	scratch.resize(count);
+	if (count == 0) {
+		return;
+	}
+
+	// Count every digit in one pass over the keys
+	std::vector<uint32_t> histograms(PASSES << DIGIT_BITS, 0);
+	for (const Entry& entry : entries) {
+		for (int pass = 0; pass < PASSES; pass++) {
+			histograms[(pass << DIGIT_BITS) + ((entry.Key >> (pass * DIGIT_BITS)) & DIGIT_MASK)]++;
+		}
+	}
+
+	Entry* source = entries.data();
+	Entry* target = scratch.data();
+	for (int pass = 0; pass < PASSES; pass++) {
+		uint32_t* histogram = histograms.data() + (pass << DIGIT_BITS);
+		const int shift = pass * DIGIT_BITS;
+		// If every key has the same digit here, this pass would not move anything
+		if (histogram[(source[0].Key >> shift) & DIGIT_MASK] == count) {
+			continue;
+		}
+		uint32_t offset = 0;
+		for (size_t bucket = 0; bucket <= DIGIT_MASK; bucket++) {
+			const uint32_t size = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += size;
+		}
+		for (size_t ix = 0; ix < count; ix++) {
+			target[histogram[(source[ix].Key >> shift) & DIGIT_MASK]++] = source[ix];
+		}
+		std::swap(source, target);
+	}
+	// An odd number of passes leaves the results in the scratch buffer
+	if (source != entries.data()) {
+		entries.swap(scratch);
+	}
+}
+
+void RenderSorter::Invalidate() {
+	_entries.clear();
+	_previous.clear();
+}
+
+void RenderSorter::_Sort(const entt::registry& registry, const glm::mat4& view) {
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	// The view matrix's third row gives the view space z of a point, the camera looks down -z
+	const glm::vec4 depthRow = -glm::vec4(view[0][2], view[1][2], view[2][2], view[3][2]);
+	_keys.resize(_candidates.size());
+	if (_candidates.size() >= MinParallelCount) {
+		JobSystem& jobs = JobSystem::Instance();
+		jobs.Wait(jobs.ParallelFor(_candidates.size(), [&](size_t begin, size_t end) {
+			_BuildKeys(registry, depthRow, begin, end);
+		}, BatchSize));
+	} else {
+		_BuildKeys(registry, depthRow, 0, _candidates.size());
+	}
+
+	_stats.Draws = _candidates.size();
+	_stats.Moved = 0;
+	// If renderers were added or removed (or the group was reordered), the last order doesn't mean anything anymore
+	const bool matches = _entries.size() == _candidates.size() && _previous == _candidates;
+	if (matches) {
+		bool sorted = true;
+		for (size_t ix = 0; ix < _entries.size(); ix++) {
+			_entries[ix].Key = _keys[_entries[ix].Index];
+			sorted &= ix == 0 || _entries[ix - 1].Key <= _entries[ix].Key;
+		}
+		if (sorted) {
+			_stats.Method = RenderSortMethod::Skipped;
+		} else if (_TryPatch()) {
+			_stats.Method = RenderSortMethod::Patched;
+		} else {
+			RadixSort(_entries, _scratch);
+			_stats.Method = RenderSortMethod::Radix;
+		}
+	} else {
+		_entries.resize(_candidates.size());
+		for (size_t ix = 0; ix < _candidates.size(); ix++) {
+			_entries[ix] = { _keys[ix], static_cast<uint32_t>(ix) };
+		}
+		RadixSort(_entries, _scratch);
+		_stats.Method = RenderSortMethod::Radix;
+	}
+
+	if (_stats.Method != RenderSortMethod::Skipped || _sorted.size() != _entries.size()) {
+		_sorted.resize(_entries.size());
+		for (size_t ix = 0; ix < _entries.size(); ix++) {
+			_sorted[ix] = _candidates[_entries[ix].Index];
+		}
+	}
+	_previous.swap(_candidates);
+
+	const auto end = std::chrono::high_resolution_clock::now();
+	_stats.Ms = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void RenderSorter::_BuildKeys(const entt::registry& registry, const glm::vec4& depthRow, size_t begin, size_t end) {
+	for (size_t ix = begin; ix < end; ix++) {
+		const entt::entity entity = _candidates[ix];
+		const RendererComponent& renderer = registry.get<RendererComponent>(entity);
+		const glm::mat4& world = registry.get<WorldMatrix>(entity).Value;
+
+		int layer = 0;
+		bool transparent = false;
+		uint32_t shader = 0, material = 0, mesh = 0;
+		if (renderer.Material != nullptr) {
+			layer = renderer.Material->RenderLayer;
+			transparent = renderer.Material->IsTransparent;
+			material = renderer.Material->GetSortId();
+			shader = renderer.Material->Shader != nullptr ? renderer.Material->Shader->GetHandle() : 0;
+		}
+
+		// Measure depth from the middle of the mesh where we can, big meshes can be a long way off their origin
+		glm::vec4 center = world[3];
+		if (renderer.Mesh != nullptr) {
+			mesh = renderer.Mesh->GetSortId();
+			if (renderer.Mesh->GetBounds().IsValid()) {
+				center = world * glm::vec4(renderer.Mesh->GetBoundingSphere().Center, 1.0f);
+			}
+		}
+		const float depth = (transparent || OpaqueDepthSort) ? glm::dot(depthRow, center) : 0.0f;
+		_keys[ix] = MakeKey(layer, transparent, shader, material, mesh, depth);
+	}
+}
+
+bool RenderSorter::_TryPatch() {
+	const size_t total = _entries.size();
+	const size_t limit = static_cast<size_t>(PatchLimit * total);
+	_patch.clear();
+
+	// Pull out every entry that is out of order with either of it's neighbours, until what is left is in order
+	bool sorted = false;
+	while (!sorted) {
+		const size_t count = _entries.size();
+		size_t kept = 0;
+		uint64_t previous = 0;
+		for (size_t ix = 0; ix < count; ix++) {
+			const Entry entry = _entries[ix];
+			const bool outOfOrder = (ix > 0 && entry.Key < previous) || (ix + 1 < count && entry.Key > _entries[ix + 1].Key);
+			previous = entry.Key;
+			if (outOfOrder) {
+				_patch.push_back(entry);
+			} else {
+				_entries[kept++] = entry;
+			}
+		}
+		_entries.resize(kept);
+		if (_patch.size() > limit) {
+			// Too much has changed, put everything back so the radix sort can pick up from here
+			_entries.insert(_entries.end(), _patch.begin(), _patch.end());
+			return false;
+		}
+		sorted = std::is_sorted(_entries.begin(), _entries.end(), [](const Entry& l, const Entry& r) { return l.Key < r.Key; });
+	}
+
+	// Then sort the few that were pulled out, and merge them back in
+	std::sort(_patch.begin(), _patch.end(), [](const Entry& l, const Entry& r) { return l.Key < r.Key; });
+	_scratch.resize(total);
+	std::merge(_entries.begin(), _entries.end(), _patch.begin(), _patch.end(), _scratch.begin(), [](const Entry& l, const Entry& r) { return l.Key < r.Key; });
+	_entries.swap(_scratch);
+	_stats.Moved = _patch.size();
+	return true;
+}
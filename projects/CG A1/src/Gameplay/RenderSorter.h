@@ -0,0 +1,142 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <entt.hpp>
+#include <GLM/glm.hpp>
+#include <EnumToString.h>
+
+/// <summary>
+/// How the draw list was put in order by the last call to RenderSorter::Sort
+/// </summary>
+ENUM(RenderSortMethod, int,
+	// The keys were already in order, so nothing was moved
+	Skipped = 0,
+	// A few keys were out of order, and were moved in to place
+	Patched = 1,
+	// The whole list was radix sorted
+	Radix   = 2
+);
+
+/// <summary>
+/// Counters from the last call to RenderSorter::Sort
+/// </summary>
+struct RenderSortStats
+{
+	size_t Draws = 0;
+	RenderSortMethod Method = RenderSortMethod::Skipped;
+	// The number of draws that were out of place and had to be moved by patching
+	size_t Moved = 0;
+	double Ms    = 0.0;
+};
+
+/// <summary>
+/// Puts renderers in draw order with a packed 64 bit key per draw, so that ordering never has to chase the
+/// renderer's material and shader pointers.
+///
+/// Keys sort by render layer first, then opaque before transparent. Opaque draws are grouped by shader, material and
+/// mesh to minimize state changes, and then go front to back so that the depth test can reject hidden fragments
+/// early. Transparent draws go back to front so that they blend correctly, and are only grouped by state where they
+/// are at the same depth.
+///
+/// Keys are rebuilt every frame in the order the entities are given (on the job system for large lists), so that
+/// their components are read in storage order. While the same entities are given in the same order as last frame,
+/// the last frame's order is reused. If the keys are still in that order nothing is sorted at all, if only a few are
+/// out of place they are pulled out, sorted on their own and merged back in, and otherwise the list is radix sorted
+/// 11 bits at a time
+/// </summary>
+class RenderSorter final
+{
+public:
+	/// <summary>
+	/// A sort key, and the index of the thing it belongs to
+	/// </summary>
+	struct Entry
+	{
+		uint64_t Key;
+		uint32_t Index;
+	};
+
+	/// <summary>
+	/// If false, opaque draws are only grouped by state. This stops camera movement from changing the order
+	/// </summary>
+	bool   OpaqueDepthSort = true;
+	/// <summary>
+	/// If more than this fraction of the draws are out of place, the whole list is radix sorted instead of patched
+	/// </summary>
+	float  PatchLimit = 0.1f;
+	size_t MinParallelCount = 4096;
+	size_t BatchSize = 2048;
+
+	RenderSorter() = default;
+	~RenderSorter() = default;
+
+	RenderSorter(const RenderSorter& other) = delete;
+	RenderSorter(RenderSorter&& other) = delete;
+	RenderSorter& operator=(const RenderSorter& other) = delete;
+	RenderSorter& operator=(RenderSorter&& other) = delete;
+
+	/// <summary>
+	/// Sorts a list of entities with RendererComponent and WorldMatrix components, see GetSorted for the results.
+	/// Renderers without a material are drawn first in their layer
+	/// </summary>
+	/// <param name="registry">The registry that the entities belong to</param>
+	/// <param name="first">The first entity to sort (ex renderGroup.begin())</param>
+	/// <param name="last">The end of the entities to sort (ex renderGroup.end())</param>
+	/// <param name="view">The view matrix of the camera, used for the depth of each draw</param>
+	template <typename Iterator>
+	void Sort(const entt::registry& registry, Iterator first, Iterator last, const glm::mat4& view) {
+		_candidates.assign(first, last);
+		_Sort(registry, view);
+	}
+
+	/// <summary>
+	/// Gets the entities from the last sort, in the order they should be drawn
+	/// </summary>
+	const std::vector<entt::entity>& GetSorted() const { return _sorted; }
+	const RenderSortStats& GetStats() const { return _stats; }
+
+	/// <summary>
+	/// Forgets the order from the last frame, so the next sort is a full radix sort
+	/// </summary>
+	void Invalidate();
+
+	/// <summary>
+	/// Packs the sort key for a single draw
+	/// </summary>
+	/// <param name="layer">The material's render layer, clamped to [-128, 127]</param>
+	/// <param name="transparent">True if the draw is blended, and should go back to front</param>
+	/// <param name="shader">An ID for the shader, only the low 12 bits are used</param>
+	/// <param name="material">An ID for the material, only the low 12 bits are used</param>
+	/// <param name="mesh">An ID for the mesh, only the low 11 bits are used</param>
+	/// <param name="depth">The distance in front of the camera, or 0 to leave depth out of the key</param>
+	/// <returns>A key where smaller values should be drawn first</returns>
+	static uint64_t MakeKey(int layer, bool transparent, uint32_t shader, uint32_t material, uint32_t mesh, float depth);
+
+	/// <summary>
+	/// Sorts entries by their keys with an LSD radix sort, skipping any digit that is the same for every key. Entries
+	/// with the same key keep their order
+	/// </summary>
+	/// <param name="entries">The entries to sort</param>
+	/// <param name="scratch">Working space, will be resized to match the entries</param>
+	static void RadixSort(std::vector<Entry>& entries, std::vector<Entry>& scratch);
+
+private:
+	std::vector<entt::entity> _candidates;
+	// The candidates from the last sort, the entries index in to these
+	std::vector<entt::entity> _previous;
+	std::vector<entt::entity> _sorted;
+	// A key for each candidate
+	std::vector<uint64_t>     _keys;
+	// The entries in the order from the last sort
+	std::vector<Entry>        _entries;
+	std::vector<Entry>        _scratch;
+	// The entries that were pulled out while patching
+	std::vector<Entry>        _patch;
+	RenderSortStats _stats;
+
+	void _Sort(const entt::registry& registry, const glm::mat4& view);
+	// Builds the keys for the candidates in [begin, end)
+	void _BuildKeys(const entt::registry& registry, const glm::vec4& depthRow, size_t begin, size_t end);
+	// Tries to move the entries that are out of place, returns false if there were more than the patch limit
+	bool _TryPatch();
+};
@@ -1,17 +1,84 @@
 #include "Scene.h"
 
 #include "Transform.h"
+#include "TransformHierarchy.h"
+#include "SpatialIndex.h"
+#include "Bounds.h"
 #include "GameObjectTag.h"
 #include "Logging.h"
+#include "Utilities/JobSystem.h"
 
 entt::registry GameScene::_prefabRegistry;
-std::unordered_map<entt::id_type, StampFunction> GameScene::_stampFunctions;
+std::unordered_map<entt::id_type, GameScene::ComponentStampers> GameScene::_stampFunctions;
+
+// The prefab registry has no TransformHierarchy, so it's transforms get their LocalTRS from these instead
+static void AddPrefabLocalTRS(entt::registry& registry, entt::entity entity) {
+	registry.emplace<LocalTRS>(entity);
+}
+static void RemovePrefabLocalTRS(entt::registry& registry, entt::entity entity) {
+	registry.remove_if_exists<LocalTRS>(entity);
+}
+static const bool prefabHooksConnected = [] {
+	GameScene::Prefabs().on_construct<Transform>().connect<&AddPrefabLocalTRS>();
+	GameScene::Prefabs().on_destroy<Transform>().connect<&RemovePrefabLocalTRS>();
+	return true;
+}();
 
 GameScene::GameScene(const std::string& name) {
 	Name = name;
 
-	RegisterComponentType<Transform>();
+	RegisterComponentType<Transform>(&Transform::Stamp, &Transform::StampBatch);
+	// Copied along with the Transform by it's stamp functions
+	RegisterComponentType<LocalTRS>(
+		[](const entt::registry&, const entt::entity, entt::registry&, const entt::entity) {},
+		[](const entt::registry&, const entt::entity, entt::registry&, const entt::entity*, size_t) {});
 	RegisterComponentType<GameObjectTag>();
+	RegisterComponentType<LocalBounds>();
+
+	_registry.set<TransformHierarchy>(_registry);
+	_registry.set<SpatialIndex>(_registry);
+
+	const uint32_t threadCount = std::max(JobSystem::Instance().GetThreadCount(), 1u);
+	_commandBuffers.reserve(threadCount);
+	for (uint32_t ix = 0; ix < threadCount; ix++) {
+		_commandBuffers.push_back(std::make_unique<CommandBuffer>(ix));
+	}
+
+	_registry.on_construct<GameObjectTag>().connect<&GameScene::_OnTagConstructed>(*this);
+	_registry.on_update<GameObjectTag>().connect<&GameScene::_OnTagUpdated>(*this);
+	_registry.on_destroy<GameObjectTag>().connect<&GameScene::_OnTagDestroyed>(*this);
+}
+
+TransformHierarchy& GameScene::Hierarchy() {
+	return _registry.ctx<TransformHierarchy>();
+}
+
+SpatialIndex& GameScene::Spatial() {
+	return _registry.ctx<SpatialIndex>();
+}
+
+CommandBuffer& GameScene::Commands() {
+	const int thread = JobSystem::GetThreadIndex();
+	LOG_ASSERT(thread >= 0 && thread < static_cast<int>(_commandBuffers.size()), "Command buffers can only be used from the main thread or job system threads!");
+	return *_commandBuffers[thread];
+}
+
+void GameScene::BeginCommandPass() {
+	_commandPass++;
+	for (const auto& buffer : _commandBuffers) {
+		buffer->SetPass(_commandPass);
+	}
+}
+
+void GameScene::Poll() {
+	CommandBuffer::Replay(*this, _commandBuffers);
+	// Replay resets the buffers to pass 0
+	_commandPass = 0;
+
+	for (entt::entity instance : _deletionQueue) {
+		_registry.destroy(instance);
+	}
+	_deletionQueue.clear();
 }
 
 entt::handle GameScene::CreateEntity(const std::string& name) {
@@ -30,25 +97,114 @@ entt::handle GameScene::CreateEntity(entt::entity prefab, const std::string& nam
 	return entt::handle(_registry, instance);
 }
 
+void GameScene::InstantiateBatch(entt::entity prefab, size_t count, std::vector<entt::entity>& result) {
+	LOG_ASSERT(_prefabRegistry.valid(prefab), "Entity is not a valid prefab! You may need to call CreatePrefab(entity_id) first!");
+
+	const size_t start = result.size();
+	result.resize(start + count);
+	entt::entity* instances = result.data() + start;
+	_registry.reserve(_registry.size() + count);
+	_registry.create(instances, instances + count);
+
+	// Look up the stamp functions once per component type, rather than once per component
+	_prefabRegistry.visit(prefab, [&](const auto typeId) {
+		const auto it = _stampFunctions.find(typeId);
+		LOG_ASSERT(it != _stampFunctions.end(), "Prefab has a component type that was not registered with RegisterComponentType!");
+		const ComponentStampers& stampers = it->second;
+		if (stampers.BatchStamp != nullptr) {
+			stampers.BatchStamp(_prefabRegistry, prefab, _registry, instances, count);
+		} else {
+			for (size_t ix = 0; ix < count; ix++) {
+				stampers.Stamp(_prefabRegistry, prefab, _registry, instances[ix]);
+			}
+		}
+	});
+}
+
 entt::handle GameScene::FindFirst(const std::string& name)
 {
-	entt::entity result = entt::null;
-	uint32_t hash = entt::hashed_string::value(name.c_str());
-	const auto view = _registry.view<GameObjectTag>();
-	
-	for(const entt::entity& entity : view) {
-		const GameObjectTag& tag = _registry.get<GameObjectTag>(entity);
-		if (tag.HashedName == hash && tag.Name == name) {
-			return entt::handle(_registry, entity);
+	const auto bucket = _nameBuckets.find(entt::hashed_string::value(name.c_str()));
+	if (bucket != _nameBuckets.end()) {
+		for (entt::entity entity : bucket->second) {
+			// Make sure this isn't a hash collision
+			const auto entry = _nameEntries.find(entity);
+			if (entry != _nameEntries.end() && entry->second.Sorted->first == name) {
+				return entt::handle(_registry, entity);
+			}
 		}
 	}
 	return entt::handle(_registry, entt::null);
 }
 
+std::vector<entt::handle> GameScene::FindAll(const std::string& name)
+{
+	std::vector<entt::handle> result;
+	const auto bucket = _nameBuckets.find(entt::hashed_string::value(name.c_str()));
+	if (bucket != _nameBuckets.end()) {
+		for (entt::entity entity : bucket->second) {
+			const auto entry = _nameEntries.find(entity);
+			if (entry != _nameEntries.end() && entry->second.Sorted->first == name) {
+				result.emplace_back(_registry, entity);
+			}
+		}
+	}
+	return result;
+}
+
+std::vector<entt::handle> GameScene::FindAllWithPrefix(const std::string& prefix)
+{
+	std::vector<entt::handle> result;
+	// Names are sorted, so everything with the prefix sits in one run starting at the prefix itself
+	for (auto it = _names.lower_bound(prefix); it != _names.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+		result.emplace_back(_registry, it->second);
+	}
+	return result;
+}
+
 entt::handle GameScene::StampEntity(const entt::registry& from, entt::entity src, entt::registry& to) {
 	entt::entity dst = to.create();
+	StampEntity(from, src, to, dst);
+	return entt::handle(to, dst);
+}
+
+void GameScene::StampEntity(const entt::registry& from, entt::entity src, entt::registry& to, entt::entity dst) {
 	from.visit(src, [&from, &to, src, dst](const auto type_id) {
-		_stampFunctions[type_id](from, src, to, dst);
+		_stampFunctions[type_id].Stamp(from, src, to, dst);
 	});
-	return entt::handle(to, dst);
+}
+
+void GameScene::_OnTagConstructed(entt::registry& registry, entt::entity entity) {
+	const GameObjectTag& tag = registry.get<GameObjectTag>(entity);
+	std::vector<entt::entity>& bucket = _nameBuckets[tag.HashedName];
+	NameEntry& entry = _nameEntries[entity];
+	entry.Sorted = _names.emplace(tag.Name, entity);
+	entry.Hash = tag.HashedName;
+	entry.BucketIndex = bucket.size();
+	bucket.push_back(entity);
+}
+
+void GameScene::_OnTagUpdated(entt::registry& registry, entt::entity entity) {
+	_OnTagDestroyed(registry, entity);
+	_OnTagConstructed(registry, entity);
+}
+
+void GameScene::_OnTagDestroyed(entt::registry& registry, entt::entity entity) {
+	// The tag may have already changed, so we use what we indexed the entity under
+	const auto entry = _nameEntries.find(entity);
+	if (entry == _nameEntries.end()) {
+		return;
+	}
+
+	// Swap the last entity in the bucket into our slot, so many entities sharing a name stays cheap
+	const auto bucket = _nameBuckets.find(entry->second.Hash);
+	const entt::entity last = bucket->second.back();
+	bucket->second[entry->second.BucketIndex] = last;
+	_nameEntries.find(last)->second.BucketIndex = entry->second.BucketIndex;
+	bucket->second.pop_back();
+	if (bucket->second.empty()) {
+		_nameBuckets.erase(bucket);
+	}
+
+	_names.erase(entry->second.Sorted);
+	_nameEntries.erase(entry);
 }
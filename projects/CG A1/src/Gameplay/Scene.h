@@ -1,14 +1,25 @@
 #pragma once
+#include <map>
+#include <memory>
+#include <unordered_map>
 #include "entt.hpp"
 #include "Utilities/Macros.h"
+#include "Gameplay/CommandBuffer.h"
 
 /// <summary>
 /// Represents a callback that may be used to customize how entity stamping works between registries
 /// </summary>
 typedef void(*StampFunction)(const entt::registry& from, const entt::entity src, entt::registry& to, const entt::entity dst);
+/// <summary>
+/// Represents a callback that may be used to customize how a component is stamped onto many entities at once
+/// </summary>
+typedef void(*BatchStampFunction)(const entt::registry& from, const entt::entity src, entt::registry& to, const entt::entity* dst, size_t count);
 
 typedef entt::handle GameObject;
 
+class TransformHierarchy;
+class SpatialIndex;
+
 class GameScene final
 {
 	SMART_MEMORY_MANAGED(GameScene)
@@ -21,20 +32,59 @@ public:
 	
 	entt::handle CreateEntity(const std::string& name = "");
 	entt::handle CreateEntity(entt::entity prefab, const std::string& name = "");
+	/// <summary>
+	/// Creates many instances of a prefab at once. Entities are created in bulk, and each component type is copied
+	/// to all of the instances in one go, which is much faster than calling CreateEntity in a loop
+	/// </summary>
+	/// <param name="prefab">The prefab to instantiate, must be in the prefab registry</param>
+	/// <param name="count">The number of instances to create</param>
+	/// <param name="result">The vector to append the new entities to</param>
+	void InstantiateBatch(entt::entity prefab, size_t count, std::vector<entt::entity>& result);
 
+	/// <summary>
+	/// Finds an entity with the given name, if multiple entities share the name any one of them may be returned
+	/// </summary>
+	/// <param name="name">The name of the entity to search for</param>
+	/// <returns>A handle to the entity, or a handle to entt::null if no entity has the name</returns>
 	entt::handle FindFirst(const std::string& name);
+	/// <summary>
+	/// Finds all the entities with the given name
+	/// </summary>
+	/// <param name="name">The name of the entities to search for</param>
+	std::vector<entt::handle> FindAll(const std::string& name);
+	/// <summary>
+	/// Finds all the entities whose names start with the given prefix, sorted by name
+	/// </summary>
+	/// <param name="prefix">The prefix to search for</param>
+	std::vector<entt::handle> FindAllWithPrefix(const std::string& prefix);
 
 	entt::registry& Registry() { return _registry; }
+	const entt::registry& Registry() const { return _registry; }
+	/// <summary>
+	/// Gets the hierarchy that manages the parenting and world matrices of the transforms in this scene
+	/// </summary>
+	TransformHierarchy& Hierarchy();
+	/// <summary>
+	/// Gets the index used to find the entities with LocalBounds in a region of space
+	/// </summary>
+	SpatialIndex& Spatial();
 
 	/// <summary>
-	/// Perform any tasks that should happen at the end of a loop, such as deleting queued objects
+	/// Gets the command buffer for the calling thread, use this to make structural changes (creating or destroying
+	/// entities, adding or removing components, re-parenting) from a parallel phase. The commands are applied in Poll
 	/// </summary>
-	void Poll() {
-		for(entt::entity instance : _deletionQueue) {
-			_registry.destroy(instance);
-		}
-		_deletionQueue.clear();
-	}
+	CommandBuffer& Commands();
+	/// <summary>
+	/// Starts a new recording pass on every command buffer, so that the commands recorded after this replay after
+	/// the ones recorded before it. Called on the main thread before each group of behaviour updates
+	/// </summary>
+	void BeginCommandPass();
+
+	/// <summary>
+	/// Perform any tasks that should happen at the end of a loop, such as replaying command buffers and deleting
+	/// queued objects
+	/// </summary>
+	void Poll();
 
 	/// <summary>
 	/// Creates a new entity in the <i>to</i> registry, copying the components from the <i>src</i> entity in the from registry
@@ -44,22 +94,69 @@ public:
 	/// <param name="to">The destination registry to store the entity in</param>
 	/// <returns>A handle for the newly created entity</returns>
 	static entt::handle StampEntity(const entt::registry& from, entt::entity src, entt::registry& to);
+	/// <summary>
+	/// Copies the components from the <i>src</i> entity in the from registry onto an existing entity, replacing any
+	/// components that it already has. Components that src does not have are left alone
+	/// </summary>
+	/// <param name="from">The source registry to copy the object from</param>
+	/// <param name="src">The source entity within the <i>from</i> registry to copy</param>
+	/// <param name="to">The destination registry</param>
+	/// <param name="dst">The entity within the <i>to</i> registry to copy onto</param>
+	static void StampEntity(const entt::registry& from, entt::entity src, entt::registry& to, entt::entity dst);
 
+	/// <summary>
+	/// Registers a component type so that it can be copied out of prefabs
+	/// </summary>
+	/// <param name="stampOverride">A custom function for copying the component, or nullptr to copy construct it</param>
+	/// <param name="batchStampOverride">
+	/// A custom function for copying the component to many entities, or nullptr to use the default. If stampOverride is
+	/// set and this is not, batches will call stampOverride for each entity
+	/// </param>
 	template <typename Type>
-	static void RegisterComponentType(StampFunction stampOverride = nullptr) {
-		_stampFunctions[entt::type_info<Type>::id()] = stampOverride != nullptr ? stampOverride : &_DefaultComponentStamp<Type>;
+	static void RegisterComponentType(StampFunction stampOverride = nullptr, BatchStampFunction batchStampOverride = nullptr) {
+		ComponentStampers& stampers = _stampFunctions[entt::type_info<Type>::id()];
+		stampers.Stamp = stampOverride != nullptr ? stampOverride : &_DefaultComponentStamp<Type>;
+		stampers.BatchStamp = batchStampOverride != nullptr ? batchStampOverride : stampOverride != nullptr ? nullptr : &_DefaultComponentBatchStamp<Type>;
 	}
 	static entt::registry& Prefabs() { return _prefabRegistry; }
 	
 private:
 	entt::registry _registry;
 	std::vector<entt::entity> _deletionQueue;
+	// One per job system thread, indexed by JobSystem::GetThreadIndex
+	std::vector<std::unique_ptr<CommandBuffer>> _commandBuffers;
+	uint32_t _commandPass = 0;
+
+	// Name index, kept up to date by the GameObjectTag signals. Names must be changed via replace or patch
+	// for the index to see them. Entities are bucketed by hash for exact lookups, and sorted by name for prefix queries
+	typedef std::multimap<std::string, entt::entity> NameMap;
+	struct NameEntry {
+		NameMap::iterator Sorted;
+		uint32_t          Hash;
+		size_t            BucketIndex;
+	};
+	NameMap _names;
+	std::unordered_map<uint32_t, std::vector<entt::entity>> _nameBuckets;
+	std::unordered_map<entt::entity, NameEntry> _nameEntries;
 
 	static entt::registry _prefabRegistry;
-	static std::unordered_map<entt::id_type, StampFunction> _stampFunctions;
+	struct ComponentStampers {
+		StampFunction      Stamp      = nullptr;
+		BatchStampFunction BatchStamp = nullptr;
+	};
+	static std::unordered_map<entt::id_type, ComponentStampers> _stampFunctions;
+
+	void _OnTagConstructed(entt::registry& registry, entt::entity entity);
+	void _OnTagUpdated(entt::registry& registry, entt::entity entity);
+	void _OnTagDestroyed(entt::registry& registry, entt::entity entity);
 
 	template <typename T>
 	static void _DefaultComponentStamp(const entt::registry& from, const entt::entity src, entt::registry& to, const entt::entity dst) {
 		to.emplace_or_replace<T>(dst, from.get<T>(src));
 	}
+	template <typename T>
+	static void _DefaultComponentBatchStamp(const entt::registry& from, const entt::entity src, entt::registry& to, const entt::entity* dst, size_t count) {
+		// The destination entities are always fresh, so we can copy into all of them in one go
+		to.insert<T>(dst, dst + count, from.get<T>(src));
+	}
 };
@@ -0,0 +1,338 @@
+#include "SceneSnapshot.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <gzip/compress.hpp>
+#include <gzip/decompress.hpp>
+#include <gzip/utils.hpp>
+
+#include "Logging.h"
+#include "Gameplay/Bounds.h"
+#include "Gameplay/GameObjectTag.h"
+#include "Gameplay/InterpolatedTransform.h"
+#include "Gameplay/LODGroup.h"
+#include "Gameplay/RendererComponent.h"
+#include "Gameplay/Scene.h"
+#include "Gameplay/Transform.h"
+#include "Gameplay/TransformHierarchy.h"
+
+// 'OTSN', followed by the format version
+static constexpr uint32_t SNAPSHOT_MAGIC = 0x4E53544F;
+static constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+std::vector<SceneSnapshot::ComponentSerializer> SceneSnapshot::_serializers;
+std::unordered_map<std::string, VertexArrayObject::sptr> SceneSnapshot::_meshes;
+std::unordered_map<const VertexArrayObject*, std::string> SceneSnapshot::_meshNames;
+std::unordered_map<std::string, ShaderMaterial::sptr> SceneSnapshot::_materials;
+std::unordered_map<const ShaderMaterial*, std::string> SceneSnapshot::_materialNames;
+
+std::string SceneSnapshot::Save(const GameScene& scene) {
+	_RegisterBuiltInTypes();
+	const entt::registry& registry = scene.Registry();
+
+	std::ostringstream stream(std::ios::binary);
+	{
+		cereal::BinaryOutputArchive archive(stream);
+		archive(SNAPSHOT_MAGIC, SNAPSHOT_VERSION);
+
+		// The raw entity list, including the free list, so that identifiers and versions survive the round trip
+		const uint64_t entityCount = registry.size();
+		archive(entityCount);
+		archive(cereal::binary_data(registry.data(), entityCount * sizeof(entt::entity)));
+
+		// Each block is prefixed with it's size, so that loading can skip types it doesn't know about
+		archive(static_cast<uint32_t>(_serializers.size()));
+		for (const ComponentSerializer& serializer : _serializers) {
+			archive(serializer.Type);
+			const std::streampos sizePos = stream.tellp();
+			archive(uint64_t(0));
+			serializer.Save(registry, archive);
+			const std::streampos endPos = stream.tellp();
+			stream.seekp(sizePos);
+			archive(static_cast<uint64_t>(endPos - sizePos) - sizeof(uint64_t));
+			stream.seekp(endPos);
+		}
+	}
+
+	const std::string raw = stream.str();
+	return gzip::compress(raw.data(), raw.size(), Z_BEST_SPEED);
+}
+
+bool SceneSnapshot::Load(GameScene& scene, const std::string& data) {
+	_RegisterBuiltInTypes();
+	entt::registry& registry = scene.Registry();
+
+	const std::string raw = gzip::is_compressed(data.data(), data.size()) ? gzip::decompress(data.data(), data.size()) : data;
+	std::istringstream stream(raw, std::ios::binary);
+	cereal::BinaryInputArchive archive(stream);
+
+	try {
+		uint32_t magic, version;
+		archive(magic, version);
+		if (magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION) {
+			LOG_ERROR("Data is not a scene snapshot, or is from an unsupported version");
+			return false;
+		}
+
+		// Tear down the current scene, this runs the destroy signals so the hierarchy and name index stay in sync
+		registry.clear();
+
+		uint64_t entityCount;
+		archive(entityCount);
+		std::vector<entt::entity> entities(entityCount);
+		archive(cereal::binary_data(entities.data(), entityCount * sizeof(entt::entity)));
+		registry.assign(entities.begin(), entities.end());
+
+		uint32_t blockCount;
+		archive(blockCount);
+		for (uint32_t ix = 0; ix < blockCount; ix++) {
+			entt::id_type type;
+			uint64_t size;
+			archive(type, size);
+			const auto it = std::find_if(_serializers.begin(), _serializers.end(), [type](const ComponentSerializer& s) { return s.Type == type; });
+			if (it != _serializers.end()) {
+				if (!it->Load(registry, archive)) {
+					return false;
+				}
+			} else {
+				LOG_WARN("Skipping unregistered component type {} in scene snapshot", type);
+				stream.seekg(size, std::ios::cur);
+			}
+		}
+	} catch (const cereal::Exception& e) {
+		LOG_ERROR("Scene snapshot is corrupt: {}", e.what());
+		return false;
+	}
+	return true;
+}
+
+bool SceneSnapshot::SaveToFile(const GameScene& scene, const std::string& path) {
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		LOG_ERROR("Failed to open \"{}\" for writing", path);
+		return false;
+	}
+	const std::string data = Save(scene);
+	file.write(data.data(), data.size());
+	return true;
+}
+
+bool SceneSnapshot::LoadFromFile(GameScene& scene, const std::string& path) {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) {
+		LOG_ERROR("Failed to open \"{}\" for reading", path);
+		return false;
+	}
+	std::string data(static_cast<size_t>(file.tellg()), '\0');
+	file.seekg(0);
+	file.read(&data[0], data.size());
+	return Load(scene, data);
+}
+
+void SceneSnapshot::RegisterComponentType(entt::id_type type, SaveFunction save, LoadFunction load) {
+	// Make sure transforms always come first, since other types may depend on them when loading
+	_RegisterBuiltInTypes();
+	const auto it = std::find_if(_serializers.begin(), _serializers.end(), [type](const ComponentSerializer& s) { return s.Type == type; });
+	if (it != _serializers.end()) {
+		it->Save = save;
+		it->Load = load;
+	} else {
+		_serializers.push_back({ type, save, load });
+	}
+}
+
+void SceneSnapshot::RegisterAsset(const std::string& name, const VertexArrayObject::sptr& mesh) {
+	_meshes[name] = mesh;
+	_meshNames[mesh.get()] = name;
+}
+
+void SceneSnapshot::RegisterAsset(const std::string& name, const ShaderMaterial::sptr& material) {
+	_materials[name] = material;
+	_materialNames[material.get()] = name;
+}
+
+void SceneSnapshot::_RegisterBuiltInTypes() {
+	if (!_serializers.empty()) {
+		return;
+	}
+	_serializers.push_back({ entt::type_info<Transform>::id(), &_SaveTransforms, &_LoadTransforms });
+	_serializers.push_back({ entt::type_info<GameObjectTag>::id(), &SaveComponents<GameObjectTag>, &LoadComponents<GameObjectTag> });
+	_serializers.push_back({ entt::type_info<InactiveTag>::id(), &SaveComponents<InactiveTag>, &LoadComponents<InactiveTag> });
+	_serializers.push_back({ entt::type_info<InterpolatedTransform>::id(), &SaveComponents<InterpolatedTransform>, &LoadComponents<InterpolatedTransform> });
+	_serializers.push_back({ entt::type_info<LocalBounds>::id(), &SaveComponents<LocalBounds>, &LoadComponents<LocalBounds> });
+	_serializers.push_back({ entt::type_info<RendererComponent>::id(), &_SaveRenderers, &_LoadRenderers });
+	_serializers.push_back({ entt::type_info<LODGroup>::id(), &_SaveLODGroups, &_LoadLODGroups });
+}
+
+// The parts of a transform that we save, packed so they can be written in one go
+struct TransformRecord {
+	glm::vec3    Position;
+	glm::quat    Rotation;
+	glm::vec3    Scale;
+	entt::entity Parent;
+};
+
+void SceneSnapshot::_SaveTransforms(const entt::registry& registry, cereal::BinaryOutputArchive& archive) {
+	const auto view = registry.view<const Transform>();
+	const uint64_t count = view.size();
+	std::vector<TransformRecord> records;
+	records.reserve(count);
+	for (const Transform* it = view.raw(), *end = view.raw() + count; it != end; ++it) {
+		records.push_back({ it->GetLocalPosition(), it->GetLocalRotationQuat(), it->GetLocalScale(), it->GetParent() });
+	}
+	archive(count);
+	archive(cereal::binary_data(view.data(), count * sizeof(entt::entity)));
+	archive(cereal::binary_data(records.data(), count * sizeof(TransformRecord)));
+}
+
+bool SceneSnapshot::_LoadTransforms(entt::registry& registry, cereal::BinaryInputArchive& archive) {
+	uint64_t count;
+	archive(count);
+	std::vector<entt::entity> entities(count);
+	std::vector<TransformRecord> records(count);
+	archive(cereal::binary_data(entities.data(), count * sizeof(entt::entity)));
+	archive(cereal::binary_data(records.data(), count * sizeof(TransformRecord)));
+
+	registry.reserve<Transform>(count);
+	std::vector<std::pair<entt::entity, entt::entity>> links;
+	for (size_t ix = 0; ix < count; ix++) {
+		const TransformRecord& record = records[ix];
+		Transform& transform = registry.emplace<Transform>(entities[ix], entt::handle(registry, entities[ix]));
+		transform.SetLocalPosition(record.Position);
+		transform.SetLocalRotation(record.Rotation);
+		transform.SetLocalScale(record.Scale);
+		if (record.Parent != entt::null) {
+			links.emplace_back(entities[ix], record.Parent);
+		}
+	}
+	// Parents may come after their children in the pool, so we wait until they all exist
+	if (!links.empty()) {
+		registry.ctx<TransformHierarchy>().SetParents(links);
+	}
+	return true;
+}
+
+void SceneSnapshot::_SaveRenderers(const entt::registry& registry, cereal::BinaryOutputArchive& archive) {
+	const auto view = registry.view<const RendererComponent>();
+	const uint64_t count = view.size();
+
+	// Each distinct asset is written once by name, and renderers refer to them by index
+	std::vector<std::string> meshNames, materialNames;
+	std::unordered_map<const void*, uint32_t> indices;
+	const auto getIndex = [&](const void* asset, const std::string& name, std::vector<std::string>& names) {
+		const auto it = indices.find(asset);
+		if (it != indices.end()) {
+			return it->second;
+		}
+		const uint32_t index = static_cast<uint32_t>(names.size());
+		names.push_back(name);
+		indices[asset] = index;
+		return index;
+	};
+	std::vector<uint32_t> references;
+	references.reserve(count * 2);
+	for (const RendererComponent* it = view.raw(), *end = view.raw() + count; it != end; ++it) {
+		const auto mesh = _meshNames.find(it->Mesh.get());
+		const auto material = _materialNames.find(it->Material.get());
+		if ((it->Mesh != nullptr && mesh == _meshNames.end()) || (it->Material != nullptr && material == _materialNames.end())) {
+			LOG_WARN("A renderer is using a mesh or material that has not been registered, it will be loaded without it");
+		}
+		references.push_back(mesh != _meshNames.end() ? getIndex(it->Mesh.get(), mesh->second, meshNames) : UINT32_MAX);
+		references.push_back(material != _materialNames.end() ? getIndex(it->Material.get(), material->second, materialNames) : UINT32_MAX);
+	}
+
+	archive(meshNames, materialNames);
+	archive(count);
+	archive(cereal::binary_data(view.data(), count * sizeof(entt::entity)));
+	archive(cereal::binary_data(references.data(), references.size() * sizeof(uint32_t)));
+}
+
+bool SceneSnapshot::_LoadRenderers(entt::registry& registry, cereal::BinaryInputArchive& archive) {
+	std::vector<std::string> meshNames, materialNames;
+	archive(meshNames, materialNames);
+
+	// Resolve each asset once up front
+	std::vector<VertexArrayObject::sptr> meshes;
+	std::vector<ShaderMaterial::sptr> materials;
+	for (const std::string& name : meshNames) {
+		const auto it = _meshes.find(name);
+		if (it == _meshes.end()) {
+			LOG_ERROR("Scene snapshot uses mesh \"{}\", which has not been registered", name);
+			return false;
+		}
+		meshes.push_back(it->second);
+	}
+	for (const std::string& name : materialNames) {
+		const auto it = _materials.find(name);
+		if (it == _materials.end()) {
+			LOG_ERROR("Scene snapshot uses material \"{}\", which has not been registered", name);
+			return false;
+		}
+		materials.push_back(it->second);
+	}
+
+	uint64_t count;
+	archive(count);
+	std::vector<entt::entity> entities(count);
+	std::vector<uint32_t> references(count * 2);
+	archive(cereal::binary_data(entities.data(), count * sizeof(entt::entity)));
+	archive(cereal::binary_data(references.data(), references.size() * sizeof(uint32_t)));
+
+	std::vector<RendererComponent> renderers(count);
+	for (size_t ix = 0; ix < count; ix++) {
+		const uint32_t mesh = references[ix * 2];
+		const uint32_t material = references[ix * 2 + 1];
+		renderers[ix].Mesh = mesh != UINT32_MAX ? meshes[mesh] : nullptr;
+		renderers[ix].Material = material != UINT32_MAX ? materials[material] : nullptr;
+	}
+	registry.insert<RendererComponent>(entities.begin(), entities.end(), std::make_move_iterator(renderers.begin()), std::make_move_iterator(renderers.end()));
+	return true;
+}
+
+void SceneSnapshot::_SaveLODGroups(const entt::registry& registry, cereal::BinaryOutputArchive& archive) {
+	const auto view = registry.view<const LODGroup>();
+	const uint64_t count = view.size();
+	archive(count);
+	archive(cereal::binary_data(view.data(), count * sizeof(entt::entity)));
+
+	// Only the settings are saved, the selected level is worked out again on the next frame
+	for (const LODGroup* it = view.raw(), *end = view.raw() + count; it != end; ++it) {
+		archive(it->Hysteresis, it->FadeDuration, static_cast<uint32_t>(it->Levels.size()));
+		for (const LODLevel& level : it->Levels) {
+			const auto mesh = _meshNames.find(level.Mesh.get());
+			if (level.Mesh != nullptr && mesh == _meshNames.end()) {
+				LOG_WARN("A LOD group is using a mesh that has not been registered, it will be loaded without it");
+			}
+			archive(mesh != _meshNames.end() ? mesh->second : std::string(), level.ScreenCoverage);
+		}
+	}
+}
+
+bool SceneSnapshot::_LoadLODGroups(entt::registry& registry, cereal::BinaryInputArchive& archive) {
+	uint64_t count;
+	archive(count);
+	std::vector<entt::entity> entities(count);
+	archive(cereal::binary_data(entities.data(), count * sizeof(entt::entity)));
+
+	std::vector<LODGroup> groups(count);
+	for (LODGroup& group : groups) {
+		uint32_t levelCount;
+		archive(group.Hysteresis, group.FadeDuration, levelCount);
+		group.Levels.resize(levelCount);
+		for (LODLevel& level : group.Levels) {
+			std::string name;
+			archive(name, level.ScreenCoverage);
+			if (!name.empty()) {
+				const auto it = _meshes.find(name);
+				if (it == _meshes.end()) {
+					LOG_ERROR("Scene snapshot uses mesh \"{}\", which has not been registered", name);
+					return false;
+				}
+				level.Mesh = it->second;
+			}
+		}
+	}
+	registry.insert<LODGroup>(entities.begin(), entities.end(), std::make_move_iterator(groups.begin()), std::make_move_iterator(groups.end()));
+	return true;
+}
@@ -0,0 +1,154 @@
+#pragma once
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <entt.hpp>
+#include <cereal/cereal.hpp>
+#include <cereal/archives/binary.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
+#include "Graphics/VertexArrayObject.h"
+#include "Gameplay/ShaderMaterial.h"
+
+class GameScene;
+
+/// <summary>
+/// Saves and restores whole scenes in a compact, gzip compressed binary format.
+///
+/// The entity list is written as-is, and each registered component type is written as one block: the entities that
+/// have it, followed by the components. Trivially copyable components are copied as a single block of memory, other
+/// types are written with cereal (so they need a serialize function). Meshes and materials are written as references
+/// to assets that have been registered with RegisterAsset, so they must be registered again before loading.
+///
+/// Entities keep their identifiers across a save and load, so handles held from before the save are still valid
+/// after loading it back into the same scene
+/// </summary>
+class SceneSnapshot final
+{
+public:
+	typedef void(*SaveFunction)(const entt::registry& registry, cereal::BinaryOutputArchive& archive);
+	// Load functions return false if the data can't be loaded, ex: it refers to an asset that has not been registered
+	typedef bool(*LoadFunction)(entt::registry& registry, cereal::BinaryInputArchive& archive);
+
+	/// <summary>
+	/// Writes the scene to a compressed binary blob
+	/// </summary>
+	/// <param name="scene">The scene to save</param>
+	static std::string Save(const GameScene& scene);
+	/// <summary>
+	/// Replaces the contents of a scene with a blob from Save. Any components that are not registered are lost, and
+	/// any pending commands or queued deletions should be flushed with GameScene::Poll first
+	/// </summary>
+	/// <param name="scene">The scene to load into</param>
+	/// <param name="data">The blob returned from Save</param>
+	/// <returns>
+	/// True if the blob was loaded, false if it is not a valid snapshot or refers to a mesh or material that has not been
+	/// registered. The scene may be left partially loaded if this fails
+	/// </returns>
+	static bool Load(GameScene& scene, const std::string& data);
+
+	/// <summary>
+	/// Saves a scene to a file, see Save
+	/// </summary>
+	static bool SaveToFile(const GameScene& scene, const std::string& path);
+	/// <summary>
+	/// Loads a scene from a file created with SaveToFile, see Load
+	/// </summary>
+	static bool LoadFromFile(GameScene& scene, const std::string& path);
+
+	/// <summary>
+	/// Registers a component type to be saved in snapshots. Types that are not trivially copyable must provide a cereal
+	/// serialize function
+	/// </summary>
+	template <typename Type>
+	static void RegisterComponentType() {
+		static_assert(std::is_trivially_copyable<Type>::value || cereal::traits::is_output_serializable<Type, cereal::BinaryOutputArchive>::value,
+			"Component types must be trivially copyable, or provide a cereal serialize function");
+		RegisterComponentType(entt::type_info<Type>::id(), &SaveComponents<Type>, &LoadComponents<Type>);
+	}
+	/// <summary>
+	/// Registers a component type with custom save and load functions. Types are saved in the order they are registered
+	/// </summary>
+	/// <param name="type">The ID of the component type, from entt::type_info</param>
+	static void RegisterComponentType(entt::id_type type, SaveFunction save, LoadFunction load);
+
+	/// <summary>
+	/// Registers a mesh so that renderers using it can be saved
+	/// </summary>
+	/// <param name="name">A name that is unique among meshes, this is what is written to the snapshot</param>
+	static void RegisterAsset(const std::string& name, const VertexArrayObject::sptr& mesh);
+	/// <summary>
+	/// Registers a material so that renderers using it can be saved
+	/// </summary>
+	/// <param name="name">A name that is unique among materials, this is what is written to the snapshot</param>
+	static void RegisterAsset(const std::string& name, const ShaderMaterial::sptr& material);
+
+	/// <summary>
+	/// The default save function for a component type, writes all instances of the component in one block
+	/// </summary>
+	template <typename Type>
+	static void SaveComponents(const entt::registry& registry, cereal::BinaryOutputArchive& archive) {
+		const auto view = registry.view<const Type>();
+		const uint64_t count = view.size();
+		archive(count);
+		archive(cereal::binary_data(view.data(), count * sizeof(entt::entity)));
+		if constexpr (std::is_empty<Type>::value) {
+			// Nothing to write, having the component is all there is to it
+		} else if constexpr (cereal::traits::is_output_serializable<Type, cereal::BinaryOutputArchive>::value) {
+			for (const Type* it = view.raw(), *end = view.raw() + count; it != end; ++it) {
+				archive(*it);
+			}
+		} else {
+			archive(cereal::binary_data(view.raw(), count * sizeof(Type)));
+		}
+	}
+	/// <summary>
+	/// The default load function for a component type, reads a block written by SaveComponents
+	/// </summary>
+	template <typename Type>
+	static bool LoadComponents(entt::registry& registry, cereal::BinaryInputArchive& archive) {
+		uint64_t count;
+		archive(count);
+		std::vector<entt::entity> entities(count);
+		archive(cereal::binary_data(entities.data(), count * sizeof(entt::entity)));
+		if constexpr (std::is_empty<Type>::value) {
+			registry.insert<Type>(entities.begin(), entities.end());
+		} else {
+			std::vector<Type> components(count);
+			if constexpr (cereal::traits::is_input_serializable<Type, cereal::BinaryInputArchive>::value) {
+				for (Type& component : components) {
+					archive(component);
+				}
+			} else {
+				archive(cereal::binary_data(components.data(), count * sizeof(Type)));
+			}
+			registry.insert<Type>(entities.begin(), entities.end(), std::make_move_iterator(components.begin()), std::make_move_iterator(components.end()));
+		}
+		return true;
+	}
+
+private:
+	struct ComponentSerializer {
+		entt::id_type Type;
+		SaveFunction  Save;
+		LoadFunction  Load;
+	};
+	static std::vector<ComponentSerializer> _serializers;
+
+	// Registered assets, by name and by pointer
+	static std::unordered_map<std::string, VertexArrayObject::sptr> _meshes;
+	static std::unordered_map<const VertexArrayObject*, std::string> _meshNames;
+	static std::unordered_map<std::string, ShaderMaterial::sptr> _materials;
+	static std::unordered_map<const ShaderMaterial*, std::string> _materialNames;
+
+	// Transforms and renderers need special handling for parenting and asset references
+	static void _SaveTransforms(const entt::registry& registry, cereal::BinaryOutputArchive& archive);
+	static bool _LoadTransforms(entt::registry& registry, cereal::BinaryInputArchive& archive);
+	static void _SaveRenderers(const entt::registry& registry, cereal::BinaryOutputArchive& archive);
+	static bool _LoadRenderers(entt::registry& registry, cereal::BinaryInputArchive& archive);
+	static void _SaveLODGroups(const entt::registry& registry, cereal::BinaryOutputArchive& archive);
+	static bool _LoadLODGroups(entt::registry& registry, cereal::BinaryInputArchive& archive);
+	static void _RegisterBuiltInTypes();
+};
@@ -1,22 +1,29 @@
 #include "ShaderMaterial.h"
 
-template<typename T>
-void SubmitUniforms(const Shader::sptr& shader, const std::unordered_map<ShaderParamName, T>& values) {
-	for (auto& kvp : values) {
-		shader->SetUniform(kvp.first.Location, kvp.second);
-	}
-}
+#include <algorithm>
+
+std::atomic<uint64_t> ShaderMaterial::_nextVersion(1);
 
-template<typename T>
-void SubmitUniformsMat(const Shader::sptr& shader, const std::unordered_map<ShaderParamName, T>& values) {
-	for (auto& kvp : values) {
-		shader->SetUniformMatrix(kvp.first.Location, kvp.second);
+// Gets the size of a value in the parameter block, or 0 for types that materials can't hold
+static uint32_t GetParamSize(GLenum type) {
+	switch (type) {
+		case GL_FLOAT:      return sizeof(float);
+		case GL_FLOAT_VEC2: return sizeof(glm::vec2);
+		case GL_FLOAT_VEC3: return sizeof(glm::vec3);
+		case GL_FLOAT_VEC4: return sizeof(glm::vec4);
+		case GL_FLOAT_MAT3: return sizeof(glm::mat3);
+		case GL_FLOAT_MAT4: return sizeof(glm::mat4);
+		default:            return 0;
 	}
 }
 
 ShaderMaterial::ShaderMaterial()
-	: Shader(nullptr),  RenderLayer(0)
+	: Shader(nullptr), RenderLayer(0), IsCullable(true), IsTransparent(false),
+	_layout(nullptr), _textureSlotCount(0), _version(0)
 {
+	// Materials can be made from any thread (ex when loading)
+	static std::atomic<uint32_t> nextSortId(1);
+	_sortId = nextSortId++;
 }
 
 ShaderMaterial::~ShaderMaterial() {
@@ -24,69 +31,152 @@ ShaderMaterial::~ShaderMaterial() {
 }
 
 void ShaderMaterial::Apply()
-{	
-	int slot = 1;
-	for (auto& kvp : Textures) {
-		if (kvp.first.Location != -1 && kvp.second != nullptr) {
-			Shader->SetUniform(kvp.first.Location, slot);
-			kvp.second->Bind(slot);
-			slot++;
+{
+	LOG_ASSERT(_params.empty() || Shader.get() == _layout, "Material's shader was changed after it's parameters were set!");
+
+	// Samplers are given their slots when the shader is linked, so we only need to bind the textures
+	for (int slot = 0; slot < _textureSlotCount; slot++) {
+		if (_textures[slot] != nullptr) {
+			_textures[slot]->Bind(slot);
 		}
 	}
 
-	SubmitUniforms(Shader, FloatParams);
-	SubmitUniforms(Shader, Vec2Params);
-	SubmitUniforms(Shader, Vec3Params);
-	SubmitUniforms(Shader, Vec4Params);
-	SubmitUniformsMat(Shader, Mat4Params);
-	SubmitUniformsMat(Shader, Mat3Params);
+	// The shader keeps it's uniforms between draws, so if we set them last they're still good
+	if (Shader->GetAppliedVersion() == _version) {
+		return;
+	}
+	for (const Param& param : _params) {
+		const uint8_t* value = _block.data() + param.Offset;
+		switch (param.Type) {
+			case GL_FLOAT:      Shader->SetUniform(param.Location, reinterpret_cast<const float*>(value)); break;
+			case GL_FLOAT_VEC2: Shader->SetUniform(param.Location, reinterpret_cast<const glm::vec2*>(value)); break;
+			case GL_FLOAT_VEC3: Shader->SetUniform(param.Location, reinterpret_cast<const glm::vec3*>(value)); break;
+			case GL_FLOAT_VEC4: Shader->SetUniform(param.Location, reinterpret_cast<const glm::vec4*>(value)); break;
+			case GL_FLOAT_MAT3: Shader->SetUniformMatrix(param.Location, reinterpret_cast<const glm::mat3*>(value)); break;
+			case GL_FLOAT_MAT4: Shader->SetUniformMatrix(param.Location, reinterpret_cast<const glm::mat4*>(value)); break;
+			// Samplers are handled above
+			default: break;
+		}
+	}
+	Shader->SetAppliedVersion(_version);
 }
 
-void ShaderMaterial::Set(const std::string& name, const ITexture::sptr& texture) {
+int ShaderMaterial::_FindOrAdd(const ShaderUniformInfo& info) {
+	for (size_t ix = 0; ix < _params.size(); ix++) {
+		if (_params[ix].Location == info.Location) {
+			return static_cast<int>(ix);
+		}
+	}
+
+	Param param;
+	param.Location = info.Location;
+	param.Type = info.Type;
+	if (info.TextureSlot != -1) {
+		if (info.TextureSlot >= MAX_TEXTURE_SLOTS) {
+			LOG_WARN("Sampler \"{}\" is in slot {}, materials only support {} texture slots", info.Name, info.TextureSlot, MAX_TEXTURE_SLOTS);
+			return -1;
+		}
+		param.Offset = info.TextureSlot;
+		_textureSlotCount = std::max(_textureSlotCount, info.TextureSlot + 1);
+	} else {
+		const uint32_t size = GetParamSize(info.Type);
+		if (size == 0 || info.ArraySize != 1) {
+			LOG_WARN("Uniform \"{}\" has a type that materials don't support", info.Name);
+			return -1;
+		}
+		param.Offset = static_cast<uint32_t>(_block.size());
+		_block.resize(_block.size() + size, 0);
+	}
+	_params.push_back(param);
+	_layout = Shader.get();
+	// The new parameter has to be sent, even if it's never set
+	_version = _nextVersion++;
+	return static_cast<int>(_params.size()) - 1;
+}
+
+int ShaderMaterial::_FindOrAdd(const std::string& name, GLenum type) {
 	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
-	ShaderParamName pName = name;
-	pName.Location = Shader->GetUniformLocation(name);
-	Textures[pName] = texture;
+	const ShaderUniformInfo* info = Shader->FindUniform(name);
+	if (info == nullptr) {
+		LOG_WARN("Ignoring uniform \"{}\"", name);
+		return -1;
+	}
+	// Any sampler type can take a texture
+	const bool typeMatches = type == GL_SAMPLER_2D ? info->TextureSlot != -1 : info->Type == type;
+	if (!typeMatches) {
+		LOG_WARN("Ignoring uniform \"{}\", the value does not match the type in the shader", name);
+		return -1;
+	}
+	return _FindOrAdd(*info);
 }
 
-void ShaderMaterial::Set(const std::string& name, float value) {
+ShaderParamHandle ShaderMaterial::GetHandle(const std::string& name) {
 	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
-	ShaderParamName pName = name;
-	pName.Location = Shader->GetUniformLocation(name);
-	FloatParams[pName] = value;
+	ShaderParamHandle result;
+	const ShaderUniformInfo* info = Shader->FindUniform(name);
+	if (info != nullptr) {
+		result.Index = _FindOrAdd(*info);
+	} else {
+		LOG_WARN("Ignoring uniform \"{}\"", name);
+	}
+	return result;
+}
+
+void ShaderMaterial::Set(const std::string& name, const ITexture::sptr& texture) {
+	Set(ShaderParamHandle{ _FindOrAdd(name, GL_SAMPLER_2D) }, texture);
+}
+
+void ShaderMaterial::Set(const std::string& name, float value) {
+	Set(ShaderParamHandle{ _FindOrAdd(name, GL_FLOAT) }, value);
 }
 
 void ShaderMaterial::Set(const std::string& name, const glm::vec2& value) {
-	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
-	ShaderParamName pName = name;
-	pName.Location = Shader->GetUniformLocation(name);
-	Vec2Params[pName] = value;
+	Set(ShaderParamHandle{ _FindOrAdd(name, GL_FLOAT_VEC2) }, value);
 }
 
 void ShaderMaterial::Set(const std::string& name, const glm::vec3& value) {
-	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
-	ShaderParamName pName = name;
-	pName.Location = Shader->GetUniformLocation(name);
-	Vec3Params[pName] = value;
+	Set(ShaderParamHandle{ _FindOrAdd(name, GL_FLOAT_VEC3) }, value);
 }
 
 void ShaderMaterial::Set(const std::string& name, const glm::vec4& value) {
-	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
-	ShaderParamName pName = name;
-	pName.Location = Shader->GetUniformLocation(name);
-	Vec4Params[pName] = value;
+	Set(ShaderParamHandle{ _FindOrAdd(name, GL_FLOAT_VEC4) }, value);
 }
 
 void ShaderMaterial::Set(const std::string& name, const glm::mat4& value) {
-	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
-	ShaderParamName pName = name;
-	pName.Location = Shader->GetUniformLocation(name);
-	Mat4Params[pName] = value;
+	Set(ShaderParamHandle{ _FindOrAdd(name, GL_FLOAT_MAT4) }, value);
 }
 
 void ShaderMaterial::Set(const std::string& name, const glm::mat3& value) {
-	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
-	ShaderParamName pName = name;
-	pName.Location = Shader->GetUniformLocation(name);
-	Mat3Params[pName] = value;
+	Set(ShaderParamHandle{ _FindOrAdd(name, GL_FLOAT_MAT3) }, value);
+}
+
+void ShaderMaterial::Set(ShaderParamHandle handle, const ITexture::sptr& texture) {
+	if (handle.IsValid()) {
+		LOG_ASSERT(handle.Index < static_cast<int>(_params.size()) && GetParamSize(_params[handle.Index].Type) == 0, "Parameter handle does not match the value type!");
+		_textures[_params[handle.Index].Offset] = texture;
+	}
+}
+
+void ShaderMaterial::Set(ShaderParamHandle handle, float value) {
+	if (handle.IsValid()) { _Write(handle, GL_FLOAT, value); }
+}
+
+void ShaderMaterial::Set(ShaderParamHandle handle, const glm::vec2& value) {
+	if (handle.IsValid()) { _Write(handle, GL_FLOAT_VEC2, value); }
+}
+
+void ShaderMaterial::Set(ShaderParamHandle handle, const glm::vec3& value) {
+	if (handle.IsValid()) { _Write(handle, GL_FLOAT_VEC3, value); }
+}
+
+void ShaderMaterial::Set(ShaderParamHandle handle, const glm::vec4& value) {
+	if (handle.IsValid()) { _Write(handle, GL_FLOAT_VEC4, value); }
+}
+
+void ShaderMaterial::Set(ShaderParamHandle handle, const glm::mat4& value) {
+	if (handle.IsValid()) { _Write(handle, GL_FLOAT_MAT4, value); }
+}
+
+void ShaderMaterial::Set(ShaderParamHandle handle, const glm::mat3& value) {
+	if (handle.IsValid()) { _Write(handle, GL_FLOAT_MAT3, value); }
 }
@@ -1,56 +1,73 @@
 #pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <vector>
 #include "Graphics/Shader.h"
 #include "Graphics/ITexture.h"
 #include "Utilities/Macros.h"
 #include <EnumToString.h>
 
-struct ShaderParamName {
-	std::string Name;
-	int         Location;
-
-	ShaderParamName(const std::string& name) :
-		Name(name), Location(-1) {}
+/// <summary>
+/// A handle to one of a material's parameters, from ShaderMaterial::GetHandle. Setting a parameter through it's
+/// handle skips looking the parameter up by name, so it's the way to go for values that change every frame
+/// </summary>
+struct ShaderParamHandle
+{
+	int Index = -1;
 
-	bool operator ==(const ShaderParamName& r) const {
-		return Name == r.Name;
-	}
-	bool operator !=(const ShaderParamName& r) const {
-		return Name != r.Name;
-	}
+	bool IsValid() const { return Index >= 0; }
 };
 
-namespace  std
-{
-	template<>
-	struct hash<ShaderParamName> {
-		std::size_t operator()(const ShaderParamName& p) const noexcept {
-			return std::hash<std::string>()(p.Name);
-		}
-	};
-}
-
 class ShaderMaterial {
 	SMART_MEMORY_MANAGED(ShaderMaterial)
 public:
-	
+	/// <summary>
+	/// The most texture slots a material can use
+	/// </summary>
+	static constexpr int MAX_TEXTURE_SLOTS = 16;
+
 	ShaderMaterial();
 	virtual ~ShaderMaterial();
 
+	/// <summary>
+	/// The shader to draw with, this must be set before any parameters are, and can't change after
+	/// </summary>
 	Shader::sptr Shader;
-	std::unordered_map<ShaderParamName, ITexture::sptr> Textures;
-	std::unordered_map<ShaderParamName, float> FloatParams;
-	std::unordered_map<ShaderParamName, glm::vec2> Vec2Params;
-	std::unordered_map<ShaderParamName, glm::vec3> Vec3Params;
-	std::unordered_map<ShaderParamName, glm::vec4> Vec4Params;
-	std::unordered_map<ShaderParamName, glm::mat4> Mat4Params;
-	std::unordered_map<ShaderParamName, glm::mat3> Mat3Params;
 
 	int RenderLayer;
+	/// <summary>
+	/// False if objects using this material should never be frustum culled, ex when the shader ignores the model
+	/// matrix (like the skybox does)
+	/// </summary>
+	bool IsCullable;
+	/// <summary>
+	/// True if objects using this material are blended with what is behind them. They are drawn after the opaque
+	/// objects in their render layer, from back to front
+	/// </summary>
+	bool IsTransparent;
 	std::string DebugName;
 
+	/// <summary>
+	/// Gets a small number that is unique to this material, used to build render sort keys
+	/// </summary>
+	uint32_t GetSortId() const { return _sortId; }
+
+	/// <summary>
+	/// Binds the material's textures, and sends it's parameters to the shader. If this material was the last one to
+	/// set the shader's uniforms and nothing has changed since, only the textures are bound
+	/// </summary>
 	void Apply();
 
+	/// <summary>
+	/// Gets a handle to a parameter, adding it to the material if it hasn't been set yet (in which case it starts at
+	/// zero). Returns an invalid handle if the shader does not have the uniform
+	/// </summary>
+	/// <param name="name">The name of the uniform in the shader</param>
+	ShaderParamHandle GetHandle(const std::string& name);
+
 	void Set(const std::string& name, const ITexture::sptr& texture);
 	void Set(const std::string& name, float value);
 	void Set(const std::string& name, const glm::vec2& value);
@@ -59,5 +76,49 @@ public:
 	void Set(const std::string& name, const glm::mat4& value);
 	void Set(const std::string& name, const glm::mat3& value);
 
+	void Set(ShaderParamHandle handle, const ITexture::sptr& texture);
+	void Set(ShaderParamHandle handle, float value);
+	void Set(ShaderParamHandle handle, const glm::vec2& value);
+	void Set(ShaderParamHandle handle, const glm::vec3& value);
+	void Set(ShaderParamHandle handle, const glm::vec4& value);
+	void Set(ShaderParamHandle handle, const glm::mat4& value);
+	void Set(ShaderParamHandle handle, const glm::mat3& value);
+
 protected:
+	/// <summary>
+	/// A parameter in the material, laid out against the shader's uniforms
+	/// </summary>
+	struct Param
+	{
+		int      Location;
+		GLenum   Type;
+		// The offset of the value in the parameter block, or the texture slot for samplers
+		uint32_t Offset;
+	};
+
+	uint32_t _sortId;
+	// The shader that the parameters were laid out for
+	const ::Shader* _layout;
+	std::vector<Param> _params;
+	// The values of all the parameters, packed one after another
+	std::vector<uint8_t> _block;
+	// The textures, indexed by the slot they are bound to
+	std::array<ITexture::sptr, MAX_TEXTURE_SLOTS> _textures;
+	int _textureSlotCount;
+	// Changes every time a parameter is set, and is unique across all materials
+	uint64_t _version;
+
+	static std::atomic<uint64_t> _nextVersion;
+
+	// Finds the parameter for a uniform, or adds it to the block
+	int _FindOrAdd(const ShaderUniformInfo& info);
+	// Finds the parameter by name, checking that the uniform has the expected type. Returns -1 if not found
+	int _FindOrAdd(const std::string& name, GLenum type);
+
+	template <typename T>
+	void _Write(ShaderParamHandle handle, GLenum type, const T& value) {
+		LOG_ASSERT(handle.Index < static_cast<int>(_params.size()) && _params[handle.Index].Type == type, "Parameter handle does not match the value type!");
+		memcpy(_block.data() + _params[handle.Index].Offset, &value, sizeof(T));
+		_version = _nextVersion++;
+	}
 };
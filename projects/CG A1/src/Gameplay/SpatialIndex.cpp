@@ -0,0 +1,428 @@
+#include "SpatialIndex.h"
+
+#include <algorithm>
+#include "Bounds.h"
+#include "TransformHierarchy.h"
+#include "WorldMatrix.h"
+#include "Logging.h"
+
+// The tree is kept balanced, so even billions of entities would not come close to this depth
+static constexpr int MaxStackDepth = 256;
+
+SpatialIndex::SpatialIndex(entt::registry& registry) :
+	_registry(registry),
+	_root(NullNode),
+	_freeList(NullNode),
+	_count(0)
+{
+	_registry.on_construct<LocalBounds>().connect<&SpatialIndex::_OnBoundsChanged>(*this);
+	_registry.on_update<LocalBounds>().connect<&SpatialIndex::_OnBoundsChanged>(*this);
+	_registry.on_destroy<LocalBounds>().connect<&SpatialIndex::_OnBoundsDestroyed>(*this);
+}
+
+SpatialIndex::~SpatialIndex() {
+	_registry.on_construct<LocalBounds>().disconnect<&SpatialIndex::_OnBoundsChanged>(*this);
+	_registry.on_update<LocalBounds>().disconnect<&SpatialIndex::_OnBoundsChanged>(*this);
+	_registry.on_destroy<LocalBounds>().disconnect<&SpatialIndex::_OnBoundsDestroyed>(*this);
+}
+
+void SpatialIndex::Update() {
+	for (entt::entity entity : _dirty) {
+		// The bounds may have been removed again since they were marked
+		if (_registry.valid(entity) && _registry.has<LocalBounds>(entity)) {
+			_Refresh(entity);
+		}
+	}
+	_dirty.clear();
+
+	// Anything that had it's world matrix recomputed may have moved
+	if (_registry.try_ctx<TransformHierarchy>() != nullptr) {
+		for (entt::entity entity : _registry.ctx<TransformHierarchy>().GetUpdated()) {
+			if (_registry.valid(entity) && _registry.has<LocalBounds>(entity)) {
+				_Refresh(entity);
+			}
+		}
+	}
+}
+
+template <typename Test, typename Visit>
+void SpatialIndex::_Traverse(const Test& test, const Visit& visit) const {
+	if (_root == NullNode) {
+		return;
+	}
+	int stack[MaxStackDepth];
+	int top = 0;
+	stack[top++] = _root;
+	while (top > 0) {
+		const Node& node = _nodes[stack[--top]];
+		if (!test(node.Box)) {
+			continue;
+		}
+		if (node.IsLeaf()) {
+			if (!visit(node)) {
+				return;
+			}
+		} else {
+			LOG_ASSERT(top + 2 <= MaxStackDepth, "Spatial index is too deep!");
+			stack[top++] = node.Left;
+			stack[top++] = node.Right;
+		}
+	}
+}
+
+void SpatialIndex::QueryAABB(const AABB& box, std::vector<entt::entity>& results) const {
+	_Traverse(
+		[&](const AABB& nodeBox) { return nodeBox.Intersects(box); },
+		[&](const Node& leaf) {
+			if (leaf.Bounds.Intersects(box)) {
+				results.push_back(leaf.Entity);
+			}
+			return true;
+		});
+}
+
+void SpatialIndex::QuerySphere(const BoundingSphere& sphere, std::vector<entt::entity>& results) const {
+	_Traverse(
+		[&](const AABB& nodeBox) { return sphere.Intersects(nodeBox); },
+		[&](const Node& leaf) {
+			if (sphere.Intersects(leaf.Bounds)) {
+				results.push_back(leaf.Entity);
+			}
+			return true;
+		});
+}
+
+void SpatialIndex::QueryFrustum(const Frustum& frustum, std::vector<entt::entity>& results) const {
+	if (_root == NullNode) {
+		return;
+	}
+	// Each stack entry remembers whether it's parent was fully inside, so we can skip the plane tests for it
+	std::pair<int, bool> stack[MaxStackDepth];
+	int top = 0;
+	stack[top++] = { _root, false };
+	while (top > 0) {
+		const auto [index, inside] = stack[--top];
+		const Node& node = _nodes[index];
+		bool nodeInside = inside;
+		if (!inside) {
+			const Frustum::Result result = frustum.Classify(node.IsLeaf() ? node.Bounds : node.Box);
+			if (result == Frustum::Result::Outside) {
+				continue;
+			}
+			nodeInside = result == Frustum::Result::Inside;
+		}
+		if (node.IsLeaf()) {
+			results.push_back(node.Entity);
+		} else {
+			LOG_ASSERT(top + 2 <= MaxStackDepth, "Spatial index is too deep!");
+			stack[top++] = { node.Left, nodeInside };
+			stack[top++] = { node.Right, nodeInside };
+		}
+	}
+}
+
+bool SpatialIndex::Raycast(const Ray& ray, float maxDistance, RaycastHit& hit) const {
+	// Every hit shortens the ray, so we stop looking at anything further away than the closest hit so far
+	float closest = maxDistance;
+	bool result = false;
+	float distance;
+	_Traverse(
+		[&](const AABB& nodeBox) { return ray.Intersects(nodeBox, closest, distance); },
+		[&](const Node& leaf) {
+			if (ray.Intersects(leaf.Bounds, closest, distance)) {
+				closest = distance;
+				hit.Entity = leaf.Entity;
+				hit.Distance = distance;
+				result = true;
+			}
+			return true;
+		});
+	return result;
+}
+
+void SpatialIndex::RaycastAll(const Ray& ray, float maxDistance, std::vector<RaycastHit>& results) const {
+	float distance;
+	_Traverse(
+		[&](const AABB& nodeBox) { return ray.Intersects(nodeBox, maxDistance, distance); },
+		[&](const Node& leaf) {
+			if (ray.Intersects(leaf.Bounds, maxDistance, distance)) {
+				results.push_back({ leaf.Entity, distance });
+			}
+			return true;
+		});
+}
+
+void SpatialIndex::_OnBoundsChanged(entt::registry& registry, entt::entity entity) {
+	_dirty.push_back(entity);
+}
+
+void SpatialIndex::_OnBoundsDestroyed(entt::registry& registry, entt::entity entity) {
+	_RemoveProxy(entity);
+	registry.remove_if_exists<WorldBounds>(entity);
+}
+
+int& SpatialIndex::_LeafOf(entt::entity entity) {
+	const size_t index = entt::to_integral(entity) & entt::entt_traits<entt::entity>::entity_mask;
+	if (index >= _leaves.size()) {
+		_leaves.resize(index + 1, NullNode);
+	}
+	return _leaves[index];
+}
+
+void SpatialIndex::_Refresh(entt::entity entity) {
+	const AABB& local = _registry.get<LocalBounds>(entity).Value;
+	const WorldMatrix* world = _registry.try_get<WorldMatrix>(entity);
+	const AABB bounds = world != nullptr ? local.Transformed(world->Value) : local;
+	_registry.get_or_emplace<WorldBounds>(entity).Value = bounds;
+
+	if (!bounds.IsValid()) {
+		_RemoveProxy(entity);
+		return;
+	}
+
+	int leaf = _LeafOf(entity);
+	if (leaf != NullNode) {
+		// Most of the time an object only moves a little, and stays within it's inflated box
+		_nodes[leaf].Bounds = bounds;
+		if (_nodes[leaf].Box.Contains(bounds)) {
+			return;
+		}
+		_RemoveLeaf(leaf);
+	} else {
+		leaf = _AllocateNode();
+		_LeafOf(entity) = leaf;
+		_count++;
+	}
+
+	Node& node = _nodes[leaf];
+	node.Entity = entity;
+	node.Bounds = bounds;
+	node.Box = bounds.Inflated(Margin);
+	node.Left = NullNode;
+	node.Right = NullNode;
+	node.Height = 0;
+	_InsertLeaf(leaf);
+}
+
+void SpatialIndex::_RemoveProxy(entt::entity entity) {
+	int& leaf = _LeafOf(entity);
+	if (leaf != NullNode) {
+		_RemoveLeaf(leaf);
+		_FreeNode(leaf);
+		leaf = NullNode;
+		_count--;
+	}
+}
+
+int SpatialIndex::_AllocateNode() {
+	if (_freeList == NullNode) {
+		Node node;
+		node.Height = -1;
+		node.Parent = NullNode;
+		_nodes.push_back(node);
+		_freeList = static_cast<int>(_nodes.size()) - 1;
+	}
+	const int index = _freeList;
+	Node& node = _nodes[index];
+	_freeList = node.Parent;
+	node.Entity = entt::null;
+	node.Parent = NullNode;
+	node.Left = NullNode;
+	node.Right = NullNode;
+	node.Height = 0;
+	return index;
+}
+
+void SpatialIndex::_FreeNode(int node) {
+	_nodes[node].Parent = _freeList;
+	_nodes[node].Height = -1;
+	_freeList = node;
+}
+
+void SpatialIndex::_InsertLeaf(int leaf) {
+	if (_root == NullNode) {
+		_root = leaf;
+		_nodes[leaf].Parent = NullNode;
+		return;
+	}
+
+	// Walk down the tree, picking the child that would grow the least (by surface area) to fit the new leaf. We stop
+	// when making a new branch here is cheaper than pushing the leaf down into either child
+	const AABB leafBox = _nodes[leaf].Box;
+	int index = _root;
+	while (!_nodes[index].IsLeaf()) {
+		const Node& node = _nodes[index];
+		const float area = node.Box.SurfaceArea();
+		const float combinedArea = AABB::Merge(node.Box, leafBox).SurfaceArea();
+		const float cost = 2.0f * combinedArea;
+		// The cost that pushing the leaf further down adds to this node
+		const float inheritedCost = 2.0f * (combinedArea - area);
+
+		const auto childCost = [&](int child) {
+			const AABB& childBox = _nodes[child].Box;
+			const float grownArea = AABB::Merge(childBox, leafBox).SurfaceArea();
+			return _nodes[child].IsLeaf() ? grownArea + inheritedCost : grownArea - childBox.SurfaceArea() + inheritedCost;
+		};
+		const float leftCost = childCost(node.Left);
+		const float rightCost = childCost(node.Right);
+
+		if (cost < leftCost && cost < rightCost) {
+			break;
+		}
+		index = leftCost < rightCost ? node.Left : node.Right;
+	}
+
+	// Make a new branch in place of the sibling, holding the sibling and our leaf
+	const int sibling = index;
+	const int oldParent = _nodes[sibling].Parent;
+	const int newParent = _AllocateNode();
+	Node& parent = _nodes[newParent];
+	parent.Parent = oldParent;
+	parent.Box = AABB::Merge(leafBox, _nodes[sibling].Box);
+	parent.Height = _nodes[sibling].Height + 1;
+	parent.Left = sibling;
+	parent.Right = leaf;
+	_nodes[sibling].Parent = newParent;
+	_nodes[leaf].Parent = newParent;
+
+	if (oldParent == NullNode) {
+		_root = newParent;
+	} else if (_nodes[oldParent].Left == sibling) {
+		_nodes[oldParent].Left = newParent;
+	} else {
+		_nodes[oldParent].Right = newParent;
+	}
+
+	_Refit(oldParent);
+}
+
+void SpatialIndex::_RemoveLeaf(int leaf) {
+	if (leaf == _root) {
+		_root = NullNode;
+		return;
+	}
+
+	// The leaf's sibling takes the place of their parent
+	const int parent = _nodes[leaf].Parent;
+	const int grandParent = _nodes[parent].Parent;
+	const int sibling = _nodes[parent].Left == leaf ? _nodes[parent].Right : _nodes[parent].Left;
+	_FreeNode(parent);
+	_nodes[leaf].Parent = NullNode;
+
+	_nodes[sibling].Parent = grandParent;
+	if (grandParent == NullNode) {
+		_root = sibling;
+	} else {
+		if (_nodes[grandParent].Left == parent) {
+			_nodes[grandParent].Left = sibling;
+		} else {
+			_nodes[grandParent].Right = sibling;
+		}
+		_Refit(grandParent);
+	}
+}
+
+void SpatialIndex::_Refit(int node) {
+	int index = node;
+	while (index != NullNode) {
+		index = _Balance(index);
+		Node& current = _nodes[index];
+		const Node& left = _nodes[current.Left];
+		const Node& right = _nodes[current.Right];
+		current.Height = 1 + std::max(left.Height, right.Height);
+		current.Box = AABB::Merge(left.Box, right.Box);
+		index = current.Parent;
+	}
+}
+
+int SpatialIndex::_Balance(int a) {
+	Node& nodeA = _nodes[a];
+	if (nodeA.IsLeaf() || nodeA.Height < 2) {
+		return a;
+	}
+
+	const int b = nodeA.Left;
+	const int c = nodeA.Right;
+	Node& nodeB = _nodes[b];
+	Node& nodeC = _nodes[c];
+	const int balance = nodeC.Height - nodeB.Height;
+
+	// The right side is too tall, rotate C up into A's place
+	if (balance > 1) {
+		const int f = nodeC.Left;
+		const int g = nodeC.Right;
+		Node& nodeF = _nodes[f];
+		Node& nodeG = _nodes[g];
+
+		nodeC.Left = a;
+		nodeC.Parent = nodeA.Parent;
+		nodeA.Parent = c;
+		if (nodeC.Parent == NullNode) {
+			_root = c;
+		} else if (_nodes[nodeC.Parent].Left == a) {
+			_nodes[nodeC.Parent].Left = c;
+		} else {
+			_nodes[nodeC.Parent].Right = c;
+		}
+
+		// Keep the taller of C's children, and give the other one to A
+		if (nodeF.Height > nodeG.Height) {
+			nodeC.Right = f;
+			nodeA.Right = g;
+			nodeG.Parent = a;
+			nodeA.Box = AABB::Merge(nodeB.Box, nodeG.Box);
+			nodeC.Box = AABB::Merge(nodeA.Box, nodeF.Box);
+			nodeA.Height = 1 + std::max(nodeB.Height, nodeG.Height);
+			nodeC.Height = 1 + std::max(nodeA.Height, nodeF.Height);
+		} else {
+			nodeC.Right = g;
+			nodeA.Right = f;
+			nodeF.Parent = a;
+			nodeA.Box = AABB::Merge(nodeB.Box, nodeF.Box);
+			nodeC.Box = AABB::Merge(nodeA.Box, nodeG.Box);
+			nodeA.Height = 1 + std::max(nodeB.Height, nodeF.Height);
+			nodeC.Height = 1 + std::max(nodeA.Height, nodeG.Height);
+		}
+		return c;
+	}
+
+	// The left side is too tall, rotate B up into A's place
+	if (balance < -1) {
+		const int d = nodeB.Left;
+		const int e = nodeB.Right;
+		Node& nodeD = _nodes[d];
+		Node& nodeE = _nodes[e];
+
+		nodeB.Left = a;
+		nodeB.Parent = nodeA.Parent;
+		nodeA.Parent = b;
+		if (nodeB.Parent == NullNode) {
+			_root = b;
+		} else if (_nodes[nodeB.Parent].Left == a) {
+			_nodes[nodeB.Parent].Left = b;
+		} else {
+			_nodes[nodeB.Parent].Right = b;
+		}
+
+		if (nodeD.Height > nodeE.Height) {
+			nodeB.Right = d;
+			nodeA.Left = e;
+			nodeE.Parent = a;
+			nodeA.Box = AABB::Merge(nodeC.Box, nodeE.Box);
+			nodeB.Box = AABB::Merge(nodeA.Box, nodeD.Box);
+			nodeA.Height = 1 + std::max(nodeC.Height, nodeE.Height);
+			nodeB.Height = 1 + std::max(nodeA.Height, nodeD.Height);
+		} else {
+			nodeB.Right = e;
+			nodeA.Left = d;
+			nodeD.Parent = a;
+			nodeA.Box = AABB::Merge(nodeC.Box, nodeD.Box);
+			nodeB.Box = AABB::Merge(nodeA.Box, nodeE.Box);
+			nodeA.Height = 1 + std::max(nodeC.Height, nodeD.Height);
+			nodeB.Height = 1 + std::max(nodeA.Height, nodeE.Height);
+		}
+		return b;
+	}
+
+	return a;
+}
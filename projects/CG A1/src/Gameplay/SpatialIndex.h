@@ -0,0 +1,146 @@
+#pragma once
+#include <vector>
+#include <entt.hpp>
+#include "Utilities/BoundingVolumes.h"
+
+/// <summary>
+/// Keeps track of where the entities in a registry are in space, so that proximity, visibility and picking queries
+/// don't have to scan the whole registry.
+///
+/// Every entity with LocalBounds is given WorldBounds, and is stored in a dynamic AABB tree (the same kind of tree
+/// that most physics engines use for their broadphase). The tree stores a slightly inflated box for each entity, so
+/// small movements don't touch the tree at all, and is kept balanced with tree rotations as entities are inserted
+/// and removed.
+///
+/// Update is incremental: only entities whose bounds changed, or whose world matrix was recomputed by the last
+/// TransformHierarchy::Update, are refreshed. Queries are read-only, and may be run from many threads at once as long
+/// as Update is not running
+///
+/// One index lives in the context of each GameScene's registry
+/// </summary>
+class SpatialIndex final
+{
+public:
+	/// <summary>
+	/// The result of a raycast
+	/// </summary>
+	struct RaycastHit {
+		entt::entity Entity   = entt::null;
+		float        Distance = 0.0f;
+	};
+
+	/// <summary>
+	/// How far the boxes in the tree are inflated past the actual bounds, in world units. Larger margins mean fewer
+	/// tree updates for moving objects, but looser query culling
+	/// </summary>
+	float Margin = 0.1f;
+
+	SpatialIndex(entt::registry& registry);
+	~SpatialIndex();
+
+	SpatialIndex(const SpatialIndex& other) = delete;
+	SpatialIndex(SpatialIndex&& other) = delete;
+	SpatialIndex& operator=(const SpatialIndex& other) = delete;
+	SpatialIndex& operator=(SpatialIndex&& other) = delete;
+
+	/// <summary>
+	/// Refreshes the world bounds of any entities that were moved or had their bounds changed, and moves them in the
+	/// tree if needed. Call this after TransformHierarchy::Update, from one thread only
+	/// </summary>
+	void Update();
+
+	/// <summary>
+	/// Finds all the entities whose bounds overlap a box
+	/// </summary>
+	/// <param name="box">The world space box to search</param>
+	/// <param name="results">The vector to append the entities to</param>
+	void QueryAABB(const AABB& box, std::vector<entt::entity>& results) const;
+	/// <summary>
+	/// Finds all the entities whose bounds overlap a sphere
+	/// </summary>
+	/// <param name="sphere">The world space sphere to search</param>
+	/// <param name="results">The vector to append the entities to</param>
+	void QuerySphere(const BoundingSphere& sphere, std::vector<entt::entity>& results) const;
+	/// <summary>
+	/// Finds all the entities whose bounds are at least partially inside a frustum. Whole branches of the tree that
+	/// are inside the frustum are accepted without testing each entity
+	/// </summary>
+	/// <param name="frustum">The world space frustum to search</param>
+	/// <param name="results">The vector to append the entities to</param>
+	void QueryFrustum(const Frustum& frustum, std::vector<entt::entity>& results) const;
+	/// <summary>
+	/// Finds the first entity whose bounds are hit by a ray
+	/// </summary>
+	/// <param name="ray">The world space ray to cast, it's direction should be normalized</param>
+	/// <param name="maxDistance">The length of the ray</param>
+	/// <param name="hit">Receives the closest hit, if there is one</param>
+	/// <returns>True if the ray hit anything</returns>
+	bool Raycast(const Ray& ray, float maxDistance, RaycastHit& hit) const;
+	/// <summary>
+	/// Finds all the entities whose bounds are hit by a ray, in no particular order
+	/// </summary>
+	/// <param name="ray">The world space ray to cast, it's direction should be normalized</param>
+	/// <param name="maxDistance">The length of the ray</param>
+	/// <param name="results">The vector to append the hits to</param>
+	void RaycastAll(const Ray& ray, float maxDistance, std::vector<RaycastHit>& results) const;
+
+	/// <summary>
+	/// Gets the number of entities in the index
+	/// </summary>
+	size_t GetCount() const { return _count; }
+	/// <summary>
+	/// Gets the height of the tree, a balanced tree should be roughly log2 of the count
+	/// </summary>
+	int GetHeight() const { return _root == NullNode ? 0 : _nodes[_root].Height; }
+
+private:
+	static constexpr int NullNode = -1;
+
+	struct Node {
+		// The inflated box for leaves, or the union of the children for branches
+		AABB Box;
+		// The actual world bounds, for leaves only
+		AABB Bounds;
+		entt::entity Entity;
+		// The parent, or the next free node when this node is not in use
+		int Parent;
+		int Left;
+		int Right;
+		// 0 for leaves, -1 for free nodes
+		int Height;
+
+		bool IsLeaf() const { return Left == NullNode; }
+	};
+
+	entt::registry& _registry;
+
+	std::vector<Node> _nodes;
+	int    _root;
+	int    _freeList;
+	size_t _count;
+
+	// The leaf node for each entity, indexed by the entity part of the identifier
+	std::vector<int> _leaves;
+	// Entities whose local bounds were added or changed since the last update
+	std::vector<entt::entity> _dirty;
+
+	void _OnBoundsChanged(entt::registry& registry, entt::entity entity);
+	void _OnBoundsDestroyed(entt::registry& registry, entt::entity entity);
+
+	void _Refresh(entt::entity entity);
+	int& _LeafOf(entt::entity entity);
+	void _RemoveProxy(entt::entity entity);
+
+	int  _AllocateNode();
+	void _FreeNode(int node);
+	void _InsertLeaf(int leaf);
+	void _RemoveLeaf(int leaf);
+	// Rotates the tree around a node if it's children are unbalanced, and returns the node that took it's place
+	int  _Balance(int node);
+	// Fixes up the boxes and heights of all the ancestors of a node, re-balancing as it goes
+	void _Refit(int node);
+
+	// Visits every leaf whose box passes the test, visit returns false to stop
+	template <typename Test, typename Visit>
+	void _Traverse(const Test& test, const Visit& visit) const;
+};
@@ -0,0 +1,102 @@
+#include "SystemScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "Logging.h"
+#include "Gameplay/Timing.h"
+#include "Utilities/JobSystem.h"
+
+// Returns true if any of the ids in a are also in b
+static bool Overlaps(const std::vector<entt::id_type>& a, const std::vector<entt::id_type>& b) {
+	for (entt::id_type id : a) {
+		if (std::find(b.begin(), b.end(), id) != b.end()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool SystemAccess::ConflictsWith(const SystemAccess& other) const {
+	return Exclusive || other.Exclusive ||
+		Overlaps(Writes, other.Reads) || Overlaps(Writes, other.Writes) || Overlaps(Reads, other.Writes);
+}
+
+void SystemScheduler::AddSystem(SystemPhase phase, const std::string& name, const SystemAccess& access, const SystemFunc& func) {
+	LOG_ASSERT(*phase >= 0 && *phase < PhaseCount, "Invalid system phase!");
+	std::vector<System>& systems = _phases[*phase];
+
+	System system;
+	system.Func = func;
+	system.Access = access;
+	system.StatsIndex = _stats.size();
+	// We only need to wait on the earlier systems that we conflict with, everything else can overlap with us
+	for (size_t ix = 0; ix < systems.size(); ix++) {
+		if (access.ConflictsWith(systems[ix].Access)) {
+			system.Dependencies.push_back(ix);
+		}
+	}
+	systems.push_back(system);
+	_stats.push_back({ name, phase, 0.0, 0.0, 0 });
+}
+
+void SystemScheduler::RunPhase(SystemPhase phase) {
+	JobSystem& jobs = JobSystem::Instance();
+	std::vector<System>& systems = _phases[*phase];
+	const auto phaseStart = std::chrono::high_resolution_clock::now();
+
+	const auto run = [this](const System& system) {
+		const auto start = std::chrono::high_resolution_clock::now();
+		system.Func();
+		const auto end = std::chrono::high_resolution_clock::now();
+		// Each system only runs once at a time, so nobody else is touching these stats
+		SystemStats& stats = _stats[system.StatsIndex];
+		stats.LastMs += std::chrono::duration<double, std::milli>(end - start).count();
+		stats.Runs++;
+	};
+
+	std::vector<JobHandle> handles(systems.size(), nullptr);
+	std::vector<JobHandle> dependencies;
+	for (size_t ix = 0; ix < systems.size(); ix++) {
+		const System& system = systems[ix];
+		dependencies.clear();
+		for (size_t dependency : system.Dependencies) {
+			dependencies.push_back(handles[dependency]);
+		}
+		if (system.Access.MainThread || jobs.GetThreadCount() <= 1) {
+			// Waiting will help out with any queued jobs, so the main thread is not idle while we wait
+			jobs.WaitAll(dependencies);
+			run(system);
+		} else {
+			handles[ix] = jobs.Schedule([&run, &system]() { run(system); }, dependencies);
+		}
+	}
+	jobs.WaitAll(handles);
+
+	const auto phaseEnd = std::chrono::high_resolution_clock::now();
+	_phaseMs[*phase] += std::chrono::duration<double, std::milli>(phaseEnd - phaseStart).count();
+}
+
+void SystemScheduler::RunFrame() {
+	for (SystemStats& stats : _stats) {
+		stats.LastMs = 0.0;
+		stats.Runs = 0;
+	}
+	std::fill(std::begin(_phaseMs), std::end(_phaseMs), 0.0);
+
+	RunPhase(SystemPhase::Input);
+	Timing& time = Timing::Instance();
+	while (time.NextFixedStep()) {
+		RunPhase(SystemPhase::FixedUpdate);
+	}
+	RunPhase(SystemPhase::Update);
+	RunPhase(SystemPhase::LateUpdate);
+	RunPhase(SystemPhase::TransformSync);
+	RunPhase(SystemPhase::RenderPrep);
+	RunPhase(SystemPhase::Render);
+
+	// A simple running average, so the timings are readable in the debug window
+	for (SystemStats& stats : _stats) {
+		stats.AverageMs = stats.AverageMs * 0.95 + stats.LastMs * 0.05;
+	}
+}
@@ -0,0 +1,162 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+#include <entt.hpp>
+#include <EnumToString.h>
+
+/// <summary>
+/// The phases of a frame, in the order that they run. FixedUpdate runs once per fixed step, so it may run any
+/// number of times in a frame (including not at all), see Timing::NextFixedStep
+/// </summary>
+ENUM(SystemPhase, int,
+	Input         = 0,
+	FixedUpdate   = 1,
+	Update        = 2,
+	LateUpdate    = 3,
+	TransformSync = 4,
+	RenderPrep    = 5,
+	Render        = 6
+);
+
+/// <summary>
+/// Declares what a system touches, so the scheduler can tell which systems may run at the same time. Anything can be
+/// declared as a resource, not just components (ex the camera, or a shared cache), as long as everyone uses the
+/// same type for it
+/// </summary>
+struct SystemAccess
+{
+	std::vector<entt::id_type> Reads;
+	std::vector<entt::id_type> Writes;
+	/// <summary>
+	/// If true, the system must run on the main thread (ex because it makes OpenGL, GLFW or ImGui calls)
+	/// </summary>
+	bool MainThread = false;
+	/// <summary>
+	/// If true, the system may touch anything, and will not run alongside any other system in it's phase
+	/// </summary>
+	bool Exclusive = false;
+
+	/// <summary>
+	/// Declares that the system reads the given types
+	/// </summary>
+	template <typename ... Types>
+	SystemAccess& Read() {
+		(Reads.push_back(entt::type_info<Types>::id()), ...);
+		return *this;
+	}
+	/// <summary>
+	/// Declares that the system writes the given types
+	/// </summary>
+	template <typename ... Types>
+	SystemAccess& Write() {
+		(Writes.push_back(entt::type_info<Types>::id()), ...);
+		return *this;
+	}
+	/// <summary>
+	/// Declares that the system must run on the main thread
+	/// </summary>
+	SystemAccess& OnMainThread() {
+		MainThread = true;
+		return *this;
+	}
+	/// <summary>
+	/// Declares that the system may touch anything, it will be ordered after every system registered before it in the
+	/// same phase, and before every system registered after it
+	/// </summary>
+	SystemAccess& AsExclusive() {
+		Exclusive = true;
+		return *this;
+	}
+
+	/// <summary>
+	/// Returns true if the two systems can not safely run at the same time
+	/// </summary>
+	bool ConflictsWith(const SystemAccess& other) const;
+};
+
+/// <summary>
+/// Runs the per-frame work of the game as a set of systems, grouped into phases. Phases run one after another, and
+/// within a phase systems are ordered by when they were added, but only where their declared access conflicts (one
+/// writes something the other reads or writes). Systems that don't conflict are handed to the job system to run
+/// at the same time.
+///
+/// Main thread systems are run inline when the scheduler reaches them, so register them after any worker systems
+/// that they could overlap with
+/// </summary>
+class SystemScheduler final
+{
+public:
+	typedef std::function<void()> SystemFunc;
+
+	/// <summary>
+	/// Timing info for a single system
+	/// </summary>
+	struct SystemStats {
+		std::string Name;
+		SystemPhase Phase;
+		/// <summary>
+		/// The total time spent in the system last frame, in milliseconds. For FixedUpdate systems this covers all steps
+		/// </summary>
+		double      LastMs;
+		/// <summary>
+		/// A running average of LastMs
+		/// </summary>
+		double      AverageMs;
+		/// <summary>
+		/// The number of times the system ran last frame
+		/// </summary>
+		int         Runs;
+	};
+
+	SystemScheduler() = default;
+	~SystemScheduler() = default;
+
+	SystemScheduler(const SystemScheduler& other) = delete;
+	SystemScheduler(SystemScheduler&& other) = delete;
+	SystemScheduler& operator=(const SystemScheduler& other) = delete;
+	SystemScheduler& operator=(SystemScheduler&& other) = delete;
+
+	/// <summary>
+	/// Adds a system to the end of a phase
+	/// </summary>
+	/// <param name="phase">The phase to run the system in</param>
+	/// <param name="name">The name to show in the timings</param>
+	/// <param name="access">The components and resources that the system reads and writes</param>
+	/// <param name="func">The function to invoke</param>
+	void AddSystem(SystemPhase phase, const std::string& name, const SystemAccess& access, const SystemFunc& func);
+
+	/// <summary>
+	/// Runs all of the systems in a single phase, and waits for them to complete
+	/// </summary>
+	void RunPhase(SystemPhase phase);
+	/// <summary>
+	/// Runs a whole frame, all phases in order, with FixedUpdate running for every fixed step that Timing has
+	/// accumulated. Timing::BeginFrame should be called before this
+	/// </summary>
+	void RunFrame();
+
+	/// <summary>
+	/// Gets the timings for all of the systems, in the order they were added
+	/// </summary>
+	const std::vector<SystemStats>& GetStats() const { return _stats; }
+	/// <summary>
+	/// Gets the total time spent in a phase last frame, in milliseconds
+	/// </summary>
+	double GetPhaseMs(SystemPhase phase) const { return _phaseMs[*phase]; }
+
+private:
+	static constexpr int PhaseCount = 7;
+
+	struct System {
+		SystemFunc   Func;
+		SystemAccess Access;
+		size_t       StatsIndex;
+		// Earlier systems in the phase that this one has to wait for
+		std::vector<size_t> Dependencies;
+	};
+
+	std::vector<System> _phases[PhaseCount];
+	std::vector<SystemStats> _stats;
+	double _phaseMs[PhaseCount] = { 0.0 };
+};
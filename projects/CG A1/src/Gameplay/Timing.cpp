@@ -0,0 +1,29 @@
+#include "Timing.h"
+
+#include <cmath>
+
+void Timing::BeginFrame(double now) {
+	CurrentFrame = now;
+	DeltaTime = static_cast<float>(CurrentFrame - LastFrame);
+	DeltaTime = DeltaTime > MaxDeltaTime ? MaxDeltaTime : DeltaTime;
+
+	_accumulator += DeltaTime;
+	FixedStepsThisFrame = 0;
+}
+
+bool Timing::NextFixedStep() {
+	if (_accumulator >= FixedTimeStep) {
+		if (FixedStepsThisFrame < MaxFixedStepsPerFrame) {
+			_accumulator -= FixedTimeStep;
+			FixedStepsThisFrame++;
+			FixedStepCount++;
+			return true;
+		}
+		// We've hit the catch-up limit, drop whole steps but keep the remainder so the interpolation stays smooth
+		const double remainder = std::fmod(_accumulator, static_cast<double>(FixedTimeStep));
+		DroppedTime += _accumulator - remainder;
+		_accumulator = remainder;
+	}
+	FixedAlpha = static_cast<float>(_accumulator / FixedTimeStep);
+	return false;
+}
@@ -1,5 +1,15 @@
 #pragma once
+#include <cstdint>
 
+/// <summary>
+/// Tracks frame timing, and schedules the fixed rate simulation steps. Each frame, call BeginFrame, then run a
+/// fixed update for as long as NextFixedStep returns true, then do the variable rate update and render, and finally
+/// call EndFrame.
+///
+/// Time accumulates between frames and is consumed in steps of FixedTimeStep, so the simulation runs at the same
+/// rate no matter how fast we render. The leftover time is exposed as FixedAlpha, for interpolating between the
+/// last two simulation states when rendering
+/// </summary>
 class Timing
 {
 public:
@@ -8,10 +18,59 @@ public:
 		return instance;
 	}
 
-	double CurrentFrame;
-	double LastFrame;
-	float  DeltaTime;
+	double CurrentFrame = 0.0;
+	double LastFrame = 0.0;
+	float  DeltaTime = 0.0f;
+
+	/// <summary>
+	/// The length of a single fixed update step in seconds
+	/// </summary>
+	float  FixedTimeStep = 1.0f / 60.0f;
+	/// <summary>
+	/// The most fixed steps that may run in a single frame. If the simulation falls further behind than this, the
+	/// extra time is dropped so that a slow frame can't cause a slower frame (the spiral of death)
+	/// </summary>
+	int    MaxFixedStepsPerFrame = 5;
+	/// <summary>
+	/// The longest a single frame may be considered to take, in seconds. This stops a long stall (ex a breakpoint
+	/// or dragging the window) from being simulated all at once
+	/// </summary>
+	float  MaxDeltaTime = 1.0f;
+
+	/// <summary>
+	/// How far we are between the last fixed step and the next one, in the range [0, 1)
+	/// </summary>
+	float    FixedAlpha = 0.0f;
+	/// <summary>
+	/// The number of fixed steps that have been run this frame
+	/// </summary>
+	int      FixedStepsThisFrame = 0;
+	/// <summary>
+	/// The total number of fixed steps that have been run
+	/// </summary>
+	uint64_t FixedStepCount = 0;
+	/// <summary>
+	/// The total amount of simulation time that has been dropped by the catch-up limit, in seconds
+	/// </summary>
+	double   DroppedTime = 0.0;
+
+	/// <summary>
+	/// Starts a new frame, updating the delta time and adding it to the fixed step accumulator
+	/// </summary>
+	/// <param name="now">The current time in seconds</param>
+	void BeginFrame(double now);
+	/// <summary>
+	/// Consumes a fixed step from the accumulator, use this as a loop condition around the fixed update
+	/// </summary>
+	/// <returns>True if a fixed step should be run, false once the simulation has caught up for this frame</returns>
+	bool NextFixedStep();
+	/// <summary>
+	/// Ends the current frame
+	/// </summary>
+	void EndFrame() { LastFrame = CurrentFrame; }
 
 protected:
 	Timing() = default;
-};
\ No newline at end of file
+
+	double _accumulator = 0.0;
+};
@@ -5,45 +5,42 @@
 #include <GLM/gtx/quaternion.hpp>
 
 #include "Logging.h"
+#include "TransformHierarchy.h"
+#include "WorldMatrix.h"
 
 const glm::mat4 IDENTITY = glm::mat4(1.0f);
 
+glm::vec3 Transform::GetLocalRotation() const {
+	return glm::degrees(glm::eulerAngles(_Local().Rotation));
+}
+
 Transform& Transform::SetLocalRotation(const glm::vec3 eulerDegrees) {
-	_rotationEulerDeg = eulerDegrees;
-	_rotation = glm::quat(glm::radians(eulerDegrees));
-	_isLocalDirty = true;
+	_Local().Rotation = glm::quat(glm::radians(eulerDegrees));
+	_MarkDirty();
 	return *this;
 }
 
 Transform& Transform::SetLocalRotation(const glm::quat& quaternion) {
-	_rotation = quaternion;
-	_rotationEulerDeg = glm::degrees(glm::eulerAngles(_rotation));
-	_isLocalDirty = true;
+	_Local().Rotation = quaternion;
+	_MarkDirty();
 	return *this;
 }
 
 Transform& Transform::SetLocalRotation(float yawDeg, float pitchDeg, float rollDeg) {
-	_rotationEulerDeg.x = yawDeg;
-	_rotationEulerDeg.y = pitchDeg;
-	_rotationEulerDeg.z = rollDeg;
-	_rotation = glm::quat(glm::radians(_rotationEulerDeg));
-	_isLocalDirty = true;
+	_Local().Rotation = glm::quat(glm::radians(glm::vec3(yawDeg, pitchDeg, rollDeg)));
+	_MarkDirty();
 	return *this;
 }
 
 Transform& Transform::SetLocalPosition(float x, float y, float z) {
-	_position.x = x;
-	_position.y = y;
-	_position.z = z;
-	_isLocalDirty = true;
+	_Local().Position = glm::vec3(x, y, z);
+	_MarkDirty();
 	return *this;
 }
 
 Transform& Transform::SetLocalScale(float x, float y, float z) {
-	_scale.x = x;
-	_scale.y = y;
-	_scale.z = z;
-	_isLocalDirty = true;
+	_Local().Scale = glm::vec3(x, y, z);
+	_MarkDirty();
 	return *this;
 }
 
@@ -53,9 +50,9 @@ Transform& Transform::RotateLocal(float yawDeg, float pitchDeg, float rollDeg) {
 }
 
 Transform& Transform::RotateLocalFixed(const glm::vec3& rotationDeg) {
-	_rotation = glm::quat(glm::radians(rotationDeg)) * _rotation;
-	_rotationEulerDeg = glm::degrees(glm::eulerAngles(_rotation));
-	_isLocalDirty = true;
+	LocalTRS& local = _Local();
+	local.Rotation = glm::quat(glm::radians(rotationDeg)) * local.Rotation;
+	_MarkDirty();
 	return *this;
 }
 
@@ -65,28 +62,29 @@ Transform& Transform::RotateLocalFixed(float yawDeg, float pitchDeg, float rollD
 }
 
 Transform& Transform::SetLocalPosition(const glm::vec3 value) {
-	_position = value;
-	_isLocalDirty = true;
+	_Local().Position = value;
+	_MarkDirty();
 	return *this;
 }
 
 Transform& Transform::SetLocalScale(const glm::vec3 value) {
-	_scale = value;
-	_isLocalDirty = true;
+	_Local().Scale = value;
+	_MarkDirty();
 	return *this;
 }
 
 Transform& Transform::RotateLocal(const glm::vec3& rotation) {
-	_rotation = _rotation * glm::quat(glm::radians(rotation));
-	_rotationEulerDeg = glm::degrees(glm::eulerAngles(_rotation));
-	_isLocalDirty = true;
+	LocalTRS& local = _Local();
+	local.Rotation = local.Rotation * glm::quat(glm::radians(rotation));
+	_MarkDirty();
 	return *this;
 }
 
 Transform& Transform::MoveLocal(const glm::vec3& localMovement)
 {
-	_position += _rotation * localMovement;
-	_isLocalDirty = true;
+	LocalTRS& local = _Local();
+	local.Position += local.Rotation * localMovement;
+	_MarkDirty();
 	return *this;
 }
 
@@ -97,81 +95,91 @@ Transform& Transform::MoveLocal(float x, float y, float z) {
 
 Transform& Transform::MoveLocalFixed(const glm::vec3& localMovement)
 {
-	_position += localMovement;
-	_isLocalDirty = true;
+	_Local().Position += localMovement;
+	_MarkDirty();
 	return *this;
 }
 
 Transform& Transform::MoveLocalFixed(float x, float y, float z) {
-	_position.x += x;
-	_position.y += y;
-	_position.z += z;
-	_isLocalDirty = true;
+	_Local().Position += glm::vec3(x, y, z);
+	_MarkDirty();
 	return *this;
 }
 
 Transform& Transform::LookAt(const glm::vec3& localSpace)
 {
-	_rotation = glm::quatLookAt(-glm::normalize(_position - localSpace), glm::normalize(_rotation * glm::vec3(0, 0, 1)));
-	_rotationEulerDeg = glm::degrees(glm::eulerAngles(_rotation));
-	_isLocalDirty = true;
+	LocalTRS& local = _Local();
+	local.Rotation = glm::quatLookAt(-glm::normalize(local.Position - localSpace), glm::normalize(local.Rotation * glm::vec3(0, 0, 1)));
+	_MarkDirty();
 	return *this;
 }
 
-void Transform::Recalculate() const {
-	_UpdateLocalTransformIfDirty();
-}
-
-const glm::mat4& Transform::LocalTransform() const {
-	_UpdateLocalTransformIfDirty();
-	return _localTransform;
+glm::mat4 Transform::LocalTransform() const {
+	// TRS
+	const LocalTRS& local = _Local();
+	return glm::translate(IDENTITY, local.Position) * glm::toMat4(local.Rotation) * glm::scale(IDENTITY, local.Scale);
 }
 
-const glm::mat3& Transform::NormalMatrix() const {
-	_UpdateLocalTransformIfDirty();
-	return _normalMatrix;	
+glm::mat3 Transform::NormalMatrix() const {
+	// The inverse transpose of R * S is just R * S^-1
+	const LocalTRS& local = _Local();
+	const glm::mat3 rotation = glm::toMat3(local.Rotation);
+	return glm::mat3(rotation[0] / local.Scale.x, rotation[1] / local.Scale.y, rotation[2] / local.Scale.z);
 }
 
 void Transform::SetParent(entt::handle parent)
 {
-	_parent = parent;
+	entt::entity parentEntity = entt::null;
 	// If we passed in a handle, make sure it has a transform and belongs to the same scene
 	if (&parent.registry() != nullptr && parent.entity() != entt::null) {
 		LOG_ASSERT(parent.has<Transform>(), "Parent entity must have a transform component");
 		LOG_ASSERT(&parent.registry() == &_gameObject.registry(), "Parent entity must be in same registry!");
-		_hierarchyDepth = parent.get<Transform>()._hierarchyDepth + 1;
-	} else {
-		_hierarchyDepth = 0;
-	}
-	
-	// Re-calculate hierarchy depth for all children recursively
-	_gameObject.registry().view<Transform>().each([&](entt::entity entity, Transform& t) {
-		if (t._parent == _gameObject) {
-			t.SetParent(entt::handle(parent.registry(), _gameObject));
-		}
-	});
-	// Re-sort components
-	_gameObject.registry().sort<Transform>([](const Transform& l, const Transform& r) {
-		return l.GetHierarchyDepth() < r.GetHierarchyDepth();
-	});
-}
-
-void Transform::UpdateWorldMatrix() const {
-	if (_parent != entt::null) {
-		_worldTransform = _gameObject.registry().get<Transform>(_parent)._worldTransform * LocalTransform();
-		_worldNormalMatrix = glm::mat3(glm::transpose(glm::inverse(_worldTransform)));
-	} else {
-		_worldTransform = LocalTransform();
-		_worldNormalMatrix = _normalMatrix;
+		parentEntity = parent.entity();
 	}
+
+	TransformHierarchy* hierarchy = _gameObject.registry().try_ctx<TransformHierarchy>();
+	LOG_ASSERT(hierarchy != nullptr, "Transform's registry does not have a hierarchy, prefabs cannot be parented!");
+	hierarchy->SetParent(_gameObject.entity(), parentEntity);
 }
 
-void Transform::_UpdateLocalTransformIfDirty() const {
-	if (_isLocalDirty) {
-		// TRS
-		_localTransform = glm::translate(IDENTITY, _position) * glm::toMat4(_rotation) * glm::scale(IDENTITY, _scale);
-		_normalMatrix = glm::mat3(glm::transpose(glm::inverse(_localTransform)));
+const glm::mat4& Transform::WorldTransform() const {
+	return _gameObject.get<WorldMatrix>().Value;
+}
 
-		_isLocalDirty = false;
+const glm::mat3& Transform::WorldNormalMatrix() const {
+	return _gameObject.get<::WorldNormalMatrix>().Value;
+}
+
+void Transform::Stamp(const entt::registry& from, const entt::entity src, entt::registry& to, const entt::entity dst) {
+	Transform* result = to.try_get<Transform>(dst);
+	if (result == nullptr) {
+		result = &to.emplace<Transform>(dst, entt::handle(to, dst));
+	}
+	const LocalTRS* source = from.try_get<LocalTRS>(src);
+	to.get_or_emplace<LocalTRS>(dst) = source != nullptr ? *source : LocalTRS();
+	result->_MarkDirty();
+}
+
+void Transform::StampBatch(const entt::registry& from, const entt::entity src, entt::registry& to, const entt::entity* dst, size_t count) {
+	const LocalTRS* found = from.try_get<LocalTRS>(src);
+	const LocalTRS source = found != nullptr ? *found : LocalTRS();
+	to.reserve<Transform>(to.size<Transform>() + count);
+	to.reserve<LocalTRS>(to.size<LocalTRS>() + count);
+	for (size_t ix = 0; ix < count; ix++) {
+		to.emplace<Transform>(dst[ix], entt::handle(to, dst[ix]));
+		// It's trivially copyable, so this is just a copy in to the packed storage
+		to.get_or_emplace<LocalTRS>(dst[ix]) = source;
+	}
+}
+
+void Transform::_MarkDirty() {
+	// Only the first modification since the last hierarchy update needs to queue us
+	if (!_isWorldDirty) {
+		_isWorldDirty = true;
+		// Prefab registries have no hierarchy, their transforms are never rendered
+		TransformHierarchy* hierarchy = _gameObject.registry().try_ctx<TransformHierarchy>();
+		if (hierarchy != nullptr) {
+			hierarchy->MarkDirty(_gameObject.entity());
+		}
 	}
 }
@@ -3,46 +3,45 @@
 #include <memory>
 #include <GLM/glm.hpp>
 #include <GLM/gtc/quaternion.hpp>
+#include "LocalTRS.h"
 
 /// <summary>
-/// A simple transformation class, without parent/child relationships
+/// A transformation component, which may be parented to another transform in the same scene.
+/// Parent/child links and world matrices are managed by the scene's TransformHierarchy.
+///
+/// The transform itself only holds the hierarchy links. The local position, rotation and scale live in the
+/// LocalTRS component, and the world and normal matrices in the WorldMatrix and WorldNormalMatrix components, so
+/// that the hierarchy's kernel can read them without dragging the links and handle through the cache
 /// </summary>
 class Transform final
 {
 public:
-	struct TransformDirtyTag { };
-	
 	Transform(entt::handle gameObject) :
-		_isLocalDirty(true),
-		_localTransform(glm::mat4(1.0f)),
-		_normalMatrix(glm::mat3(1.0f)),
-		_isWorldDirty(true),
-		_worldTransform(glm::mat4(1.0f)),
-		_worldNormalMatrix(glm::mat3(1.0f)),
-		_rotation(glm::quat(1.0f, 0.0f, 0.0f, 0.0f)),
-		_rotationEulerDeg(glm::vec3(0.0f)),
-		_position(glm::vec3(0.0f)),
-		_scale(glm::vec3(1.0f)),
 		_parent(entt::null),
+		_firstChild(entt::null),
+		_nextSibling(entt::null),
+		_prevSibling(entt::null),
 		_gameObject(gameObject),
-		_hierarchyDepth(0)
+		_hierarchyDepth(0),
+		_isWorldDirty(true)
 	{}
 	Transform(const Transform& other) = default;
 	Transform(Transform&& other) = default;
 	Transform& operator =(const Transform & other) = default;
 	Transform& operator =(Transform && other) = default;
-	virtual ~Transform() = default;
+	~Transform() = default;
 
 	// Rotation Getters/Setters
 
 	/// <summary>
-	/// Gets the local rotation of the transform in euler degrees
+	/// Gets the local rotation of the transform in euler degrees. This is calculated from the
+	/// rotation quaternion, so it may not match the angles that were passed to SetLocalRotation
 	/// </summary>
-	const glm::vec3& GetLocalRotation() const { return _rotationEulerDeg; }
+	glm::vec3 GetLocalRotation() const;
 	/// <summary>
 	/// Returns the local rotation as a quaternion
 	/// </summary>
-	const glm::quat& GetLocalRotationQuat() const { return _rotation; }
+	const glm::quat& GetLocalRotationQuat() const { return _Local().Rotation; }
 	/// <summary>
 	/// Sets the local rotation of this transform to the given value in euler degrees
 	/// </summary>
@@ -69,7 +68,7 @@ public:
 	/// <summary>
 	/// Gets the local position of this transform
 	/// </summary>
-	const glm::vec3& GetLocalPosition() const { return _position; }
+	const glm::vec3& GetLocalPosition() const { return _Local().Position; }
 	/// <summary>
 	/// Sets this transforms translation within it's local space
 	/// </summary>
@@ -90,7 +89,7 @@ public:
 	/// <summary>
 	/// Gets the local scale for this transform, along each axis
 	/// </summary>
-	const glm::vec3& GetLocalScale() const { return _scale; }
+	const glm::vec3& GetLocalScale() const { return _Local().Scale; }
 	/// <summary>
 	/// Sets this transforms scale within it's local space
 	/// </summary>
@@ -174,26 +173,36 @@ public:
 	// Matrix gets
 
 	/// <summary>
-	/// Forces the transform to re-calculate it's matrices
+	/// Calculates the local transformation matrix for this transform
 	/// </summary>
-	void Recalculate() const;
-
+	glm::mat4 LocalTransform() const;
 	/// <summary>
-	/// Gets the local transformation matrix for this transform, updating it if required
+	/// Calculates the local normal matrix for this transform (the inverse transpose of the upper 3x3
+	/// of the local transformation matrix)
 	/// </summary>
-	const glm::mat4& LocalTransform() const;
+	glm::mat3 NormalMatrix() const;
+
 	/// <summary>
-	/// Gets the local rotation matrix for this transform, updating it if required.
-	/// This is useful for calculating the normal matrix
+	/// Sets the parent of this transform, or detaches it from it's parent if parent is a null handle.
+	/// The parent must have a transform and belong to the same scene
 	/// </summary>
-	const glm::mat3& NormalMatrix() const;
-
+	/// <param name="parent">The new parent for this transform</param>
 	void SetParent(entt::handle parent);
+	/// <summary>
+	/// Gets the entity that this transform is parented to, or entt::null if this transform is a root
+	/// </summary>
+	entt::entity GetParent() const { return _parent; }
 
-	void UpdateWorldMatrix() const;
-
-	const glm::mat4& WorldTransform() const { return _worldTransform; }
-	const glm::mat3& WorldNormalMatrix() const { return _worldNormalMatrix; };
+	/// <summary>
+	/// Gets the world transformation matrix as of the last TransformHierarchy::Update. Prefer
+	/// iterating the WorldMatrix component directly when processing many objects
+	/// </summary>
+	const glm::mat4& WorldTransform() const;
+	/// <summary>
+	/// Gets the world normal matrix as of the last TransformHierarchy::Update. Prefer iterating
+	/// the WorldNormalMatrix component directly when processing many objects
+	/// </summary>
+	const glm::mat3& WorldNormalMatrix() const;
 
 	/// <summary>
 	/// Gets the depth of this transform within the scene hierarchy (ie. how many parents
@@ -202,23 +211,32 @@ public:
 	/// <returns></returns>
 	int GetHierarchyDepth() const { return _hierarchyDepth; }
 
+	/// <summary>
+	/// Stamp function for copying a transform between registries, see GameScene::RegisterComponentType.
+	/// Only the LocalTRS is copied. If dst has no transform, the new transform is
+	/// bound to dst and has no parent, otherwise dst keeps it's place in the hierarchy
+	/// </summary>
+	static void Stamp(const entt::registry& from, const entt::entity src, entt::registry& to, const entt::entity dst);
+	/// <summary>
+	/// Batch stamp function for copying a transform to many new entities, see GameScene::RegisterComponentType
+	/// </summary>
+	static void StampBatch(const entt::registry& from, const entt::entity src, entt::registry& to, const entt::entity* dst, size_t count);
+
 private:
-	mutable bool _isLocalDirty;
-	mutable glm::mat4 _localTransform;
-	mutable glm::mat3 _normalMatrix;
-
-	mutable bool _isWorldDirty;
-	mutable glm::mat4 _worldTransform;
-	mutable glm::mat3 _worldNormalMatrix;
-	
-	glm::quat _rotation;
-	glm::vec3 _rotationEulerDeg;
-	glm::vec3 _position;
-	glm::vec3 _scale;
+	friend class TransformHierarchy;
 
+	// Intrusive links into our parent's list of children
 	entt::entity _parent;
+	entt::entity _firstChild;
+	entt::entity _nextSibling;
+	entt::entity _prevSibling;
 	entt::handle _gameObject;
 	int _hierarchyDepth;
+	bool _isWorldDirty;
 
-	void _UpdateLocalTransformIfDirty() const;
+	// Queues us with the hierarchy if we haven't been already since it's last update
+	void _MarkDirty();
+	// Gets our position, rotation and scale, which are added along with the transform (see TransformHierarchy and GameScene)
+	LocalTRS& _Local() { return _gameObject.get<LocalTRS>(); }
+	const LocalTRS& _Local() const { return _gameObject.get<LocalTRS>(); }
 };
@@ -0,0 +1,303 @@
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include "LocalTRS.h"
+#include "Transform.h"
+#include "WorldMatrix.h"
+#include "Logging.h"
+
+TransformHierarchy::TransformHierarchy(entt::registry& registry) :
+	_registry(registry),
+	_allDirty(false)
+{
+	_registry.on_construct<Transform>().connect<&TransformHierarchy::_OnTransformConstructed>(*this);
+	_registry.on_destroy<Transform>().connect<&TransformHierarchy::_OnTransformDestroyed>(*this);
+}
+
+TransformHierarchy::~TransformHierarchy() {
+	_registry.on_construct<Transform>().disconnect<&TransformHierarchy::_OnTransformConstructed>(*this);
+	_registry.on_destroy<Transform>().disconnect<&TransformHierarchy::_OnTransformDestroyed>(*this);
+}
+
+void TransformHierarchy::MarkDirty(entt::entity entity) {
+	std::lock_guard<std::mutex> lock(_dirtyLock);
+	_dirty.push_back(entity);
+}
+
+void TransformHierarchy::MarkAllDirty() {
+	std::lock_guard<std::mutex> lock(_dirtyLock);
+	_allDirty = true;
+}
+
+void TransformHierarchy::SetParent(entt::entity child, entt::entity parent) {
+	LOG_ASSERT(_registry.valid(child) && _registry.has<Transform>(child), "Child entity must have a transform component");
+	LOG_ASSERT(parent == entt::null || (_registry.valid(parent) && _registry.has<Transform>(parent)), "Parent entity must have a transform component");
+	LOG_ASSERT(parent == entt::null || !_IsAncestorOf(child, parent), "Cannot parent a transform to itself or one of it's descendants!");
+
+	if (_registry.get<Transform>(child)._parent == parent) {
+		return;
+	}
+
+	_Unlink(child);
+	_Link(child, parent);
+	_UpdateSubtreeDepths(child);
+
+	// Our local transform is unchanged, but we're now relative to a different parent
+	Transform& transform = _registry.get<Transform>(child);
+	if (!transform._isWorldDirty) {
+		transform._isWorldDirty = true;
+		MarkDirty(child);
+	}
+}
+
+void TransformHierarchy::SetParents(const std::vector<std::pair<entt::entity, entt::entity>>& links) {
+	// Update all the links first, we check for cycles as we go so that we're always validating
+	// against the hierarchy as it will be after the previous links were applied
+	std::vector<entt::entity> moved;
+	moved.reserve(links.size());
+	for (const auto& [child, parent] : links) {
+		LOG_ASSERT(_registry.valid(child) && _registry.has<Transform>(child), "Child entity must have a transform component");
+		LOG_ASSERT(parent == entt::null || (_registry.valid(parent) && _registry.has<Transform>(parent)), "Parent entity must have a transform component");
+		LOG_ASSERT(parent == entt::null || !_IsAncestorOf(child, parent), "Cannot parent a transform to itself or one of it's descendants!");
+
+		if (_registry.get<Transform>(child)._parent != parent) {
+			_Unlink(child);
+			_Link(child, parent);
+			moved.push_back(child);
+		}
+	}
+	std::sort(moved.begin(), moved.end());
+	moved.erase(std::unique(moved.begin(), moved.end()), moved.end());
+
+	// Only the moved subtrees whose roots don't have a moved ancestor need to be walked, the others
+	// will be handled by their ancestor's walk
+	for (entt::entity root : moved) {
+		bool hasMovedAncestor = false;
+		for (entt::entity it = _registry.get<Transform>(root)._parent; it != entt::null; it = _registry.get<Transform>(it)._parent) {
+			if (std::binary_search(moved.begin(), moved.end(), it)) {
+				hasMovedAncestor = true;
+				break;
+			}
+		}
+		if (!hasMovedAncestor) {
+			_UpdateSubtreeDepths(root);
+			Transform& transform = _registry.get<Transform>(root);
+			if (!transform._isWorldDirty) {
+				transform._isWorldDirty = true;
+				MarkDirty(root);
+			}
+		}
+	}
+}
+
+void TransformHierarchy::Update() {
+	_updated.clear();
+	_updatedTransforms.clear();
+	_batch.clear();
+	_levelStarts.clear();
+
+	// Swap out the dirty list so that we only hold the lock for a moment
+	_scratch.clear();
+	bool allDirty;
+	{
+		std::lock_guard<std::mutex> lock(_dirtyLock);
+		_scratch.swap(_dirty);
+		allDirty = _allDirty;
+		_allDirty = false;
+	}
+	if (_scratch.empty() && !allDirty) {
+		return;
+	}
+
+	auto transforms = _registry.view<Transform>();
+	auto locals     = _registry.view<LocalTRS>();
+	auto worlds     = _registry.view<WorldMatrix>();
+	auto normals    = _registry.view<WorldNormalMatrix>();
+
+	// Bucket the dirty transforms by depth, if everything is dirty we just need to start from the roots
+	_roots.clear();
+	_rootStarts.clear();
+	if (allDirty) {
+		for (entt::entity entity : transforms) {
+			if (transforms.get<Transform>(entity)._parent == entt::null) {
+				_roots.push_back(entity);
+			}
+		}
+		_rootStarts.push_back(0);
+		_rootStarts.push_back(_roots.size());
+	} else {
+		_processing.clear();
+		for (entt::entity entity : _scratch) {
+			if (_registry.valid(entity) && transforms.contains(entity)) {
+				const Transform& transform = transforms.get<Transform>(entity);
+				if (transform._isWorldDirty) {
+					_processing.emplace_back(transform._hierarchyDepth, entity);
+				}
+			}
+		}
+		int maxDepth = -1;
+		for (const auto& [depth, entity] : _processing) {
+			maxDepth = std::max(maxDepth, depth);
+		}
+		_rootStarts.assign(static_cast<size_t>(maxDepth) + 2, 0);
+		for (const auto& [depth, entity] : _processing) {
+			_rootStarts[depth + 1]++;
+		}
+		for (size_t ix = 1; ix < _rootStarts.size(); ix++) {
+			_rootStarts[ix] += _rootStarts[ix - 1];
+		}
+		_roots.resize(_processing.size());
+		std::vector<size_t> cursor(_rootStarts.begin(), _rootStarts.end() - 1);
+		for (const auto& [depth, entity] : _processing) {
+			_roots[cursor[depth]++] = entity;
+		}
+	}
+
+	// Queues a transform to be computed as part of the current level
+	const auto collect = [&](entt::entity entity, Transform& transform, const glm::mat4* parentWorld, const glm::mat3* parentNormal) {
+		transform._isWorldDirty = false;
+		_updated.push_back(entity);
+		_updatedTransforms.push_back(&transform);
+
+		TransformKernelItem item;
+		item.Local        = &locals.get<LocalTRS>(entity);
+		item.ParentWorld  = parentWorld;
+		item.ParentNormal = parentNormal;
+		item.World        = &worlds.get<WorldMatrix>(entity).Value;
+		item.Normal       = &normals.get<WorldNormalMatrix>(entity).Value;
+		_batch.push_back(item);
+	};
+
+	// Walk the dirty subtrees one level at a time, each level is made up of the children of the previous
+	// level, plus any dirty transforms at that depth that weren't reached from above. Nothing in a level
+	// depends on anything else in the same level, so each one can be handed to the kernel in one go
+	const size_t rootLevels = _rootStarts.size() - 1;
+	for (size_t depth = 0; depth < rootLevels || _levelStarts.empty() || _levelStarts.back() < _updated.size(); depth++) {
+		const size_t previousStart = _levelStarts.empty() ? 0 : _levelStarts.back();
+		const size_t levelStart = _updated.size();
+		_levelStarts.push_back(levelStart);
+
+		for (size_t ix = previousStart; ix < levelStart; ix++) {
+			const glm::mat4* parentWorld  = _batch[ix].World;
+			const glm::mat3* parentNormal = _batch[ix].Normal;
+			for (entt::entity child = _updatedTransforms[ix]->_firstChild; child != entt::null;) {
+				Transform& childTransform = transforms.get<Transform>(child);
+				collect(child, childTransform, parentWorld, parentNormal);
+				child = childTransform._nextSibling;
+			}
+		}
+
+		if (depth < rootLevels) {
+			for (size_t ix = _rootStarts[depth]; ix < _rootStarts[depth + 1]; ix++) {
+				const entt::entity entity = _roots[ix];
+				Transform& transform = transforms.get<Transform>(entity);
+				// If an ancestor was dirty, we've already been collected as part of it's subtree
+				if (!transform._isWorldDirty && !allDirty) {
+					continue;
+				}
+				if (transform._parent != entt::null) {
+					collect(entity, transform, &worlds.get<WorldMatrix>(transform._parent).Value, &normals.get<WorldNormalMatrix>(transform._parent).Value);
+				} else {
+					collect(entity, transform, &TransformKernel::IdentityWorld, &TransformKernel::IdentityNormal);
+				}
+			}
+		}
+	}
+	_levelStarts.push_back(_updated.size());
+
+	for (size_t level = 0; level + 1 < _levelStarts.size(); level++) {
+		TransformKernel::ComputeWorldMatrices(_batch.data() + _levelStarts[level], _levelStarts[level + 1] - _levelStarts[level]);
+	}
+}
+
+void TransformHierarchy::_OnTransformConstructed(entt::registry& registry, entt::entity entity) {
+	registry.emplace<LocalTRS>(entity);
+	registry.emplace_or_replace<WorldMatrix>(entity);
+	registry.emplace_or_replace<WorldNormalMatrix>(entity);
+	// New transforms start out dirty, we just need to queue them
+	MarkDirty(entity);
+}
+
+void TransformHierarchy::_OnTransformDestroyed(entt::registry& registry, entt::entity entity) {
+	Transform& transform = registry.get<Transform>(entity);
+
+	// Our children become roots, keeping their local transforms
+	entt::entity child = transform._firstChild;
+	while (child != entt::null) {
+		Transform& childTransform = registry.get<Transform>(child);
+		const entt::entity next = childTransform._nextSibling;
+		childTransform._parent      = entt::null;
+		childTransform._nextSibling = entt::null;
+		childTransform._prevSibling = entt::null;
+		_UpdateSubtreeDepths(child);
+		if (!childTransform._isWorldDirty) {
+			childTransform._isWorldDirty = true;
+			MarkDirty(child);
+		}
+		child = next;
+	}
+	transform._firstChild = entt::null;
+
+	_Unlink(entity);
+	registry.remove_if_exists<LocalTRS, WorldMatrix, WorldNormalMatrix>(entity);
+}
+
+void TransformHierarchy::_Link(entt::entity child, entt::entity parent) {
+	Transform& transform = _registry.get<Transform>(child);
+	transform._parent = parent;
+	transform._prevSibling = entt::null;
+	transform._nextSibling = entt::null;
+
+	if (parent != entt::null) {
+		Transform& parentTransform = _registry.get<Transform>(parent);
+		transform._nextSibling = parentTransform._firstChild;
+		if (parentTransform._firstChild != entt::null) {
+			_registry.get<Transform>(parentTransform._firstChild)._prevSibling = child;
+		}
+		parentTransform._firstChild = child;
+	}
+}
+
+void TransformHierarchy::_Unlink(entt::entity child) {
+	Transform& transform = _registry.get<Transform>(child);
+	if (transform._parent != entt::null) {
+		if (transform._prevSibling != entt::null) {
+			_registry.get<Transform>(transform._prevSibling)._nextSibling = transform._nextSibling;
+		} else {
+			_registry.get<Transform>(transform._parent)._firstChild = transform._nextSibling;
+		}
+		if (transform._nextSibling != entt::null) {
+			_registry.get<Transform>(transform._nextSibling)._prevSibling = transform._prevSibling;
+		}
+	}
+	transform._parent = entt::null;
+	transform._prevSibling = entt::null;
+	transform._nextSibling = entt::null;
+}
+
+void TransformHierarchy::_UpdateSubtreeDepths(entt::entity root) {
+	Transform& rootTransform = _registry.get<Transform>(root);
+	rootTransform._hierarchyDepth = rootTransform._parent != entt::null ? _registry.get<Transform>(rootTransform._parent)._hierarchyDepth + 1 : 0;
+
+	std::vector<entt::entity> stack;
+	stack.push_back(root);
+	while (!stack.empty()) {
+		const Transform& transform = _registry.get<Transform>(stack.back());
+		stack.pop_back();
+		for (entt::entity child = transform._firstChild; child != entt::null;) {
+			Transform& childTransform = _registry.get<Transform>(child);
+			childTransform._hierarchyDepth = transform._hierarchyDepth + 1;
+			stack.push_back(child);
+			child = childTransform._nextSibling;
+		}
+	}
+}
+
+bool TransformHierarchy::_IsAncestorOf(entt::entity ancestor, entt::entity entity) const {
+	for (entt::entity it = entity; it != entt::null; it = _registry.get<Transform>(it)._parent) {
+		if (it == ancestor) {
+			return true;
+		}
+	}
+	return false;
+}
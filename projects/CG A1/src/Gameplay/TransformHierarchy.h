@@ -0,0 +1,98 @@
+#pragma once
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <entt.hpp>
+#include "Utilities/TransformKernel.h"
+
+class Transform;
+
+/// <summary>
+/// Maintains the parent/child links between all the Transforms in a registry, and keeps their world
+/// matrices up to date.
+///
+/// Transforms add themselves to a dirty list when they are modified, and Update only recomputes the
+/// world matrices of dirty transforms and their descendants, always resolving parents before children.
+/// A frame where nothing moved costs next to nothing, no matter how many transforms are in the scene.
+///
+/// Every transform in the registry is given a WorldMatrix and WorldNormalMatrix component, which are
+/// filled in one hierarchy level at a time by the TransformKernel
+///
+/// One hierarchy lives in the context of each GameScene's registry
+/// </summary>
+class TransformHierarchy final
+{
+public:
+	TransformHierarchy(entt::registry& registry);
+	~TransformHierarchy();
+
+	TransformHierarchy(const TransformHierarchy& other) = delete;
+	TransformHierarchy(TransformHierarchy&& other) = delete;
+	TransformHierarchy& operator=(const TransformHierarchy& other) = delete;
+	TransformHierarchy& operator=(TransformHierarchy&& other) = delete;
+
+	/// <summary>
+	/// Queues a transform to have it's world matrix recomputed in the next Update. This is safe to call
+	/// from worker threads, and is invoked automatically by Transform whenever it is modified
+	/// </summary>
+	/// <param name="entity">The entity whose transform has changed</param>
+	void MarkDirty(entt::entity entity);
+	/// <summary>
+	/// Queues every transform in the registry to have it's world matrix recomputed
+	/// </summary>
+	void MarkAllDirty();
+
+	/// <summary>
+	/// Sets the parent of a transform, updating the depths of it and all of it's descendants. Must be
+	/// called from the main thread
+	/// </summary>
+	/// <param name="child">The entity to re-parent</param>
+	/// <param name="parent">The new parent entity, or entt::null to make child a root</param>
+	void SetParent(entt::entity child, entt::entity parent);
+	/// <summary>
+	/// Re-parents many transforms at once. All the links are updated first, then the depths of each moved
+	/// subtree are fixed up once, so this is much cheaper than calling SetParent repeatedly when moving
+	/// nested objects. Must be called from the main thread
+	/// </summary>
+	/// <param name="links">A list of (child, parent) pairs, parent may be entt::null to make the child a root</param>
+	void SetParents(const std::vector<std::pair<entt::entity, entt::entity>>& links);
+
+	/// <summary>
+	/// Recomputes the world matrices of all dirty transforms and their descendants, parents first
+	/// </summary>
+	void Update();
+
+	/// <summary>
+	/// Gets the entities whose world matrices were recomputed by the last call to Update, sorted by
+	/// hierarchy depth (so parents always come before their children)
+	/// </summary>
+	const std::vector<entt::entity>& GetUpdated() const { return _updated; }
+
+private:
+	entt::registry& _registry;
+
+	std::mutex                _dirtyLock;
+	std::vector<entt::entity> _dirty;
+	bool                      _allDirty;
+
+	// Scratch storage for Update, kept around so we don't re-allocate every frame
+	std::vector<entt::entity> _scratch;
+	std::vector<std::pair<int, entt::entity>> _processing;
+	std::vector<entt::entity> _roots;
+	std::vector<size_t>       _rootStarts;
+
+	// The transforms we updated in the last Update, and their kernel inputs. These are grouped by level,
+	// with _levelStarts holding the index of the first item in each level
+	std::vector<entt::entity>        _updated;
+	std::vector<Transform*>          _updatedTransforms;
+	std::vector<TransformKernelItem> _batch;
+	std::vector<size_t>              _levelStarts;
+
+	void _OnTransformConstructed(entt::registry& registry, entt::entity entity);
+	void _OnTransformDestroyed(entt::registry& registry, entt::entity entity);
+
+	void _Link(entt::entity child, entt::entity parent);
+	void _Unlink(entt::entity child);
+	void _UpdateSubtreeDepths(entt::entity root);
+	bool _IsAncestorOf(entt::entity ancestor, entt::entity entity) const;
+};
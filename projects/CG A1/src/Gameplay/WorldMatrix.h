@@ -0,0 +1,22 @@
+#pragma once
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// The world space transformation matrix for an entity, kept separate from the Transform so that
+/// rendering only has to stream through the matrices. This is added and updated by the scene's
+/// TransformHierarchy, and should be treated as read-only everywhere else
+/// </summary>
+struct WorldMatrix
+{
+	glm::mat4 Value = glm::mat4(1.0f);
+};
+
+/// <summary>
+/// The world space normal matrix (the inverse transpose of the upper 3x3 of the world matrix) for an
+/// entity. This is added and updated by the scene's TransformHierarchy, and should be treated as
+/// read-only everywhere else
+/// </summary>
+struct WorldNormalMatrix
+{
+	glm::mat3 Value = glm::mat3(1.0f);
+};
@@ -0,0 +1,244 @@
+#include "BufferAllocator.h"
+
+#include <algorithm>
+#include "GLStateCache.h"
+#include "IBuffer.h"
+#include "Logging.h"
+
+bool BufferAllocator::ShouldAllocate(GLenum type, GLenum usage, size_t size) const {
+	return Enabled && (type == GL_ARRAY_BUFFER || type == GL_ELEMENT_ARRAY_BUFFER) && usage == GL_STATIC_DRAW &&
+		size > 0 && size <= MaxAllocationSize && size <= PAGE_SIZE;
+}
+
+int BufferAllocator::_GetOrder(size_t size) {
+	int order = 0;
+	while ((static_cast<size_t>(MIN_BLOCK_SIZE) << order) < size) {
+		order++;
+	}
+	return order;
+}
+
+uint32_t BufferAllocator::_CreatePage() {
+	// Re-use the slot of a page that was released, so page indices stay small
+	uint32_t index = static_cast<uint32_t>(_pages.size());
+	for (uint32_t ix = 0; ix < _pages.size(); ix++) {
+		if (_pages[ix].Handle == 0) {
+			index = ix;
+			break;
+		}
+	}
+	if (index == _pages.size()) {
+		_pages.emplace_back();
+	}
+
+	Page& page = _pages[index];
+	glCreateBuffers(1, &page.Handle);
+	// Immutable storage, but we still need to be able to write in to it
+	glNamedBufferStorage(page.Handle, PAGE_SIZE, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	page.FreeBlocks[ORDER_COUNT - 1].insert(0);
+	page.Allocated = 0;
+	LOG_INFO("Buffer allocator created page {} ({} KB)", index, PAGE_SIZE / 1024);
+	return index;
+}
+
+bool BufferAllocator::_AllocateIn(uint32_t page, int order, uint32_t& offset) {
+	Page& target = _pages[page];
+	if (target.Handle == 0) {
+		return false;
+	}
+	// Find the smallest free block that is big enough
+	int found = order;
+	while (found < ORDER_COUNT && target.FreeBlocks[found].empty()) {
+		found++;
+	}
+	if (found == ORDER_COUNT) {
+		return false;
+	}
+	offset = *target.FreeBlocks[found].begin();
+	target.FreeBlocks[found].erase(target.FreeBlocks[found].begin());
+	// Split it in half until it's the right size, freeing the upper halves
+	while (found > order) {
+		found--;
+		target.FreeBlocks[found].insert(offset + (MIN_BLOCK_SIZE << found));
+	}
+	target.Allocated += static_cast<size_t>(MIN_BLOCK_SIZE) << order;
+	return true;
+}
+
+void BufferAllocator::_FreeIn(uint32_t page, uint32_t offset, int order) {
+	Page& target = _pages[page];
+	target.Allocated -= static_cast<size_t>(MIN_BLOCK_SIZE) << order;
+	// Merge with our buddy for as long as it's free
+	while (order < ORDER_COUNT - 1) {
+		const uint32_t buddy = offset ^ (MIN_BLOCK_SIZE << order);
+		auto it = target.FreeBlocks[order].find(buddy);
+		if (it == target.FreeBlocks[order].end()) {
+			break;
+		}
+		target.FreeBlocks[order].erase(it);
+		offset = std::min(offset, buddy);
+		order++;
+	}
+	target.FreeBlocks[order].insert(offset);
+}
+
+BufferAllocation BufferAllocator::Allocate(IBuffer* owner, size_t size) {
+	LOG_ASSERT(size <= PAGE_SIZE, "Allocation of {} bytes does not fit in a page!", size);
+	const int order = _GetOrder(std::max<size_t>(size, 1));
+
+	// Fill the fullest pages first, so the emptier ones have a chance to become empty
+	uint32_t best = UINT32_MAX;
+	for (uint32_t ix = 0; ix < _pages.size(); ix++) {
+		if (_pages[ix].Handle != 0 && (best == UINT32_MAX || _pages[ix].Allocated > _pages[best].Allocated)) {
+			// Only consider pages that have a block big enough
+			bool hasRoom = false;
+			for (int search = order; search < ORDER_COUNT && !hasRoom; search++) {
+				hasRoom = !_pages[ix].FreeBlocks[search].empty();
+			}
+			if (hasRoom) {
+				best = ix;
+			}
+		}
+	}
+	if (best == UINT32_MAX) {
+		best = _CreatePage();
+	}
+	uint32_t offset = 0;
+	[[maybe_unused]] const bool allocated = _AllocateIn(best, order, offset);
+	LOG_ASSERT(allocated, "Buffer allocator failed to allocate from a page with room!");
+
+	_pages[best].Owners[offset] = Owner{ owner, static_cast<uint32_t>(size), order };
+	BufferAllocation result;
+	result.Page = best;
+	result.Offset = offset;
+	result.Size = MIN_BLOCK_SIZE << order;
+	return result;
+}
+
+bool BufferAllocator::Reuse(const BufferAllocation& allocation, size_t size) {
+	if (!allocation.IsValid() || size > allocation.Size || (size <= allocation.Size / 2 && allocation.Size > MIN_BLOCK_SIZE)) {
+		return false;
+	}
+	_pages[allocation.Page].Owners[allocation.Offset].Requested = static_cast<uint32_t>(size);
+	return true;
+}
+
+void BufferAllocator::Free(const BufferAllocation& allocation) {
+	if (!allocation.IsValid()) {
+		return;
+	}
+	Page& page = _pages[allocation.Page];
+	auto it = page.Owners.find(allocation.Offset);
+	LOG_ASSERT(it != page.Owners.end(), "Freeing a block that was not allocated!");
+	const int order = it->second.Order;
+	page.Owners.erase(it);
+	_FreeIn(allocation.Page, allocation.Offset, order);
+}
+
+size_t BufferAllocator::Defragment() {
+	size_t moved = 0;
+
+	// Empty the pages with the least in them first, those are the cheapest to release
+	std::vector<uint32_t> pages;
+	for (uint32_t ix = 0; ix < _pages.size(); ix++) {
+		if (_pages[ix].Handle != 0) {
+			pages.push_back(ix);
+		}
+	}
+	std::sort(pages.begin(), pages.end(), [&](uint32_t l, uint32_t r) { return _pages[l].Allocated < _pages[r].Allocated; });
+
+	for (size_t source = 0; source < pages.size(); source++) {
+		const uint32_t from = pages[source];
+		// Copy the owners out, since moving them changes the map
+		std::vector<std::pair<uint32_t, Owner>> owners(_pages[from].Owners.begin(), _pages[from].Owners.end());
+		// Move the biggest blocks first, they are the hardest to fit
+		std::sort(owners.begin(), owners.end(), [](const auto& l, const auto& r) { return l.second.Order > r.second.Order; });
+		for (const auto& [offset, owner] : owners) {
+			// Only move in to pages that are fuller than this one, the rest will be emptied after
+			bool placed = false;
+			for (size_t target = pages.size(); target-- > source + 1 && !placed;) {
+				const uint32_t to = pages[target];
+				uint32_t newOffset = 0;
+				if (!_AllocateIn(to, owner.Order, newOffset)) {
+					continue;
+				}
+				// Copy the whole block, the owner may have written less than it asked for
+				glCopyNamedBufferSubData(_pages[from].Handle, _pages[to].Handle, offset, newOffset, MIN_BLOCK_SIZE << owner.Order);
+				_pages[to].Owners[newOffset] = owner;
+				_pages[from].Owners.erase(offset);
+				_FreeIn(from, offset, owner.Order);
+
+				BufferAllocation allocation;
+				allocation.Page = to;
+				allocation.Offset = newOffset;
+				allocation.Size = MIN_BLOCK_SIZE << owner.Order;
+				owner.Buffer->_Relocate(_pages[to].Handle, allocation);
+				placed = true;
+				moved++;
+			}
+		}
+	}
+	ReleaseEmptyPages();
+	_lastMoved = moved;
+	if (moved > 0) {
+		LOG_INFO("Buffer allocator moved {} allocations", moved);
+	}
+	return moved;
+}
+
+void BufferAllocator::ReleaseEmptyPages() {
+	for (Page& page : _pages) {
+		if (page.Handle != 0 && page.Owners.empty()) {
+			GLStateCache::Instance().ForgetBuffer(page.Handle);
+			glDeleteBuffers(1, &page.Handle);
+			page.Handle = 0;
+			for (std::set<uint32_t>& blocks : page.FreeBlocks) {
+				blocks.clear();
+			}
+		}
+	}
+}
+
+void BufferAllocator::Shutdown() {
+	size_t remaining = 0;
+	for (Page& page : _pages) {
+		// Detach any buffers that are still alive, so that they don't try to free their range later
+		for (const auto& [offset, owner] : page.Owners) {
+			owner.Buffer->_Relocate(0, BufferAllocation());
+			remaining++;
+		}
+		if (page.Handle != 0) {
+			GLStateCache::Instance().ForgetBuffer(page.Handle);
+			glDeleteBuffers(1, &page.Handle);
+		}
+	}
+	_pages.clear();
+	_lastMoved = 0;
+	if (remaining > 0) {
+		LOG_INFO("Buffer allocator shut down with {} buffers still allocated", remaining);
+	}
+}
+
+BufferAllocatorStats BufferAllocator::GetStats() const {
+	BufferAllocatorStats result;
+	for (const Page& page : _pages) {
+		if (page.Handle == 0) {
+			continue;
+		}
+		result.Pages++;
+		result.ReservedBytes += PAGE_SIZE;
+		result.AllocatedBytes += page.Allocated;
+		result.Allocations += page.Owners.size();
+		for (const auto& [offset, owner] : page.Owners) {
+			result.RequestedBytes += owner.Requested;
+		}
+		for (int order = ORDER_COUNT - 1; order >= 0; order--) {
+			if (!page.FreeBlocks[order].empty()) {
+				result.LargestFree = std::max<size_t>(result.LargestFree, static_cast<size_t>(MIN_BLOCK_SIZE) << order);
+				break;
+			}
+		}
+	}
+	result.Moved = _lastMoved;
+	return result;
+}
@@ -0,0 +1,168 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
+
+class IBuffer;
+
+/// <summary>
+/// A range of one of the BufferAllocator's pages
+/// </summary>
+struct BufferAllocation
+{
+	uint32_t Page   = UINT32_MAX;
+	uint32_t Offset = 0;
+	// The size of the block, which is the requested size rounded up to a power of two
+	uint32_t Size   = 0;
+
+	bool IsValid() const { return Page != UINT32_MAX; }
+};
+
+/// <summary>
+/// Usage counters for the BufferAllocator
+/// </summary>
+struct BufferAllocatorStats
+{
+	size_t Pages          = 0;
+	size_t Allocations    = 0;
+	// The bytes that the buffers asked for
+	size_t RequestedBytes = 0;
+	// The bytes in the blocks handed out, the difference from RequestedBytes is lost to rounding
+	size_t AllocatedBytes = 0;
+	// The bytes in all the pages
+	size_t ReservedBytes  = 0;
+	size_t LargestFree    = 0;
+	// The number of allocations moved by the last call to Defragment
+	size_t Moved          = 0;
+};
+
+/// <summary>
+/// Hands out ranges of large, immutable buffers (allocated with glNamedBufferStorage), so that thousands of small
+/// static meshes don't each need a buffer object and driver allocation of their own. IBuffers with GL_STATIC_DRAW
+/// usage go through this automatically, and become a view of (page handle, offset) without changing their API.
+///
+/// Each page is managed as a buddy allocator, blocks are powers of two between MIN_BLOCK_SIZE and PAGE_SIZE, and
+/// freed blocks merge with their buddy. Defragment moves allocations out of the emptiest pages (copying on the GPU)
+/// so that pages can be released.
+///
+/// OpenGL objects belong to the context, so this must only be used on the main thread
+/// </summary>
+class BufferAllocator final
+{
+public:
+	static BufferAllocator& Instance() {
+		static BufferAllocator instance;
+		return instance;
+	}
+
+	BufferAllocator(const BufferAllocator& other) = delete;
+	BufferAllocator(BufferAllocator&& other) = delete;
+	BufferAllocator& operator=(const BufferAllocator& other) = delete;
+	BufferAllocator& operator=(BufferAllocator&& other) = delete;
+
+	/// <summary>
+	/// The size of each page, in bytes
+	/// </summary>
+	static constexpr uint32_t PAGE_SIZE = 4 * 1024 * 1024;
+	/// <summary>
+	/// The smallest block, every allocation is aligned to this, which covers vertex, index and uniform buffer offsets
+	/// </summary>
+	static constexpr uint32_t MIN_BLOCK_SIZE = 256;
+
+	/// <summary>
+	/// If false, new buffers get a buffer object of their own. Buffers that were already allocated are not affected
+	/// </summary>
+	bool   Enabled = true;
+	/// <summary>
+	/// Buffers larger than this get a buffer object of their own, so that one large mesh can't take a whole page
+	/// </summary>
+	size_t MaxAllocationSize = PAGE_SIZE / 4;
+
+	/// <summary>
+	/// Returns true if a buffer should be allocated here. Only static vertex and index buffers are, buffers that are
+	/// updated often keep their own buffer objects so they can be orphaned, and uniform buffers are bound whole
+	/// </summary>
+	/// <param name="type">The type of the buffer (ex GL_ARRAY_BUFFER)</param>
+	/// <param name="usage">The usage hint of the buffer (ex GL_STATIC_DRAW)</param>
+	/// <param name="size">The size of the data, in bytes</param>
+	bool ShouldAllocate(GLenum type, GLenum usage, size_t size) const;
+
+	/// <summary>
+	/// Allocates a range for a buffer, creating a new page if none of them have room
+	/// </summary>
+	/// <param name="owner">The buffer that will use the range, it is told when the range is moved</param>
+	/// <param name="size">The number of bytes needed, at most PAGE_SIZE</param>
+	BufferAllocation Allocate(IBuffer* owner, size_t size);
+	/// <summary>
+	/// Checks if an allocation can hold new data of a different size, so that it's buffer can be updated in place. This
+	/// fails if the data is too big, or small enough that a smaller block would do
+	/// </summary>
+	/// <param name="allocation">The allocation to re-use</param>
+	/// <param name="size">The size of the new data, in bytes</param>
+	/// <returns>True if the allocation was kept, false if the buffer should free it and allocate again</returns>
+	bool Reuse(const BufferAllocation& allocation, size_t size);
+	/// <summary>
+	/// Returns a range to it's page. Empty pages are kept for reuse, see ReleaseEmptyPages
+	/// </summary>
+	void Free(const BufferAllocation& allocation);
+	/// <summary>
+	/// Gets the OpenGL buffer for a page
+	/// </summary>
+	GLuint GetPageHandle(uint32_t page) const { return _pages[page].Handle; }
+
+	/// <summary>
+	/// Moves allocations out of the emptiest pages in to the others, and releases the pages that end up empty. The
+	/// buffers that are moved keep working, VAOs pick up their new location the next time they are bound
+	/// </summary>
+	/// <returns>The number of allocations that were moved</returns>
+	size_t Defragment();
+	/// <summary>
+	/// Deletes any pages with nothing in them
+	/// </summary>
+	void ReleaseEmptyPages();
+	/// <summary>
+	/// Deletes all the pages, this must be called while the context is still alive, since the allocator itself is
+	/// only destroyed after it is gone. Buffers that still have a range (ex ones held by a static) lose their data,
+	/// but are still safe to destroy afterwards
+	/// </summary>
+	void Shutdown();
+
+	BufferAllocatorStats GetStats() const;
+
+private:
+	BufferAllocator() = default;
+	// The pages are deleted by Shutdown, the context is gone by the time this runs
+	~BufferAllocator() = default;
+
+	static constexpr int ORDER_COUNT = 15;
+	static_assert((MIN_BLOCK_SIZE << (ORDER_COUNT - 1)) == PAGE_SIZE, "Orders must cover the block sizes from MIN_BLOCK_SIZE to PAGE_SIZE!");
+
+	struct Owner
+	{
+		IBuffer* Buffer;
+		uint32_t Requested;
+		int      Order;
+	};
+
+	struct Page
+	{
+		GLuint Handle = 0;
+		// The offsets of the free blocks of each size
+		std::set<uint32_t> FreeBlocks[ORDER_COUNT];
+		// The buffer in each allocated block, by offset
+		std::unordered_map<uint32_t, Owner> Owners;
+		size_t Allocated = 0;
+	};
+
+	std::vector<Page> _pages;
+	size_t _lastMoved = 0;
+
+	static int _GetOrder(size_t size);
+	// Allocates a block in a page, returns false if the page does not have room
+	bool _AllocateIn(uint32_t page, int order, uint32_t& offset);
+	void _FreeIn(uint32_t page, uint32_t offset, int order);
+	uint32_t _CreatePage();
+};
@@ -0,0 +1,194 @@
+#include "GLStateCache.h"
+
+GLStateCache::GLStateCache() {
+	Invalidate();
+}
+
+int GLStateCache::_GetCapIndex(GLenum cap) {
+	switch (cap) {
+		case GL_DEPTH_TEST:   return DepthTest;
+		case GL_CULL_FACE:    return CullFace;
+		case GL_BLEND:        return Blend;
+		case GL_SCISSOR_TEST: return ScissorTest;
+		case GL_STENCIL_TEST: return StencilTest;
+		default:              return -1;
+	}
+}
+
+int GLStateCache::_GetTargetIndex(GLenum target) {
+	switch (target) {
+		case GL_ARRAY_BUFFER:          return ArrayBuffer;
+		case GL_UNIFORM_BUFFER:        return UniformBuffer;
+		case GL_SHADER_STORAGE_BUFFER: return StorageBuffer;
+		case GL_DRAW_INDIRECT_BUFFER:  return IndirectBuffer;
+		case GL_COPY_READ_BUFFER:      return CopyReadBuffer;
+		case GL_COPY_WRITE_BUFFER:     return CopyWriteBuffer;
+		case GL_PIXEL_UNPACK_BUFFER:   return PixelUnpackBuffer;
+		default:                       return -1;
+	}
+}
+
+void GLStateCache::UseProgram(GLuint program) {
+	if (_Change(_program, program)) {
+		glUseProgram(program);
+	}
+}
+
+void GLStateCache::BindVertexArray(GLuint vao) {
+	if (_Change(_vao, vao)) {
+		glBindVertexArray(vao);
+	}
+}
+
+void GLStateCache::BindTextureUnit(int unit, GLuint texture) {
+	if (unit >= MAX_TEXTURE_UNITS) {
+		_frame.Calls++;
+		glBindTextureUnit(unit, texture);
+	} else if (_Change(_textures[unit], texture)) {
+		glBindTextureUnit(unit, texture);
+	}
+}
+
+void GLStateCache::BindBuffer(GLenum target, GLuint buffer) {
+	const int index = _GetTargetIndex(target);
+	if (index == -1) {
+		_frame.Calls++;
+		glBindBuffer(target, buffer);
+	} else if (_Change(_buffers[index], buffer)) {
+		glBindBuffer(target, buffer);
+	}
+}
+
+void GLStateCache::BindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+	GLuint* bindings = target == GL_UNIFORM_BUFFER ? _uniformBindings : target == GL_SHADER_STORAGE_BUFFER ? _storageBindings : nullptr;
+	if (bindings == nullptr || index >= MAX_BUFFER_BINDINGS) {
+		_frame.Calls++;
+		glBindBufferBase(target, index, buffer);
+	} else if (_Change(bindings[index], buffer)) {
+		glBindBufferBase(target, index, buffer);
+	} else {
+		return;
+	}
+	// Binding to an index also binds to the generic target
+	const int generic = _GetTargetIndex(target);
+	if (generic != -1) {
+		_buffers[generic] = buffer;
+	}
+}
+
+void GLStateCache::BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+	// The binding is no longer the whole buffer, so the next BindBufferBase has to go through
+	GLuint* bindings = target == GL_UNIFORM_BUFFER ? _uniformBindings : target == GL_SHADER_STORAGE_BUFFER ? _storageBindings : nullptr;
+	if (bindings != nullptr && index < MAX_BUFFER_BINDINGS) {
+		bindings[index] = UNKNOWN;
+	}
+	_frame.Calls++;
+	glBindBufferRange(target, index, buffer, offset, size);
+	const int generic = _GetTargetIndex(target);
+	if (generic != -1) {
+		_buffers[generic] = buffer;
+	}
+}
+
+void GLStateCache::SetEnabled(GLenum cap, bool enabled) {
+	const int index = _GetCapIndex(cap);
+	if (index == -1) {
+		_frame.Calls++;
+	} else if (!_Change(_caps[index], enabled ? 1 : 0)) {
+		return;
+	}
+	if (enabled) {
+		glEnable(cap);
+	} else {
+		glDisable(cap);
+	}
+}
+
+void GLStateCache::SetDepthFunc(GLenum func) {
+	if (_Change(_depthFunc, func)) {
+		glDepthFunc(func);
+	}
+}
+
+void GLStateCache::SetDepthMask(bool write) {
+	if (_Change(_depthMask, write ? 1 : 0)) {
+		glDepthMask(write ? GL_TRUE : GL_FALSE);
+	}
+}
+
+void GLStateCache::SetBlendFunc(GLenum source, GLenum dest) {
+	if (_blendSource == source && _blendDest == dest) {
+		_frame.Skipped++;
+		return;
+	}
+	_blendSource = source;
+	_blendDest = dest;
+	_frame.Calls++;
+	glBlendFunc(source, dest);
+}
+
+void GLStateCache::SetCullFace(GLenum face) {
+	if (_Change(_cullFace, face)) {
+		glCullFace(face);
+	}
+}
+
+void GLStateCache::ForgetProgram(GLuint program) {
+	// A program that is in use is only deleted once it stops being used, so it's name can't be reused before then
+	if (_program == program) {
+		_program = UNKNOWN;
+	}
+}
+
+void GLStateCache::ForgetVertexArray(GLuint vao) {
+	if (_vao == vao) {
+		_vao = 0;
+	}
+}
+
+void GLStateCache::ForgetTexture(GLuint texture) {
+	for (GLuint& bound : _textures) {
+		if (bound == texture) {
+			bound = 0;
+		}
+	}
+}
+
+void GLStateCache::ForgetBuffer(GLuint buffer) {
+	for (GLuint& bound : _buffers) {
+		if (bound == buffer) {
+			bound = 0;
+		}
+	}
+	// Deleting a buffer only unbinds it from the generic targets, the indexed bindings still reference it
+	for (GLuint& bound : _uniformBindings) {
+		if (bound == buffer) {
+			bound = UNKNOWN;
+		}
+	}
+	for (GLuint& bound : _storageBindings) {
+		if (bound == buffer) {
+			bound = UNKNOWN;
+		}
+	}
+}
+
+void GLStateCache::Invalidate() {
+	_program = UNKNOWN;
+	_vao = UNKNOWN;
+	for (GLuint& bound : _textures) bound = UNKNOWN;
+	for (GLuint& bound : _buffers) bound = UNKNOWN;
+	for (GLuint& bound : _uniformBindings) bound = UNKNOWN;
+	for (GLuint& bound : _storageBindings) bound = UNKNOWN;
+	for (GLuint& cap : _caps) cap = UNKNOWN;
+	_depthFunc = UNKNOWN;
+	_depthMask = UNKNOWN;
+	_blendSource = UNKNOWN;
+	_blendDest = UNKNOWN;
+	_cullFace = UNKNOWN;
+}
+
+void GLStateCache::NewFrame() {
+	_lastFrame = _frame;
+	_frame = GLStateStats();
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include <cstddef>
+#include <glad/glad.h>
+
+/// <summary>
+/// Counters from the last frame, see GLStateCache::NewFrame
+/// </summary>
+struct GLStateStats
+{
+	// The number of state changes that were sent to OpenGL
+	size_t Calls   = 0;
+	// The number of state changes that were skipped, since OpenGL was already in that state
+	size_t Skipped = 0;
+};
+
+/// <summary>
+/// Remembers the OpenGL state that we have set, so that setting it again does nothing. Tracks the current program,
+/// VAO, the texture bound to each unit, the generic and indexed buffer bindings, and the depth, blend and cull state.
+///
+/// Every class in Graphics goes through this instead of calling glBind* or glEnable directly. Anything that changes
+/// the state without going through it (ex a library) must call Invalidate afterwards, or put the state back the way
+/// it found it (like the ImGui backend does).
+///
+/// OpenGL state belongs to the context, so this must only be used on the main thread
+/// </summary>
+class GLStateCache final
+{
+public:
+	static GLStateCache& Instance() {
+		static GLStateCache instance;
+		return instance;
+	}
+
+	GLStateCache(const GLStateCache& other) = delete;
+	GLStateCache(GLStateCache&& other) = delete;
+	GLStateCache& operator=(const GLStateCache& other) = delete;
+	GLStateCache& operator=(GLStateCache&& other) = delete;
+
+	/// <summary>
+	/// The most texture units that are tracked, binds to higher units always go through
+	/// </summary>
+	static constexpr int MAX_TEXTURE_UNITS = 32;
+	/// <summary>
+	/// The most indexed uniform and storage buffer bindings that are tracked
+	/// </summary>
+	static constexpr int MAX_BUFFER_BINDINGS = 16;
+
+	void UseProgram(GLuint program);
+	void BindVertexArray(GLuint vao);
+	void BindTextureUnit(int unit, GLuint texture);
+	/// <summary>
+	/// Binds a buffer to a target. Note that GL_ELEMENT_ARRAY_BUFFER is part of the VAO's state, so it is never skipped
+	/// </summary>
+	void BindBuffer(GLenum target, GLuint buffer);
+	/// <summary>
+	/// Binds a buffer to an indexed target, this also binds it to the generic target like OpenGL does
+	/// </summary>
+	void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+	/// <summary>
+	/// Binds a range of a buffer to an indexed target, this also binds it to the generic target. Ranges usually move
+	/// every time they are bound (ex streamed uniform blocks), so they are not tracked and this always goes through
+	/// </summary>
+	void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+	/// <summary>
+	/// Enables or disables a capability. GL_DEPTH_TEST, GL_CULL_FACE, GL_BLEND, GL_SCISSOR_TEST and
+	/// GL_STENCIL_TEST are tracked, anything else always goes through
+	/// </summary>
+	void SetEnabled(GLenum cap, bool enabled);
+	void SetDepthFunc(GLenum func);
+	void SetDepthMask(bool write);
+	void SetBlendFunc(GLenum source, GLenum dest);
+	void SetCullFace(GLenum face);
+
+	GLuint GetProgram() const { return _program; }
+	GLuint GetVertexArray() const { return _vao; }
+
+	/// <summary>
+	/// Called when an object is deleted, so that a new object that reuses it's name is not mistaken for it. Deleting
+	/// an object that is bound also unbinds it in OpenGL
+	/// </summary>
+	void ForgetProgram(GLuint program);
+	void ForgetVertexArray(GLuint vao);
+	void ForgetTexture(GLuint texture);
+	void ForgetBuffer(GLuint buffer);
+
+	/// <summary>
+	/// Forgets all the tracked state, so that the next change of each kind goes through
+	/// </summary>
+	void Invalidate();
+
+	/// <summary>
+	/// Starts counting a new frame, the counts from the frame before are kept for GetStats
+	/// </summary>
+	void NewFrame();
+	const GLStateStats& GetStats() const { return _lastFrame; }
+
+private:
+	GLStateCache();
+
+	// Used for values that we have not set yet, none of the GL enums or names we track use it
+	static constexpr GLuint UNKNOWN = 0xFFFFFFFF;
+
+	enum TrackedCap { DepthTest, CullFace, Blend, ScissorTest, StencilTest, CapCount };
+	enum TrackedTarget { ArrayBuffer, UniformBuffer, StorageBuffer, IndirectBuffer, CopyReadBuffer, CopyWriteBuffer, PixelUnpackBuffer, TargetCount };
+
+	GLuint _program;
+	GLuint _vao;
+	GLuint _textures[MAX_TEXTURE_UNITS];
+	GLuint _buffers[TargetCount];
+	GLuint _uniformBindings[MAX_BUFFER_BINDINGS];
+	GLuint _storageBindings[MAX_BUFFER_BINDINGS];
+	GLuint _caps[CapCount];
+	GLenum _depthFunc;
+	GLuint _depthMask;
+	GLenum _blendSource;
+	GLenum _blendDest;
+	GLenum _cullFace;
+
+	GLStateStats _frame;
+	GLStateStats _lastFrame;
+
+	// Returns true if the value changed, and counts the call either way
+	inline bool _Change(GLuint& current, GLuint value) {
+		if (current == value) {
+			_frame.Skipped++;
+			return false;
+		}
+		current = value;
+		_frame.Calls++;
+		return true;
+	}
+
+	static int _GetCapIndex(GLenum cap);
+	static int _GetTargetIndex(GLenum target);
+};
@@ -0,0 +1,68 @@
+#include "GeometryArena.h"
+
+#include <algorithm>
+#include "Logging.h"
+
+GeometryArena::GeometryArena(const std::vector<BufferAttribute>& layout, size_t vertexSize, size_t vertexCapacity, size_t indexCapacity) :
+	_layout(layout),
+	_vertexSize(vertexSize),
+	_vertexCount(0),
+	_indexCount(0),
+	_vertexCapacity(std::max<size_t>(vertexCapacity, 1)),
+	_indexCapacity(std::max<size_t>(indexCapacity, 1))
+{
+	_vertices = VertexBuffer::Create();
+	_vertices->LoadData(nullptr, _vertexSize, _vertexCapacity);
+	_indices = IndexBuffer::Create();
+	_indices->LoadData(nullptr, sizeof(uint32_t), _indexCapacity, GL_UNSIGNED_INT);
+
+	_vao = VertexArrayObject::Create();
+	_vao->AddVertexBuffer(_vertices, _layout);
+	_vao->SetIndexBuffer(_indices);
+}
+
+void GeometryArena::_Grow(IBuffer& buffer, size_t usedBytes, size_t elementSize, size_t newCount, GLenum indexType) {
+	// Park the contents in a temporary buffer while the buffer is re-allocated, this never leaves the GPU
+	GLuint temp = 0;
+	if (usedBytes > 0) {
+		glCreateBuffers(1, &temp);
+		glNamedBufferData(temp, usedBytes, nullptr, GL_STREAM_COPY);
+		glCopyNamedBufferSubData(buffer.GetHandle(), temp, buffer.GetOffset(), 0, usedBytes);
+	}
+	if (indexType != GL_NONE) {
+		static_cast<IndexBuffer&>(buffer).LoadData(nullptr, elementSize, newCount, indexType);
+	} else {
+		buffer.LoadData(nullptr, elementSize, newCount);
+	}
+	// The buffer may have moved to a different page or a buffer object of it's own, so we read where it is again
+	if (temp != 0) {
+		glCopyNamedBufferSubData(temp, buffer.GetHandle(), 0, buffer.GetOffset(), usedBytes);
+		glDeleteBuffers(1, &temp);
+	}
+}
+
+VertexArrayObject::sptr GeometryArena::Add(const void* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount) {
+	LOG_ASSERT(indexCount > 0, "Meshes in an arena must be indexed!");
+
+	if (_vertexCount + vertexCount > _vertexCapacity) {
+		const size_t capacity = std::max(_vertexCapacity * 2, _vertexCount + vertexCount);
+		LOG_INFO("Growing geometry arena from {} to {} vertices", _vertexCapacity, capacity);
+		_Grow(*_vertices, _vertexCount * _vertexSize, _vertexSize, capacity, GL_NONE);
+		_vertexCapacity = capacity;
+	}
+	if (_indexCount + indexCount > _indexCapacity) {
+		const size_t capacity = std::max(_indexCapacity * 2, _indexCount + indexCount);
+		LOG_INFO("Growing geometry arena from {} to {} indices", _indexCapacity, capacity);
+		_Grow(*_indices, _indexCount * sizeof(uint32_t), sizeof(uint32_t), capacity, GL_UNSIGNED_INT);
+		_indexCapacity = capacity;
+	}
+
+	glNamedBufferSubData(_vertices->GetHandle(), _vertices->GetOffset() + _vertexCount * _vertexSize, vertexCount * _vertexSize, vertices);
+	glNamedBufferSubData(_indices->GetHandle(), _indices->GetOffset() + _indexCount * sizeof(uint32_t), indexCount * sizeof(uint32_t), indices);
+
+	// The indices stay relative to the mesh, the base vertex moves them to where it's vertices are
+	VertexArrayObject::sptr result = VertexArrayObject::Create(_vao, static_cast<GLuint>(_indexCount), static_cast<GLsizei>(indexCount), static_cast<GLint>(_vertexCount));
+	_vertexCount += vertexCount;
+	_indexCount += indexCount;
+	return result;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "VertexArrayObject.h"
+
+/// <summary>
+/// Packs many static meshes with the same vertex layout into one shared vertex buffer and index buffer, behind a
+/// single VAO. Each mesh that is added comes back as a range of that VAO (see VertexArrayObject::IsRange), so it can
+/// be used anywhere a normal mesh can. Since they all share buffers, drawing them back to back never changes the
+/// bound VAO, and the RenderBatcher can draw them all with a single glMultiDrawElementsIndirect.
+///
+/// Meshes can only be added, the arena grows (by copying on the GPU) when it runs out of room
+/// </summary>
+class GeometryArena final
+{
+public:
+	typedef std::shared_ptr<GeometryArena> sptr;
+	static inline sptr Create(const std::vector<BufferAttribute>& layout, size_t vertexSize, size_t vertexCapacity = 65536, size_t indexCapacity = 196608) {
+		return std::make_shared<GeometryArena>(layout, vertexSize, vertexCapacity, indexCapacity);
+	}
+
+	// We'll disallow moving and copying, since we want to manually control when the destructor is called
+	// We'll use these classes via pointers
+	GeometryArena(const GeometryArena& other) = delete;
+	GeometryArena(GeometryArena&& other) = delete;
+	GeometryArena& operator=(const GeometryArena& other) = delete;
+	GeometryArena& operator=(GeometryArena&& other) = delete;
+
+public:
+	/// <summary>
+	/// Creates a new empty arena
+	/// </summary>
+	/// <param name="layout">The vertex attributes of every mesh in the arena, ex VertexPosNormTexCol::V_DECL</param>
+	/// <param name="vertexSize">The size of a single vertex, in bytes</param>
+	/// <param name="vertexCapacity">The number of vertices to make room for up front</param>
+	/// <param name="indexCapacity">The number of indices to make room for up front</param>
+	GeometryArena(const std::vector<BufferAttribute>& layout, size_t vertexSize, size_t vertexCapacity, size_t indexCapacity);
+	~GeometryArena() = default;
+
+	/// <summary>
+	/// Copies a mesh into the arena. See MeshBuilder::Bake(GeometryArena&), which also sets the mesh's bounds
+	/// </summary>
+	/// <param name="vertices">The vertices of the mesh, each must be GetVertexSize bytes and match the layout</param>
+	/// <param name="vertexCount">The number of vertices</param>
+	/// <param name="indices">The indices of the mesh, relative to it's first vertex</param>
+	/// <param name="indexCount">The number of indices</param>
+	/// <returns>A range of the arena's VAO that draws the mesh</returns>
+	VertexArrayObject::sptr Add(const void* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount);
+
+	const std::vector<BufferAttribute>& GetLayout() const { return _layout; }
+	size_t GetVertexSize() const { return _vertexSize; }
+	size_t GetVertexCount() const { return _vertexCount; }
+	size_t GetIndexCount() const { return _indexCount; }
+	size_t GetVertexCapacity() const { return _vertexCapacity; }
+	size_t GetIndexCapacity() const { return _indexCapacity; }
+	/// <summary>
+	/// Gets the VAO that every mesh in the arena is a range of
+	/// </summary>
+	const VertexArrayObject::sptr& GetVertexArray() const { return _vao; }
+
+private:
+	std::vector<BufferAttribute> _layout;
+	size_t _vertexSize;
+	size_t _vertexCount;
+	size_t _indexCount;
+	size_t _vertexCapacity;
+	size_t _indexCapacity;
+
+	VertexBuffer::sptr      _vertices;
+	IndexBuffer::sptr       _indices;
+	VertexArrayObject::sptr _vao;
+
+	// Re-allocates a buffer with a new size, keeping the first usedBytes of it's contents. The buffer may move if it
+	// is sub-allocated, the VAO picks that up the next time it is bound
+	static void _Grow(IBuffer& buffer, size_t usedBytes, size_t elementSize, size_t newCount, GLenum indexType);
+};
@@ -1,33 +1,83 @@
 #include "IBuffer.h"
+#include "GLStateCache.h"
+
+// Buffers are only created on the main thread, so this doesn't need to be atomic
+uint64_t IBuffer::_placementGeneration = 0;
 
 IBuffer::IBuffer(GLenum type, GLenum usage) :
 	_elementCount(0),
 	_elementSize(0),
-	_handle(0)
+	_handle(0),
+	_offset(0),
+	_allocation(),
+	_placementVersion(0)
 {
 	_type = type;
 	_usage = usage;
-	glCreateBuffers(1, &_handle);
+	// Static buffers are probably going to be sub-allocated, so we wait until we know how big they are
+	if (_usage != GL_STATIC_DRAW) {
+		glCreateBuffers(1, &_handle);
+	}
+	_Moved();
 }
 
 IBuffer::~IBuffer() {
-	if (_handle != 0) {
+	_Release();
+}
+
+void IBuffer::_Release() {
+	if (_allocation.IsValid()) {
+		BufferAllocator::Instance().Free(_allocation);
+		_allocation = BufferAllocation();
+	} else if (_handle != 0) {
+		GLStateCache::Instance().ForgetBuffer(_handle);
 		glDeleteBuffers(1, &_handle);
-		_handle = 0;
 	}
+	_handle = 0;
+	_offset = 0;
+}
+
+void IBuffer::_Relocate(GLuint handle, const BufferAllocation& allocation) {
+	_handle = handle;
+	_offset = allocation.Offset;
+	_allocation = allocation;
+	_Moved();
 }
 
 void IBuffer::LoadData(const void* data, size_t elementSize, size_t elementCount) {
-	// Note, this is part of the bindless state access stuff added in 4.5    
-	glNamedBufferData(_handle, elementSize * elementCount, data, _usage);
+	const size_t size = elementSize * elementCount;
+	BufferAllocator& allocator = BufferAllocator::Instance();
+
+	if (allocator.ShouldAllocate(_type, _usage, size)) {
+		// Update our range in place if we can, otherwise move to a new one
+		if (!allocator.Reuse(_allocation, size)) {
+			_Release();
+			_allocation = allocator.Allocate(this, size);
+			_handle = allocator.GetPageHandle(_allocation.Page);
+			_offset = _allocation.Offset;
+			_Moved();
+		}
+		if (data != nullptr) {
+			glNamedBufferSubData(_handle, _offset, size, data);
+		}
+	} else {
+		// Buffers that are too big or change often get a buffer object of their own
+		if (_allocation.IsValid() || _handle == 0) {
+			_Release();
+			glCreateBuffers(1, &_handle);
+			_Moved();
+		}
+		// Note, this is part of the bindless state access stuff added in 4.5
+		glNamedBufferData(_handle, size, data, _usage);
+	}
 	_elementCount = elementCount;
 	_elementSize = elementSize;
 }
 
 void IBuffer::Bind() {
-	glBindBuffer(_type, _handle);
+	GLStateCache::Instance().BindBuffer(_type, _handle);
 }
 
 void IBuffer::UnBind(GLenum type) {
-	glBindBuffer(type, 0);
+	GLStateCache::Instance().BindBuffer(type, 0);
 }
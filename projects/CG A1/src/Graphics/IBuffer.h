@@ -1,8 +1,15 @@
 #pragma once
+#include <cstdint>
 #include <glad/glad.h>
+#include "BufferAllocator.h"
 
 /// <summary>
 /// This is our abstract base class for all our OpenGL buffer types
+///
+/// Static vertex and index buffers don't get a buffer object of their own, they are a range of one of the
+/// BufferAllocator's pages instead, starting at GetOffset. Anything that reads the buffer directly (rather than
+/// through a VAO) must add the offset, and should check GetPlacementVersion, since the range moves when the buffer is
+/// re-allocated or defragmented
 /// </summary>
 class IBuffer
 {	
@@ -21,7 +28,8 @@ public:
 	virtual ~IBuffer();
 
 	/// <summary>
-	/// Loads data into this buffer, using the bindless method glNamedBufferData
+	/// Loads data into this buffer, using the bindless method glNamedBufferData. Buffers that are sub-allocated update
+	/// their range in place if the data still fits in it
 	/// </summary>
 	/// <param name="data">The data that you want to load into the buffer</param>
 	/// <param name="elementSize">The size of a single element, in bytes</param>
@@ -62,6 +70,24 @@ public:
 	/// Returns the underlying OpenGL handle that this class is wrapping around
 	/// </summary>
 	GLuint GetHandle() const { return _handle; }
+	/// <summary>
+	/// Returns the offset in bytes of this buffer's data within GetHandle, this is only non-zero for buffers that are
+	/// sub-allocated
+	/// </summary>
+	size_t GetOffset() const { return _offset; }
+	/// <summary>
+	/// Returns true if this buffer is a range of one of the BufferAllocator's pages
+	/// </summary>
+	bool IsSubAllocated() const { return _allocation.IsValid(); }
+	/// <summary>
+	/// Returns a number that changes whenever the handle or offset of this buffer changes, so that VAOs know when to
+	/// update their attributes. Versions are unique across all buffers, see GetPlacementGeneration
+	/// </summary>
+	uint64_t GetPlacementVersion() const { return _placementVersion; }
+	/// <summary>
+	/// Returns the newest placement version of any buffer, if this has not changed then no buffer has moved
+	/// </summary>
+	static uint64_t GetPlacementGeneration() { return _placementGeneration; }
 
 	/// <summary>
 	/// Binds this buffer for use to the slot returned by GetType()
@@ -83,7 +109,22 @@ protected:
 	
 	size_t _elementSize; // The size or stride of our elements
 	size_t _elementCount; // The number of elements in the buffer
-	GLuint _handle; // The OpenGL handle for the underlying buffer
+	GLuint _handle; // The OpenGL handle for the underlying buffer, which is a page of the BufferAllocator if we are sub-allocated
+	size_t _offset; // The offset of our data in the buffer given by _handle
 	GLenum _usage; // The buffer usage mode (GL_STATIC_DRAW, GL_DYNAMIC_DRAW)
 	GLenum _type; // The buffer type (ex GL_ARRAY_BUFFER, GL_ARRAY_ELEMENT_BUFFER)
+
+	BufferAllocation _allocation; // Our range of the BufferAllocator, if we are sub-allocated
+	uint64_t _placementVersion; // Changes whenever _handle or _offset does
+
+	// Called by the BufferAllocator when it moves our data
+	void _Relocate(GLuint handle, const BufferAllocation& allocation);
+	// Deletes our buffer object or frees our range
+	void _Release();
+	// Records that our handle or offset changed
+	void _Moved() { _placementVersion = ++_placementGeneration; }
+
+	static uint64_t _placementGeneration;
+
+	friend class BufferAllocator;
 };
@@ -1,6 +1,7 @@
 #include "ITexture.h"
 
 #include "Logging.h"
+#include "GLStateCache.h"
 
 ITexture::Limits ITexture::_limits = ITexture::Limits();
 bool ITexture::_isStaticInit = false;
@@ -16,7 +17,7 @@ ITexture::ITexture()
 		glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &_limits.MAX_TEXTURE_IMAGE_UNITS);
 		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &_limits.MAX_ANISOTROPY);
 
-		glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+		GLStateCache::Instance().SetEnabled(GL_TEXTURE_CUBE_MAP_SEAMLESS, true);
 
 		LOG_INFO("==== Texture Limits =====");
 		LOG_INFO("\tSize:       {}", _limits.MAX_TEXTURE_SIZE);
@@ -31,21 +32,20 @@ ITexture::ITexture()
 
 ITexture::~ITexture() {
 	if (glIsTexture(_handle)) {
+		GLStateCache::Instance().ForgetTexture(_handle);
 		glDeleteTextures(1, &_handle);
 	}
 }
 
 void ITexture::Bind(int slot) const {
 	if (_handle != 0) {
-		//glActiveTexture(GL_TEXTURE0 + slot);
-		glBindTextureUnit(slot, _handle);
+		GLStateCache::Instance().BindTextureUnit(slot, _handle);
 	}
 }
 
 void ITexture::Unbind(int slot)
 {
-	//glActiveTexture(GL_TEXTURE0 + slot);
-	glBindTextureUnit(slot, 0);
+	GLStateCache::Instance().BindTextureUnit(slot, 0);
 }
 
 
@@ -0,0 +1,41 @@
+#pragma once
+#include "IBuffer.h"
+#include <cstdint>
+#include <memory>
+
+/// <summary>
+/// The parameters for a single draw in glMultiDrawElementsIndirect, laid out the way OpenGL expects them
+/// </summary>
+struct DrawElementsIndirectCommand
+{
+	uint32_t Count;
+	uint32_t InstanceCount;
+	uint32_t FirstIndex;
+	int32_t  BaseVertex;
+	uint32_t BaseInstance;
+};
+
+/// <summary>
+/// The indirect buffer stores draw commands, so that many draws can be made with a single call to
+/// glMultiDrawElementsIndirect
+/// </summary>
+class IndirectBuffer : public IBuffer
+{
+public:
+	typedef std::shared_ptr<IndirectBuffer> sptr;
+	static inline sptr Create(GLenum usage = GL_DYNAMIC_DRAW) {
+		return std::make_shared<IndirectBuffer>(usage);
+	}
+
+public:
+	/// <summary>
+	/// Creates a new indirect buffer, with the given usage. Data will still need to be uploaded before it can be used
+	/// </summary>
+	/// <param name="usage">The usage hint for the buffer, default is GL_DYNAMIC_DRAW since commands are usually rebuilt every frame</param>
+	IndirectBuffer(GLenum usage = GL_DYNAMIC_DRAW) : IBuffer(GL_DRAW_INDIRECT_BUFFER, usage) { }
+
+	/// <summary>
+	/// Unbinds the current indirect buffer
+	/// </summary>
+	static void UnBind() { IBuffer::UnBind(GL_DRAW_INDIRECT_BUFFER); }
+};
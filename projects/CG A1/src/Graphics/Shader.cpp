@@ -1,18 +1,21 @@
 #include "Shader.h"
 #include "Logging.h"
+#include "GLStateCache.h"
 #include <fstream>
 #include <sstream>
 
 Shader::Shader() :
 	_vs(0),
 	_fs(0),
-	_handle(0)
+	_handle(0),
+	_appliedVersion(0)
 {
 	_handle = glCreateProgram();
 }
 
 Shader::~Shader() {
 	if (_handle != 0) {
+		GLStateCache::Instance().ForgetProgram(_handle);
 		glDeleteProgram(_handle);
 		_handle = 0;
 		LOG_INFO("Deleting shader program");
@@ -112,63 +115,151 @@ bool Shader::Link()
 		else {
 			LOG_ERROR("Shader failed to link for an unknown reason!");
 		}
+	} else {
+		_Reflect();
 	}
 	return status != GL_FALSE;
 }
 
+// Returns true for the sampler types that we can bind a texture to
+static bool IsSamplerType(GLenum type) {
+	switch (type) {
+		case GL_SAMPLER_1D:
+		case GL_SAMPLER_2D:
+		case GL_SAMPLER_3D:
+		case GL_SAMPLER_CUBE:
+		case GL_SAMPLER_1D_SHADOW:
+		case GL_SAMPLER_2D_SHADOW:
+		case GL_SAMPLER_1D_ARRAY:
+		case GL_SAMPLER_2D_ARRAY:
+		case GL_SAMPLER_2D_ARRAY_SHADOW:
+		case GL_SAMPLER_CUBE_SHADOW:
+		case GL_SAMPLER_CUBE_MAP_ARRAY:
+		case GL_SAMPLER_2D_MULTISAMPLE:
+		case GL_INT_SAMPLER_2D:
+		case GL_UNSIGNED_INT_SAMPLER_2D:
+			return true;
+		default:
+			return false;
+	}
+}
+
+void Shader::_Reflect() {
+	_uniforms.clear();
+
+	GLint count = 0;
+	glGetProgramiv(_handle, GL_ACTIVE_UNIFORMS, &count);
+	GLint maxLength = 0;
+	glGetProgramiv(_handle, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	std::vector<char> name(maxLength > 0 ? maxLength : 1);
+
+	int textureSlot = FIRST_TEXTURE_SLOT;
+	for (GLint ix = 0; ix < count; ix++) {
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(_handle, ix, static_cast<GLsizei>(name.size()), &length, &size, &type, name.data());
+
+		ShaderUniformInfo info;
+		info.Name = std::string(name.data(), length);
+		// Arrays are reported as the first element, ex u_Array[0]
+		if (info.Name.size() > 3 && info.Name.compare(info.Name.size() - 3, 3, "[0]") == 0) {
+			info.Name.resize(info.Name.size() - 3);
+		}
+		info.Type = type;
+		info.Location = glGetUniformLocation(_handle, info.Name.c_str());
+		info.ArraySize = size;
+		info.TextureSlot = -1;
+		// Uniforms in blocks don't have locations, they are set through uniform buffers
+		if (info.Location == -1) {
+			continue;
+		}
+		// Samplers never change slot, so we can set them once here instead of every time a material is applied
+		if (IsSamplerType(type)) {
+			info.TextureSlot = textureSlot++;
+			glProgramUniform1i(_handle, info.Location, info.TextureSlot);
+		}
+		_uniformLocs[info.Name] = info.Location;
+		_uniforms.push_back(info);
+	}
+}
+
+const ShaderUniformInfo* Shader::FindUniform(const std::string& name) const {
+	for (const ShaderUniformInfo& info : _uniforms) {
+		if (info.Name == name) {
+			return &info;
+		}
+	}
+	return nullptr;
+}
+
 void Shader::Bind() {
-	glUseProgram(_handle);
+	GLStateCache::Instance().UseProgram(_handle);
 }
 
 void Shader::UnBind() {
-	glUseProgram(0);
+	GLStateCache::Instance().UseProgram(0);
 }
 
 void Shader::SetUniformMatrix(int location, const glm::mat3* value, int count, bool transposed) {
+	_appliedVersion = 0;
 	glProgramUniformMatrix3fv(_handle, location, count, transposed, glm::value_ptr(*value));
 }
 void Shader::SetUniformMatrix(int location, const glm::mat4* value, int count, bool transposed) {
+	_appliedVersion = 0;
 	glProgramUniformMatrix4fv(_handle, location, count, transposed, glm::value_ptr(*value));
 }
 void Shader::SetUniform(int location, const float* value, int count) {
+	_appliedVersion = 0;
 	glProgramUniform1fv(_handle, location, count, value);
 }
 void Shader::SetUniform(int location, const glm::vec2* value, int count) {
+	_appliedVersion = 0;
 	glProgramUniform2fv(_handle, location, count, glm::value_ptr(*value));
 }
 void Shader::SetUniform(int location, const glm::vec3* value, int count) {
+	_appliedVersion = 0;
 	glProgramUniform3fv(_handle, location, count, glm::value_ptr(*value));
 }
 void Shader::SetUniform(int location, const glm::vec4* value, int count) {
+	_appliedVersion = 0;
 	glProgramUniform4fv(_handle, location, count, glm::value_ptr(*value));
 }
 
 void Shader::SetUniform(int location, const int* value, int count) {
+	_appliedVersion = 0;
 	glProgramUniform1iv(_handle, location, count, value);
 }
 void Shader::SetUniform(int location, const glm::ivec2* value, int count) {
+	_appliedVersion = 0;
 	glProgramUniform2iv(_handle, location, count, glm::value_ptr(*value));
 }
 void Shader::SetUniform(int location, const glm::ivec3* value, int count) {
+	_appliedVersion = 0;
 	glProgramUniform3iv(_handle, location, count, glm::value_ptr(*value));
 }
 void Shader::SetUniform(int location, const glm::ivec4* value, int count) {
+	_appliedVersion = 0;
 	glProgramUniform4iv(_handle, location, count, glm::value_ptr(*value));
 }
 
 void Shader::SetUniform(int location, const bool* value, int count) {
+	_appliedVersion = 0;
 	LOG_ASSERT(count == 1, "SetUniform for bools only supports setting single values at a time!");
 	glProgramUniform1i(location, *value, 1);
 }
 void Shader::SetUniform(int location, const glm::bvec2* value, int count) {
+	_appliedVersion = 0;
 	LOG_ASSERT(count == 1, "SetUniform for bools only supports setting single values at a time!");
 	glProgramUniform2i(location, value->x, value->y, 1);
 }
 void Shader::SetUniform(int location, const glm::bvec3* value, int count) {
+	_appliedVersion = 0;
 	LOG_ASSERT(count == 1, "SetUniform for bools only supports setting single values at a time!");
 	glProgramUniform3i(location, value->x, value->y, value->z, 1);
 }
 void Shader::SetUniform(int location, const glm::bvec4* value, int count) {
+	_appliedVersion = 0;
 	LOG_ASSERT(count == 1, "SetUniform for bools only supports setting single values at a time!");
 	glProgramUniform4i(location, value->x, value->y, value->z, value->w, 1);
 }
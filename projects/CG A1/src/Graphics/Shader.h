@@ -4,10 +4,25 @@
 
 #include <string>               // for std::string
 #include <unordered_map>        // for std::unordered_map
+#include <vector>               // for std::vector
 #include <GLM/glm.hpp>          // for our GLM types
 #include <GLM/gtc/type_ptr.hpp> // for glm::value_ptr
 #include "Logging.h"            // for the logging functions
 
+/// <summary>
+/// Describes a uniform in a linked shader program that is not part of a uniform block
+/// </summary>
+struct ShaderUniformInfo
+{
+	std::string Name;
+	// The GLSL type of the uniform, ex GL_FLOAT_VEC3 or GL_SAMPLER_2D
+	GLenum      Type;
+	int         Location;
+	int         ArraySize;
+	// For samplers, the texture slot that the sampler reads from, otherwise -1
+	int         TextureSlot;
+};
+
 /// <summary>
 /// This class will wrap around an OpenGL shader program
 /// </summary>
@@ -70,6 +85,28 @@ public:
 	/// Gets the underlying OpenGL handle that this class is wrapping
 	/// </summary>
 	GLuint GetHandle() const { return _handle; }
+
+	/// <summary>
+	/// Gets the uniforms that were found when the shader was linked, not including uniforms in blocks. Every sampler
+	/// is given it's own texture slot when the shader is linked, so textures only need to be bound to that slot
+	/// </summary>
+	const std::vector<ShaderUniformInfo>& GetUniforms() const { return _uniforms; }
+	/// <summary>
+	/// Finds a uniform by name, or returns nullptr if the shader does not have it (or it was optimized out)
+	/// </summary>
+	const ShaderUniformInfo* FindUniform(const std::string& name) const;
+
+	/// <summary>
+	/// Materials use this to tell if they were the last thing to set this shader's uniforms. Setting any uniform on
+	/// the shader directly resets it to 0
+	/// </summary>
+	uint64_t GetAppliedVersion() const { return _appliedVersion; }
+	void SetAppliedVersion(uint64_t version) { _appliedVersion = version; }
+
+	/// <summary>
+	/// The first texture slot given to samplers, slot 0 is left free for binding textures we are editing
+	/// </summary>
+	static constexpr int FIRST_TEXTURE_SLOT = 1;
 	
 public:
 	int GetUniformLocation(const std::string& name);
@@ -123,5 +160,10 @@ protected:
 	GLuint _handle;
 
 	std::unordered_map<std::string, int> _uniformLocs;
+	std::vector<ShaderUniformInfo> _uniforms;
+	uint64_t _appliedVersion;
+
+	// Reads the uniforms from the linked program, and sets up the sampler slots
+	void _Reflect();
 	
 };
\ No newline at end of file
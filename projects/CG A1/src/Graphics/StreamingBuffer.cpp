@@ -0,0 +1,43 @@
+#include "StreamingBuffer.h"
+#include <algorithm>
+#include "GLStateCache.h"
+#include "Logging.h"
+
+StreamingBuffer::StreamingBuffer(size_t regionSize) :
+	VertexBuffer(GL_STREAM_DRAW)
+{
+	// We draw from the stream's buffer, so we don't need the one that IBuffer made
+	GLStateCache::Instance().ForgetBuffer(_handle);
+	glDeleteBuffers(1, &_handle);
+
+	_stream = std::make_unique<TTK::StreamingBuffer>(regionSize);
+	_handle = _stream->GetHandle();
+	_Moved();
+}
+
+StreamingBuffer::~StreamingBuffer() {
+	// The stream owns the handle, so IBuffer shouldn't delete it
+	GLStateCache::Instance().ForgetBuffer(_handle);
+	_handle = 0;
+}
+
+GLuint StreamingBuffer::Write(const void* data, size_t elementSize, size_t elementCount) {
+	const size_t size = elementSize * elementCount;
+	// Aligning the data to a whole element can take up to another element's worth of the region
+	if (size + elementSize > _stream->GetRegionSize()) {
+		// Anything still drawing from the old buffer keeps it alive until it's done, and VAOs pick up the new one the
+		// next time they are bound
+		const size_t regionSize = std::max(_stream->GetRegionSize() * 2, size + elementSize);
+		LOG_INFO("Growing streaming buffer from {} to {} bytes per region", _stream->GetRegionSize(), regionSize);
+		GLStateCache::Instance().ForgetBuffer(_handle);
+		_stream = std::make_unique<TTK::StreamingBuffer>(regionSize);
+		_handle = _stream->GetHandle();
+		_Moved();
+	}
+
+	const size_t offset = _stream->Write(data, size, elementSize);
+	LOG_ASSERT(offset != SIZE_MAX, "Failed to write to streaming buffer!");
+	_elementSize = elementSize;
+	_elementCount = elementCount;
+	return static_cast<GLuint>(offset / elementSize);
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "VertexBuffer.h"
+#include <memory>
+#include <stdexcept>
+#include <TTK/StreamingBuffer.h>
+
+/// <summary>
+/// A vertex buffer for data that is re-written every frame, such as instance data. Uploads are copied straight in to
+/// persistently mapped memory (see TTK::StreamingBuffer), so they never wait for the GPU to finish drawing the last
+/// frame's data, unless the GPU falls more than two regions behind (see GetStats).
+///
+/// Each upload lands somewhere different in the buffer, so Write returns the element that the data starts at, which
+/// should be used as the first vertex or base instance when drawing. VAOs point at the start of the buffer, so they
+/// don't need to change between frames
+/// </summary>
+class StreamingBuffer : public VertexBuffer
+{
+public:
+	typedef std::shared_ptr<StreamingBuffer> sptr;
+	static inline sptr Create(size_t regionSize) {
+		return std::make_shared<StreamingBuffer>(regionSize);
+	}
+
+public:
+	/// <summary>
+	/// Creates a new streaming buffer
+	/// </summary>
+	/// <param name="regionSize">The size of each of the buffer's regions in bytes, the buffer grows if an upload is bigger than this</param>
+	StreamingBuffer(size_t regionSize);
+	~StreamingBuffer();
+
+	// Data doesn't stay where it's loaded, so we need the caller to use the element that Write returns
+	inline void LoadData(const void* data, size_t elementSize, size_t elementCount) override {
+		throw std::runtime_error("Must use Write, and draw from the element it returns");
+	}
+
+	/// <summary>
+	/// Copies data in to the buffer
+	/// </summary>
+	/// <param name="data">The data to copy</param>
+	/// <param name="elementSize">The size of a single element, in bytes</param>
+	/// <param name="elementCount">The number of elements to copy</param>
+	/// <returns>The index of the first element, counted from the start of the buffer</returns>
+	GLuint Write(const void* data, size_t elementSize, size_t elementCount);
+	/// <summary>
+	/// Copies an array of data in to the buffer
+	/// </summary>
+	/// <typeparam name="T">The type of data you are uploading</typeparam>
+	/// <param name="data">A pointer to the first element in the array</param>
+	/// <param name="count">The number of elements in the array to upload</param>
+	/// <returns>The index of the first element, counted from the start of the buffer</returns>
+	template <typename T>
+	GLuint Write(const T* data, size_t count) {
+		return Write(static_cast<const void*>(data), sizeof(T), count);
+	}
+
+	/// <summary>
+	/// Gets the counters for this buffer since it was created or last grew, see TTK::StreamingBuffer::GetTotalStats
+	/// for all the streaming buffers together
+	/// </summary>
+	const TTK::StreamingStats& GetStats() const { return _stream->GetStats(); }
+
+protected:
+	std::unique_ptr<TTK::StreamingBuffer> _stream;
+};
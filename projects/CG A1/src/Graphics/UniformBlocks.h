@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <GLM/glm.hpp>
+
+// The binding points for the uniform blocks shared by all our shaders, these must match the bindings in res/shaders
+static constexpr unsigned int FRAME_UNIFORM_BINDING = 0;
+static constexpr unsigned int LIGHT_UNIFORM_BINDING = 1;
+
+/// <summary>
+/// Mirrors the b_Frame block, the camera and timing uniforms that change once per frame. Laid out with std140
+/// </summary>
+struct FrameUniforms
+{
+	glm::mat4 View;
+	glm::mat4 Projection;
+	glm::mat4 ViewProjection;
+	// The projection times the rotation of the view, for drawing things that are infinitely far away
+	glm::mat4 SkyboxMatrix;
+	glm::vec3 CamPos;
+	// The time since the application started, in seconds
+	float     Time;
+	float     DeltaTime;
+	float     _padding[3];
+};
+
+/// <summary>
+/// Mirrors the b_Light block, the scene's light and ambient settings. Laid out with std140
+/// </summary>
+struct LightUniforms
+{
+	glm::vec3 LightPos;
+	float     LightAttenuationConstant;
+	glm::vec3 LightCol;
+	float     LightAttenuationLinear;
+	glm::vec3 AmbientCol;
+	float     LightAttenuationQuadratic;
+	float     AmbientLightStrength;
+	float     SpecularLightStrength;
+	float     AmbientStrength;
+	// Toggles for each part of the lighting, 1 for on and 0 for off
+	int       DiffuseFactor;
+	int       AmbientFactor;
+	int       SpecularFactor;
+	int       ToonFactor;
+	float     _padding;
+};
+
+// std140 puts every vec3 and mat4 on a 16 byte boundary, and our floats sit in the space after the vec3s
+static_assert(offsetof(FrameUniforms, CamPos) == 256 && offsetof(FrameUniforms, Time) == 268 && sizeof(FrameUniforms) == 288, "FrameUniforms does not match the std140 layout of b_Frame!");
+static_assert(offsetof(LightUniforms, AmbientCol) == 32 && offsetof(LightUniforms, ToonFactor) == 72 && sizeof(LightUniforms) == 80, "LightUniforms does not match the std140 layout of b_Light!");
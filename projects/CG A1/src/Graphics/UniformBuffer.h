@@ -0,0 +1,108 @@
+#pragma once
+#include "IBuffer.h"
+#include "GLStateCache.h"
+#include <algorithm>
+#include <memory>
+#include <TTK/StreamingBuffer.h>
+#include "Logging.h"
+
+/// <summary>
+/// A uniform buffer holds a block of uniforms that can be shared by every shader that declares the same block, ex:
+///     layout(std140, binding = 0) uniform b_Frame { ... };
+/// The block is bound to it's binding point once, so switching shaders doesn't need to upload anything. T must be
+/// laid out to match the block with the std140 rules (vec3s and vec4s are 16 byte aligned, mat3s are 3 vec4s, and
+/// arrays have a 16 byte stride)
+///
+/// Each update is copied in to the next free range of a persistently mapped buffer (see TTK::StreamingBuffer), and that
+/// range is bound instead of the whole buffer. This way we never write over a block that the GPU is still reading from
+/// the frames before
+/// </summary>
+/// <typeparam name="T">The structure that mirrors the uniform block</typeparam>
+template <typename T>
+class UniformBuffer : public IBuffer
+{
+public:
+	typedef std::shared_ptr<UniformBuffer<T>> sptr;
+	static inline sptr Create(GLuint binding) {
+		return std::make_shared<UniformBuffer<T>>(binding);
+	}
+
+public:
+	/// <summary>
+	/// The number of updates that fit in each region of the stream, the GPU has to fall this many updates behind
+	/// before an update can wait on it
+	/// </summary>
+	static constexpr size_t UPDATES_PER_REGION = 16;
+
+	/// <summary>
+	/// The values that will be sent to the GPU on the next call to Update
+	/// </summary>
+	T Data;
+
+	/// <summary>
+	/// Creates a new uniform buffer with room for one T, and binds it to a binding point
+	/// </summary>
+	/// <param name="binding">The binding point, this should match the binding of the block in the shaders</param>
+	UniformBuffer(GLuint binding) :
+		IBuffer(GL_UNIFORM_BUFFER, GL_STREAM_DRAW), Data(), _binding(binding), _alignment(1), _current(0)
+	{
+		// We bind ranges of the stream's buffer, so we don't need the one that IBuffer made
+		GLStateCache::Instance().ForgetBuffer(_handle);
+		glDeleteBuffers(1, &_handle);
+
+		// Ranges have to start on a multiple of the uniform buffer offset alignment, which is usually 256 bytes
+		GLint alignment = 0;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		_alignment = std::max<size_t>(alignment, 1);
+		const size_t stride = (sizeof(T) + _alignment - 1) / _alignment * _alignment;
+
+		_stream = std::make_unique<TTK::StreamingBuffer>(stride * UPDATES_PER_REGION);
+		_handle = _stream->GetHandle();
+		_elementSize = sizeof(T);
+		_elementCount = 1;
+		_Moved();
+		Update();
+	}
+
+	~UniformBuffer() {
+		// The stream owns the handle, so IBuffer shouldn't delete it
+		GLStateCache::Instance().ForgetBuffer(_handle);
+		_handle = 0;
+	}
+
+	// We'll override the LoadData so the buffer always holds exactly one block
+	inline void LoadData(const void* data, size_t elementSize, size_t elementCount) override {
+		LOG_ASSERT(elementSize * elementCount == sizeof(T), "Uniform buffers can only hold one block!");
+		Data = *static_cast<const T*>(data);
+		Update();
+	}
+
+	/// <summary>
+	/// Sends Data to the GPU, and binds the range that it was copied to
+	/// </summary>
+	void Update() {
+		const size_t offset = _stream->Write(&Data, sizeof(T), _alignment);
+		LOG_ASSERT(offset != SIZE_MAX, "Failed to stream uniform block!");
+		_current = offset;
+		Bind();
+	}
+
+	/// <summary>
+	/// Binds the last update to this buffer's binding point. This only needs to be called again if something else was
+	/// bound there
+	/// </summary>
+	void Bind() override {
+		GLStateCache::Instance().BindBufferRange(GL_UNIFORM_BUFFER, _binding, _handle, _current, sizeof(T));
+	}
+
+	/// <summary>
+	/// Returns the binding point of the block that this buffer feeds
+	/// </summary>
+	GLuint GetBinding() const { return _binding; }
+
+protected:
+	GLuint _binding;
+	size_t _alignment; // The alignment of each update in the stream
+	size_t _current;   // The offset of the last update in the stream
+	std::unique_ptr<TTK::StreamingBuffer> _stream;
+};
@@ -1,19 +1,49 @@
 #include "VertexArrayObject.h"
+#include "GLStateCache.h"
 #include "IndexBuffer.h"
+#include "IndirectBuffer.h"
 #include "Logging.h"
 #include "VertexBuffer.h"
+#include <atomic>
+
+// Meshes can be made from any thread (ex when loading)
+static std::atomic<uint32_t> NextSortId(1);
 
 VertexArrayObject::VertexArrayObject() :
 	_indexBuffer(nullptr),
+	_indexPlacement(0),
+	_syncedGeneration(0),
+	_source(nullptr),
+	_firstIndex(0),
+	_indexCount(0),
+	_baseVertex(0),
 	_handle(0),
 	_vertexCount(0)
 {
+	_sortId = NextSortId++;
 	glCreateVertexArrays(1, &_handle);
 }
 
+VertexArrayObject::VertexArrayObject(const sptr& source, GLuint firstIndex, GLsizei indexCount, GLint baseVertex) :
+	_indexBuffer(nullptr),
+	_indexPlacement(0),
+	_syncedGeneration(0),
+	_source(source->GetSource() == source.get() ? source : source->_source),
+	_firstIndex(firstIndex),
+	_indexCount(indexCount),
+	_baseVertex(baseVertex),
+	_handle(source->GetHandle()),
+	_vertexCount(0)
+{
+	LOG_ASSERT(_source->_indexBuffer != nullptr, "Ranges can only be made from VAOs with an index buffer!");
+	_sortId = NextSortId++;
+}
+
 VertexArrayObject::~VertexArrayObject()
 {
-	if (_handle != 0) {
+	// Ranges share their source's handle, so only the source deletes it
+	if (_handle != 0 && _source == nullptr) {
+		GLStateCache::Instance().ForgetVertexArray(_handle);
 		glDeleteVertexArrays(1, &_handle);
 		_handle = 0;
 	}
@@ -24,15 +54,21 @@ void VertexArrayObject::SetDebugName(const std::string& name) {
 }
 
 void VertexArrayObject::SetIndexBuffer(const IndexBuffer::sptr& ibo) {
+	LOG_ASSERT(_source == nullptr, "Can't change the buffers of a range, change it's source instead!");
 	_indexBuffer = ibo;
 	Bind();
-	if (_indexBuffer != nullptr) _indexBuffer->Bind();
-	else IndexBuffer::UnBind();
+	if (_indexBuffer != nullptr) {
+		_indexBuffer->Bind();
+		_indexPlacement = _indexBuffer->GetPlacementVersion();
+	} else {
+		IndexBuffer::UnBind();
+	}
 	UnBind();
 }
 
 void VertexArrayObject::AddVertexBuffer(const VertexBuffer::sptr& buffer, const std::vector<BufferAttribute>& attributes)
 {
+	LOG_ASSERT(_source == nullptr, "Can't change the buffers of a range, change it's source instead!");
 	if (_vertexCount == 0) {
 		_vertexCount = buffer->GetElementCount();
 	} else {
@@ -41,32 +77,142 @@ void VertexArrayObject::AddVertexBuffer(const VertexBuffer::sptr& buffer, const
 	VertexBufferBinding binding;
 	binding.Buffer = buffer;
 	binding.Attributes = attributes;
+	binding.Divisor = 0;
+	binding.Placement = 0;
+
+	// Bind before adding the binding, so that it isn't caught up in syncing the existing ones
+	Bind();
 	_vertexBuffers.push_back(binding);
+	for (const BufferAttribute& attrib : attributes) {
+		glEnableVertexArrayAttrib(_handle, attrib.Slot);
+	}
+	_ApplyBinding(_vertexBuffers.back());
+	UnBind();
+
+}
 
+void VertexArrayObject::AddInstanceBuffer(const VertexBuffer::sptr& buffer, const std::vector<BufferAttribute>& attributes, GLuint divisor)
+{
+	LOG_ASSERT(divisor > 0, "Instance buffers must have a divisor of at least 1!");
+	// Instance buffers are shared by every range of a VAO
+	if (_source != nullptr) {
+		_source->AddInstanceBuffer(buffer, attributes, divisor);
+		return;
+	}
+	VertexBufferBinding binding;
+	binding.Buffer = buffer;
+	binding.Attributes = attributes;
+	binding.Divisor = divisor;
+	binding.Placement = 0;
+
+	// Bind before adding the binding, so that it isn't caught up in syncing the existing ones
 	Bind();
-	buffer->Bind();
+	_vertexBuffers.push_back(binding);
 	for (const BufferAttribute& attrib : attributes) {
 		glEnableVertexArrayAttrib(_handle, attrib.Slot);
-		glVertexAttribPointer(attrib.Slot, attrib.Size, attrib.Type, attrib.Normalized, attrib.Stride, (void*)attrib.Offset);
+		glVertexAttribDivisor(attrib.Slot, divisor);
 	}
+	_ApplyBinding(_vertexBuffers.back());
 	UnBind();
+}
+
+void VertexArrayObject::_ApplyBinding(const VertexBufferBinding& binding) const {
+	binding.Buffer->Bind();
+	// Sub-allocated buffers start part way through their OpenGL buffer
+	const size_t base = binding.Buffer->GetOffset();
+	for (const BufferAttribute& attrib : binding.Attributes) {
+		glVertexAttribPointer(attrib.Slot, attrib.Size, attrib.Type, attrib.Normalized, attrib.Stride, (void*)(base + attrib.Offset));
+	}
+	binding.Placement = binding.Buffer->GetPlacementVersion();
+}
 
+void VertexArrayObject::_Sync() const {
+	GLStateCache::Instance().BindVertexArray(_handle);
+	for (const VertexBufferBinding& binding : _vertexBuffers) {
+		if (binding.Placement != binding.Buffer->GetPlacementVersion()) {
+			_ApplyBinding(binding);
+		}
+	}
+	if (_indexBuffer != nullptr && _indexPlacement != _indexBuffer->GetPlacementVersion()) {
+		_indexBuffer->Bind();
+		_indexPlacement = _indexBuffer->GetPlacementVersion();
+	}
+	_syncedGeneration = IBuffer::GetPlacementGeneration();
+}
+
+bool VertexArrayObject::HasBuffer(const VertexBuffer::sptr& buffer) const {
+	for (const VertexBufferBinding& binding : GetSource()->_vertexBuffers) {
+		if (binding.Buffer == buffer) {
+			return true;
+		}
+	}
+	return false;
 }
 
 void VertexArrayObject::Bind() const {
-	glBindVertexArray(_handle);
+	// Ranges share their source's attributes, so the source is the one that needs to keep up with it's buffers
+	const VertexArrayObject* source = GetSource();
+	if (source->_syncedGeneration != IBuffer::GetPlacementGeneration()) {
+		source->_Sync();
+	}
+	GLStateCache::Instance().BindVertexArray(_handle);
 }
 
 void VertexArrayObject::UnBind() {
-	glBindVertexArray(0);
+	GLStateCache::Instance().BindVertexArray(0);
+}
+
+GLsizei VertexArrayObject::GetIndexCount() const {
+	if (_source != nullptr) {
+		return _indexCount;
+	}
+	return _indexBuffer != nullptr ? _indexBuffer->GetElementCount() : 0;
+}
+
+GLuint VertexArrayObject::GetFirstIndex() const {
+	const IndexBuffer::sptr& indices = GetIndexBuffer();
+	if (indices == nullptr) {
+		return 0;
+	}
+	// Allocations are aligned to BufferAllocator::MIN_BLOCK_SIZE, so the offset is always a whole number of indices
+	return _firstIndex + static_cast<GLuint>(indices->GetOffset() / indices->GetElementSize());
+}
+
+// Gets the byte offset of an index in an index buffer's OpenGL buffer
+static const void* GetIndexOffset(const IndexBuffer::sptr& buffer, GLuint index) {
+	return reinterpret_cast<const void*>(buffer->GetOffset() + static_cast<size_t>(index) * buffer->GetElementSize());
 }
 
 void VertexArrayObject::Render() const {
 	Bind();
-	if (_indexBuffer != nullptr) {
-		glDrawElements(GL_TRIANGLES, _indexBuffer->GetElementCount(), _indexBuffer->GetElementType(), nullptr);
+	if (_source != nullptr) {
+		const IndexBuffer::sptr& indices = _source->_indexBuffer;
+		glDrawElementsBaseVertex(GL_TRIANGLES, _indexCount, indices->GetElementType(), GetIndexOffset(indices, _firstIndex), _baseVertex);
+	} else if (_indexBuffer != nullptr) {
+		glDrawElements(GL_TRIANGLES, _indexBuffer->GetElementCount(), _indexBuffer->GetElementType(), GetIndexOffset(_indexBuffer, 0));
 	} else {
 		glDrawArrays(GL_TRIANGLES, 0, _vertexCount / 3);
 	}
-	UnBind();
+}
+
+void VertexArrayObject::RenderInstanced(GLsizei instanceCount, GLuint baseInstance) const {
+	Bind();
+	if (_source != nullptr) {
+		const IndexBuffer::sptr& indices = _source->_indexBuffer;
+		glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, _indexCount, indices->GetElementType(), GetIndexOffset(indices, _firstIndex),
+			instanceCount, _baseVertex, baseInstance);
+	} else if (_indexBuffer != nullptr) {
+		glDrawElementsInstancedBaseInstance(GL_TRIANGLES, _indexBuffer->GetElementCount(), _indexBuffer->GetElementType(), GetIndexOffset(_indexBuffer, 0),
+			instanceCount, baseInstance);
+	} else {
+		glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, _vertexCount / 3, instanceCount, baseInstance);
+	}
+}
+
+void VertexArrayObject::RenderIndirect(GLsizei commandCount, GLuint firstCommand) const {
+	const IndexBuffer::sptr& indices = GetIndexBuffer();
+	LOG_ASSERT(indices != nullptr, "Indirect draws need an index buffer!");
+	Bind();
+	glMultiDrawElementsIndirect(GL_TRIANGLES, indices->GetElementType(),
+		reinterpret_cast<const void*>(static_cast<size_t>(firstCommand) * sizeof(DrawElementsIndirectCommand)), commandCount, 0);
 }
@@ -6,6 +6,7 @@
 
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
+#include "Utilities/BoundingVolumes.h"
 
 /// <summary>
 /// We'll use this just to make it more clear what the intended usage of an attribute is in our code!
@@ -93,6 +94,15 @@ public:
 	/// Creates a new empty Vertex Array Object
 	/// </summary>
 	VertexArrayObject();
+	/// <summary>
+	/// Creates a mesh that draws a range of another VAO's index buffer, sharing it's buffers and OpenGL handle. This is
+	/// how meshes in a GeometryArena are represented, so that they can be drawn together with glMultiDrawElementsIndirect
+	/// </summary>
+	/// <param name="source">The VAO that holds the vertex and index buffers, must have an index buffer</param>
+	/// <param name="firstIndex">The first index in the source's index buffer to draw</param>
+	/// <param name="indexCount">The number of indices to draw</param>
+	/// <param name="baseVertex">The value that is added to each index before reading the vertex buffers</param>
+	VertexArrayObject(const sptr& source, GLuint firstIndex, GLsizei indexCount, GLint baseVertex);
 	// Destructor does not need to be virtual due to the use of the final keyword
 	~VertexArrayObject();
 
@@ -113,9 +123,22 @@ public:
 	/// <param name="buffer">The buffer to add (note, does not take ownership, you will still need to delete later)</param>
 	/// <param name="attributes">A list of vertex attributes that will be fed by this buffer</param>
 	void AddVertexBuffer(const VertexBuffer::sptr& buffer, const std::vector<BufferAttribute>& attributes);
+	/// <summary>
+	/// Adds a buffer of per-instance data to this VAO. The attributes advance once every divisor instances instead of
+	/// once per vertex, and the buffer may have any number of elements
+	/// </summary>
+	/// <param name="buffer">The buffer to add (note, does not take ownership, you will still need to delete later)</param>
+	/// <param name="attributes">A list of vertex attributes that will be fed by this buffer</param>
+	/// <param name="divisor">The number of instances that share each element, must be at least 1</param>
+	void AddInstanceBuffer(const VertexBuffer::sptr& buffer, const std::vector<BufferAttribute>& attributes, GLuint divisor = 1);
+	/// <summary>
+	/// Returns true if the buffer has been added to this VAO, either as a vertex or an instance buffer
+	/// </summary>
+	bool HasBuffer(const VertexBuffer::sptr& buffer) const;
 
 	/// <summary>
-	/// Binds this VAO as the source of data for draw operations
+	/// Binds this VAO as the source of data for draw operations. If any of it's buffers have moved (see
+	/// IBuffer::GetPlacementVersion), the attributes are pointed at their new location first
 	/// </summary>
 	void Bind() const;
 	/// <summary>
@@ -127,8 +150,70 @@ public:
 	/// Returns the underlying OpenGL handle that this class is wrapping around
 	/// </summary>
 	GLuint GetHandle() const { return _handle; }
+	/// <summary>
+	/// Gets a small number that is unique to this mesh, used to build render sort keys. Meshes that share a handle
+	/// (see IsRange) still get their own IDs
+	/// </summary>
+	uint32_t GetSortId() const { return _sortId; }
+
+	/// <summary>
+	/// Returns true if this mesh is a range of another VAO, see the range constructor
+	/// </summary>
+	bool IsRange() const { return _source != nullptr; }
+	/// <summary>
+	/// Gets the VAO that holds this mesh's buffers, this is the VAO itself unless it is a range
+	/// </summary>
+	VertexArrayObject* GetSource() { return _source != nullptr ? _source.get() : this; }
+	const VertexArrayObject* GetSource() const { return _source != nullptr ? _source.get() : this; }
+	/// <summary>
+	/// Gets the index buffer that this mesh draws from, which is it's source's if it is a range
+	/// </summary>
+	const IndexBuffer::sptr& GetIndexBuffer() const { return GetSource()->_indexBuffer; }
+	/// <summary>
+	/// Gets the first index that this mesh draws, counted from the start of the index buffer's OpenGL buffer (which is
+	/// not the start of the IndexBuffer if it is sub-allocated)
+	/// </summary>
+	GLuint  GetFirstIndex() const;
+	/// <summary>
+	/// Gets the number of indices that this mesh draws, or 0 if it has no index buffer
+	/// </summary>
+	GLsizei GetIndexCount() const;
+	GLint   GetBaseVertex() const { return _baseVertex; }
+
+	/// <summary>
+	/// Sets the bounds of the mesh in model space, these are used for culling and spatial queries. MeshBuilder sets
+	/// these when baking, so this only needs to be called for meshes that are built by hand
+	/// </summary>
+	/// <param name="bounds">The box around all the vertices</param>
+	/// <param name="sphere">The sphere around all the vertices</param>
+	void SetBounds(const AABB& bounds, const BoundingSphere& sphere) { _bounds = bounds; _boundingSphere = sphere; }
+	/// <summary>
+	/// Sets the bounds of the mesh in model space, using the sphere around the box as the bounding sphere
+	/// </summary>
+	void SetBounds(const AABB& bounds) { SetBounds(bounds, BoundingSphere::FromAABB(bounds)); }
+	/// <summary>
+	/// Gets the model space box around the mesh, this is empty (see AABB::IsValid) if the bounds were never set
+	/// </summary>
+	const AABB& GetBounds() const { return _bounds; }
+	/// <summary>
+	/// Gets the model space sphere around the mesh, only valid if GetBounds is
+	/// </summary>
+	const BoundingSphere& GetBoundingSphere() const { return _boundingSphere; }
 
 	void Render() const;
+	/// <summary>
+	/// Draws several instances of this mesh in one draw call
+	/// </summary>
+	/// <param name="instanceCount">The number of instances to draw</param>
+	/// <param name="baseInstance">The element to start reading instance buffers from</param>
+	void RenderInstanced(GLsizei instanceCount, GLuint baseInstance = 0) const;
+	/// <summary>
+	/// Draws with glMultiDrawElementsIndirect, reading commands from the indirect buffer that is currently bound. The
+	/// commands select ranges of this VAO's index buffer
+	/// </summary>
+	/// <param name="commandCount">The number of commands to draw</param>
+	/// <param name="firstCommand">The index of the first command in the indirect buffer</param>
+	void RenderIndirect(GLsizei commandCount, GLuint firstCommand = 0) const;
 	
 protected:
 	// Helper structure to store a buffer and the attributes
@@ -136,15 +221,40 @@ protected:
 	{
 		VertexBuffer::sptr Buffer;
 		std::vector<BufferAttribute> Attributes;
+		// 0 for per-vertex data, otherwise the number of instances that share each element
+		GLuint Divisor;
+		// The placement version of the buffer when the attributes were last pointed at it
+		mutable uint64_t Placement;
 	};
 	
 	// The index buffer bound to this VAO
 	IndexBuffer::sptr _indexBuffer;
 	// The vertex buffers bound to this VAO
 	std::vector<VertexBufferBinding> _vertexBuffers;
+	// The placement version of the index buffer when it was last bound to the VAO
+	mutable uint64_t _indexPlacement;
+	// The placement generation when we last checked our buffers, we don't need to check again until it changes
+	mutable uint64_t _syncedGeneration;
 
 	GLsizei _vertexCount;
+
+	// Model space bounds, for culling
+	AABB           _bounds;
+	BoundingSphere _boundingSphere;
 	
+	// The VAO that this is a range of, or nullptr if this VAO owns it's handle
+	sptr    _source;
+	GLuint  _firstIndex;
+	GLsizei _indexCount;
+	GLint   _baseVertex;
+
+	uint32_t _sortId;
+
+	// Points the attributes and index buffer at any buffers that have moved
+	void _Sync() const;
+	// Points the attributes fed by a binding at it's buffer, the VAO must be bound
+	void _ApplyBinding(const VertexBufferBinding& binding) const;
+
 	// The underlying OpenGL handle that this class is wrapping around
 	GLuint _handle;
 };
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+
+/// <summary>
+/// In-engine micro benchmarks, these are hooked up to the debug window so that they can be run on the
+/// target hardware with a real build. All results are written to the log
+/// </summary>
+class Benchmarks
+{
+public:
+	/// <summary>
+	/// Runs a function a number of times, and returns the average time taken in milliseconds
+	/// </summary>
+	/// <param name="iterations">The number of times to run the function</param>
+	/// <param name="func">The function to measure</param>
+	static double Measure(int iterations, const std::function<void()>& func);
+
+	/// <summary>
+	/// Compares the world matrix update for a scene of transforms using the original per-object path
+	/// (one ~250 byte transform, glm matrix products and a full inverse for every normal matrix) against
+	/// the TransformHierarchy and it's batched kernel
+	/// </summary>
+	/// <param name="count">The number of transforms to create</param>
+	/// <param name="iterations">The number of times to run each path</param>
+	static void TransformUpdate(size_t count = 10000, int iterations = 100);
+
+	/// <summary>
+	/// Compares spawning and despawning a burst of prefab instances every frame using CreateEntity, InstantiateBatch,
+	/// and an EntityPool
+	/// </summary>
+	/// <param name="count">The number of instances to spawn each frame</param>
+	/// <param name="iterations">The number of frames to simulate for each method</param>
+	static void PrefabSpawn(size_t count = 10000, int iterations = 20);
+
+	/// <summary>
+	/// Measures saving and loading a scene snapshot of a large scene, and reports the compressed and uncompressed sizes
+	/// </summary>
+	/// <param name="count">The number of entities in the scene</param>
+	/// <param name="iterations">The number of times to save and load</param>
+	static void SceneSnapshots(size_t count = 50000, int iterations = 10);
+
+	/// <summary>
+	/// Compares sphere and ray queries against a scan of every WorldBounds in the registry with the same queries
+	/// against the SpatialIndex, and measures the cost of keeping the index up to date as objects move
+	/// </summary>
+	/// <param name="count">The number of entities in the scene</param>
+	/// <param name="queries">The number of queries of each kind to run</param>
+	/// <param name="iterations">The number of times to run each test</param>
+	static void SpatialQueries(size_t count = 50000, size_t queries = 1000, int iterations = 10);
+
+	/// <summary>
+	/// Compares frustum culling a scene of renderers one sphere at a time against the FrustumCuller's SIMD tests, both
+	/// on the calling thread and split across the job system
+	/// </summary>
+	/// <param name="count">The number of renderers in the scene</param>
+	/// <param name="iterations">The number of times to cull the scene with each method</param>
+	static void FrustumCulling(size_t count = 100000, int iterations = 50);
+
+	/// <summary>
+	/// Measures the OcclusionCuller with a grid of props, most of which are hidden behind a large wall. Reports the
+	/// time taken to rasterize the occluders and to test the props, and checks that no visible prop is culled
+	/// </summary>
+	/// <param name="count">The number of props in the scene</param>
+	/// <param name="iterations">The number of times to cull the scene</param>
+	static void OcclusionCulling(size_t count = 20000, int iterations = 50);
+
+	/// <summary>
+	/// Compares sorting a scene of renderers with a comparator that reads through their materials (the way the
+	/// render group used to be sorted) against the RenderSorter's radix sort, and measures the RenderSorter when
+	/// nothing has changed and when a few renderers change material each frame
+	/// </summary>
+	/// <param name="count">The number of renderers in the scene</param>
+	/// <param name="iterations">The number of times to sort the scene with each method</param>
+	static void RenderSort(size_t count = 50000, int iterations = 50);
+
+	/// <summary>
+	/// Measures setting an animated parameter on a set of materials by name and through a ShaderParamHandle, and
+	/// applying the materials when their values have changed and when they have not. Needs a GL context, since the
+	/// materials are laid out against a real shader
+	/// </summary>
+	/// <param name="count">The number of materials</param>
+	/// <param name="iterations">The number of times to run each test</param>
+	static void MaterialParams(size_t count = 1000, int iterations = 100);
+
+	/// <summary>
+	/// Records component changes for a set of sources from two threads over two passes, with the threads swapping
+	/// command buffers between runs, and checks that replay gives the same result either way. Reports the time taken
+	/// to record and replay
+	/// </summary>
+	/// <param name="count">The number of source entities</param>
+	/// <param name="iterations">The number of times to record and replay</param>
+	static void CommandReplay(size_t count = 10000, int iterations = 20);
+
+	/// <summary>
+	/// Measures drawing a mix of debug spheres and cubes through TTK::Graphics, flushing after every call (one draw
+	/// per primitive, like the old immediate path) against queueing them all and flushing once at the end of the frame.
+	/// Needs a GL context, and waits for the GPU to finish so that the driver's work is included
+	/// </summary>
+	/// <param name="count">The number of primitives to draw each frame</param>
+	/// <param name="iterations">The number of frames to draw with each method</param>
+	static void DebugPrimitives(size_t count = 10000, int iterations = 20);
+};
@@ -0,0 +1,80 @@
+#include "BoundingVolumes.h"
+
+#include <algorithm>
+
+AABB AABB::Transformed(const glm::mat4& matrix) const {
+	if (!IsValid()) {
+		return *this;
+	}
+	// Transform the center as a point, and project the extents onto each world axis (Arvo's method)
+	const glm::vec3 center = glm::vec3(matrix * glm::vec4(Center(), 1.0f));
+	const glm::vec3 extents = Extents();
+	const glm::vec3 worldExtents =
+		glm::abs(glm::vec3(matrix[0])) * extents.x +
+		glm::abs(glm::vec3(matrix[1])) * extents.y +
+		glm::abs(glm::vec3(matrix[2])) * extents.z;
+	return FromCenterExtents(center, worldExtents);
+}
+
+bool BoundingSphere::Intersects(const AABB& box) const {
+	const glm::vec3 closest = glm::clamp(Center, box.Min, box.Max);
+	const glm::vec3 delta = closest - Center;
+	return glm::dot(delta, delta) <= Radius * Radius;
+}
+
+bool Ray::Intersects(const AABB& box, float maxDistance, float& distance) const {
+	// Slab test, an axis aligned direction gives an infinite inverse, which the min/max handle correctly
+	const glm::vec3 inverse = 1.0f / Direction;
+	const glm::vec3 t0 = (box.Min - Origin) * inverse;
+	const glm::vec3 t1 = (box.Max - Origin) * inverse;
+	const glm::vec3 tNear = glm::min(t0, t1);
+	const glm::vec3 tFar = glm::max(t0, t1);
+	const float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+	const float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+	distance = enter;
+	return enter <= exit;
+}
+
+Frustum Frustum::FromMatrix(const glm::mat4& viewProjection) {
+	// Gribb/Hartmann plane extraction, GLM is column major so we have to pull the rows out ourselves
+	const glm::mat4 m = glm::transpose(viewProjection);
+	Frustum result;
+	result.Planes[0] = m[3] + m[0];
+	result.Planes[1] = m[3] - m[0];
+	result.Planes[2] = m[3] + m[1];
+	result.Planes[3] = m[3] - m[1];
+	result.Planes[4] = m[3] + m[2];
+	result.Planes[5] = m[3] - m[2];
+	for (glm::vec4& plane : result.Planes) {
+		plane /= glm::length(glm::vec3(plane));
+	}
+	return result;
+}
+
+Frustum::Result Frustum::Classify(const AABB& box) const {
+	const glm::vec3 center = box.Center();
+	const glm::vec3 extents = box.Extents();
+	Result result = Result::Inside;
+	for (const glm::vec4& plane : Planes) {
+		const glm::vec3 normal = glm::vec3(plane);
+		// Distance from the plane to the center, and the box's projected radius along the normal
+		const float distance = glm::dot(normal, center) + plane.w;
+		const float radius = glm::dot(glm::abs(normal), extents);
+		if (distance + radius < 0.0f) {
+			return Result::Outside;
+		}
+		if (distance - radius < 0.0f) {
+			result = Result::Intersects;
+		}
+	}
+	return result;
+}
+
+bool Frustum::Intersects(const BoundingSphere& sphere) const {
+	for (const glm::vec4& plane : Planes) {
+		if (glm::dot(glm::vec3(plane), sphere.Center) + plane.w < -sphere.Radius) {
+			return false;
+		}
+	}
+	return true;
+}
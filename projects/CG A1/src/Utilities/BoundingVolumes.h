@@ -0,0 +1,142 @@
+#pragma once
+#include <limits>
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// An axis aligned bounding box. A default constructed box is empty (min is +infinity and max is -infinity), so
+/// that expanding it by a point or merging another box into it gives the right result
+/// </summary>
+struct AABB
+{
+	glm::vec3 Min = glm::vec3(std::numeric_limits<float>::infinity());
+	glm::vec3 Max = glm::vec3(-std::numeric_limits<float>::infinity());
+
+	AABB() = default;
+	AABB(const glm::vec3& min, const glm::vec3& max) : Min(min), Max(max) {}
+
+	/// <summary>
+	/// Creates a box from it's center and half size
+	/// </summary>
+	static AABB FromCenterExtents(const glm::vec3& center, const glm::vec3& extents) { return AABB(center - extents, center + extents); }
+
+	/// <summary>
+	/// Returns true if the box contains at least one point
+	/// </summary>
+	bool IsValid() const { return Min.x <= Max.x && Min.y <= Max.y && Min.z <= Max.z; }
+	glm::vec3 Center() const { return (Min + Max) * 0.5f; }
+	/// <summary>
+	/// Gets the half size of the box
+	/// </summary>
+	glm::vec3 Extents() const { return (Max - Min) * 0.5f; }
+	/// <summary>
+	/// Gets the surface area of the box, this is the cost metric used to build bounding volume trees
+	/// </summary>
+	float SurfaceArea() const {
+		const glm::vec3 size = Max - Min;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	/// <summary>
+	/// Grows the box to include a point
+	/// </summary>
+	void Expand(const glm::vec3& point) {
+		Min = glm::min(Min, point);
+		Max = glm::max(Max, point);
+	}
+	/// <summary>
+	/// Grows the box by a margin on every side
+	/// </summary>
+	AABB Inflated(float margin) const { return AABB(Min - glm::vec3(margin), Max + glm::vec3(margin)); }
+
+	bool Contains(const glm::vec3& point) const {
+		return glm::all(glm::greaterThanEqual(point, Min)) && glm::all(glm::lessThanEqual(point, Max));
+	}
+	bool Contains(const AABB& other) const {
+		return glm::all(glm::lessThanEqual(Min, other.Min)) && glm::all(glm::greaterThanEqual(Max, other.Max));
+	}
+	bool Intersects(const AABB& other) const {
+		return glm::all(glm::lessThanEqual(Min, other.Max)) && glm::all(glm::greaterThanEqual(Max, other.Min));
+	}
+
+	/// <summary>
+	/// Gets the box that encloses this box after it has been transformed by a matrix. This is the tight box around
+	/// the transformed corners, but is computed without visiting each corner
+	/// </summary>
+	AABB Transformed(const glm::mat4& matrix) const;
+
+	/// <summary>
+	/// Gets the smallest box that contains both boxes
+	/// </summary>
+	static AABB Merge(const AABB& a, const AABB& b) { return AABB(glm::min(a.Min, b.Min), glm::max(a.Max, b.Max)); }
+};
+
+/// <summary>
+/// A sphere, used for radius queries and cheap visibility tests
+/// </summary>
+struct BoundingSphere
+{
+	glm::vec3 Center = glm::vec3(0.0f);
+	float     Radius = 0.0f;
+
+	BoundingSphere() = default;
+	BoundingSphere(const glm::vec3& center, float radius) : Center(center), Radius(radius) {}
+
+	/// <summary>
+	/// Gets the sphere that encloses a box
+	/// </summary>
+	static BoundingSphere FromAABB(const AABB& box) { return BoundingSphere(box.Center(), glm::length(box.Extents())); }
+
+	bool Intersects(const AABB& box) const;
+};
+
+/// <summary>
+/// A half-line, used for picking and line of sight checks
+/// </summary>
+struct Ray
+{
+	glm::vec3 Origin    = glm::vec3(0.0f);
+	// Should be normalized, so that hit distances are in world units
+	glm::vec3 Direction = glm::vec3(0.0f, 0.0f, -1.0f);
+
+	Ray() = default;
+	Ray(const glm::vec3& origin, const glm::vec3& direction) : Origin(origin), Direction(direction) {}
+
+	/// <summary>
+	/// Tests the ray against a box
+	/// </summary>
+	/// <param name="box">The box to test against</param>
+	/// <param name="maxDistance">The length of the ray</param>
+	/// <param name="distance">Receives the distance along the ray to where it enters the box, or 0 if it starts inside</param>
+	/// <returns>True if the ray hits the box within maxDistance</returns>
+	bool Intersects(const AABB& box, float maxDistance, float& distance) const;
+};
+
+/// <summary>
+/// A view frustum, stored as 6 inward facing planes (xyz is the normal, w is the distance), so that a point p is
+/// inside a plane when dot(plane.xyz, p) + plane.w >= 0
+/// </summary>
+struct Frustum
+{
+	enum class Result {
+		Outside,
+		Intersects,
+		Inside
+	};
+
+	// Left, right, bottom, top, near, far
+	glm::vec4 Planes[6];
+
+	/// <summary>
+	/// Extracts the planes of a frustum from a view projection matrix (ex Camera::GetViewProjection), the planes are
+	/// in the space that the matrix transforms from (world space for a view projection)
+	/// </summary>
+	static Frustum FromMatrix(const glm::mat4& viewProjection);
+
+	/// <summary>
+	/// Tests whether a box is inside, outside, or straddling the frustum. Boxes near the corners of the frustum may
+	/// be reported as intersecting when they are outside, which is fine for culling
+	/// </summary>
+	Result Classify(const AABB& box) const;
+	bool Intersects(const AABB& box) const { return Classify(box) != Result::Outside; }
+	bool Intersects(const BoundingSphere& sphere) const;
+};
@@ -0,0 +1,255 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include "Logging.h"
+
+// The index of the job system thread that is running on, -1 if not owned by the job system
+thread_local int t_threadIndex = -1;
+
+JobSystem::JobSystem() :
+	_isRunning(false),
+	_queuedJobs(0)
+{ }
+
+JobSystem::~JobSystem() {
+	Shutdown();
+}
+
+void JobSystem::Init(uint32_t workerCount) {
+	LOG_ASSERT(!_isRunning, "Job system has already been initialized!");
+
+	if (workerCount == 0) {
+		const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	// The calling thread gets the first queue, the workers get the rest
+	t_threadIndex = 0;
+	_queues.clear();
+	for (uint32_t ix = 0; ix <= workerCount; ix++) {
+		_queues.push_back(std::make_unique<WorkQueue>());
+	}
+
+	_isRunning = true;
+	for (uint32_t ix = 1; ix <= workerCount; ix++) {
+		_workers.emplace_back(&JobSystem::_WorkerLoop, this, ix);
+	}
+
+	LOG_INFO("Job system started with {} worker threads", workerCount);
+}
+
+void JobSystem::Shutdown() {
+	if (!_isRunning) {
+		return;
+	}
+
+	_isRunning = false;
+	{
+		std::lock_guard<std::mutex> lock(_sleepLock);
+	}
+	_wakeCondition.notify_all();
+
+	for (std::thread& worker : _workers) {
+		worker.join();
+	}
+	_workers.clear();
+	_queues.clear();
+	_queuedJobs = 0;
+	t_threadIndex = -1;
+}
+
+int JobSystem::GetThreadIndex() {
+	return t_threadIndex;
+}
+
+JobHandle JobSystem::Schedule(const std::function<void()>& task, const std::vector<JobHandle>& dependencies) {
+	JobHandle job = _CreateJob(task, nullptr);
+	_Submit(job, dependencies);
+	return job;
+}
+
+JobHandle JobSystem::ParallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& func, size_t batchSize, const std::vector<JobHandle>& dependencies) {
+	if (batchSize == 0) {
+		// Aim for a few batches per thread so that stealing can even out uneven workloads
+		const size_t batches = static_cast<size_t>(std::max(GetThreadCount(), 1u)) * 4;
+		batchSize = std::max<size_t>((count + batches - 1) / batches, 1);
+	}
+
+	// The root job spawns the batches as children once it's dependencies are met, and will not
+	// complete until all of it's children have
+	JobHandle root = _CreateJob(nullptr, nullptr);
+	std::weak_ptr<Job> weakRoot = root;
+	root->_task = [this, weakRoot, count, func, batchSize]() {
+		// We're running inside the root, so it's guaranteed to be alive until we return
+		const JobHandle parent = weakRoot.lock();
+		for (size_t begin = 0; begin < count; begin += batchSize) {
+			const size_t end = std::min(begin + batchSize, count);
+			_Submit(_CreateJob([func, begin, end]() { func(begin, end); }, parent), {});
+		}
+	};
+	_Submit(root, dependencies);
+	return root;
+}
+
+void JobSystem::Wait(const JobHandle& job) {
+	if (job == nullptr) {
+		return;
+	}
+	while (!job->IsComplete()) {
+		if (!_TryExecuteOne()) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::WaitAll(const std::vector<JobHandle>& jobs) {
+	for (const JobHandle& job : jobs) {
+		Wait(job);
+	}
+}
+
+JobHandle JobSystem::_CreateJob(const std::function<void()>& task, const JobHandle& parent) {
+	JobHandle job = std::make_shared<Job>();
+	job->_task = task;
+	job->_parent = parent;
+	if (parent != nullptr) {
+		parent->_unfinished.fetch_add(1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+void JobSystem::_Submit(const JobHandle& job, const std::vector<JobHandle>& dependencies) {
+	// Register as a continuation of every dependency that has not yet completed. The job holds a
+	// guard count while we do this, so it cannot be queued until we're done
+	for (const JobHandle& dependency : dependencies) {
+		if (dependency == nullptr) {
+			continue;
+		}
+		std::lock_guard<std::mutex> lock(dependency->_continuationLock);
+		if (!dependency->IsComplete()) {
+			job->_pendingDependencies.fetch_add(1, std::memory_order_relaxed);
+			dependency->_continuations.push_back(job);
+		}
+	}
+
+	// Release the guard, if all dependencies are met we can queue the job right away
+	if (job->_pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		_Enqueue(job);
+	}
+}
+
+void JobSystem::_Enqueue(const JobHandle& job) {
+	// If the job system is not running, we just run the job inline
+	if (_queues.empty()) {
+		_Execute(job);
+		return;
+	}
+
+	// Threads that are not owned by the job system will push onto the main thread's queue
+	const size_t queueIx = t_threadIndex >= 0 ? static_cast<size_t>(t_threadIndex) : 0;
+	{
+		WorkQueue& queue = *_queues[queueIx];
+		std::lock_guard<std::mutex> lock(queue.Lock);
+		queue.Jobs.push_back(job);
+	}
+	_queuedJobs.fetch_add(1, std::memory_order_release);
+
+	// Take the sleep lock so we cannot notify between a worker checking for work and going to sleep
+	{
+		std::lock_guard<std::mutex> lock(_sleepLock);
+	}
+	_wakeCondition.notify_one();
+}
+
+JobHandle JobSystem::_FindJob(uint32_t threadIndex) {
+	const size_t queueCount = _queues.size();
+
+	// Take the newest job from our own queue first, it's most likely to still be in cache
+	{
+		WorkQueue& queue = *_queues[threadIndex];
+		std::lock_guard<std::mutex> lock(queue.Lock);
+		if (!queue.Jobs.empty()) {
+			JobHandle result = std::move(queue.Jobs.back());
+			queue.Jobs.pop_back();
+			_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+			return result;
+		}
+	}
+
+	// Otherwise steal the oldest job from one of the other threads
+	for (size_t offset = 1; offset < queueCount; offset++) {
+		WorkQueue& queue = *_queues[(threadIndex + offset) % queueCount];
+		std::lock_guard<std::mutex> lock(queue.Lock);
+		if (!queue.Jobs.empty()) {
+			JobHandle result = std::move(queue.Jobs.front());
+			queue.Jobs.pop_front();
+			_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+			return result;
+		}
+	}
+
+	return nullptr;
+}
+
+bool JobSystem::_TryExecuteOne() {
+	if (_queues.empty()) {
+		return false;
+	}
+	const uint32_t threadIndex = t_threadIndex >= 0 ? static_cast<uint32_t>(t_threadIndex) : 0;
+	JobHandle job = _FindJob(threadIndex);
+	if (job != nullptr) {
+		_Execute(job);
+		return true;
+	}
+	return false;
+}
+
+void JobSystem::_Execute(const JobHandle& job) {
+	if (job->_task) {
+		job->_task();
+	}
+	_Finish(job);
+}
+
+void JobSystem::_Finish(const JobHandle& job) {
+	// The job is only complete once it and all of it's children have finished
+	if (job->_unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+		return;
+	}
+
+	std::vector<JobHandle> continuations;
+	{
+		std::lock_guard<std::mutex> lock(job->_continuationLock);
+		job->_isComplete.store(true, std::memory_order_release);
+		continuations.swap(job->_continuations);
+	}
+
+	// Release any jobs that were waiting on us
+	for (const JobHandle& continuation : continuations) {
+		if (continuation->_pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			_Enqueue(continuation);
+		}
+	}
+
+	// Let our parent know we're done, and drop our reference to it
+	JobHandle parent = std::move(job->_parent);
+	if (parent != nullptr) {
+		_Finish(parent);
+	}
+}
+
+void JobSystem::_WorkerLoop(uint32_t threadIndex) {
+	t_threadIndex = static_cast<int>(threadIndex);
+
+	while (_isRunning) {
+		JobHandle job = _FindJob(threadIndex);
+		if (job != nullptr) {
+			_Execute(job);
+		} else {
+			std::unique_lock<std::mutex> lock(_sleepLock);
+			_wakeCondition.wait(lock, [this]() {
+				return _queuedJobs.load(std::memory_order_acquire) > 0 || !_isRunning;
+			});
+		}
+	}
+}
@@ -0,0 +1,179 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <entt.hpp>
+
+/// <summary>
+/// Represents a single unit of work that has been handed to the JobSystem. Jobs may depend on other
+/// jobs, and will only be queued once all of their dependencies have completed
+/// </summary>
+class Job final
+{
+public:
+	typedef std::shared_ptr<Job> sptr;
+
+	Job() :
+		_task(nullptr),
+		_parent(nullptr),
+		_unfinished(1),
+		_pendingDependencies(1),
+		_isComplete(false) {}
+	~Job() = default;
+
+	Job(const Job& other) = delete;
+	Job(Job&& other) = delete;
+	Job& operator=(const Job& other) = delete;
+	Job& operator=(Job&& other) = delete;
+
+	/// <summary>
+	/// Returns true once this job, and any child jobs it spawned, have finished executing
+	/// </summary>
+	bool IsComplete() const { return _isComplete.load(std::memory_order_acquire); }
+
+private:
+	friend class JobSystem;
+
+	std::function<void()> _task;
+	// The job that spawned this one, it will not complete until we do
+	sptr _parent;
+	// This job plus any children that have not yet finished
+	std::atomic<int> _unfinished;
+	// The number of dependencies that have not yet completed, plus one guard held while scheduling
+	std::atomic<int> _pendingDependencies;
+	std::atomic<bool> _isComplete;
+
+	// Jobs that are waiting on this one to complete
+	std::mutex _continuationLock;
+	std::vector<sptr> _continuations;
+};
+
+typedef Job::sptr JobHandle;
+
+/// <summary>
+/// A work-stealing job system. Each thread (the main thread, plus one worker per additional core) owns
+/// a deque of jobs, it pops from the back of it's own deque and steals from the front of the others when
+/// it runs out of work.
+///
+/// Waiting on a job from the main thread will execute other jobs while it waits, so the main thread is
+/// never idle during a parallel phase
+/// </summary>
+class JobSystem final
+{
+public:
+	static JobSystem& Instance() {
+		static JobSystem instance;
+		return instance;
+	}
+
+	JobSystem(const JobSystem& other) = delete;
+	JobSystem(JobSystem&& other) = delete;
+	JobSystem& operator=(const JobSystem& other) = delete;
+	JobSystem& operator=(JobSystem&& other) = delete;
+
+	/// <summary>
+	/// Starts the worker threads, the calling thread will be treated as the main thread
+	/// </summary>
+	/// <param name="workerCount">The number of worker threads to spawn, or 0 to use one less than the number of hardware threads</param>
+	void Init(uint32_t workerCount = 0);
+	/// <summary>
+	/// Stops and joins all the worker threads, any jobs that have not yet been started are discarded
+	/// </summary>
+	void Shutdown();
+
+	/// <summary>
+	/// Gets the number of threads that can execute jobs, including the main thread
+	/// </summary>
+	uint32_t GetThreadCount() const { return static_cast<uint32_t>(_queues.size()); }
+	/// <summary>
+	/// Gets the index of the calling thread within the job system (0 for the main thread), or -1 if the
+	/// calling thread is not owned by the job system
+	/// </summary>
+	static int GetThreadIndex();
+
+	/// <summary>
+	/// Schedules a task to run on the job system
+	/// </summary>
+	/// <param name="task">The task to execute</param>
+	/// <param name="dependencies">The jobs that must complete before the task may start</param>
+	/// <returns>A handle to the job that can be waited on, or used as a dependency of other jobs</returns>
+	JobHandle Schedule(const std::function<void()>& task, const std::vector<JobHandle>& dependencies = {});
+
+	/// <summary>
+	/// Splits the range [0, count) into batches and executes them in parallel
+	/// </summary>
+	/// <param name="count">The number of items to iterate over</param>
+	/// <param name="func">The function to invoke with the range [begin, end) of each batch</param>
+	/// <param name="batchSize">The number of items to process per job, or 0 to pick a size based on the thread count</param>
+	/// <param name="dependencies">The jobs that must complete before any batches may start</param>
+	/// <returns>A handle to a job that completes once all the batches have completed</returns>
+	JobHandle ParallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& func, size_t batchSize = 0, const std::vector<JobHandle>& dependencies = {});
+
+	/// <summary>
+	/// Invokes func(entity, components...) for every entity in an entt view, in parallel.
+	///
+	/// The entities in the view are captured when this is called, so no entities may be created or destroyed,
+	/// and none of the viewed components may be added or removed until the returned job has completed
+	/// </summary>
+	/// <param name="view">The view to iterate over</param>
+	/// <param name="func">The function to invoke for each entity</param>
+	/// <param name="batchSize">The number of entities to process per job, or 0 to pick a size based on the thread count</param>
+	/// <param name="dependencies">The jobs that must complete before any batches may start</param>
+	/// <returns>A handle to a job that completes once all entities have been processed</returns>
+	template <typename... Exclude, typename... Component, typename Func>
+	JobHandle ParallelForEach(entt::basic_view<entt::entity, entt::exclude_t<Exclude...>, Component...> view, Func func, size_t batchSize = 0, const std::vector<JobHandle>& dependencies = {}) {
+		std::shared_ptr<std::vector<entt::entity>> entities = std::make_shared<std::vector<entt::entity>>();
+		entities->reserve(view.size());
+		for (entt::entity entity : view) {
+			entities->push_back(entity);
+		}
+		return ParallelFor(entities->size(), [view, func, entities](size_t begin, size_t end) {
+			for (size_t ix = begin; ix < end; ix++) {
+				const entt::entity entity = (*entities)[ix];
+				func(entity, view.template get<Component>(entity)...);
+			}
+		}, batchSize, dependencies);
+	}
+
+	/// <summary>
+	/// Blocks until the given job has completed, executing other jobs while waiting
+	/// </summary>
+	void Wait(const JobHandle& job);
+	/// <summary>
+	/// Blocks until all the given jobs have completed, executing other jobs while waiting
+	/// </summary>
+	void WaitAll(const std::vector<JobHandle>& jobs);
+
+private:
+	JobSystem();
+	~JobSystem();
+
+	// A single thread's deque of jobs, the owner pushes and pops at the back, thieves take from the front
+	struct WorkQueue {
+		std::mutex             Lock;
+		std::deque<JobHandle>  Jobs;
+	};
+
+	std::vector<std::unique_ptr<WorkQueue>> _queues;
+	std::vector<std::thread>                _workers;
+	std::atomic<bool>                       _isRunning;
+	// Total number of jobs waiting in all queues, used to put idle workers to sleep
+	std::atomic<size_t>                     _queuedJobs;
+	std::mutex                              _sleepLock;
+	std::condition_variable                 _wakeCondition;
+
+	JobHandle _CreateJob(const std::function<void()>& task, const JobHandle& parent);
+	void _Submit(const JobHandle& job, const std::vector<JobHandle>& dependencies);
+	void _Enqueue(const JobHandle& job);
+	JobHandle _FindJob(uint32_t threadIndex);
+	bool _TryExecuteOne();
+	void _Execute(const JobHandle& job);
+	void _Finish(const JobHandle& job);
+	void _WorkerLoop(uint32_t threadIndex);
+};
@@ -1,6 +1,8 @@
 #pragma once
 #include <vector>
 #include "Graphics/VertexArrayObject.h"
+#include "Graphics/GeometryArena.h"
+#include "Logging.h"
 
 template <typename VertType>
 class MeshBuilder
@@ -81,6 +83,29 @@ public:
 	/// </summary>
 	size_t GetTriangleCount() const { return _indices.size() > 0 ? _indices.size() / 3 : _vertices.size() / 3; }
 
+	/// <summary>
+	/// Calculates the box around all of the vertices in the mesh
+	/// </summary>
+	AABB GetBounds() const {
+		AABB result;
+		for (const VertType& vertex : _vertices) {
+			result.Expand(vertex.Position);
+		}
+		return result;
+	}
+	/// <summary>
+	/// Calculates a sphere around all of the vertices in the mesh, centered on the middle of it's bounds
+	/// </summary>
+	BoundingSphere GetBoundingSphere() const {
+		const glm::vec3 center = GetBounds().Center();
+		float radiusSq = 0.0f;
+		for (const VertType& vertex : _vertices) {
+			const glm::vec3 delta = vertex.Position - center;
+			radiusSq = glm::max(radiusSq, glm::dot(delta, delta));
+		}
+		return BoundingSphere(center, glm::sqrt(radiusSq));
+	}
+
 	VertexArrayObject::sptr Bake() {
 		VertexBuffer::sptr vbo = VertexBuffer::Create();
 		vbo->LoadData(GetVertexDataPtr(), _vertices.size());
@@ -91,7 +116,25 @@ public:
 		VertexArrayObject::sptr result = VertexArrayObject::Create();
 		result->AddVertexBuffer(vbo, VertType::V_DECL);
 		result->SetIndexBuffer(ebo);
+		if (!_vertices.empty()) {
+			result->SetBounds(GetBounds(), GetBoundingSphere());
+		}
+
+		return result;
+	}
 
+	/// <summary>
+	/// Copies the mesh in to a geometry arena instead of giving it buffers of it's own, so that it can be drawn
+	/// together with the other meshes in the arena. The mesh must be indexed, and use the arena's vertex layout
+	/// </summary>
+	/// <param name="arena">The arena to add the mesh to</param>
+	/// <returns>A range of the arena's VAO that draws this mesh</returns>
+	VertexArrayObject::sptr Bake(GeometryArena& arena) {
+		LOG_ASSERT(arena.GetVertexSize() == sizeof(VertType), "Mesh vertices do not match the arena's vertex size!");
+		VertexArrayObject::sptr result = arena.Add(GetVertexDataPtr(), _vertices.size(), GetIndexDataPtr(), _indices.size());
+		if (!_vertices.empty()) {
+			result->SetBounds(GetBounds(), GetBoundingSphere());
+		}
 		return result;
 	}
 	
@@ -0,0 +1,645 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include "Utilities/JobSystem.h"
+
+namespace {
+	// A symmetric 4x4 matrix holding the sum of the squared distances to a set of weighted planes
+	struct Quadric {
+		double A2 = 0.0, AB = 0.0, AC = 0.0, AD = 0.0;
+		double B2 = 0.0, BC = 0.0, BD = 0.0;
+		double C2 = 0.0, CD = 0.0;
+		double D2 = 0.0;
+		double Weight = 0.0;
+
+		void AddPlane(const glm::dvec3& normal, double d, double weight) {
+			A2 += normal.x * normal.x * weight; AB += normal.x * normal.y * weight; AC += normal.x * normal.z * weight; AD += normal.x * d * weight;
+			B2 += normal.y * normal.y * weight; BC += normal.y * normal.z * weight; BD += normal.y * d * weight;
+			C2 += normal.z * normal.z * weight; CD += normal.z * d * weight;
+			D2 += d * d * weight;
+			Weight += weight;
+		}
+		void Add(const Quadric& other) {
+			A2 += other.A2; AB += other.AB; AC += other.AC; AD += other.AD;
+			B2 += other.B2; BC += other.BC; BD += other.BD;
+			C2 += other.C2; CD += other.CD;
+			D2 += other.D2;
+			Weight += other.Weight;
+		}
+		// The weighted mean squared distance from a point to the planes
+		double Evaluate(const glm::dvec3& p) const {
+			const double error =
+				A2 * p.x * p.x + B2 * p.y * p.y + C2 * p.z * p.z +
+				2.0 * (AB * p.x * p.y + AC * p.x * p.z + BC * p.y * p.z + AD * p.x + BD * p.y + CD * p.z) + D2;
+			return Weight > 0.0 ? std::max(error, 0.0) / Weight : 0.0;
+		}
+	};
+
+	enum class VertexKind : uint8_t {
+		// Surrounded by triangles, with a single set of attributes
+		Interior,
+		// On an open border, can only slide along the border
+		Border,
+		// On a UV seam, can only slide along the seam
+		Seam,
+		// Corners, non-manifold vertices and anything else we can't safely move
+		Locked
+	};
+
+	struct EdgeInfo {
+		uint32_t Count = 0;
+		// The UV groups at the lower and higher position of the first triangle that used the edge
+		uint32_t GroupLow = 0;
+		uint32_t GroupHigh = 0;
+		uint32_t Triangle = 0;
+		bool     Seam = false;
+
+		bool IsBorder() const { return Count == 1; }
+		bool IsSeam() const { return Count == 2 && Seam; }
+	};
+
+	struct Collapse {
+		uint32_t From;
+		uint32_t To;
+		double   Cost;
+		// The geometric part of the cost, without the attributes
+		double   Error;
+	};
+
+	struct PositionHash {
+		size_t operator()(const glm::vec3& position) const {
+			uint32_t bits[3];
+			memcpy(bits, &position, sizeof(bits));
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+	};
+
+	// Normals closer than this are treated as the same normal
+	constexpr float SAME_NORMAL = 0.999f;
+
+	uint64_t EdgeKey(uint32_t a, uint32_t b) {
+		return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+	}
+
+	// Does the work for a single mesh, all positions are normalized so that the mesh is about 1 unit across
+	class Simplifier {
+	public:
+		Simplifier(const MeshBuilder<VertexPosNormTexCol>& input, const SimplifyOptions& options) :
+			_vertices(input.GetVertexDataPtr(), input.GetVertexDataPtr() + input.GetVertexCount()),
+			_options(options)
+		{
+			if (input.GetIndexCount() > 0) {
+				_indices.assign(input.GetIndexDataPtr(), input.GetIndexDataPtr() + input.GetIndexCount());
+			} else {
+				_indices.resize(input.GetVertexCount());
+				for (uint32_t ix = 0; ix < static_cast<uint32_t>(_indices.size()); ix++) {
+					_indices[ix] = ix;
+				}
+			}
+			_indices.resize(_indices.size() - _indices.size() % 3);
+
+			const AABB bounds = input.GetBounds();
+			_origin = bounds.IsValid() ? bounds.Min : glm::vec3(0.0f);
+			_scale = bounds.IsValid() ? glm::length(bounds.Max - bounds.Min) : 0.0f;
+			if (_scale <= 0.0f) {
+				_scale = 1.0f;
+			}
+
+			_WeldPositions(input.GetVertexCount());
+			_ClassifyEdges();
+			_ClassifyVertices();
+			_BuildQuadrics();
+		}
+
+		SimplifyResult Run(MeshBuilder<VertexPosNormTexCol>& output) {
+			SimplifyResult result;
+			const size_t triangleCount = _indices.size() / 3;
+			result.InputTriangles = triangleCount;
+
+			const size_t target = static_cast<size_t>(static_cast<double>(triangleCount) * glm::clamp(_options.TargetRatio, 0.0f, 1.0f));
+			const double errorLimit = static_cast<double>(_options.MaxError) * static_cast<double>(_options.MaxError);
+			double maxError = 0.0;
+
+			std::vector<Collapse> collapses;
+			bool done = false;
+			while (_liveTriangles > target && !done) {
+				_BuildAdjacency();
+
+				// Find the cheapest collapse for every vertex
+				collapses.clear();
+				for (uint32_t position = 0; position < static_cast<uint32_t>(_positions.size()); position++) {
+					if (_removed[position] || _kinds[position] == VertexKind::Locked) {
+						continue;
+					}
+					Collapse best = { position, position, std::numeric_limits<double>::max(), 0.0 };
+					for (uint32_t triangle : _adjacency[position]) {
+						for (int corner = 0; corner < 3; corner++) {
+							const uint32_t other = _wedgePositions[_indices[triangle * 3 + corner]];
+							if (other == position || !_CanCollapseAlong(position, other)) {
+								continue;
+							}
+							const double error = _quadrics[position].Evaluate(_positions[other]);
+							const double cost = error + _AttributeCost(position, other);
+							if (cost < best.Cost) {
+								best.To = other;
+								best.Cost = cost;
+								best.Error = error;
+							}
+						}
+					}
+					if (best.To != position) {
+						collapses.push_back(best);
+					}
+				}
+				if (collapses.empty()) {
+					break;
+				}
+				std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) { return l.Cost < r.Cost; });
+
+				// Do as many as we can without touching a vertex twice, the costs around a collapsed vertex are stale
+				// until the next pass
+				std::fill(_touched.begin(), _touched.end(), 0);
+				size_t collapsed = 0;
+				for (const Collapse& collapse : collapses) {
+					if (collapse.Error > errorLimit || _touched[collapse.From] || _touched[collapse.To] || !_TryCollapse(collapse.From, collapse.To)) {
+						continue;
+					}
+					maxError = std::max(maxError, collapse.Error);
+					collapsed++;
+					if (_liveTriangles <= target) {
+						break;
+					}
+				}
+				done = collapsed == 0;
+			}
+
+			// Copy out the wedges that are still in use
+			std::vector<uint32_t> remap(_vertices.size(), UINT32_MAX);
+			output.ReserveIndexSpace(_liveTriangles * 3);
+			for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+				if (_dead[triangle]) {
+					continue;
+				}
+				uint32_t corners[3];
+				for (int corner = 0; corner < 3; corner++) {
+					const uint32_t wedge = _indices[triangle * 3 + corner];
+					if (remap[wedge] == UINT32_MAX) {
+						remap[wedge] = output.AddVertex(_vertices[wedge]);
+					}
+					corners[corner] = remap[wedge];
+				}
+				output.AddIndexTri(corners[0], corners[1], corners[2]);
+			}
+
+			result.OutputTriangles = _liveTriangles;
+			result.Error = static_cast<float>(glm::sqrt(maxError));
+			result.AbsoluteError = result.Error * _scale;
+			return result;
+		}
+
+	private:
+		// A copy of the input vertices (wedges), collapses on hard edges can add new ones
+		std::vector<VertexPosNormTexCol> _vertices;
+		SimplifyOptions _options;
+		std::vector<uint32_t> _indices;
+		glm::vec3 _origin;
+		float _scale;
+
+		// The unique positions, and the position of each vertex (wedge)
+		std::vector<glm::vec3> _positions;
+		std::vector<uint32_t> _wedgePositions;
+		std::vector<std::vector<uint32_t>> _wedges;
+		// Wedges at the same position with the same UV are in the same group. Differences in UVs are seams that
+		// must be kept, but differences in normals alone are just hard edges
+		std::vector<uint32_t> _wedgeGroups;
+		std::vector<std::vector<uint32_t>> _groups;
+		std::vector<glm::vec2> _groupUVs;
+		std::vector<uint32_t> _groupSizes;
+
+		std::unordered_map<uint64_t, EdgeInfo> _edges;
+		std::vector<VertexKind> _kinds;
+		std::vector<Quadric> _quadrics;
+
+		std::vector<std::vector<uint32_t>> _adjacency;
+		std::vector<uint8_t> _dead;
+		std::vector<uint8_t> _removed;
+		std::vector<uint8_t> _touched;
+		size_t _liveTriangles = 0;
+
+		void _WeldPositions(size_t vertexCount) {
+			std::unordered_map<glm::vec3, uint32_t, PositionHash> lookup;
+			lookup.reserve(vertexCount);
+			_wedgePositions.resize(vertexCount);
+			_wedgeGroups.resize(vertexCount);
+			for (size_t ix = 0; ix < vertexCount; ix++) {
+				const auto [it, added] = lookup.emplace(_vertices[ix].Position, static_cast<uint32_t>(_positions.size()));
+				if (added) {
+					_positions.push_back((_vertices[ix].Position - _origin) / _scale);
+					_wedges.emplace_back();
+					_groups.emplace_back();
+				}
+				const uint32_t position = it->second;
+				_wedgePositions[ix] = position;
+				_wedges[position].push_back(static_cast<uint32_t>(ix));
+
+				// There are only ever a handful of wedges at a position, so a linear search is fine
+				uint32_t group = UINT32_MAX;
+				for (uint32_t other : _groups[position]) {
+					if (_groupUVs[other] == _vertices[ix].UV) {
+						group = other;
+						break;
+					}
+				}
+				if (group == UINT32_MAX) {
+					group = static_cast<uint32_t>(_groupUVs.size());
+					_groupUVs.push_back(_vertices[ix].UV);
+					_groupSizes.push_back(0);
+					_groups[position].push_back(group);
+				}
+				_wedgeGroups[ix] = group;
+				_groupSizes[group]++;
+			}
+
+			_dead.resize(_indices.size() / 3, 0);
+			_removed.resize(_positions.size(), 0);
+			_touched.resize(_positions.size(), 0);
+			_adjacency.resize(_positions.size());
+			for (size_t triangle = 0; triangle < _dead.size(); triangle++) {
+				const uint32_t a = _wedgePositions[_indices[triangle * 3]];
+				const uint32_t b = _wedgePositions[_indices[triangle * 3 + 1]];
+				const uint32_t c = _wedgePositions[_indices[triangle * 3 + 2]];
+				_dead[triangle] = (a == b || b == c || a == c) ? 1 : 0;
+				_liveTriangles += _dead[triangle] ? 0 : 1;
+			}
+		}
+
+		void _ClassifyEdges() {
+			for (uint32_t triangle = 0; triangle < static_cast<uint32_t>(_dead.size()); triangle++) {
+				if (_dead[triangle]) {
+					continue;
+				}
+				for (int corner = 0; corner < 3; corner++) {
+					const uint32_t wedgeA = _indices[triangle * 3 + corner];
+					const uint32_t wedgeB = _indices[triangle * 3 + (corner + 1) % 3];
+					const uint32_t a = _wedgePositions[wedgeA];
+					const uint32_t b = _wedgePositions[wedgeB];
+					const uint32_t low = _wedgeGroups[a < b ? wedgeA : wedgeB];
+					const uint32_t high = _wedgeGroups[a < b ? wedgeB : wedgeA];
+
+					EdgeInfo& edge = _edges[EdgeKey(a, b)];
+					if (edge.Count == 0) {
+						edge.GroupLow = low;
+						edge.GroupHigh = high;
+						edge.Triangle = triangle;
+					}
+					// The triangles on either side of the edge disagree on the UVs, so this is a seam
+					else if (edge.GroupLow != low || edge.GroupHigh != high) {
+						edge.Seam = true;
+					}
+					edge.Count++;
+				}
+			}
+		}
+
+		void _ClassifyVertices() {
+			std::vector<uint8_t> borders(_positions.size(), 0), seams(_positions.size(), 0), complex(_positions.size(), 0);
+			for (const auto& [key, edge] : _edges) {
+				const uint32_t a = static_cast<uint32_t>(key >> 32);
+				const uint32_t b = static_cast<uint32_t>(key & 0xFFFFFFFFu);
+				if (edge.Count > 2) {
+					complex[a] = complex[b] = 1;
+				} else if (edge.IsBorder()) {
+					borders[a] = std::min(borders[a] + 1, 255);
+					borders[b] = std::min(borders[b] + 1, 255);
+				} else if (edge.IsSeam()) {
+					seams[a] = std::min(seams[a] + 1, 255);
+					seams[b] = std::min(seams[b] + 1, 255);
+				}
+			}
+
+			_kinds.resize(_positions.size(), VertexKind::Locked);
+			for (size_t ix = 0; ix < _positions.size(); ix++) {
+				const size_t wedges = _groups[ix].size();
+				if (complex[ix]) {
+					_kinds[ix] = VertexKind::Locked;
+				} else if (borders[ix] == 0 && seams[ix] == 0) {
+					_kinds[ix] = wedges == 1 ? VertexKind::Interior : VertexKind::Locked;
+				} else if (borders[ix] == 2 && seams[ix] == 0 && wedges == 1) {
+					_kinds[ix] = _options.LockBorders ? VertexKind::Locked : VertexKind::Border;
+				} else if (seams[ix] == 2 && borders[ix] == 0 && wedges == 2) {
+					_kinds[ix] = VertexKind::Seam;
+				} else {
+					_kinds[ix] = VertexKind::Locked;
+				}
+			}
+		}
+
+		void _BuildQuadrics() {
+			_quadrics.resize(_positions.size());
+			std::vector<glm::dvec3> faceNormals(_dead.size(), glm::dvec3(0.0));
+			for (size_t triangle = 0; triangle < _dead.size(); triangle++) {
+				if (_dead[triangle]) {
+					continue;
+				}
+				const uint32_t a = _wedgePositions[_indices[triangle * 3]];
+				const uint32_t b = _wedgePositions[_indices[triangle * 3 + 1]];
+				const uint32_t c = _wedgePositions[_indices[triangle * 3 + 2]];
+				const glm::dvec3 p0 = _positions[a], p1 = _positions[b], p2 = _positions[c];
+				glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+				const double doubleArea = glm::length(normal);
+				if (doubleArea <= 0.0) {
+					continue;
+				}
+				normal /= doubleArea;
+				faceNormals[triangle] = normal;
+				// Weighting by area stops tiny triangles from having as much say as large ones
+				const double d = -glm::dot(normal, p0);
+				_quadrics[a].AddPlane(normal, d, doubleArea * 0.5);
+				_quadrics[b].AddPlane(normal, d, doubleArea * 0.5);
+				_quadrics[c].AddPlane(normal, d, doubleArea * 0.5);
+			}
+
+			// Borders and seams get an extra plane through the edge, perpendicular to the surface, so that moving
+			// the vertices along them is cheap but moving them off of them is expensive
+			for (const auto& [key, edge] : _edges) {
+				if (!edge.IsBorder() && !edge.IsSeam()) {
+					continue;
+				}
+				const uint32_t a = static_cast<uint32_t>(key >> 32);
+				const uint32_t b = static_cast<uint32_t>(key & 0xFFFFFFFFu);
+				const glm::dvec3 pa = _positions[a], pb = _positions[b];
+				const glm::dvec3 along = pb - pa;
+				glm::dvec3 normal = glm::cross(along, faceNormals[edge.Triangle]);
+				const double length = glm::length(normal);
+				if (length <= 0.0) {
+					continue;
+				}
+				normal /= length;
+				const double weight = _options.BorderWeight * glm::dot(along, along);
+				_quadrics[a].AddPlane(normal, -glm::dot(normal, pa), weight);
+				_quadrics[b].AddPlane(normal, -glm::dot(normal, pa), weight);
+			}
+		}
+
+		void _BuildAdjacency() {
+			for (std::vector<uint32_t>& triangles : _adjacency) {
+				triangles.clear();
+			}
+			for (uint32_t triangle = 0; triangle < static_cast<uint32_t>(_dead.size()); triangle++) {
+				if (_dead[triangle]) {
+					continue;
+				}
+				for (int corner = 0; corner < 3; corner++) {
+					_adjacency[_wedgePositions[_indices[triangle * 3 + corner]]].push_back(triangle);
+				}
+			}
+		}
+
+		// Border and seam vertices can only move along their border or seam, on to another vertex of the same kind
+		bool _CanCollapseAlong(uint32_t from, uint32_t to) const {
+			switch (_kinds[from]) {
+				case VertexKind::Interior:
+					return true;
+				case VertexKind::Border:
+				case VertexKind::Seam: {
+					const auto it = _edges.find(EdgeKey(from, to));
+					if (it == _edges.end()) {
+						return false;
+					}
+					if (_kinds[from] == VertexKind::Border) {
+						return it->second.IsBorder() && (_kinds[to] == VertexKind::Border || _kinds[to] == VertexKind::Locked);
+					}
+					return it->second.IsSeam() && (_kinds[to] == VertexKind::Seam || _kinds[to] == VertexKind::Locked);
+				}
+				default:
+					return false;
+			}
+		}
+
+		double _AttributeCost(uint32_t from, uint32_t to) const {
+			double cost = 0.0;
+			// Each wedge will take on the attributes of the closest wedge at the new position
+			for (uint32_t wedge : _wedges[from]) {
+				double closest = std::numeric_limits<double>::max();
+				for (uint32_t other : _wedges[to]) {
+					const glm::vec3 normal = (_vertices[wedge].Normal - _vertices[other].Normal) * 0.5f;
+					const glm::vec2 uv = _vertices[wedge].UV - _vertices[other].UV;
+					closest = std::min(closest, static_cast<double>(glm::dot(normal, normal) + glm::dot(uv, uv)));
+				}
+				cost += closest * _options.AttributeWeight;
+			}
+			return cost;
+		}
+
+		bool _Contains(uint32_t triangle, uint32_t position) const {
+			return _wedgePositions[_indices[triangle * 3]] == position ||
+				_wedgePositions[_indices[triangle * 3 + 1]] == position ||
+				_wedgePositions[_indices[triangle * 3 + 2]] == position;
+		}
+
+		// Picks the wedge at a position that a wedge will turn in to, adding a new one if needed
+		uint32_t _TargetWedge(uint32_t wedge, uint32_t position, uint32_t group) {
+			const glm::vec3& normal = _vertices[wedge].Normal;
+			uint32_t closest = UINT32_MAX;
+			float closestDot = -std::numeric_limits<float>::max();
+			for (uint32_t other : _wedges[position]) {
+				if (_wedgeGroups[other] != group) {
+					continue;
+				}
+				const float dot = glm::dot(normal, _vertices[other].Normal);
+				if (dot > closestDot) {
+					closest = other;
+					closestDot = dot;
+				}
+			}
+			// Smooth vertices take on the normal at the new position. Corners with hard edges keep their own normal,
+			// or the faces around them would be shaded as if they were smooth
+			if (_groupSizes[_wedgeGroups[wedge]] == 1 || closestDot >= SAME_NORMAL) {
+				return closest;
+			}
+			VertexPosNormTexCol vertex = _vertices[closest];
+			vertex.Normal = normal;
+			const uint32_t result = static_cast<uint32_t>(_vertices.size());
+			_vertices.push_back(vertex);
+			_wedgePositions.push_back(position);
+			_wedgeGroups.push_back(group);
+			_wedges[position].push_back(result);
+			_groupSizes[group]++;
+			return result;
+		}
+
+		bool _TryCollapse(uint32_t from, uint32_t to) {
+			// Work out which UV group at the new position each of our UV groups turns in to, using the triangles that
+			// touch both positions
+			std::pair<uint32_t, uint32_t> groupMap[8];
+			int mapped = 0;
+			for (uint32_t triangle : _adjacency[from]) {
+				if (_dead[triangle]) {
+					continue;
+				}
+				uint32_t fromGroup = UINT32_MAX, toGroup = UINT32_MAX;
+				for (int corner = 0; corner < 3; corner++) {
+					const uint32_t wedge = _indices[triangle * 3 + corner];
+					if (_wedgePositions[wedge] == from) { fromGroup = _wedgeGroups[wedge]; }
+					if (_wedgePositions[wedge] == to) { toGroup = _wedgeGroups[wedge]; }
+				}
+				if (toGroup == UINT32_MAX) {
+					continue;
+				}
+				int ix = 0;
+				for (; ix < mapped && groupMap[ix].first != fromGroup; ix++) {}
+				if (ix < mapped) {
+					if (groupMap[ix].second != toGroup) {
+						return false;
+					}
+				} else if (mapped < 8) {
+					groupMap[mapped++] = { fromGroup, toGroup };
+				} else {
+					return false;
+				}
+			}
+
+			// Every group that's still in use needs somewhere to go, and we can't join two sheets together (the
+			// link condition, the only neighbours we may share are the ones on the triangles being removed)
+			std::vector<uint32_t> fromNeighbours, toNeighbours;
+			size_t shared = 0;
+			for (uint32_t triangle : _adjacency[from]) {
+				if (_dead[triangle]) {
+					continue;
+				}
+				shared += _Contains(triangle, to) ? 1 : 0;
+				for (int corner = 0; corner < 3; corner++) {
+					const uint32_t wedge = _indices[triangle * 3 + corner];
+					const uint32_t position = _wedgePositions[wedge];
+					if (position == from) {
+						int ix = 0;
+						for (; ix < mapped && groupMap[ix].first != _wedgeGroups[wedge]; ix++) {}
+						if (ix == mapped) {
+							return false;
+						}
+					} else if (position != to) {
+						fromNeighbours.push_back(position);
+					}
+				}
+			}
+			for (uint32_t triangle : _adjacency[to]) {
+				if (_dead[triangle]) {
+					continue;
+				}
+				for (int corner = 0; corner < 3; corner++) {
+					const uint32_t position = _wedgePositions[_indices[triangle * 3 + corner]];
+					if (position != to && position != from) {
+						toNeighbours.push_back(position);
+					}
+				}
+			}
+			std::sort(fromNeighbours.begin(), fromNeighbours.end());
+			fromNeighbours.erase(std::unique(fromNeighbours.begin(), fromNeighbours.end()), fromNeighbours.end());
+			std::sort(toNeighbours.begin(), toNeighbours.end());
+			toNeighbours.erase(std::unique(toNeighbours.begin(), toNeighbours.end()), toNeighbours.end());
+			size_t common = 0;
+			for (uint32_t position : fromNeighbours) {
+				common += std::binary_search(toNeighbours.begin(), toNeighbours.end(), position) ? 1 : 0;
+			}
+			if (shared == 0 || common > shared) {
+				return false;
+			}
+
+			// Don't flip any of the triangles that survive
+			const glm::vec3& target = _positions[to];
+			for (uint32_t triangle : _adjacency[from]) {
+				if (_dead[triangle] || _Contains(triangle, to)) {
+					continue;
+				}
+				glm::vec3 before[3], after[3];
+				for (int corner = 0; corner < 3; corner++) {
+					const uint32_t position = _wedgePositions[_indices[triangle * 3 + corner]];
+					before[corner] = _positions[position];
+					after[corner] = position == from ? target : before[corner];
+				}
+				const glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				const glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+				if (glm::dot(normalBefore, normalAfter) <= 0.0f) {
+					return false;
+				}
+			}
+
+			// Borders and seams move with the vertex, so the next collapse along them is still allowed
+			if (_kinds[from] == VertexKind::Border || _kinds[from] == VertexKind::Seam) {
+				for (uint32_t neighbour : fromNeighbours) {
+					const auto it = _edges.find(EdgeKey(from, neighbour));
+					if (it != _edges.end() && (it->second.IsBorder() || it->second.IsSeam())) {
+						_edges.emplace(EdgeKey(to, neighbour), it->second);
+					}
+				}
+			}
+
+			// Commit, triangles along the edge disappear and the rest are moved to the new position
+			for (uint32_t triangle : _adjacency[from]) {
+				if (_dead[triangle]) {
+					continue;
+				}
+				if (_Contains(triangle, to)) {
+					_dead[triangle] = 1;
+					_liveTriangles--;
+					continue;
+				}
+				for (int corner = 0; corner < 3; corner++) {
+					uint32_t& wedge = _indices[triangle * 3 + corner];
+					if (_wedgePositions[wedge] == from) {
+						for (int ix = 0; ix < mapped; ix++) {
+							if (groupMap[ix].first == _wedgeGroups[wedge]) {
+								wedge = _TargetWedge(wedge, to, groupMap[ix].second);
+								break;
+							}
+						}
+					}
+				}
+				_adjacency[to].push_back(triangle);
+			}
+			_quadrics[to].Add(_quadrics[from]);
+			_removed[from] = 1;
+			_touched[from] = 1;
+			_touched[to] = 1;
+			for (uint32_t neighbour : fromNeighbours) {
+				_touched[neighbour] = 1;
+			}
+			return true;
+		}
+	};
+}
+
+SimplifyResult MeshSimplifier::Simplify(const MeshBuilder<VertexPosNormTexCol>& input, MeshBuilder<VertexPosNormTexCol>& output, const SimplifyOptions& options) {
+	if (input.GetVertexCount() == 0) {
+		return SimplifyResult();
+	}
+	Simplifier simplifier(input, options);
+	return simplifier.Run(output);
+}
+
+std::vector<SimplifiedMesh> MeshSimplifier::GenerateLODChain(const MeshBuilder<VertexPosNormTexCol>& source, const std::vector<float>& ratios, const SimplifyOptions& options) {
+	return GenerateLODChains({ &source }, ratios, options)[0];
+}
+
+std::vector<std::vector<SimplifiedMesh>> MeshSimplifier::GenerateLODChains(const std::vector<const MeshBuilder<VertexPosNormTexCol>*>& sources, const std::vector<float>& ratios, const SimplifyOptions& options) {
+	std::vector<std::vector<SimplifiedMesh>> result(sources.size());
+	for (std::vector<SimplifiedMesh>& chain : result) {
+		chain.resize(ratios.size());
+	}
+
+	// Every level of every mesh is independent, so they all get their own job
+	JobSystem& jobs = JobSystem::Instance();
+	jobs.Wait(jobs.ParallelFor(sources.size() * ratios.size(), [&](size_t begin, size_t end) {
+		for (size_t ix = begin; ix < end; ix++) {
+			const size_t mesh = ix / ratios.size();
+			const size_t level = ix % ratios.size();
+			SimplifyOptions levelOptions = options;
+			levelOptions.TargetRatio = ratios[level];
+			result[mesh][level].Result = Simplify(*sources[mesh], result[mesh][level].Mesh, levelOptions);
+		}
+	}, 1));
+	return result;
+}
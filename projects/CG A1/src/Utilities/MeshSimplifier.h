@@ -0,0 +1,110 @@
+#pragma once
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "Utilities/MeshBuilder.h"
+#include "Utilities/VertexTypes.h"
+
+/// <summary>
+/// Controls how far a mesh is simplified
+/// </summary>
+struct SimplifyOptions
+{
+	/// <summary>
+	/// Stop once the mesh has at most this fraction of it's original triangles. Set to 0 to simplify until the
+	/// error bound is reached
+	/// </summary>
+	float TargetRatio = 0.5f;
+	/// <summary>
+	/// The most error any collapse may introduce, as a fraction of the size of the mesh (the diagonal of it's bounds).
+	/// Leave at the default to simplify until the target ratio is reached
+	/// </summary>
+	float MaxError = std::numeric_limits<float>::max();
+	/// <summary>
+	/// How strongly differences in normals and UVs count against a collapse, compared to moving the surface
+	/// </summary>
+	float AttributeWeight = 0.01f;
+	/// <summary>
+	/// How strongly open borders and UV or normal seams are held in place
+	/// </summary>
+	float BorderWeight = 10.0f;
+	/// <summary>
+	/// If true, vertices on open borders are never moved, so that meshes that tile together stay sealed
+	/// </summary>
+	bool  LockBorders = false;
+};
+
+/// <summary>
+/// What a call to MeshSimplifier::Simplify achieved
+/// </summary>
+struct SimplifyResult
+{
+	size_t InputTriangles  = 0;
+	size_t OutputTriangles = 0;
+	/// <summary>
+	/// The largest error introduced by any collapse, as a fraction of the size of the mesh
+	/// </summary>
+	float  Error = 0.0f;
+	/// <summary>
+	/// The error in the same units as the mesh's positions
+	/// </summary>
+	float  AbsoluteError = 0.0f;
+};
+
+/// <summary>
+/// One level of a chain generated by MeshSimplifier::GenerateLODChain
+/// </summary>
+struct SimplifiedMesh
+{
+	MeshBuilder<VertexPosNormTexCol> Mesh;
+	SimplifyResult Result;
+};
+
+/// <summary>
+/// Reduces the triangle count of meshes with quadric error metric edge collapses (Garland and Heckbert).
+///
+/// Every vertex accumulates the planes of the triangles around it, and an edge is collapsed by moving one vertex on
+/// to the other, so that no new vertices (or attributes) are ever made up. The cost of a collapse is the squared
+/// distance of the moved vertex to it's planes, plus a weighted difference in normals and UVs. Cheapest collapses
+/// are done first, in passes, until the target triangle count or the error bound is reached.
+///
+/// Vertices that share a position but have different normals or UVs are treated as one corner with several wedges, so
+/// that UV and normal seams do not tear apart. Vertices on seams and open borders can only slide along their seam or
+/// border, and extra planes along those edges keep them from drifting. Collapses that would flip a triangle or make
+/// the surface non-manifold are skipped
+/// </summary>
+class MeshSimplifier
+{
+public:
+	/// <summary>
+	/// Simplifies a mesh
+	/// </summary>
+	/// <param name="input">The mesh to simplify</param>
+	/// <param name="output">The mesh builder to write the simplified mesh in to, should be empty</param>
+	/// <param name="options">How far to simplify the mesh</param>
+	/// <returns>The triangle counts and the error that was achieved</returns>
+	static SimplifyResult Simplify(const MeshBuilder<VertexPosNormTexCol>& input, MeshBuilder<VertexPosNormTexCol>& output, const SimplifyOptions& options = SimplifyOptions());
+
+	/// <summary>
+	/// Generates a chain of simplified meshes, with each level simplified from the source mesh. The levels are
+	/// simplified in parallel on the job system
+	/// </summary>
+	/// <param name="source">The full detail mesh</param>
+	/// <param name="ratios">The target ratio of each level, ex { 0.5f, 0.25f, 0.1f }</param>
+	/// <param name="options">Options for all levels, the target ratio is replaced by each ratio in turn</param>
+	/// <returns>One simplified mesh per ratio, in the same order</returns>
+	static std::vector<SimplifiedMesh> GenerateLODChain(const MeshBuilder<VertexPosNormTexCol>& source, const std::vector<float>& ratios, const SimplifyOptions& options = SimplifyOptions());
+
+	/// <summary>
+	/// Generates LOD chains for many meshes at once, in parallel across all of the meshes and levels
+	/// </summary>
+	/// <param name="sources">The full detail meshes</param>
+	/// <param name="ratios">The target ratio of each level</param>
+	/// <param name="options">Options for all levels, the target ratio is replaced by each ratio in turn</param>
+	/// <returns>A chain for each source, in the same order</returns>
+	static std::vector<std::vector<SimplifiedMesh>> GenerateLODChains(const std::vector<const MeshBuilder<VertexPosNormTexCol>*>& sources, const std::vector<float>& ratios, const SimplifyOptions& options = SimplifyOptions());
+
+protected:
+	MeshSimplifier() = default;
+	~MeshSimplifier() = default;
+};
@@ -9,6 +9,13 @@
 #include "StringUtils.h"
 
 VertexArrayObject::sptr ObjLoader::LoadFromFile(const std::string& filename, const glm::vec4& inColor)
+{
+	MeshBuilder<VertexPosNormTexCol> mesh;
+	LoadFromFile(filename, mesh, inColor);
+	return mesh.Bake();
+}
+
+void ObjLoader::LoadFromFile(const std::string& filename, MeshBuilder<VertexPosNormTexCol>& mesh, const glm::vec4& inColor)
 {	
 	// Open our file in binary mode
 	std::ifstream file;
@@ -27,9 +34,6 @@ VertexArrayObject::sptr ObjLoader::LoadFromFile(const std::string& filename, con
 	// We'll use bitmask keys and a map to avoid duplicate vertices
 	std::unordered_map<uint64_t, uint32_t> indexMap;
 
-	// We'll leverage the mesh builder class
-	MeshBuilder<VertexPosNormTexCol> mesh;
-
 	// Temporaries for loading data
 	glm::vec3 temp;
 	glm::ivec3 vertexIndices;
@@ -124,6 +128,4 @@ VertexArrayObject::sptr ObjLoader::LoadFromFile(const std::string& filename, con
 	// Note: with actual OBJ files you're going to run into the issue where faces are composited of different indices
 	// You'll need to keep track of these and create vertex entries for each vertex in the face
 	// If you want to get fancy, you can track which vertices you've already added
-
-	return mesh.Bake();
 }
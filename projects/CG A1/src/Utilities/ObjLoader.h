@@ -5,6 +5,14 @@ class ObjLoader
 {
 public:
 	static VertexArrayObject::sptr LoadFromFile(const std::string& filename, const glm::vec4& inColor = glm::vec4(1.0f));
+	/// <summary>
+	/// Loads an OBJ file into a mesh builder without baking it, so the geometry can be used on the CPU (ex for
+	/// occluders or simplification) before or instead of being uploaded
+	/// </summary>
+	/// <param name="filename">The file to load</param>
+	/// <param name="mesh">The mesh builder to append the geometry to</param>
+	/// <param name="inColor">The color to give all of the vertices</param>
+	static void LoadFromFile(const std::string& filename, MeshBuilder<VertexPosNormTexCol>& mesh, const glm::vec4& inColor = glm::vec4(1.0f));
 
 protected:
 	ObjLoader() = default;
@@ -0,0 +1,175 @@
+#include "TransformKernel.h"
+#include <cstddef>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define TRANSFORM_KERNEL_SSE
+#include <xmmintrin.h>
+#endif
+
+const glm::mat4 TransformKernel::IdentityWorld = glm::mat4(1.0f);
+const glm::mat3 TransformKernel::IdentityNormal = glm::mat3(1.0f);
+
+bool TransformKernel::IsSimd() {
+	#ifdef TRANSFORM_KERNEL_SSE
+	return true;
+	#else
+	return false;
+	#endif
+}
+
+void TransformKernel::ComputeWorldMatrix(const TransformKernelItem& item) {
+	const LocalTRS& trs = *item.Local;
+	const glm::mat3 rotation = glm::mat3_cast(trs.Rotation);
+	const glm::vec3& scale = trs.Scale;
+
+	// TRS, since the scale is only along the axes we can just scale the rotation's columns
+	const glm::mat4 local(
+		glm::vec4(rotation[0] * scale.x, 0.0f),
+		glm::vec4(rotation[1] * scale.y, 0.0f),
+		glm::vec4(rotation[2] * scale.z, 0.0f),
+		glm::vec4(trs.Position, 1.0f)
+	);
+	*item.World = *item.ParentWorld * local;
+
+	// The inverse transpose of R * S is R * S^-1, and the inverse transpose of a product is the
+	// product of the inverse transposes, so we never need to invert anything
+	*item.Normal = *item.ParentNormal * glm::mat3(
+		rotation[0] / scale.x,
+		rotation[1] / scale.y,
+		rotation[2] / scale.z
+	);
+}
+
+#ifdef TRANSFORM_KERNEL_SSE
+// The SIMD path loads LocalTRS 16 bytes at a time, starting at the position, the rotation, and the rotation's w. These
+// all stay inside the struct as long as it's packed like this
+static_assert(sizeof(glm::vec3) == 12 && sizeof(glm::quat) == 16, "LocalTRS members must be tightly packed");
+static_assert(offsetof(LocalTRS, Rotation) == 12 && offsetof(LocalTRS, Scale) == 28 && sizeof(LocalTRS) == 40, "LocalTRS layout has changed");
+
+// Shorthand for a multiply-add, SSE has no fused version
+static inline __m128 MulAdd(__m128 a, __m128 b, __m128 c) {
+	return _mm_add_ps(_mm_mul_ps(a, b), c);
+}
+
+// Loads the same column from 4 matrices, and transposes them so that the result holds one row of the
+// column for each of the 4 matrices
+static inline void LoadColumnSoA(const float* a, const float* b, const float* c, const float* d, __m128 out[4]) {
+	out[0] = _mm_loadu_ps(a);
+	out[1] = _mm_loadu_ps(b);
+	out[2] = _mm_loadu_ps(c);
+	out[3] = _mm_loadu_ps(d);
+	_MM_TRANSPOSE4_PS(out[0], out[1], out[2], out[3]);
+}
+
+// Resolves 4 transforms at once, each lane of every register belongs to a different transform
+static void ComputeWorldMatrices4(const TransformKernelItem* items) {
+	const TransformKernelItem& i0 = items[0];
+	const TransformKernelItem& i1 = items[1];
+	const TransformKernelItem& i2 = items[2];
+	const TransformKernelItem& i3 = items[3];
+
+	const LocalTRS& l0 = *i0.Local;
+	const LocalTRS& l1 = *i1.Local;
+	const LocalTRS& l2 = *i2.Local;
+	const LocalTRS& l3 = *i3.Local;
+
+	// Quaternions are stored x, y, z, w so they transpose neatly
+	__m128 q[4];
+	LoadColumnSoA(&l0.Rotation.x, &l1.Rotation.x, &l2.Rotation.x, &l3.Rotation.x, q);
+	const __m128 two = _mm_set1_ps(2.0f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 qx2 = _mm_mul_ps(q[0], two);
+	const __m128 qy2 = _mm_mul_ps(q[1], two);
+	const __m128 qz2 = _mm_mul_ps(q[2], two);
+	const __m128 xx = _mm_mul_ps(q[0], qx2);
+	const __m128 yy = _mm_mul_ps(q[1], qy2);
+	const __m128 zz = _mm_mul_ps(q[2], qz2);
+	const __m128 xy = _mm_mul_ps(q[0], qy2);
+	const __m128 xz = _mm_mul_ps(q[0], qz2);
+	const __m128 yz = _mm_mul_ps(q[1], qz2);
+	const __m128 wx = _mm_mul_ps(q[3], qx2);
+	const __m128 wy = _mm_mul_ps(q[3], qy2);
+	const __m128 wz = _mm_mul_ps(q[3], qz2);
+
+	// Rotation matrix, r[column][row], matching glm::mat3_cast
+	__m128 r[3][3];
+	r[0][0] = _mm_sub_ps(one, _mm_add_ps(yy, zz));
+	r[0][1] = _mm_add_ps(xy, wz);
+	r[0][2] = _mm_sub_ps(xz, wy);
+	r[1][0] = _mm_sub_ps(xy, wz);
+	r[1][1] = _mm_sub_ps(one, _mm_add_ps(xx, zz));
+	r[1][2] = _mm_add_ps(yz, wx);
+	r[2][0] = _mm_add_ps(xz, wy);
+	r[2][1] = _mm_sub_ps(yz, wx);
+	r[2][2] = _mm_sub_ps(one, _mm_add_ps(xx, yy));
+
+	// The position is followed by the rotation's x, and the scale is preceded by it's w, so a 4 wide load of each
+	// transposes in to 3 usable rows
+	__m128 position[4];
+	LoadColumnSoA(&l0.Position.x, &l1.Position.x, &l2.Position.x, &l3.Position.x, position);
+	__m128 loaded[4];
+	LoadColumnSoA(&l0.Rotation.w, &l1.Rotation.w, &l2.Rotation.w, &l3.Rotation.w, loaded);
+	const __m128 scale[3] = { loaded[1], loaded[2], loaded[3] };
+
+	// World matrix, W = P * L where the upper 3x3 of L is R * S, and the last column is the position
+	__m128 parent[4][4];
+	for (int col = 0; col < 4; col++) {
+		LoadColumnSoA(&(*i0.ParentWorld)[col][0], &(*i1.ParentWorld)[col][0], &(*i2.ParentWorld)[col][0], &(*i3.ParentWorld)[col][0], parent[col]);
+	}
+	__m128 world[4][4];
+	for (int col = 0; col < 3; col++) {
+		const __m128 l0 = _mm_mul_ps(r[col][0], scale[col]);
+		const __m128 l1 = _mm_mul_ps(r[col][1], scale[col]);
+		const __m128 l2 = _mm_mul_ps(r[col][2], scale[col]);
+		for (int row = 0; row < 4; row++) {
+			world[col][row] = MulAdd(parent[2][row], l2, MulAdd(parent[1][row], l1, _mm_mul_ps(parent[0][row], l0)));
+		}
+	}
+	for (int row = 0; row < 4; row++) {
+		world[3][row] = MulAdd(parent[2][row], position[2], MulAdd(parent[1][row], position[1], MulAdd(parent[0][row], position[0], parent[3][row])));
+	}
+
+	// Transpose back and store, each column goes back to it's own matrix
+	for (int col = 0; col < 4; col++) {
+		_MM_TRANSPOSE4_PS(world[col][0], world[col][1], world[col][2], world[col][3]);
+		_mm_storeu_ps(&(*i0.World)[col][0], world[col][0]);
+		_mm_storeu_ps(&(*i1.World)[col][0], world[col][1]);
+		_mm_storeu_ps(&(*i2.World)[col][0], world[col][2]);
+		_mm_storeu_ps(&(*i3.World)[col][0], world[col][3]);
+	}
+
+	// Normal matrix, N = Pn * (R * S^-1), mat3 columns aren't 16 bytes wide so we gather them manually
+	__m128 parentNormal[3][3];
+	for (int col = 0; col < 3; col++) {
+		for (int row = 0; row < 3; row++) {
+			parentNormal[col][row] = _mm_setr_ps((*i0.ParentNormal)[col][row], (*i1.ParentNormal)[col][row], (*i2.ParentNormal)[col][row], (*i3.ParentNormal)[col][row]);
+		}
+	}
+	alignas(16) float normal[4];
+	for (int col = 0; col < 3; col++) {
+		const __m128 invScale = _mm_div_ps(one, scale[col]);
+		const __m128 n0 = _mm_mul_ps(r[col][0], invScale);
+		const __m128 n1 = _mm_mul_ps(r[col][1], invScale);
+		const __m128 n2 = _mm_mul_ps(r[col][2], invScale);
+		for (int row = 0; row < 3; row++) {
+			_mm_store_ps(normal, MulAdd(parentNormal[2][row], n2, MulAdd(parentNormal[1][row], n1, _mm_mul_ps(parentNormal[0][row], n0))));
+			(*i0.Normal)[col][row] = normal[0];
+			(*i1.Normal)[col][row] = normal[1];
+			(*i2.Normal)[col][row] = normal[2];
+			(*i3.Normal)[col][row] = normal[3];
+		}
+	}
+}
+#endif
+
+void TransformKernel::ComputeWorldMatrices(const TransformKernelItem* items, size_t count) {
+	size_t ix = 0;
+	#ifdef TRANSFORM_KERNEL_SSE
+	for (; ix + 4 <= count; ix += 4) {
+		ComputeWorldMatrices4(items + ix);
+	}
+	#endif
+	for (; ix < count; ix++) {
+		ComputeWorldMatrix(items[ix]);
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <GLM/glm.hpp>
+#include <GLM/gtc/quaternion.hpp>
+#include "Gameplay/LocalTRS.h"
+
+/// <summary>
+/// Describes a single transform to be resolved by the TransformKernel. The inputs may point into
+/// component storage directly, nothing is copied
+/// </summary>
+struct TransformKernelItem
+{
+	const LocalTRS*  Local;
+	// The parent's world and normal matrices, or identity for roots
+	const glm::mat4* ParentWorld;
+	const glm::mat3* ParentNormal;
+
+	glm::mat4* World;
+	glm::mat3* Normal;
+};
+
+/// <summary>
+/// Batched computation of world and normal matrices from local position, rotation and scale.
+///
+/// Where SSE is available, transforms are processed 4 at a time, with each SIMD lane holding a
+/// different transform. The normal matrix is built directly from the rotation and inverse scale,
+/// so no matrix inverse is ever needed
+/// </summary>
+class TransformKernel
+{
+public:
+	/// <summary>
+	/// Computes the world and normal matrices for a list of transforms. None of the items may
+	/// depend on the output of another item in the same call (ie. pass one hierarchy level at a time)
+	/// </summary>
+	/// <param name="items">The transforms to compute</param>
+	/// <param name="count">The number of items</param>
+	static void ComputeWorldMatrices(const TransformKernelItem* items, size_t count);
+
+	/// <summary>
+	/// Computes the world and normal matrices for a single transform without SIMD. This is used for
+	/// the remainder of a batch, and on platforms without SSE
+	/// </summary>
+	/// <param name="item">The transform to compute</param>
+	static void ComputeWorldMatrix(const TransformKernelItem& item);
+
+	/// <summary>
+	/// Returns true if the kernel was compiled with SSE support
+	/// </summary>
+	static bool IsSimd();
+
+	/// <summary>
+	/// Identity matrices that can be used as the parent of root transforms
+	/// </summary>
+	static const glm::mat4 IdentityWorld;
+	static const glm::mat3 IdentityNormal;
+};
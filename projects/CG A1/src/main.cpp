@@ -12,6 +12,12 @@
 #include <GLM/gtc/matrix_transform.hpp>
 #include <GLM/gtc/type_ptr.hpp>
 
+#include "Graphics/BufferAllocator.h"
+#include "Graphics/GeometryArena.h"
+#include "Graphics/GLStateCache.h"
+#include "Graphics/UniformBlocks.h"
+#include "Graphics/StreamingBuffer.h"
+#include "Graphics/UniformBuffer.h"
 #include "Graphics/IndexBuffer.h"
 #include "Graphics/VertexBuffer.h"
 #include "Graphics/VertexArrayObject.h"
@@ -27,11 +33,16 @@
 #include "Gameplay/GameObjectTag.h"
 #include "Gameplay/IBehaviour.h"
 #include "Gameplay/Transform.h"
+#include "Gameplay/TransformHierarchy.h"
+#include "Gameplay/WorldMatrix.h"
 #include "Graphics/Texture2D.h"
 #include "Graphics/Texture2DData.h"
+#include "Utilities/Benchmarks.h"
 #include "Utilities/InputHelpers.h"
+#include "Utilities/JobSystem.h"
 #include "Utilities/MeshBuilder.h"
 #include "Utilities/MeshFactory.h"
+#include "Utilities/MeshSimplifier.h"
 #include "Utilities/NotObjLoader.h"
 #include "Utilities/ObjLoader.h"
 #include "Utilities/VertexTypes.h"
@@ -39,6 +50,18 @@
 #include "Gameplay/ShaderMaterial.h"
 #include "Gameplay/RendererComponent.h"
 #include "Gameplay/Timing.h"
+#include "Gameplay/InterpolatedTransform.h"
+#include "Gameplay/SystemScheduler.h"
+#include "Gameplay/SceneSnapshot.h"
+#include "Gameplay/SpatialIndex.h"
+#include "Gameplay/FrustumCuller.h"
+#include "Gameplay/Occluder.h"
+#include "Gameplay/OcclusionCuller.h"
+#include "Gameplay/LODGroup.h"
+#include "Gameplay/LODSelector.h"
+#include "Gameplay/RenderSorter.h"
+#include "Gameplay/RenderBatcher.h"
+#include "Gameplay/Bounds.h"
 #include "Graphics/TextureCubeMap.h"
 #include "Graphics/TextureCubeMapData.h"
 
@@ -191,30 +214,9 @@ void RenderImGui() {
 	}
 }
 
-void RenderVAO(
-	const Shader::sptr& shader,
-	const VertexArrayObject::sptr& vao,
-	const glm::mat4& viewProjection,
-	const Transform& transform)
-{
-	shader->SetUniformMatrix("u_ModelViewProjection", viewProjection * transform.WorldTransform());
-	shader->SetUniformMatrix("u_Model", transform.WorldTransform()); 
-	shader->SetUniformMatrix("u_NormalMatrix", transform.WorldNormalMatrix());
-	vao->Render();
-}
-
-void SetupShaderForFrame(const Shader::sptr& shader, const glm::mat4& view, const glm::mat4& projection) {
-	shader->Bind();
-	// These are the uniforms that update only once per frame
-	shader->SetUniformMatrix("u_View", view);
-	shader->SetUniformMatrix("u_ViewProjection", projection * view);
-	shader->SetUniformMatrix("u_SkyboxMatrix", projection * glm::mat4(glm::mat3(view)));
-	glm::vec3 camPos = glm::inverse(view) * glm::vec4(0,0,0,1);
-	shader->SetUniform("u_CamPos", camPos);
-}
-
 int main() {
 	Logger::Init(); // We'll borrow the logger from the toolkit, but we need to initialize it
+	JobSystem::Instance().Init(); // Spin up our worker threads, one per additional core
 
 	//Initialize GLFW
 	if (!initGLFW())
@@ -239,6 +241,21 @@ int main() {
 
 	// Push another scope so most memory should be freed *before* we exit the app
 	{
+		// Runs all the per-frame work, see the Systems region below
+		SystemScheduler scheduler;
+		// An in-memory snapshot of the scene, for the debug window
+		std::string snapshot;
+		// Decides which renderers the camera can see each frame
+		FrustumCuller culler;
+		// Hides renderers that are behind the islands, after frustum culling
+		OcclusionCuller occlusion;
+		// Picks the meshes for objects with levels of detail
+		LODSelector lods;
+		// Puts the renderers in draw order
+		RenderSorter sorter;
+		// Turns the sorted renderers in to instanced draw calls
+		RenderBatcher batcher;
+
 		#pragma region Shader and ImGui
 
 		// Load our shaders
@@ -247,66 +264,41 @@ int main() {
 		shader->LoadShaderPartFromFile("shaders/frag_blinn_phong_textured.glsl", GL_FRAGMENT_SHADER);
 		shader->Link();
 
-		glm::vec3 lightPos = glm::vec3(0.0f, 0.0f, 2.0f);
-		glm::vec3 lightCol = glm::vec3(1.0f);
-		float     lightAmbientPow = 1.0f;
-		float     lightSpecularPow = 1.0f;
-		glm::vec3 ambientCol = glm::vec3(1.0f);
-		float     ambientPow = 0.5f;
-		float     lightLinearFalloff = 0.09f;
-		float     lightQuadraticFalloff = 0.032f;
-		int		  diffuseFactor = 1;
-		int		  ambientFactor = 1;
-		int		  specularFactor = 1;
-		int		  toonFactor = 1;
-
-		// These are our application / scene level uniforms that don't necessarily update
-		// every frame
-		shader->SetUniform("u_LightPos", lightPos);
-		shader->SetUniform("u_LightCol", lightCol);
-		shader->SetUniform("u_AmbientLightStrength", lightAmbientPow);
-		shader->SetUniform("u_SpecularLightStrength", lightSpecularPow);
-		shader->SetUniform("u_AmbientCol", ambientCol);
-		shader->SetUniform("u_AmbientStrength", ambientPow);
-		shader->SetUniform("u_LightAttenuationConstant", 1.0f);
-		shader->SetUniform("u_LightAttenuationLinear", lightLinearFalloff);
-		shader->SetUniform("u_LightAttenuationQuadratic", lightQuadraticFalloff);
-		shader->SetUniform("u_DiffuseFactor", diffuseFactor);
-		shader->SetUniform("u_AmbientFactor", ambientFactor);
-		shader->SetUniform("u_SpecularFactor", specularFactor);
-		shader->SetUniform("u_ToonFactor", toonFactor);
+		// These are our application / scene level uniforms, every shader shares them through uniform buffers, so
+		// they only need to be sent once per frame no matter how many shaders we switch between
+		UniformBuffer<FrameUniforms>::sptr frameUniforms = UniformBuffer<FrameUniforms>::Create(FRAME_UNIFORM_BINDING);
+		UniformBuffer<LightUniforms>::sptr lightUniforms = UniformBuffer<LightUniforms>::Create(LIGHT_UNIFORM_BINDING);
+		LightUniforms& light = lightUniforms->Data;
+		light.LightPos = glm::vec3(0.0f, 0.0f, 2.0f);
+		light.LightCol = glm::vec3(1.0f);
+		light.AmbientLightStrength = 1.0f;
+		light.SpecularLightStrength = 1.0f;
+		light.AmbientCol = glm::vec3(1.0f);
+		light.AmbientStrength = 0.5f;
+		light.LightAttenuationConstant = 1.0f;
+		light.LightAttenuationLinear = 0.09f;
+		light.LightAttenuationQuadratic = 0.032f;
+		light.DiffuseFactor = 1;
+		light.AmbientFactor = 1;
+		light.SpecularFactor = 1;
+		light.ToonFactor = 1;
 
 		// We'll add some ImGui controls to control our shader
 		imGuiCallbacks.push_back([&]() {
 			if (ImGui::CollapsingHeader("Scene Level Lighting Settings"))
 			{
-				if (ImGui::ColorPicker3("Ambient Color", glm::value_ptr(ambientCol))) {
-					shader->SetUniform("u_AmbientCol", ambientCol);
-				}
-				if (ImGui::SliderFloat("Fixed Ambient Power", &ambientPow, 0.01f, 1.0f)) {
-					shader->SetUniform("u_AmbientStrength", ambientPow);
-				}
+				// The light block is sent every frame, so we can edit it in place
+				ImGui::ColorPicker3("Ambient Color", glm::value_ptr(light.AmbientCol));
+				ImGui::SliderFloat("Fixed Ambient Power", &light.AmbientStrength, 0.01f, 1.0f);
 			}
 			if (ImGui::CollapsingHeader("Light Level Lighting Settings"))
 			{
-				if (ImGui::DragFloat3("Light Pos", glm::value_ptr(lightPos), 0.01f, -10.0f, 10.0f)) {
-					shader->SetUniform("u_LightPos", lightPos);
-				}
-				if (ImGui::ColorPicker3("Light Col", glm::value_ptr(lightCol))) {
-					shader->SetUniform("u_LightCol", lightCol);
-				}
-				if (ImGui::SliderFloat("Light Ambient Power", &lightAmbientPow, 0.0f, 1.0f)) {
-					shader->SetUniform("u_AmbientLightStrength", lightAmbientPow);
-				}
-				if (ImGui::SliderFloat("Light Specular Power", &lightSpecularPow, 0.0f, 1.0f)) {
-					shader->SetUniform("u_SpecularLightStrength", lightSpecularPow);
-				}
-				if (ImGui::DragFloat("Light Linear Falloff", &lightLinearFalloff, 0.01f, 0.0f, 1.0f)) {
-					shader->SetUniform("u_LightAttenuationLinear", lightLinearFalloff);
-				}
-				if (ImGui::DragFloat("Light Quadratic Falloff", &lightQuadraticFalloff, 0.01f, 0.0f, 1.0f)) {
-					shader->SetUniform("u_LightAttenuationQuadratic", lightQuadraticFalloff);
-				}
+				ImGui::DragFloat3("Light Pos", glm::value_ptr(light.LightPos), 0.01f, -10.0f, 10.0f);
+				ImGui::ColorPicker3("Light Col", glm::value_ptr(light.LightCol));
+				ImGui::SliderFloat("Light Ambient Power", &light.AmbientLightStrength, 0.0f, 1.0f);
+				ImGui::SliderFloat("Light Specular Power", &light.SpecularLightStrength, 0.0f, 1.0f);
+				ImGui::DragFloat("Light Linear Falloff", &light.LightAttenuationLinear, 0.01f, 0.0f, 1.0f);
+				ImGui::DragFloat("Light Quadratic Falloff", &light.LightAttenuationQuadratic, 0.01f, 0.0f, 1.0f);
 			}
 
 			auto name = controllables[selectedVao].get<GameObjectTag>().Name;
@@ -326,38 +318,180 @@ int main() {
 			}
 			ImGui::PlotLines("FPS", fpsBuffer, 128);
 			ImGui::Text("MIN: %f MAX: %f AVG: %f", minFps, maxFps, avgFps / 128.0f);
+			ImGui::Text("Fixed steps: %d (alpha %.2f, %.2fs dropped)", Timing::Instance().FixedStepsThisFrame, Timing::Instance().FixedAlpha, Timing::Instance().DroppedTime);
 
 			if (ImGui::Button("Diffuse"))
 			{
-				if (diffuseFactor == 1)
-					diffuseFactor = 0;
-				else if (diffuseFactor == 0)
-					diffuseFactor = 1;
-				shader->SetUniform("u_DiffuseFactor", diffuseFactor);
+				if (light.DiffuseFactor == 1)
+					light.DiffuseFactor = 0;
+				else if (light.DiffuseFactor == 0)
+					light.DiffuseFactor = 1;
 			}
 			if (ImGui::Button("Ambient"))
 			{
-				if (ambientFactor == 1)
-					ambientFactor = 0;
-				else if (ambientFactor == 0)
-					ambientFactor = 1;
-				shader->SetUniform("u_AmbientFactor", ambientFactor);
+				if (light.AmbientFactor == 1)
+					light.AmbientFactor = 0;
+				else if (light.AmbientFactor == 0)
+					light.AmbientFactor = 1;
 			}
 			if (ImGui::Button("Specular"))
 			{
-				if (specularFactor == 1)
-					specularFactor = 0;
-				else if (specularFactor == 0)
-					specularFactor = 1;
-				shader->SetUniform("u_SpecularFactor", specularFactor);
+				if (light.SpecularFactor == 1)
+					light.SpecularFactor = 0;
+				else if (light.SpecularFactor == 0)
+					light.SpecularFactor = 1;
 			}
 			if (ImGui::Button("Toon"))
 			{
-				if (toonFactor == 1)
-					toonFactor = 0;
-				else if (toonFactor == 0)
-					toonFactor = 1;
-				shader->SetUniform("u_ToonFactor", toonFactor);
+				if (light.ToonFactor == 1)
+					light.ToonFactor = 0;
+				else if (light.ToonFactor == 0)
+					light.ToonFactor = 1;
+			}
+
+			if (ImGui::CollapsingHeader("Benchmarks"))
+			{
+				// Results are written to the log
+				if (ImGui::Button("Transform Update")) {
+					Benchmarks::TransformUpdate();
+				}
+				if (ImGui::Button("Prefab Spawning")) {
+					Benchmarks::PrefabSpawn();
+				}
+				if (ImGui::Button("Scene Snapshots")) {
+					Benchmarks::SceneSnapshots();
+				}
+				if (ImGui::Button("Spatial Queries")) {
+					Benchmarks::SpatialQueries();
+				}
+				if (ImGui::Button("Frustum Culling")) {
+					Benchmarks::FrustumCulling();
+				}
+				if (ImGui::Button("Occlusion Culling")) {
+					Benchmarks::OcclusionCulling();
+				}
+				if (ImGui::Button("Render Sort")) {
+					Benchmarks::RenderSort();
+				}
+				if (ImGui::Button("Material Parameters")) {
+					Benchmarks::MaterialParams();
+				}
+				if (ImGui::Button("Command Replay")) {
+					Benchmarks::CommandReplay();
+				}
+				if (ImGui::Button("Debug Primitives")) {
+					Benchmarks::DebugPrimitives();
+				}
+			}
+
+			if (ImGui::CollapsingHeader("Snapshots"))
+			{
+				GameScene::sptr scene = Application::Instance().ActiveScene;
+				if (ImGui::Button("Take Snapshot")) {
+					scene->Poll();
+					snapshot = SceneSnapshot::Save(*scene);
+					LOG_INFO("Took a scene snapshot, {} bytes", snapshot.size());
+				}
+				if (!snapshot.empty()) {
+					ImGui::SameLine();
+					if (ImGui::Button("Restore Snapshot")) {
+						scene->Poll();
+						SceneSnapshot::Load(*scene, snapshot);
+					}
+				}
+			}
+
+			if (ImGui::CollapsingHeader("Culling"))
+			{
+				ImGui::Checkbox("Frustum Culling", &culler.Enabled);
+				ImGui::Checkbox("Parallel", &culler.Parallel);
+				const CullingStats& stats = culler.GetStats();
+				ImGui::Text("Visible: %d / %d (%d culled)", (int)stats.Visible, (int)stats.Tested, (int)stats.Culled);
+				ImGui::Text("Time: %.3f ms (%s)", stats.Ms, FrustumCuller::IsSimd() ? "SSE" : "scalar");
+				ImGui::Separator();
+				ImGui::Checkbox("Occlusion Culling", &occlusion.Enabled);
+				const OcclusionStats& occlusionStats = occlusion.GetStats();
+				ImGui::Text("Occluders: %d (%d triangles)", (int)occlusionStats.Occluders, (int)occlusionStats.Triangles);
+				ImGui::Text("Occluded: %d / %d", (int)occlusionStats.Occluded, (int)occlusionStats.Tested);
+				ImGui::Text("Raster: %.3f ms, Test: %.3f ms", occlusionStats.RasterMs, occlusionStats.TestMs);
+			}
+
+			if (ImGui::CollapsingHeader("Render Sort"))
+			{
+				ImGui::Checkbox("Opaque Front to Back", &sorter.OpaqueDepthSort);
+				const RenderSortStats& stats = sorter.GetStats();
+				ImGui::Text("Draws: %d", (int)stats.Draws);
+				ImGui::Text("Method: %s (%d moved)", (~stats.Method).c_str(), (int)stats.Moved);
+				ImGui::Text("Time: %.3f ms", stats.Ms);
+			}
+
+			if (ImGui::CollapsingHeader("Instancing"))
+			{
+				ImGui::Checkbox("Enabled##Instancing", &batcher.Enabled);
+				ImGui::Checkbox("Multi-draw static geometry", &batcher.MultiDraw);
+				const BatchingStats& stats = batcher.GetStats();
+				ImGui::Text("Draw calls: %d for %d renderers", (int)stats.Batches, (int)stats.Renderers);
+				ImGui::Text("Instanced: %d", (int)stats.Instanced);
+				ImGui::Text("Multi-draws: %d (%d commands)", (int)stats.MultiDraws, (int)stats.Commands);
+				ImGui::Text("Time: %.3f ms", stats.Ms);
+			}
+
+			if (ImGui::CollapsingHeader("Streaming"))
+			{
+				// The counters add up forever, so we show the change since the last time the UI was drawn
+				static TTK::StreamingStats previous;
+				const TTK::StreamingStats& stats = TTK::StreamingBuffer::GetTotalStats();
+				ImGui::Text("Uploaded: %.1f KB this frame (%d uploads)", (stats.Bytes - previous.Bytes) / 1024.0f, (int)(stats.Allocations - previous.Allocations));
+				ImGui::Text("Region wraps: %d", (int)stats.Wraps);
+				ImGui::Text("Stalls: %d (%.3f ms this frame, %.3f ms total)", (int)stats.Stalls, stats.StallMs - previous.StallMs, stats.StallMs);
+				previous = stats;
+			}
+
+			if (ImGui::CollapsingHeader("GL State"))
+			{
+				const GLStateStats& stats = GLStateCache::Instance().GetStats();
+				ImGui::Text("State changes: %d", (int)stats.Calls);
+				ImGui::Text("Redundant changes skipped: %d", (int)stats.Skipped);
+			}
+
+			if (ImGui::CollapsingHeader("Buffer Allocator"))
+			{
+				BufferAllocator& allocator = BufferAllocator::Instance();
+				ImGui::Checkbox("Sub-allocate static buffers", &allocator.Enabled);
+				const BufferAllocatorStats stats = allocator.GetStats();
+				ImGui::Text("Pages: %d (%.1f MB)", (int)stats.Pages, stats.ReservedBytes / (1024.0f * 1024.0f));
+				ImGui::Text("Allocations: %d", (int)stats.Allocations);
+				ImGui::Text("Requested: %.1f KB, allocated: %.1f KB", stats.RequestedBytes / 1024.0f, stats.AllocatedBytes / 1024.0f);
+				ImGui::Text("Largest free block: %.1f KB", stats.LargestFree / 1024.0f);
+				if (ImGui::Button("Defragment")) {
+					allocator.Defragment();
+				}
+				ImGui::SameLine();
+				ImGui::Text("Moved: %d", (int)stats.Moved);
+			}
+
+			if (ImGui::CollapsingHeader("Level of Detail"))
+			{
+				ImGui::Checkbox("Enabled##LOD", &lods.Enabled);
+				ImGui::SliderFloat("Bias", &lods.Bias, 0.1f, 4.0f);
+				const LODStats& stats = lods.GetStats();
+				ImGui::Text("Groups: %d (%d changed, %d fading)", (int)stats.Groups, (int)stats.Changed, (int)stats.Fading);
+				for (size_t ix = 0; ix < stats.LevelCounts.size(); ix++) {
+					ImGui::BulletText("LOD %d: %d", (int)ix, (int)stats.LevelCounts[ix]);
+				}
+				ImGui::Text("Time: %.3f ms", stats.Ms);
+			}
+
+			if (ImGui::CollapsingHeader("Systems"))
+			{
+				SystemPhase phase = SystemPhase::Input;
+				for (const SystemScheduler::SystemStats& stats : scheduler.GetStats()) {
+					if (stats.Phase != phase || &stats == &scheduler.GetStats().front()) {
+						phase = stats.Phase;
+						ImGui::Text("%s: %.3f ms", (~phase).c_str(), scheduler.GetPhaseMs(phase));
+					}
+					ImGui::BulletText("%s: %.3f ms (x%d)", stats.Name.c_str(), stats.AverageMs, stats.Runs);
+				}
 			}
 
 			});
@@ -365,9 +499,10 @@ int main() {
 		#pragma endregion 
 
 		// GL states
-		glEnable(GL_DEPTH_TEST);
-		glDisable(GL_CULL_FACE);
-		glDepthFunc(GL_LEQUAL); // New 
+		GLStateCache& glState = GLStateCache::Instance();
+		glState.SetEnabled(GL_DEPTH_TEST, true);
+		glState.SetEnabled(GL_CULL_FACE, false);
+		glState.SetDepthFunc(GL_LEQUAL); // New 
 
 		#pragma region TEXTURE LOADING
 
@@ -400,16 +535,22 @@ int main() {
 		
 		// We need to tell our scene system what extra component types we want to support
 		GameScene::RegisterComponentType<RendererComponent>();
-		GameScene::RegisterComponentType<BehaviourBinding>();
 		GameScene::RegisterComponentType<Camera>();
+		GameScene::RegisterComponentType<Occluder>();
+		SceneSnapshot::RegisterComponentType<Camera>();
+		SceneSnapshot::RegisterComponentType<Occluder>();
 
 		// Create a scene, and set it to be the active scene in the application
 		GameScene::sptr scene = GameScene::Create("test");
 		Application::Instance().ActiveScene = scene;
+		// Let the behaviours add their own controls to the debug window
+		imGuiCallbacks.push_back([&]() {
+			BehaviourBinding::RenderGUI(*scene);
+		});
 
 		// We can create a group ahead of time to make iterating on the group faster
-		entt::basic_group<entt::entity, entt::exclude_t<>, entt::get_t<Transform>, RendererComponent> renderGroup =
-			scene->Registry().group<RendererComponent>(entt::get_t<Transform>());
+		entt::basic_group<entt::entity, entt::exclude_t<InactiveTag>, entt::get_t<WorldMatrix, WorldNormalMatrix>, RendererComponent> renderGroup =
+			scene->Registry().group<RendererComponent>(entt::get_t<WorldMatrix, WorldNormalMatrix>(), entt::exclude_t<InactiveTag>());
 
 		// Create a material and set some properties for it
 		ShaderMaterial::sptr material0 = ShaderMaterial::Create();  
@@ -463,15 +604,6 @@ int main() {
 		material1->Set("s_Specular", specular);
 		material1->Set("s_Reflectivity", reflectivity); 
 		material1->Set("s_Environment", environmentMap); 
-		material1->Set("u_LightPos", lightPos);
-		material1->Set("u_LightCol", lightCol);
-		material1->Set("u_AmbientLightStrength", lightAmbientPow); 
-		material1->Set("u_SpecularLightStrength", lightSpecularPow); 
-		material1->Set("u_AmbientCol", ambientCol);
-		material1->Set("u_AmbientStrength", ambientPow);
-		material1->Set("u_LightAttenuationConstant", 1.0f);
-		material1->Set("u_LightAttenuationLinear", lightLinearFalloff);
-		material1->Set("u_LightAttenuationQuadratic", lightQuadraticFalloff);
 		material1->Set("u_Shininess", 8.0f);
 		material1->Set("u_TextureMix", 0.5f);
 		material1->Set("u_EnvironmentRotation", glm::mat3(glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1, 0, 0))));
@@ -481,109 +613,163 @@ int main() {
 		reflectiveMat->Set("s_Environment", environmentMap);
 		reflectiveMat->Set("u_EnvironmentRotation", glm::mat3(glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1, 0, 0))));
 
+		// Snapshots refer to meshes and materials by name, so anything used by a renderer needs to be registered
+		SceneSnapshot::RegisterAsset("material0", material0);
+		SceneSnapshot::RegisterAsset("island", islandMat);
+		SceneSnapshot::RegisterAsset("sword", swordMat);
+		SceneSnapshot::RegisterAsset("stone", stoneMat);
+		SceneSnapshot::RegisterAsset("material1", material1);
+		SceneSnapshot::RegisterAsset("reflective", reflectiveMat);
+
+		// The islands are big and solid, so they make good occluders. We only need their positions for that
+		MeshBuilder<VertexPosNormTexCol> islandMesh;
+		ObjLoader::LoadFromFile("models/plains island.obj", islandMesh);
+		OccluderMesh::sptr islandOccluder = OccluderMesh::Create(islandMesh);
+		// The islands and their levels of detail never change, so they go in to one arena. Islands at any level of
+		// detail can then be drawn together with a single multi-draw
+		GeometryArena::sptr staticGeometry = GeometryArena::Create(VertexPosNormTexCol::V_DECL, sizeof(VertexPosNormTexCol), islandMesh.GetVertexCount() * 2, islandMesh.GetIndexCount() * 2);
+		// All the islands share one mesh, so that they can be drawn with a single instanced draw call
+		VertexArrayObject::sptr islandVao = islandMesh.Bake(*staticGeometry);
+		SceneSnapshot::RegisterAsset("island", islandVao);
+
+		// Simpler versions of the islands for when they are far away, the occluder stays at full detail
+		std::vector<SimplifiedMesh> islandChain = MeshSimplifier::GenerateLODChain(islandMesh, { 0.5f, 0.25f, 0.1f });
+		std::vector<VertexArrayObject::sptr> islandLods;
+		for (size_t ix = 0; ix < islandChain.size(); ix++) {
+			const SimplifyResult& result = islandChain[ix].Result;
+			LOG_INFO("Island LOD {}: {} -> {} triangles, error {:.4f}", ix + 1, result.InputTriangles, result.OutputTriangles, result.Error);
+			islandLods.push_back(islandChain[ix].Mesh.Bake(*staticGeometry));
+			SceneSnapshot::RegisterAsset("island_lod" + std::to_string(ix + 1), islandLods.back());
+		}
+		// The error is a fraction of the mesh's size, and the sphere's diameter is about that size, so on a 1080 pixel
+		// tall screen a level's error is about 1 pixel when the coverage is 1 / (1080 * error)
+		auto addIslandLods = [&](GameObject& island, const VertexArrayObject::sptr& fullDetail) {
+			LODGroup& group = island.emplace<LODGroup>();
+			group.FadeDuration = 0.25f;
+			group.AddLevel(fullDetail, 0.0f);
+			for (size_t ix = 0; ix < islandLods.size(); ix++) {
+				group.Levels[ix].ScreenCoverage = 1.0f / (1080.0f * glm::max(islandChain[ix].Result.Error, 1e-6f));
+				group.AddLevel(islandLods[ix], 0.0f);
+			}
+		};
+
 		GameObject islandObj = scene->CreateEntity("scene_geo");
 		{
-			VertexArrayObject::sptr sceneVao = ObjLoader::LoadFromFile("models/plains island.obj");
-			islandObj.emplace<RendererComponent>().SetMesh(sceneVao).SetMaterial(islandMat);
+			islandObj.emplace<RendererComponent>().SetMesh(islandVao).SetMaterial(islandMat);
+			islandObj.emplace<Occluder>(islandOccluder);
+			addIslandLods(islandObj, islandVao);
 			islandObj.get<Transform>().SetLocalPosition(0.0f, 0.0f, 0.0f);
 			islandObj.get<Transform>().SetLocalRotation(90.0f, 0.0f, 0.0f);
 
-			auto pathing = BehaviourBinding::Bind<FollowPathBehaviour>(islandObj);
+			FollowPathBehaviour& pathing = BehaviourBinding::Bind<FollowPathBehaviour>(islandObj);
+			islandObj.emplace<InterpolatedTransform>();
 			// Set up a path for the object to follow
-			pathing->Points.push_back({ 0.0f, 0.0f, 0.1f });
-			pathing->Points.push_back({ 0.0f, 0.0f, 0.0f });
-			pathing->Speed = 0.05f;
+			pathing.Points.push_back({ 0.0f, 0.0f, 0.1f });
+			pathing.Points.push_back({ 0.0f, 0.0f, 0.0f });
+			pathing.Speed = 0.05f;
 		}
 
 		GameObject islandObj2 = scene->CreateEntity("scene_geo");
 		{
-			VertexArrayObject::sptr sceneVao = ObjLoader::LoadFromFile("models/plains island.obj");
-			islandObj2.emplace<RendererComponent>().SetMesh(sceneVao).SetMaterial(islandMat);
+			islandObj2.emplace<RendererComponent>().SetMesh(islandVao).SetMaterial(islandMat);
+			islandObj2.emplace<Occluder>(islandOccluder);
+			addIslandLods(islandObj2, islandVao);
 			islandObj2.get<Transform>().SetLocalPosition(50.0f, 40.0f, 10.0f);
 			islandObj2.get<Transform>().SetLocalRotation(90.0f, 0.0f, 0.0f);
 
-			auto pathing = BehaviourBinding::Bind<FollowPathBehaviour>(islandObj2);
+			FollowPathBehaviour& pathing = BehaviourBinding::Bind<FollowPathBehaviour>(islandObj2);
+			islandObj2.emplace<InterpolatedTransform>();
 			// Set up a path for the object to follow
-			pathing->Points.push_back({ 50.0f, 40.0f, 13.0f });
-			pathing->Points.push_back({ 50.0f, 40.0f, 10.0f });
-			pathing->Speed = 1.0f;
+			pathing.Points.push_back({ 50.0f, 40.0f, 13.0f });
+			pathing.Points.push_back({ 50.0f, 40.0f, 10.0f });
+			pathing.Speed = 1.0f;
 		}
 
 		GameObject islandObj3 = scene->CreateEntity("scene_geo");
 		{
-			VertexArrayObject::sptr sceneVao = ObjLoader::LoadFromFile("models/plains island.obj");
-			islandObj3.emplace<RendererComponent>().SetMesh(sceneVao).SetMaterial(islandMat);
+			islandObj3.emplace<RendererComponent>().SetMesh(islandVao).SetMaterial(islandMat);
+			islandObj3.emplace<Occluder>(islandOccluder);
+			addIslandLods(islandObj3, islandVao);
 			islandObj3.get<Transform>().SetLocalPosition(-50.0f, -40.0f, 11.0f);
 			islandObj3.get<Transform>().SetLocalRotation(90.0f, 0.0f, 0.0f);
 			islandObj3.get<Transform>().SetLocalScale(glm::vec3(0.5f));
 
-			auto pathing = BehaviourBinding::Bind<FollowPathBehaviour>(islandObj3);
+			FollowPathBehaviour& pathing = BehaviourBinding::Bind<FollowPathBehaviour>(islandObj3);
+			islandObj3.emplace<InterpolatedTransform>();
 			// Set up a path for the object to follow
-			pathing->Points.push_back({ -50.0f, -40.0f, 14.0f });
-			pathing->Points.push_back({ -50.0f, -40.0f, 11.0f });
-			pathing->Speed = 1.0f;
+			pathing.Points.push_back({ -50.0f, -40.0f, 14.0f });
+			pathing.Points.push_back({ -50.0f, -40.0f, 11.0f });
+			pathing.Speed = 1.0f;
 		}
 
 		GameObject islandObj4 = scene->CreateEntity("scene_geo");
 		{
-			VertexArrayObject::sptr sceneVao = ObjLoader::LoadFromFile("models/plains island.obj");
-			islandObj4.emplace<RendererComponent>().SetMesh(sceneVao).SetMaterial(islandMat);
+			islandObj4.emplace<RendererComponent>().SetMesh(islandVao).SetMaterial(islandMat);
+			islandObj4.emplace<Occluder>(islandOccluder);
+			addIslandLods(islandObj4, islandVao);
 			islandObj4.get<Transform>().SetLocalPosition(-50.0f, 40.0f, 5.0f);
 			islandObj4.get<Transform>().SetLocalRotation(90.0f, 0.0f, 0.0f);
 			islandObj4.get<Transform>().SetLocalScale(glm::vec3(0.75f));
 
-			auto pathing = BehaviourBinding::Bind<FollowPathBehaviour>(islandObj4);
+			FollowPathBehaviour& pathing = BehaviourBinding::Bind<FollowPathBehaviour>(islandObj4);
+			islandObj4.emplace<InterpolatedTransform>();
 			// Set up a path for the object to follow
-			pathing->Points.push_back({ -50.0f, 40.0f, 8.0f });
-			pathing->Points.push_back({ -50.0f, 40.0f, 5.0f });
-			pathing->Speed = 1.0f;
+			pathing.Points.push_back({ -50.0f, 40.0f, 8.0f });
+			pathing.Points.push_back({ -50.0f, 40.0f, 5.0f });
+			pathing.Speed = 1.0f;
 		}
 
 		GameObject islandObj5 = scene->CreateEntity("scene_geo");
 		{
-			VertexArrayObject::sptr sceneVao = ObjLoader::LoadFromFile("models/plains island.obj");
-			islandObj5.emplace<RendererComponent>().SetMesh(sceneVao).SetMaterial(islandMat);
+			islandObj5.emplace<RendererComponent>().SetMesh(islandVao).SetMaterial(islandMat);
+			islandObj5.emplace<Occluder>(islandOccluder);
+			addIslandLods(islandObj5, islandVao);
 			islandObj5.get<Transform>().SetLocalPosition(50.0f, -40.0f, 8.0f);
 			islandObj5.get<Transform>().SetLocalRotation(90.0f, 0.0f, 0.0f);
 			islandObj5.get<Transform>().SetLocalScale(glm::vec3(1.5f));
 
-			auto pathing = BehaviourBinding::Bind<FollowPathBehaviour>(islandObj5);
+			FollowPathBehaviour& pathing = BehaviourBinding::Bind<FollowPathBehaviour>(islandObj5);
+			islandObj5.emplace<InterpolatedTransform>();
 			// Set up a path for the object to follow
-			pathing->Points.push_back({ 50.0f, -40.0f, 11.0f });
-			pathing->Points.push_back({ 50.0f, -40.0f, 8.0f });
-			pathing->Speed = 1.0f;
+			pathing.Points.push_back({ 50.0f, -40.0f, 11.0f });
+			pathing.Points.push_back({ 50.0f, -40.0f, 8.0f });
+			pathing.Speed = 1.0f;
 		}
 
 		GameObject swordObj = scene->CreateEntity("sword");
 		{
 			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/Sword.obj");
+			SceneSnapshot::RegisterAsset("sword", vao);
 			swordObj.emplace<RendererComponent>().SetMesh(vao).SetMaterial(swordMat);
 			swordObj.get<Transform>().SetLocalPosition(0.0f, 0.0f, 2.5f);
 			swordObj.get<Transform>().SetLocalRotation(90.0f, 170.0f, 0.0f);
 			swordObj.get<Transform>().SetLocalScale(0.1f, 0.1f, 0.1f);
 			BehaviourBinding::BindDisabled<SimpleMoveBehaviour>(swordObj);
 
-			auto pathing = BehaviourBinding::Bind<FollowPathBehaviour>(swordObj);
+			FollowPathBehaviour& pathing = BehaviourBinding::Bind<FollowPathBehaviour>(swordObj);
+			swordObj.emplace<InterpolatedTransform>();
 			// Set up a path for the object to follow
-			pathing->Points.push_back({ 0.0f, 0.0f, 2.6f });
-			pathing->Points.push_back({ 0.0f, 0.0f, 2.5f });
-			pathing->Speed = 0.05f;
+			pathing.Points.push_back({ 0.0f, 0.0f, 2.6f });
+			pathing.Points.push_back({ 0.0f, 0.0f, 2.5f });
+			pathing.Speed = 0.05f;
 		}
 
 		GameObject stoneObj = scene->CreateEntity("stone");
 		{
 			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/monkey.obj");
+			SceneSnapshot::RegisterAsset("monkey", vao);
 			stoneObj.emplace<RendererComponent>().SetMesh(vao).SetMaterial(stoneMat);
 			stoneObj.get<Transform>().SetLocalPosition(0.0f, 0.0f, -0.3f);
 			stoneObj.get<Transform>().SetLocalRotation(0.0f, 0.0f, 0.0f);
 			stoneObj.get<Transform>().SetLocalScale(glm::vec3(2.0f));
 			BehaviourBinding::BindDisabled<SimpleMoveBehaviour>(stoneObj);
 
-			auto pathing = BehaviourBinding::Bind<FollowPathBehaviour>(stoneObj);
+			FollowPathBehaviour& pathing = BehaviourBinding::Bind<FollowPathBehaviour>(stoneObj);
+			stoneObj.emplace<InterpolatedTransform>();
 			// Set up a path for the object to follow
-			pathing->Points.push_back({ 0.0f, 0.0f, -0.2f });
-			pathing->Points.push_back({ 0.0f, 0.0f, -0.3f });
-			pathing->Speed = 0.05f;
+			pathing.Points.push_back({ 0.0f, 0.0f, -0.2f });
+			pathing.Points.push_back({ 0.0f, 0.0f, -0.3f });
+			pathing.Speed = 0.05f;
 		}
 		
 		// Create an object to be our camera
@@ -617,11 +803,15 @@ int main() {
 			skyboxMat->Set("s_Environment", environmentMap);
 			skyboxMat->Set("u_EnvironmentRotation", glm::mat3(glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1, 0, 0))));
 			skyboxMat->RenderLayer = 100;
+			// The skybox is always drawn around the camera, no matter where it's object is
+			skyboxMat->IsCullable = false;
+			SceneSnapshot::RegisterAsset("skybox", skyboxMat);
 
 			MeshBuilder<VertexPosNormTexCol> mesh;
 			MeshFactory::AddIcoSphere(mesh, glm::vec3(0.0f), 1.0f);
 			MeshFactory::InvertFaces(mesh);
 			VertexArrayObject::sptr meshVao = mesh.Bake();
+			SceneSnapshot::RegisterAsset("skybox", meshVao);
 			
 			GameObject skyboxObj = scene->CreateEntity("skybox");  
 			skyboxObj.get<Transform>().SetLocalPosition(0.0f, 0.0f, 0.0f);
@@ -669,24 +859,19 @@ int main() {
 		Timing& time = Timing::Instance();
 		time.LastFrame = glfwGetTime();
 
-		///// Game loop /////
-		while (!glfwWindowShouldClose(window)) {
-			glfwPollEvents();
-
-			// Update the timing
-			time.CurrentFrame = glfwGetTime();
-			time.DeltaTime = static_cast<float>(time.CurrentFrame - time.LastFrame);
+		// Values shared between the render prep and render phases
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::mat4 viewProjection;
 
-			time.DeltaTime = time.DeltaTime > 1.0f ? 1.0f : time.DeltaTime;
-
-			// Update our FPS tracker data
-			fpsBuffer[frameIx] = 1.0f / time.DeltaTime;
-			frameIx++;
-			if (frameIx >= 128)
-				frameIx = 0;
-
-			//swordObj.get<Transform>().SetLocalRotation(swordObj.get<Transform>().GetLocalRotation() + glm::vec3(0.0f, 100.0f, 0.0f) * time.DeltaTime);
+		#pragma region Systems
 
+		// Put the simulated state back before the fixed steps run. Main thread systems run inline, so we add the worker
+		// systems for each phase first, so they can start while the main thread is busy
+		scheduler.AddSystem(SystemPhase::Input, "Restore Interpolation", SystemAccess().Read<InterpolatedTransform>().Write<Transform>(), [&]() {
+			InterpolatedTransform::Restore(scene->Registry());
+		});
+		scheduler.AddSystem(SystemPhase::Input, "Key Watchers", SystemAccess().Write<SimpleMoveBehaviour, Camera>().OnMainThread(), [&]() {
 			// We'll make sure our UI isn't focused before we start handling input for our game
 			if (!ImGui::IsAnyWindowFocused()) {
 				// We need to poll our key watchers so they can do their logic with the GLFW state
@@ -696,79 +881,145 @@ int main() {
 					watcher.Poll(window);
 				}
 			}
-
-			// Iterate over all the behaviour binding components
-			scene->Registry().view<BehaviourBinding>().each([&](entt::entity entity, BehaviourBinding& binding) {
-				// Iterate over all the behaviour scripts attached to the entity, and update them in sequence (if enabled)
-				for (const auto& behaviour : binding.Behaviours) {
-					if (behaviour->Enabled) {
-						behaviour->Update(entt::handle(scene->Registry(), entity));
-					}
-				}
-			});
+		});
+
+		// Simulation, behaviours can do anything (including GLFW calls) so they get the main thread to themselves
+		scheduler.AddSystem(SystemPhase::FixedUpdate, "Capture Interpolation", SystemAccess().Read<Transform>().Write<InterpolatedTransform>(), [&]() {
+			InterpolatedTransform::BeginFixedStep(scene->Registry());
+		});
+		scheduler.AddSystem(SystemPhase::FixedUpdate, "Behaviours", SystemAccess().AsExclusive().OnMainThread(), [&]() {
+			BehaviourBinding::FixedUpdate(*scene);
+		});
+		// Render interpolated objects part way between the last two steps
+		scheduler.AddSystem(SystemPhase::Update, "Interpolate", SystemAccess().Write<Transform, InterpolatedTransform>(), [&]() {
+			InterpolatedTransform::Interpolate(scene->Registry(), Timing::Instance().FixedAlpha);
+		});
+		scheduler.AddSystem(SystemPhase::Update, "Behaviours", SystemAccess().AsExclusive().OnMainThread(), [&]() {
+			BehaviourBinding::Update(*scene);
+		});
+		scheduler.AddSystem(SystemPhase::LateUpdate, "Behaviours", SystemAccess().AsExclusive().OnMainThread(), [&]() {
+			BehaviourBinding::LateUpdate(*scene);
+		});
+
+		// New renderers take their bounds from their mesh, so they can be found in the spatial index
+		scheduler.AddSystem(SystemPhase::TransformSync, "Renderer Bounds", SystemAccess().Read<RendererComponent>().Write<LocalBounds>().OnMainThread(), [&]() {
+			FrustumCuller::AssignRendererBounds(scene->Registry());
+		});
+		// Update the world matrices of everything that moved this frame
+		scheduler.AddSystem(SystemPhase::TransformSync, "Transform Hierarchy", SystemAccess().Read<Transform>().Write<WorldMatrix, WorldNormalMatrix>(), [&]() {
+			scene->Hierarchy().Update();
+		});
+		scheduler.AddSystem(SystemPhase::TransformSync, "Spatial Index", SystemAccess().Read<WorldMatrix, LocalBounds>().Write<WorldBounds, SpatialIndex>(), [&]() {
+			scene->Spatial().Update();
+		});
+
+		// Grab out camera info from the camera object
+		// The view and projection matrices count as part of the camera
+		scheduler.AddSystem(SystemPhase::RenderPrep, "Camera", SystemAccess().Read<Transform>().Write<Camera>(), [&]() {
+			Transform& camTransform = cameraObject.get<Transform>();
+			view = glm::inverse(camTransform.LocalTransform());
+			projection = cameraObject.get<Camera>().GetProjection();
+			viewProjection = projection * view;
+		});
+		// Swaps meshes before sorting and culling, so that they see the level that will be drawn
+		scheduler.AddSystem(SystemPhase::RenderPrep, "LOD Selection", SystemAccess().Read<WorldMatrix, Camera>().Write<LODGroup, RendererComponent, LODSelector>(), [&]() {
+			lods.Update(scene->Registry(), view, projection, Timing::Instance().DeltaTime);
+		});
+		// Sorts by render layer, then groups opaque renderers by shader, material and mesh to minimize context switches
+		// and draws them front to back, with transparent renderers back to front after them
+		scheduler.AddSystem(SystemPhase::RenderPrep, "Render Sort", SystemAccess().Read<RendererComponent, WorldMatrix, Camera>().Write<RenderSorter>(), [&]() {
+			sorter.Sort(scene->Registry(), renderGroup.begin(), renderGroup.end(), view);
+		});
+		// Runs after sorting, so the visible list is in draw order
+		scheduler.AddSystem(SystemPhase::RenderPrep, "Frustum Culling", SystemAccess().Read<RendererComponent, WorldMatrix, Camera, RenderSorter>().Write<FrustumCuller>(), [&]() {
+			culler.Cull(scene->Registry(), sorter.GetSorted().begin(), sorter.GetSorted().end(), viewProjection);
+		});
+		scheduler.AddSystem(SystemPhase::RenderPrep, "Occlusion Culling", SystemAccess().Read<Occluder, WorldMatrix, WorldBounds, RendererComponent, Camera, FrustumCuller>().Write<OcclusionCuller>(), [&]() {
+			occlusion.Cull(scene->Registry(), culler.GetVisible(), viewProjection);
+		});
+
+		// Groups the visible renderers that share a mesh and material in to instanced draws
+		scheduler.AddSystem(SystemPhase::RenderPrep, "Batching", SystemAccess().Read<RendererComponent, LODGroup, WorldMatrix, WorldNormalMatrix, OcclusionCuller>().Write<RenderBatcher>(), [&]() {
+			batcher.Build(scene->Registry(), occlusion.GetVisible());
+		});
+
+		scheduler.AddSystem(SystemPhase::Render, "Scene", SystemAccess().Read<RenderBatcher>().OnMainThread(), [&]() {
+			// Everything before this point counts towards the last frame's state changes
+			glState.NewFrame();
 
 			// Clear the screen
 			glClearColor(0.08f, 0.17f, 0.31f, 1.0f);
-			glEnable(GL_DEPTH_TEST);
+			glState.SetEnabled(GL_DEPTH_TEST, true);
 			glClearDepth(1.0f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-			// Update all world matrices for this frame
-			scene->Registry().view<Transform>().each([](entt::entity entity, Transform& t) {
-				t.UpdateWorldMatrix();
-			});
-			
-			// Grab out camera info from the camera object
-			Transform& camTransform = cameraObject.get<Transform>();
-			glm::mat4 view = glm::inverse(camTransform.LocalTransform());
-			glm::mat4 projection = cameraObject.get<Camera>().GetProjection();
-			glm::mat4 viewProjection = projection * view;
-						
-			// Sort the renderers by shader and material, we will go for a minimizing context switches approach here,
-			// but you could for instance sort front to back to optimize for fill rate if you have intensive fragment shaders
-			renderGroup.sort<RendererComponent>([](const RendererComponent& l, const RendererComponent& r) {
-				// Sort by render layer first, higher numbers get drawn last
-				if (l.Material->RenderLayer < r.Material->RenderLayer) return true;
-				if (l.Material->RenderLayer > r.Material->RenderLayer) return false;
-
-				// Sort by shader pointer next (so materials using the same shader run sequentially where possible)
-				if (l.Material->Shader < r.Material->Shader) return true;
-				if (l.Material->Shader > r.Material->Shader) return false;
-
-				// Sort by material pointer last (so we can minimize switching between materials)
-				if (l.Material < r.Material) return true;
-				if (l.Material > r.Material) return false;
-				
-				return false;
-			});
+			// Send the uniforms that every shader shares, and all the model and normal matrices for the frame in one go
+			FrameUniforms& frame = frameUniforms->Data;
+			frame.View = view;
+			frame.Projection = projection;
+			frame.ViewProjection = viewProjection;
+			frame.SkyboxMatrix = projection * glm::mat4(glm::mat3(view));
+			frame.CamPos = glm::inverse(view) * glm::vec4(0, 0, 0, 1);
+			frame.Time = static_cast<float>(Timing::Instance().CurrentFrame);
+			frame.DeltaTime = Timing::Instance().DeltaTime;
+			frameUniforms->Update();
+			lightUniforms->Update();
+			batcher.Upload();
 
 			// Start by assuming no shader or material is applied
 			Shader::sptr current = nullptr;
-			ShaderMaterial::sptr currentMat = nullptr;
+			ShaderMaterial* currentMat = nullptr;
 
-			// Iterate over the render group components and draw them
-			renderGroup.each( [&](entt::entity e, RendererComponent& renderer, Transform& transform) {
-				// If the shader has changed, set up it's uniforms
-				if (current != renderer.Material->Shader) {
-					current = renderer.Material->Shader;
+			// Iterate over the batches of renderers that survived culling and draw them
+			for (const DrawBatch& batch : batcher.GetBatches()) {
+				// If the shader has changed, bind it, the per-frame uniforms are already in the uniform buffers
+				if (current != batch.Material->Shader) {
+					current = batch.Material->Shader;
 					current->Bind();
-					SetupShaderForFrame(current, view, projection);
 				}
 				// If the material has changed, apply it
-				if (currentMat != renderer.Material) {
-					currentMat = renderer.Material;
+				if (currentMat != batch.Material) {
+					currentMat = batch.Material;
 					currentMat->Apply();
 				}
-				// Render the mesh
-				RenderVAO(renderer.Material->Shader, renderer.Mesh, viewProjection, transform);
-			});
-
+				// Runs of meshes from the same arena are drawn with one multi-draw. Objects that are switching levels of
+				// detail come in their own batches, with a fade for each level
+				if (batch.CommandCount > 0) {
+					batch.Mesh->RenderIndirect(batch.CommandCount, batch.FirstCommand);
+				} else if (batch.LodFade != 1.0f) {
+					current->SetUniform("u_LodFade", batch.LodFade);
+					batch.Mesh->RenderInstanced(batch.InstanceCount, batch.FirstInstance);
+					current->SetUniform("u_LodFade", 1.0f);
+				} else {
+					batch.Mesh->RenderInstanced(batch.InstanceCount, batch.FirstInstance);
+				}
+			}
+		});
+		scheduler.AddSystem(SystemPhase::Render, "ImGui", SystemAccess().AsExclusive().OnMainThread(), [&]() {
 			// Draw our ImGui content
 			RenderImGui();
+		});
+
+		#pragma endregion
+
+		///// Game loop /////
+		while (!glfwWindowShouldClose(window)) {
+			glfwPollEvents();
+
+			// Update the timing
+			time.BeginFrame(glfwGetTime());
+
+			// Update our FPS tracker data
+			fpsBuffer[frameIx] = 1.0f / time.DeltaTime;
+			frameIx++;
+			if (frameIx >= 128)
+				frameIx = 0;
+
+			scheduler.RunFrame();
 
 			scene->Poll();
 			glfwSwapBuffers(window);
-			time.LastFrame = time.CurrentFrame;
+			time.EndFrame();
 		}
 
 		// Nullify scene so that we can release references
@@ -776,6 +1027,10 @@ int main() {
 		ShutdownImGui();
 	}	
 
+	// Static meshes share the allocator's pages, which have to be deleted while we still have a context
+	BufferAllocator::Instance().Shutdown();
+	// Stop our worker threads before the logger goes away
+	JobSystem::Instance().Shutdown();
 	// Clean up the toolkit logger so we don't leak memory
 	Logger::Uninitialize();
 	return 0;